@@ -0,0 +1,150 @@
+#include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "LVRChunkLoadScheduler.hpp"
+
+using namespace lvr2;
+
+/**
+ * @brief Records the processed chunks. A job for the gate chunk blocks the worker
+ *        until open() is called, so requests can be queued behind it.
+ */
+class Recorder
+{
+public:
+    static constexpr size_t GATE = 1000;
+    static constexpr size_t THROWS = 2000;
+
+    void operator()(size_t id)
+    {
+        std::unique_lock<std::mutex> l(m_mutex);
+        if (id == GATE)
+        {
+            m_gateReached = true;
+            m_cond.notify_all();
+            m_cond.wait(l, [this] { return m_gateOpen; });
+            return;
+        }
+        if (id == THROWS)
+        {
+            throw std::runtime_error("chunk is broken");
+        }
+        m_processed.push_back(id);
+    }
+
+    /// blocks the worker with the gate job and waits until it is running
+    void close(ChunkLoadScheduler& scheduler)
+    {
+        std::unique_lock<std::mutex> l(m_mutex);
+        m_gateReached = false;
+        m_gateOpen = false;
+        l.unlock();
+
+        scheduler.schedule({{0.0f, GATE}});
+
+        l.lock();
+        m_cond.wait(l, [this] { return m_gateReached; });
+    }
+
+    void open()
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_gateOpen = true;
+        m_cond.notify_all();
+    }
+
+    std::vector<size_t> take()
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        std::vector<size_t> processed;
+        processed.swap(m_processed);
+        return processed;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_gateReached = false;
+    bool m_gateOpen = false;
+    std::vector<size_t> m_processed;
+};
+
+bool check(bool condition, const std::string& name)
+{
+    std::cout << (condition ? "passed: " : "FAILED: ") << name << std::endl;
+    return condition;
+}
+
+/**
+ * @brief Waits for the scheduler, but gives up after a few seconds
+ */
+bool waitIdle(ChunkLoadScheduler& scheduler)
+{
+    auto idle = std::async(std::launch::async, [&] { scheduler.wait(); });
+    return idle.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+}
+
+int main()
+{
+    bool ok = true;
+    Recorder recorder;
+
+    {
+        // A single worker processes the queue strictly in order
+        ChunkLoadScheduler scheduler([&](size_t id) { recorder(id); }, 1);
+        ok &= check(scheduler.numThreads() == 1, "one worker thread");
+
+        recorder.close(scheduler);
+        scheduler.schedule({{5.0f, 5}, {1.0f, 1}, {3.0f, 3}, {0.5f, 0}, {4.0f, 4}});
+        ok &= check(scheduler.numPending() == 5, "requests are pending behind a running job");
+        recorder.open();
+        ok &= check(waitIdle(scheduler), "wait() returns once the pool is idle");
+        ok &= check(scheduler.numPending() == 0, "no request is pending after wait()");
+        ok &= check(recorder.take() == std::vector<size_t>({0, 1, 3, 4, 5}),
+                    "requests are processed in the order of their priority");
+
+        recorder.close(scheduler);
+        scheduler.schedule({{1.0f, 10}, {2.0f, 11}});
+        scheduler.schedule({{2.0f, 21}, {1.0f, 20}});
+        recorder.open();
+        ok &= check(waitIdle(scheduler), "wait() returns after a replaced schedule");
+        ok &= check(recorder.take() == std::vector<size_t>({20, 21}),
+                    "schedule() drops the pending requests of the previous one");
+
+        recorder.close(scheduler);
+        scheduler.cancel();
+        recorder.open();
+        ok &= check(waitIdle(scheduler), "wait() returns after cancel()");
+
+        scheduler.schedule({{0.0f, Recorder::THROWS}, {1.0f, 30}});
+        ok &= check(waitIdle(scheduler), "wait() returns after a throwing job");
+        ok &= check(recorder.take() == std::vector<size_t>({30}),
+                    "a throwing job does not stop the worker");
+    }
+
+    {
+        // Jobs may still use the scheduler while it stops
+        std::unique_ptr<ChunkLoadScheduler> scheduler;
+        scheduler.reset(new ChunkLoadScheduler([&](size_t id) {
+            recorder(id);
+            scheduler->numPending();
+        }, 2));
+
+        recorder.close(*scheduler);
+        scheduler->schedule({{1.0f, 40}, {2.0f, 41}});
+        auto stopped = std::async(std::launch::async, [&] { scheduler->stop(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        recorder.open();
+        ok &= check(stopped.wait_for(std::chrono::seconds(5)) == std::future_status::ready,
+                    "stop() joins the workers");
+        scheduler.reset();
+    }
+
+    std::cout << (ok ? "All checks passed" : "Some checks failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cstdlib>
+#include <vector>
+
+#include "lvr2/geometry/BaseVector.hpp"
+#include "lvr2/geometry/HalfEdgeMesh.hpp"
+#include "lvr2/geometry/Normal.hpp"
+#include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/reconstruction/AdaptiveKSearchSurface.hpp"
+#include "lvr2/reconstruction/gs2/GrowingCellStructure.hpp"
+#include "lvr2/util/StageTimer.hpp"
+
+using namespace lvr2;
+
+using Vec = BaseVector<float>;
+
+const float RADIUS = 5.0f;
+
+/**
+ * @brief Samples points uniformly on a sphere around the origin
+ */
+PointBufferPtr createSphere(size_t numPoints)
+{
+    std::mt19937 gen(1);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+
+    floatArr points(new float[numPoints * 3]);
+    for (size_t i = 0; i < numPoints; i++)
+    {
+        Vec p = Vec(dist(gen), dist(gen), dist(gen)).normalized() * RADIUS;
+        points[i * 3]     = p.x;
+        points[i * 3 + 1] = p.y;
+        points[i * 3 + 2] = p.z;
+    }
+    return PointBufferPtr(new PointBuffer(points, numPoints));
+}
+
+/**
+ * @brief Returns the accumulated wall time of all recorded stages with the given prefix
+ */
+double stageTime(const std::string& prefix)
+{
+    double seconds = 0.0;
+    for (const StageRecord& record : StageTimerRegistry::instance().records())
+    {
+        if (record.name.compare(0, prefix.size(), prefix) == 0)
+        {
+            seconds += record.wallTime;
+        }
+    }
+    return seconds;
+}
+
+/**
+ * @brief Grows a mesh with the given batch size and prints its runtime and quality
+ */
+void run(PointsetSurfacePtr<Vec> surface, int runtime, int numSplits, int basicSteps, int batchSize)
+{
+    HalfEdgeMesh<Vec> mesh;
+    GrowingCellStructure<Vec, Normal<float>> gcs(surface);
+    gcs.setRuntime(runtime);
+    gcs.setNumSplits(numSplits);
+    gcs.setBasicSteps(basicSteps);
+    gcs.setBatchSize(batchSize);
+    gcs.setBoxFactor(0.2);
+    gcs.setWithCollapse(false);
+    gcs.setLearningRate(0.1);
+    gcs.setNeighborLearningRate(0.08);
+    gcs.setDecreaseFactor(0.999);
+    gcs.setAllowMiss(7);
+    gcs.setCollapseThreshold(0.3);
+    gcs.setFilterChain(false);
+    gcs.setDeleteLongEdgesFactor(10);
+    gcs.setInterior(false);
+    gcs.setNumBalances(20);
+
+    // the basic steps draw their samples with rand()
+    std::srand(1);
+    StageTimerRegistry::instance().clear();
+    gcs.getMesh(mesh);
+    double seconds = stageTime("gcs_growing");
+
+    // distance of the vertices to the sampled sphere
+    double meanError = 0.0, maxError = 0.0;
+    for (auto vH : mesh.vertices())
+    {
+        double error = std::abs(mesh.getVertexPosition(vH).length() - RADIUS);
+        meanError += error;
+        maxError = std::max(maxError, error);
+    }
+    meanError /= std::max<size_t>(mesh.numVertices(), 1);
+
+    std::cout << "RESULT batch " << std::setw(4) << batchSize << ": "
+              << std::fixed << std::setprecision(1) << "growing " << seconds << "s, "
+              << std::setprecision(3) << "err " << meanError << "/" << maxError << ", "
+              << std::setprecision(2) << "equilaterality " << gcs.equilaterality().second << ", "
+              << mesh.numVertices() << " vertices" << std::endl;
+}
+
+/**
+ * @brief Compares the runtime of the batched GCS basic steps with the quality of the
+ *        resulting mesh on a sampled sphere.
+ *
+ * Usage: lvr2_examples_growingcells [numPoints] [runtime] [numSplits] [basicSteps] [batch sizes...]
+ *
+ * The mesh gets runtime * numSplits vertices. The error is the mean / max distance of
+ * the vertices to the sphere, the equilaterality is GrowingCellStructure::equilaterality().
+ */
+int main(int argc, char** argv)
+{
+    size_t numPoints = argc > 1 ? std::atol(argv[1]) : 20000;
+    int runtime      = argc > 2 ? std::atoi(argv[2]) : 20;
+    int numSplits    = argc > 3 ? std::atoi(argv[3]) : 100;
+    int basicSteps   = argc > 4 ? std::atoi(argv[4]) : 200;
+
+    std::vector<int> batchSizes;
+    for (int i = 5; i < argc; i++)
+    {
+        batchSizes.push_back(std::atoi(argv[i]));
+    }
+    if (batchSizes.empty())
+    {
+        batchSizes = {1, 16, 64, 200};
+    }
+
+    PointBufferPtr buffer = createSphere(numPoints);
+    PointsetSurfacePtr<Vec> surface = std::make_shared<AdaptiveKSearchSurface<Vec>>(
+        buffer, "FLANN", 10, 10, 10, 1, "");
+    surface->calculateSurfaceNormals();
+
+    std::cout << "GCS benchmark: " << numPoints << " points on a sphere of radius " << RADIUS
+              << ", " << runtime * numSplits << " vertices, " << basicSteps
+              << " basic steps per split" << std::endl;
+
+    for (int batchSize : batchSizes)
+    {
+        run(surface, runtime, numSplits, basicSteps, batchSize);
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/registration/SLAMScanWrapper.hpp"
+#include "lvr2/registration/ICPPointAlign.hpp"
+
+using namespace lvr2;
+
+/**
+ * @brief Returns the resident memory of the process in bytes
+ */
+size_t residentMemory()
+{
+    size_t size = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Creates Scans of a wavy ground plane, each one shifted by one unit along x.
+ *        The poses are disturbed so ICP has something to correct.
+ */
+std::vector<ScanPtr> createProject(size_t numScans, size_t numPoints)
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(-20.0f, 20.0f);
+    std::uniform_real_distribution<double> noise(-0.2, 0.2);
+
+    std::vector<ScanPtr> project;
+    for (size_t s = 0; s < numScans; s++)
+    {
+        floatArr points(new float[numPoints * 3]);
+        for (size_t i = 0; i < numPoints; i++)
+        {
+            float x = dist(gen), y = dist(gen);
+            points[i * 3]     = x;
+            points[i * 3 + 1] = y;
+            points[i * 3 + 2] = std::sin((x + s) * 0.3f) + std::cos(y * 0.2f);
+        }
+
+        ScanPtr scan(new Scan);
+        scan->points = PointBufferPtr(new PointBuffer(points, numPoints));
+        scan->poseEstimation = Transformd::Identity();
+        scan->poseEstimation(0, 3) = -(double)s + noise(gen);
+        scan->poseEstimation(1, 3) = noise(gen);
+        project.push_back(scan);
+    }
+    return project;
+}
+
+/**
+ * @brief Wraps all Scans of the project and matches every Scan to its predecessor
+ */
+void run(const std::vector<ScanPtr>& project, bool sharePoints)
+{
+    size_t before = residentMemory();
+
+    std::vector<SLAMScanPtr> scans;
+    for (const ScanPtr& scan : project)
+    {
+        // like RegistrationPipeline: the project keeps its own reference to the points
+        scans.push_back(SLAMScanPtr(new SLAMScanWrapper(std::make_shared<Scan>(*scan), sharePoints)));
+    }
+
+    size_t after = residentMemory();
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 1; i < scans.size(); i++)
+    {
+        ICPPointAlign icp(scans[i - 1], scans[i]);
+        icp.setMaxMatchDistance(1.0);
+        icp.setMaxIterations(20);
+        icp.setMaxLeafSize(20);
+        icp.setEpsilon(0.00001);
+        icp.match();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << (sharePoints ? "shared" : "copied") << " points: "
+              << std::fixed << std::setprecision(2)
+              << (after - before) / 1e6 / scans.size() << " MB per scan, "
+              << seconds * 1000 / (scans.size() - 1) << " ms ICP per scan pair" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t numScans  = argc > 1 ? std::atol(argv[1]) : 10;
+    size_t numPoints = argc > 2 ? std::atol(argv[2]) : 200000;
+
+    std::cout << "Registration benchmark: " << numScans << " Scans with " << numPoints << " Points" << std::endl;
+
+    auto project = createProject(std::max<size_t>(numScans, 2), numPoints);
+
+    run(project, true);
+    run(project, false);
+
+    return 0;
+}
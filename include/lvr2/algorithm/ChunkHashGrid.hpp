@@ -42,6 +42,7 @@
 
 #include <list>
 #include <unordered_map>
+#include <vector>
 
 namespace lvr2
 {
@@ -177,6 +178,20 @@ class ChunkHashGrid
                + (j + m_chunkIndexOffset.y) * m_chunkAmount.z + k + m_chunkIndexOffset.z;
     }
 
+    /**
+     * @brief Calculates the index triple for the given hash value
+     *
+     * @param hash hash value of a chunk
+     *
+     * @return index triple of the chunk
+     */
+    inline BaseVector<int> getChunkIndex(std::size_t hash) const
+    {
+        return BaseVector<int>(hash / (m_chunkAmount.y * m_chunkAmount.z) - m_chunkIndexOffset.x,
+                               (hash / m_chunkAmount.z) % m_chunkAmount.y - m_chunkIndexOffset.y,
+                               hash % m_chunkAmount.z - m_chunkIndexOffset.z);
+    }
+
     const BoundingBox<BaseVector<float>>& getBoundingBox() const
     {
         return m_boundingBox;
@@ -192,6 +207,15 @@ class ChunkHashGrid
         return m_chunkAmount;
     }
 
+    /**
+     * @brief returns the geometric errors of the levels of detail of a layer
+     *
+     * @param layer layer of the full resolution chunks
+     *
+     * @return geometric error of every level of detail or an empty vector if the layer has none
+     */
+    const std::vector<float>& getLevelOfDetailErrors(std::string layer);
+
     /**
      * @brief returns the minimum chunk ids
      */
@@ -271,6 +295,15 @@ class ChunkHashGrid
         m_io.saveChunkSize(m_chunkSize);
     }
 
+    /**
+     * @brief sets the geometric errors of the levels of detail of a layer in this container and
+     * in persistent storage
+     *
+     * @param layer layer of the full resolution chunks
+     * @param errors geometric error of every level of detail, starting with level 0
+     */
+    void setLevelOfDetailErrors(std::string layer, const std::vector<float>& errors);
+
     // bounding box of the entire chunked model
     // i had to make this protected because of the getGlobalBoundingBox() function in ChunkManager
     BoundingBox<BaseVector<float>> m_boundingBox;
@@ -306,6 +339,9 @@ class ChunkHashGrid
 
     // offset of chunks to make chunk index start at 0
     BaseVector<std::size_t> m_chunkIndexOffset;
+
+    // geometric errors of the levels of detail per layer
+    std::unordered_map<std::string, std::vector<float>> m_lodErrors;
 };
 
 } /* namespace lvr2 */
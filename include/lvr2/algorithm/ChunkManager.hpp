@@ -44,6 +44,11 @@
 #include "lvr2/io/Model.hpp"
 #include "lvr2/types/Channel.hpp"
 
+#include <array>
+#include <atomic>
+#include <limits>
+#include <vector>
+
 namespace lvr2
 {
 
@@ -131,6 +136,33 @@ class ChunkManager : public ChunkHashGrid
                     std::string layer = std::string("mesh"));
                     
 
+    /**
+     * @brief extractArea creates and returns MeshBufferPtr of merged chunks of a level of detail
+     * for given area.
+     *
+     * Level 0 are the full resolution chunks. Use selectLevelOfDetail to pick a level for a given
+     * view.
+     *
+     * @param area bounding box of the area to request
+     * @param layer layer of the full resolution chunks
+     * @param lod level of detail created by buildLevelsOfDetail
+     * @return mesh of the given area
+     */
+    MeshBufferPtr extractArea(const BoundingBox<BaseVector<float>>& area, std::string layer, size_t lod);
+
+    /**
+     * @brief extractArea loads all chunks of a level of detail that intersect the given area.
+     *
+     * @param area bounding box of the area to request
+     * @param chunks loaded chunks, the key is the hash value of the stored chunk coordinates
+     * @param layer layer of the full resolution chunks
+     * @param lod level of detail created by buildLevelsOfDetail
+     */
+    void extractArea(const BoundingBox<BaseVector<float>>& area,
+                     std::unordered_map<std::size_t, MeshBufferPtr>& chunks,
+                     std::string layer,
+                     size_t lod);
+
     /**
      * @brief extractArea creates and returns MeshBufferPtr of merged chunks for given area after
      * filtering the resulting mesh.
@@ -156,6 +188,50 @@ class ChunkManager : public ChunkHashGrid
                               const std::map<std::string, FilterFunction> filter,
                               std::string layer = std::string("mesh"));
 
+    /**
+     * @brief buildLevelsOfDetail creates a pyramid of simplified chunks for a layer
+     *
+     * The cells of level l have a side length of chunkSize * 2^l. Every cell merges the chunks of
+     * its (up to) eight child cells of level l - 1 and simplifies them by vertex clustering.
+     * Vertices shared with other cells of the same level are locked, so neighbouring cells fit
+     * together without cracks on every level. Level l is stored in the layer returned by
+     * getLevelOfDetailLayer, the geometric error of every level is stored with the layer.
+     *
+     * @param layer layer of the full resolution chunks
+     * @param resolution number of vertex clusters along the side of a cell on every level
+     * @param levels number of levels to create, 0 creates levels until one cell covers the grid
+     */
+    void buildLevelsOfDetail(std::string layer = std::string("mesh"),
+                             unsigned int resolution = 64,
+                             size_t levels = 0);
+
+    /**
+     * @brief returns the number of levels of detail of a layer including the full resolution
+     */
+    size_t getNumLevelsOfDetail(std::string layer = std::string("mesh"));
+
+    /**
+     * @brief selectLevelOfDetail picks the coarsest level whose projected error is small enough
+     *
+     * The geometric error of a level is projected to the screen with
+     * error * projectionScale / distance.
+     *
+     * @param distance distance between the viewer and the area
+     * @param projectionScale viewport height in pixels / (2 * tan(vertical field of view / 2))
+     * @param maxScreenError maximum allowed error in pixels
+     * @param layer layer of the full resolution chunks
+     * @return level of detail to use with extractArea
+     */
+    size_t selectLevelOfDetail(float distance,
+                               float projectionScale,
+                               float maxScreenError,
+                               std::string layer = std::string("mesh"));
+
+    /**
+     * @brief returns the name of the layer holding a level of detail of the given layer
+     */
+    static std::string getLevelOfDetailLayer(const std::string& layer, size_t lod);
+
     /**
      * @brief Get all existing channels from mesh
      * 
@@ -180,35 +256,96 @@ class ChunkManager : public ChunkHashGrid
     void initBoundingBox(MeshBufferPtr mesh);
 
     /**
-     * @brief cutLargeFaces cuts a face if it is too large
+     * @brief combineChunks merges chunks into one mesh without duplicated vertices
      *
-     * Checks whether or not a triangle is overlapping the chunk borders too much and
-     * cuts those faces. The resulting smaller faces will be added as additional vertices
-     * and faces to the chunk hat holds their center point.
+     * @param chunks chunks to merge
+     * @return merged mesh
+     */
+    MeshBufferPtr combineChunks(std::unordered_map<std::size_t, MeshBufferPtr>& chunks);
+
+    /**
+     * @brief returns the number of cells per axis on a level of detail
+     */
+    BaseVector<std::size_t> getLevelOfDetailAmount(size_t lod) const;
+
+    /**
+     * @brief buildLevelOfDetailChunk merges and simplifies the chunks of one cell of a level of
+     * detail
      *
-     * @param halfEdgeMesh mesh  that is being cut
+     * @param children chunks of the child cells
+     * @param borderVertices sorted positions of the vertices shared with other cells of the level
+     * @param clusterSize side length of the vertex clusters
+     * @param maxDisplacement maximum distance between a removed vertex and its replacement
+     * @return simplified chunk, vertices shared with other cells are stored first
+     */
+    MeshBufferPtr buildLevelOfDetailChunk(const std::vector<MeshBufferPtr>& children,
+                                          const std::vector<std::array<float, 3>>& borderVertices,
+                                          float clusterSize,
+                                          float& maxDisplacement) const;
+
+    /**
+     * @brief isLargeEdge checks whether or not an edge overlaps a chunk border too much
+     *
+     * @param referenceVertex position of the vertex whose chunk border is checked
+     * @param comparedVertex position of the other vertex of the edge
      * @param overlapRatio ration of maximum allowed overlap and the chunks side length
-     * @param splitVertices map from new vertex indices to old vertex indices for all faces that
-     * will be cut
-     * @param splitFaces map from new face indices to old face indices for all faces that will be
-     * cut
+     * @return true if the edge has to be cut
      */
-    void
-    cutLargeFaces(std::shared_ptr<HalfEdgeMesh<BaseVector<float>>> halfEdgeMesh,
-                  float overlapRatio,
-                  std::shared_ptr<std::unordered_map<unsigned int, unsigned int>> splitVertices,
-                  std::shared_ptr<std::unordered_map<unsigned int, unsigned int>> splitFaces);
+    bool isLargeEdge(const float* referenceVertex,
+                     const float* comparedVertex,
+                     float overlapRatio) const;
 
     /**
-     * @brief getFaceCenter gets the center point for a given face
+     * @brief cutLargeFaces cuts faces that are too large
      *
-     * @param verticesChannel channel of mesh that holds the vertices
-     * @param facesChannel channel of mesh that holds the faces
-     * @param faceIndex index of the requested face
-     * @return center point of the given face
+     * Edges that overlap the chunk borders too much are cut in half and the faces next to them
+     * are split accordingly. This is repeated until no large edges remain.
+     *
+     * @param vertices vertex positions, new vertices are appended
+     * @param faces face indices, new faces are appended
+     * @param vertexSources original vertex whose attributes are used for every new vertex
+     * @param faceSources original face whose attributes are used for every new face
+     * @param numOriginalVertices number of vertices in the original mesh
+     * @param numOriginalFaces number of faces in the original mesh
+     * @param overlapRatio ration of maximum allowed overlap and the chunks side length
+     * @return true if any face was cut
      */
-    BaseVector<float> getFaceCenter(std::shared_ptr<HalfEdgeMesh<BaseVector<float>>> mesh,
-                                    const FaceHandle& handle) const;
+    bool cutLargeFaces(std::vector<float>& vertices,
+                       std::vector<unsigned int>& faces,
+                       std::vector<unsigned int>& vertexSources,
+                       std::vector<unsigned int>& faceSources,
+                       size_t numOriginalVertices,
+                       size_t numOriginalFaces,
+                       float overlapRatio) const;
+
+    /**
+     * @brief buildChunkMesh creates the mesh of one chunk
+     *
+     * Vertices that are shared with other chunks are placed at the beginning of the vertex
+     * array, their number is stored in the "num_duplicates" atomic.
+     *
+     * @param mesh original mesh with all attribute channels
+     * @param vertices vertex positions after cutting large faces
+     * @param faces face indices after cutting large faces
+     * @param vertexSources original vertex for every vertex added by cutLargeFaces
+     * @param faceSources original face for every face added by cutLargeFaces
+     * @param chunkFaces indices of the faces of the chunk
+     * @param numChunkFaces number of faces in the chunk
+     * @param vertexChunks owning chunk of every vertex or SHARED_VERTEX
+     * @return mesh of the chunk
+     */
+    MeshBufferPtr buildChunkMesh(MeshBufferPtr mesh,
+                                 const float* vertices,
+                                 const unsigned int* faces,
+                                 const std::vector<unsigned int>& vertexSources,
+                                 const std::vector<unsigned int>& faceSources,
+                                 const unsigned int* chunkFaces,
+                                 size_t numChunkFaces,
+                                 const std::vector<std::atomic<unsigned int>>& vertexChunks) const;
+
+    /// markers in the per-vertex chunk array of buildChunks
+    static constexpr unsigned int UNUSED_VERTEX = std::numeric_limits<unsigned int>::max();
+    static constexpr unsigned int SHARED_VERTEX = std::numeric_limits<unsigned int>::max() - 1;
 
     //    /**
     //     * @brief find corresponding grid cell of given point
@@ -124,10 +124,19 @@ void ChunkingPipeline<BaseVecT>::practicabilityAnalysis(HalfEdgeMesh<BaseVecT>&
     DenseVertexMap <Normal<float>> vertexNormals = calcVertexNormals(hem, faceNormals);
     // Calc average vertex angles
     DenseVertexMap<float> averageAngles = calcAverageVertexAngles(hem, vertexNormals);
-    // Calc roughness
-    DenseVertexMap<float> roughness = calcVertexRoughness(hem, m_roughnessRadius, vertexNormals);
-    // Calc vertex height differences
-    DenseVertexMap<float> heightDifferences = calcVertexHeightDifferences(hem, m_heightDifferencesRadius);
+    // Calc roughness and vertex height differences
+    DenseVertexMap<float> roughness;
+    DenseVertexMap<float> heightDifferences;
+    if (m_roughnessRadius == m_heightDifferencesRadius)
+    {
+        // Both share the same neighborhoods, so visit them only once
+        calcVertexRoughnessAndHeightDifferences(hem, m_roughnessRadius, vertexNormals, roughness, heightDifferences);
+    }
+    else
+    {
+        roughness = calcVertexRoughness(hem, m_roughnessRadius, vertexNormals);
+        heightDifferences = calcVertexHeightDifferences(hem, m_heightDifferencesRadius);
+    }
 
     // create and fill channels
     FloatChannel faceNormalChannel(faceNormals.numValues(), channel_type < Normal < float >> ::w);
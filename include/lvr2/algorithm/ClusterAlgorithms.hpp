@@ -157,16 +157,38 @@ BoundingRectangle<typename BaseVecT::CoordType> calculateBoundingRectangle(
 template<typename BaseVecT, typename Pred>
 ClusterBiMap<FaceHandle> clusterGrowing(const BaseMesh<BaseVecT>& mesh, Pred pred);
 
+/**
+ * @brief Parallel variant of clusterGrowing() which merges adjacent faces with a concurrent union-find.
+ *
+ * The predicate is evaluated once for every pair of adjacent faces and all pairs are processed concurrently.
+ * Two faces end up in the same cluster if they are connected by a chain of adjacent faces for which the
+ * predicate holds. Unlike clusterGrowing() there is no reference face, so the result only equals the one of
+ * clusterGrowing() for predicates which are transitive (e.g. pure connectivity).
+ *
+ * The result is deterministic: clusters are ordered by their smallest face handle and the faces of a cluster
+ * are sorted ascending, independent of the number of threads.
+ *
+ * @tparam Pred a symmetric predicate with the parameters (FaceHandle faceH, FaceHandle neighbourH) which returns
+ *         true if the two adjacent faces belong to the same cluster. It is called concurrently and must be thread
+ *         safe.
+ */
+template<typename BaseVecT, typename Pred>
+ClusterBiMap<FaceHandle> parallelClusterGrowing(const BaseMesh<BaseVecT>& mesh, Pred pred);
+
 /**
  * @brief Algorithm which generates plane clusters from the given mesh.
  * @param minSinAngle `1 - minSinAngle` is the allowed difference between the sin of the angle of the starting
  *                    face and all other faces in one cluster.
+ * @param referenceFaceCompat if true, every face is compared to the starting face of its cluster (serial
+ *                    clusterGrowing()). If false, adjacent faces are compared to each other and merged in
+ *                    parallel (parallelClusterGrowing()), so `minSinAngle` bounds the angle between neighbours.
  */
 template<typename BaseVecT>
 ClusterBiMap<FaceHandle> planarClusterGrowing(
     const BaseMesh<BaseVecT>& mesh,
     const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
-    float minSinAngle
+    float minSinAngle,
+    bool referenceFaceCompat = true
 );
 
 /**
@@ -177,6 +199,7 @@ ClusterBiMap<FaceHandle> planarClusterGrowing(
  *                    face and all other faces in one cluster.
  * @param numIterations for cluster improvement
  * @param minClusterSize minimum size for clusters (number of faces) for which a regression plane should be generated
+ * @param referenceFaceCompat see planarClusterGrowing()
  */
 template<typename BaseVecT>
 ClusterBiMap<FaceHandle> iterativePlanarClusterGrowing(
@@ -184,7 +207,8 @@ ClusterBiMap<FaceHandle> iterativePlanarClusterGrowing(
     FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
     float minSinAngle,
     int numIterations,
-    int minClusterSize
+    int minClusterSize,
+    bool referenceFaceCompat = true
 );
 
 /**
@@ -195,6 +219,7 @@ ClusterBiMap<FaceHandle> iterativePlanarClusterGrowing(
  *                    face and all other faces in one cluster.
  * @param numIterations for cluster improvement
  * @param minClusterSize minimum size for clusters (number of faces) for which a regression plane should be generated
+ * @param referenceFaceCompat see planarClusterGrowing()
  */
 template<typename BaseVecT>
 ClusterBiMap<FaceHandle> iterativePlanarClusterGrowingRANSAC(
@@ -204,7 +229,8 @@ ClusterBiMap<FaceHandle> iterativePlanarClusterGrowingRANSAC(
     int numIterations,
     int minClusterSize,
     int ransacIterations = 100,
-    int ransacSamples = 10
+    int ransacSamples = 10,
+    bool referenceFaceCompat = true
 );
 
 /// Calcs a regression plane for the given cluster
@@ -225,6 +251,24 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
     const int num_samples = 10
 );
 
+/**
+ * @brief Calcs a regression plane for the given cluster with RANSAC, drawing all samples from `gen`.
+ *
+ * The samples of all trials are drawn up front, so the result only depends on the state of `gen`. If
+ * `parallelTrials` is true, the trials are evaluated in parallel; ties between trials are resolved in favor
+ * of the earlier one, just like in the serial case.
+ */
+template<typename BaseVecT, typename RandomGenerator>
+Plane<BaseVecT> calcRegressionPlaneRANSAC(
+    const BaseMesh<BaseVecT>& mesh,
+    const Cluster<FaceHandle>& cluster,
+    const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
+    const int num_iterations,
+    const int num_samples,
+    RandomGenerator& gen,
+    bool parallelTrials = false
+);
+
 /// Calcs a regression plane for the given cluster
 template<typename BaseVecT>
 Plane<BaseVecT> calcRegressionPlanePCA(
@@ -250,6 +294,11 @@ DenseClusterMap<Plane<BaseVecT>> calcRegressionPlanes(
 
 /**
  * @brief Calcs regression planes for all cluster in clusters
+ *
+ * Clusters are processed in parallel. Each cluster uses its own random generator which is seeded from its
+ * cluster handle, so the result is reproducible and independent of the number of threads. Clusters which are
+ * large enough to dominate the run time evaluate their RANSAC trials in parallel instead.
+ *
  * @param minClusterSize minimum size for clusters (number of faces) for which a regression plane should be generated
  * @return map from cluster handle to its regression plane (clusterH -> Plane)
  */
@@ -272,7 +321,12 @@ void dragToRegressionPlane(
     FaceMap<Normal<typename BaseVecT::CoordType>>& normals
 );
 
-/// Drags all points from the given clusters into their regression planes
+/**
+ * @brief Drags all points from the given clusters into their regression planes
+ *
+ * Runs in two conflict-free parallel passes: first every vertex is projected onto the planes of all clusters
+ * it belongs to (in the iteration order of `planes`), then the face normals are set.
+ */
 template<typename BaseVecT>
 void dragToRegressionPlanes(
     BaseMesh<BaseVecT>& mesh,
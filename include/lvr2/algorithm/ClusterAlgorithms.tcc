@@ -41,15 +41,18 @@
 #include "lvr2/util/Random.hpp"
 #include "lvr2/geometry/Normal.hpp"
 #include "lvr2/util/Debug.hpp"
+#include "lvr2/util/Parallel.hpp"
 
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/io/Timestamp.hpp"
+#include "lvr2/config/lvropenmp.hpp"
 
 #include <algorithm>
 #include <complex>
 #include <sstream>
 #include <cmath>
 #include <limits>
+#include <random>
 #include <unordered_set>
 
 using std::unordered_set;
@@ -62,8 +65,9 @@ namespace lvr2
 template<typename BaseVecT>
 void removeDanglingCluster(BaseMesh<BaseVecT>& mesh, size_t sizeThreshold)
 {
-    // Do cluster growing without a predicate, so cluster will consist of connected faces
-    auto clusterSet = clusterGrowing(mesh, [](auto referenceFaceH, auto currentFaceH)
+    // Do cluster growing without a predicate, so cluster will consist of connected faces. Connectivity is
+    // transitive, so the parallel union-find variant yields the same clusters.
+    auto clusterSet = parallelClusterGrowing(mesh, [](auto faceH, auto neighbourH)
     {
         return true;
     });
@@ -432,13 +436,72 @@ ClusterBiMap<FaceHandle> clusterGrowing(const BaseMesh<BaseVecT>& mesh, Pred pre
     return clusters;
 }
 
+template<typename BaseVecT, typename Pred>
+ClusterBiMap<FaceHandle> parallelClusterGrowing(const BaseMesh<BaseVecT>& mesh, Pred pred)
+{
+    const size_t numFaceIndices = mesh.nextFaceIndex();
+    ConcurrentUnionFind sets(numFaceIndices);
+
+    // Merge all pairs of adjacent faces that match the criteria. Every pair is
+    // only checked from the face with the smaller handle.
+    #pragma omp parallel
+    {
+        vector<FaceHandle> faceNeighbours;
+
+        #pragma omp for schedule(dynamic, 4096)
+        for (long i = 0; i < static_cast<long>(numFaceIndices); i++)
+        {
+            FaceHandle faceH(i);
+            if (!mesh.containsFace(faceH))
+            {
+                continue;
+            }
+
+            faceNeighbours.clear();
+            mesh.getNeighboursOfFace(faceH, faceNeighbours);
+            for (auto neighbour: faceNeighbours)
+            {
+                if (neighbour.idx() > faceH.idx() && pred(faceH, neighbour))
+                {
+                    sets.unite(faceH.idx(), neighbour.idx());
+                }
+            }
+        }
+    }
+
+    // The root of every set is its smallest face, so iterating the faces in
+    // ascending order creates each cluster at its root.
+    ClusterBiMap<FaceHandle> clusters;
+    vector<ClusterHandle> clusterOfRoot(numFaceIndices, ClusterHandle(0));
+    for (auto faceH: mesh.faces())
+    {
+        Index root = sets.find(faceH.idx());
+        if (root == faceH.idx())
+        {
+            clusterOfRoot[root] = clusters.createCluster();
+        }
+        clusters.addToCluster(clusterOfRoot[root], faceH);
+    }
+
+    return clusters;
+}
+
 template<typename BaseVecT>
 ClusterBiMap<FaceHandle> planarClusterGrowing(
     const BaseMesh<BaseVecT>& mesh,
     const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
-    float minSinAngle
+    float minSinAngle,
+    bool referenceFaceCompat
 )
 {
+    if (!referenceFaceCompat)
+    {
+        return parallelClusterGrowing(mesh, [&](auto faceH, auto neighbourH)
+        {
+            return normals[neighbourH].dot(normals[faceH]) > minSinAngle;
+        });
+    }
+
     return clusterGrowing(mesh, [&](auto referenceFaceH, auto currentFaceH)
     {
         return normals[currentFaceH].dot(normals[referenceFaceH]) > minSinAngle;
@@ -451,7 +514,8 @@ ClusterBiMap<FaceHandle> iterativePlanarClusterGrowing(
     FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
     float minSinAngle,
     int numIterations,
-    int minClusterSize
+    int minClusterSize,
+    bool referenceFaceCompat
 )
 {
     ClusterBiMap<FaceHandle> clusters;
@@ -463,7 +527,7 @@ ClusterBiMap<FaceHandle> iterativePlanarClusterGrowing(
         std::cout << timestamp << "Optimizing planes. Iterations "
                   << i << " / " << numIterations << std::endl;
         // Generate clusters
-        clusters = planarClusterGrowing(mesh, normals, minSinAngle);
+        clusters = planarClusterGrowing(mesh, normals, minSinAngle, referenceFaceCompat);
 
         // Calc regression planes
         planes = calcRegressionPlanes(mesh, clusters, normals, minClusterSize);
@@ -486,7 +550,8 @@ ClusterBiMap<FaceHandle> iterativePlanarClusterGrowingRANSAC(
     int numIterations,
     int minClusterSize,
     int ransacIterations,
-    int ransacSamples
+    int ransacSamples,
+    bool referenceFaceCompat
 )
 {
     ClusterBiMap<FaceHandle> clusters;
@@ -498,7 +563,7 @@ ClusterBiMap<FaceHandle> iterativePlanarClusterGrowingRANSAC(
         std::cout << timestamp << "Optimizing planes. Iterations "
                   << i << " / " << numIterations << std::endl;
         // Generate clusters
-        clusters = planarClusterGrowing(mesh, normals, minSinAngle);
+        clusters = planarClusterGrowing(mesh, normals, minSinAngle, referenceFaceCompat);
 
         // Calc regression planes
         planes = calcRegressionPlanesRANSAC(mesh,
@@ -529,18 +594,31 @@ DenseClusterMap<Plane<BaseVecT>> calcRegressionPlanes(
     size_t defaultClusterThreshold = 10 * log(mesh.numFaces());
     size_t minClusterThresholdSize = max(static_cast<size_t>(minClusterSize), defaultClusterThreshold);
 
-    // For all clusters in cluster map
+    // Collect all clusters which are large enough to get a regression plane
+    vector<ClusterHandle> clusterHandles;
     for (auto clusterH: clusters)
     {
-        // Get current cluster
-        auto cluster = clusters[clusterH];
-        if (cluster.handles.size() > minClusterThresholdSize)
+        if (clusters[clusterH].handles.size() > minClusterThresholdSize)
         {
-            // Calc regression plane for current cluster and add to cluster map: cluster -> plane
-            planes.insert(clusterH, calcRegressionPlanePCA(mesh, cluster, normals));
+            clusterHandles.push_back(clusterH);
         }
     }
 
+    // Calc regression planes of all clusters in parallel
+    vector<Plane<BaseVecT>> clusterPlanes(clusterHandles.size());
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long i = 0; i < static_cast<long>(clusterHandles.size()); i++)
+    {
+        clusterPlanes[i] = calcRegressionPlanePCA(mesh, clusters[clusterHandles[i]], normals);
+    }
+
+    // Add planes to cluster map: cluster -> plane
+    for (size_t i = 0; i < clusterHandles.size(); i++)
+    {
+        planes.insert(clusterHandles[i], clusterPlanes[i]);
+    }
+
     return planes;
 }
 
@@ -558,18 +636,63 @@ DenseClusterMap<Plane<BaseVecT>> calcRegressionPlanesRANSAC(
     size_t defaultClusterThreshold = 10 * log(mesh.numFaces());
     size_t minClusterThresholdSize = max(static_cast<size_t>(minClusterSize), defaultClusterThreshold);
 
-    // For all clusters in cluster map
+    // Collect all clusters which are large enough to get a regression plane
+    vector<ClusterHandle> clusterHandles;
+    size_t numClusterFaces = 0;
     for (auto clusterH: clusters)
     {
-        // Get current cluster
-        auto cluster = clusters[clusterH];
-        if (cluster.handles.size() > minClusterThresholdSize)
+        size_t size = clusters[clusterH].handles.size();
+        if (size > minClusterThresholdSize)
+        {
+            clusterHandles.push_back(clusterH);
+            numClusterFaces += size;
+        }
+    }
+
+    // A cluster which holds more than a thread's share of all faces would keep a single thread busy
+    // while the others are idle. Those clusters are processed one after another with parallel trials.
+    const size_t numThreads = OpenMPConfig::getNumThreads();
+    auto isLarge = [&](ClusterHandle clusterH)
+    {
+        return numThreads > 1 && clusters[clusterH].handles.size() * numThreads > numClusterFaces;
+    };
+
+    // Every cluster gets its own random generator seeded from its handle, so the result neither depends on
+    // the order in which clusters are processed nor on the number of threads.
+    auto calcPlane = [&](ClusterHandle clusterH, bool parallelTrials)
+    {
+        std::seed_seq seed{clusterH.idx(), static_cast<Index>(iterations), static_cast<Index>(samples)};
+        std::mt19937 gen(seed);
+        return calcRegressionPlaneRANSAC(
+            mesh, clusters[clusterH], normals, iterations, samples, gen, parallelTrials
+        );
+    };
+
+    vector<Plane<BaseVecT>> clusterPlanes(clusterHandles.size());
+
+    for (size_t i = 0; i < clusterHandles.size(); i++)
+    {
+        if (isLarge(clusterHandles[i]))
         {
-            // Calc regression plane for current cluster and add to cluster map: cluster -> plane
-            planes.insert(clusterH, calcRegressionPlaneRANSAC(mesh, cluster, normals, iterations, samples));
+            clusterPlanes[i] = calcPlane(clusterHandles[i], true);
         }
     }
 
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long i = 0; i < static_cast<long>(clusterHandles.size()); i++)
+    {
+        if (!isLarge(clusterHandles[i]))
+        {
+            clusterPlanes[i] = calcPlane(clusterHandles[i], false);
+        }
+    }
+
+    // Add planes to cluster map: cluster -> plane
+    for (size_t i = 0; i < clusterHandles.size(); i++)
+    {
+        planes.insert(clusterHandles[i], clusterPlanes[i]);
+    }
+
     return planes;
 }
 
@@ -667,6 +790,21 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
     const int num_iterations,
     const int num_samples
 )
+{
+    std::mt19937 gen(rand());
+    return calcRegressionPlaneRANSAC(mesh, cluster, normals, num_iterations, num_samples, gen);
+}
+
+template<typename BaseVecT, typename RandomGenerator>
+Plane<BaseVecT> calcRegressionPlaneRANSAC(
+    const BaseMesh<BaseVecT>& mesh,
+    const Cluster<FaceHandle>& cluster,
+    const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
+    const int num_iterations,
+    const int num_samples,
+    RandomGenerator& gen,
+    bool parallelTrials
+)
 {
     float error_limit = 0.01; // dynamically voxelsize / 100
     Plane<BaseVecT> best_plane;
@@ -681,7 +819,8 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
     //   + determine average edge length for automatic error thresh
     float avg_dist = 0.0;
     int num_edges = 0;
-    unordered_set<VertexHandle> vertices;
+    unordered_set<VertexHandle> visited;
+    vector<VertexHandle> vertices;
     for (auto faceH: cluster.handles)
     {
         // Iterate over all vertices of current face
@@ -689,9 +828,9 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
         for (auto vH: mesh.getVerticesOfFace(faceH))
         {
             // If current vertex is not visited, add distance
-            if (!vertices.count(vH))
+            if (visited.insert(vH).second)
             {
-                vertices.insert(vH);
+                vertices.push_back(vH);
             }
 
             if(vHlast)
@@ -707,12 +846,16 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
 
     error_limit *= avg_dist;
     
-    const size_t num_cluster_vertices = vertices.size();
     const size_t num_cluster_faces = cluster.size();
 
+    // 2) draw the samples of all trials up front, so they only depend on gen
+    std::uniform_int_distribution<size_t> faceDist(0, num_cluster_faces - 1);
+    std::uniform_int_distribution<int> cornerDist(0, 2);
+    vector<Plane<BaseVecT>> trials(num_iterations);
+
     for(int i=0; i<num_iterations; i++)
     {
-        Plane<BaseVecT> plane;
+        Plane<BaseVecT>& plane = trials[i];
         plane.pos.x = 0.0;
         plane.pos.y = 0.0;
         plane.pos.z = 0.0;
@@ -723,30 +866,39 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
         // build avg plane of RANSAC samples
         for(int j=0; j<num_samples; j++)
         {
-            const FaceHandle& faceHandle = cluster.handles[rand() % num_cluster_faces];
-            plane.pos += mesh.getVertexPositionsOfFace(faceHandle)[rand() % 3];
+            const FaceHandle& faceHandle = cluster.handles[faceDist(gen)];
+            plane.pos += mesh.getVertexPositionsOfFace(faceHandle)[cornerDist(gen)];
             plane.normal += normals[faceHandle];
         }
 
         plane.pos /= static_cast<float>(num_samples);
         plane.normal.normalize();
-        
+    }
 
-        // calulate inlier
+    // 3) calulate inlier of all trials
+    vector<int> trialInlier(num_iterations, 0);
+
+    #pragma omp parallel for schedule(dynamic, 1) if(parallelTrials)
+    for(int i=0; i<num_iterations; i++)
+    {
         int inlier = 0;
         for(auto vertexH : vertices)
         {
-            const float current_dist = plane.distance(mesh.getVertexPosition(vertexH));
+            const float current_dist = trials[i].distance(mesh.getVertexPosition(vertexH));
             if(fabs(current_dist) < error_limit)
             {
                 inlier++;
             }
         }
+        trialInlier[i] = inlier;
+    }
 
-        if(inlier > best_inlier)
+    for(int i=0; i<num_iterations; i++)
+    {
+        if(trialInlier[i] > best_inlier)
         {
-            best_inlier = inlier;
-            best_plane = plane;
+            best_inlier = trialInlier[i];
+            best_plane = trials[i];
         }
     }
 
@@ -826,11 +978,71 @@ void dragToRegressionPlanes(
     FaceMap<Normal<typename BaseVecT::CoordType>>& normals
 )
 {
-    // For all clusters in cluster map
+    // Position of every cluster in the iteration order of planes. Vertices shared by several clusters are
+    // dragged into their planes in this order.
+    const size_t noPlane = std::numeric_limits<size_t>::max();
+    vector<size_t> planeRank;
+    vector<ClusterHandle> planeClusters;
     for (auto clusterH: planes)
     {
-        // Drag all vertices of current cluster into regression plane
-        dragToRegressionPlane(mesh, clusters[clusterH], planes[clusterH], normals);
+        if (clusterH.idx() >= planeRank.size())
+        {
+            planeRank.resize(clusterH.idx() + 1, noPlane);
+        }
+        planeRank[clusterH.idx()] = planeClusters.size();
+        planeClusters.push_back(clusterH);
+    }
+
+    // First pass: drag every vertex into the planes of all clusters it belongs to. Each vertex is only
+    // written by one thread.
+    #pragma omp parallel
+    {
+        vector<FaceHandle> faces;
+        vector<size_t> vertexPlanes;
+
+        #pragma omp for schedule(dynamic, 4096)
+        for (long i = 0; i < static_cast<long>(mesh.nextVertexIndex()); i++)
+        {
+            VertexHandle vertexH(i);
+            if (!mesh.containsVertex(vertexH))
+            {
+                continue;
+            }
+
+            faces.clear();
+            vertexPlanes.clear();
+            mesh.getFacesOfVertex(vertexH, faces);
+            for (auto faceH: faces)
+            {
+                auto clusterH = clusters.getClusterOf(faceH);
+                if (clusterH && clusterH.unwrap().idx() < planeRank.size()
+                    && planeRank[clusterH.unwrap().idx()] != noPlane)
+                {
+                    vertexPlanes.push_back(planeRank[clusterH.unwrap().idx()]);
+                }
+            }
+
+            std::sort(vertexPlanes.begin(), vertexPlanes.end());
+            vertexPlanes.erase(std::unique(vertexPlanes.begin(), vertexPlanes.end()), vertexPlanes.end());
+
+            auto& pos = mesh.getVertexPosition(vertexH);
+            for (auto rank: vertexPlanes)
+            {
+                auto& plane = planes[planeClusters[rank]];
+                pos -= plane.normal * plane.distance(pos);
+            }
+        }
+    }
+
+    // Second pass: every face belongs to exactly one cluster, so the normals can be set per cluster
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long i = 0; i < static_cast<long>(planeClusters.size()); i++)
+    {
+        auto& plane = planes[planeClusters[i]];
+        for (auto faceH: clusters[planeClusters[i]].handles)
+        {
+            normals[faceH] = plane.normal;
+        }
     }
 }
 
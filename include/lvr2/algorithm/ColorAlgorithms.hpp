@@ -46,6 +46,7 @@
 
 #include "lvr2/geometry/BaseMesh.hpp"
 #include "lvr2/reconstruction/PointsetSurface.hpp"
+#include "lvr2/reconstruction/SearchTree.hpp"
 #include "lvr2/attrmaps/AttrMaps.hpp"
 
 namespace lvr2
@@ -57,17 +58,22 @@ using Rgb8Color = std::array<uint8_t, 3>;
  * @brief   Calculates the color of each vertex from the point cloud
  *
  * For each vertex, its color is calculated from the rgb color information in
- * the meshes surface.
+ * the meshes surface: the colors of the `k` nearest points are averaged. The
+ * nearest neighbours of all vertices are searched in parallel batches.
  *
- * @param   mesh    The mesh
- * @param   surface The surface of the mesh
+ * @param   mesh        The mesh
+ * @param   surface     The surface of the mesh
+ * @param   k           The number of points to average
+ * @param   weighting   How the `k` points are weighted
  *
  * @return  Optional of a DenseVertexMap with a Rgb8Color for each vertex
  */
 template<typename BaseVecT>
 boost::optional<DenseVertexMap<Rgb8Color>> calcColorFromPointCloud(
     const BaseMesh<BaseVecT>& mesh,
-    const PointsetSurfacePtr<BaseVecT> surface
+    const PointsetSurfacePtr<BaseVecT> surface,
+    int k = 1,
+    KnnWeighting weighting = KnnWeighting::UNIFORM
 );
 
 /**
@@ -34,6 +34,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
+
+#include "lvr2/util/Parallel.hpp"
 
 using std::array;
 
@@ -43,49 +46,96 @@ namespace lvr2
 template <typename BaseVecT>
 boost::optional<DenseVertexMap<Rgb8Color>> calcColorFromPointCloud(
     const BaseMesh<BaseVecT>& mesh,
-    const PointsetSurfacePtr<BaseVecT> surface
+    const PointsetSurfacePtr<BaseVecT> surface,
+    int k,
+    KnnWeighting weighting
 )
 {
+    using CoordT = typename BaseVecT::CoordType;
+
     if (!surface->pointBuffer()->hasColors())
     {
         // cout << "none" << endl;
         return boost::none;
     }
 
-    DenseVertexMap<Rgb8Color> vertexMap;
-    vertexMap.reserve(mesh.numVertices());
+    // Gather the positions of all vertices in one contiguous array
+    vector<Index> compact;
+    const size_t numVertices = compactIndices(
+        mesh.nextVertexIndex(),
+        [&](Index i) { return mesh.containsVertex(VertexHandle(i)); },
+        compact
+    );
+    vector<Index> handles(numVertices);
+    vector<BaseVecT> positions(numVertices);
+
+    #pragma omp parallel for
+    for (long i = 0; i < (long)compact.size(); i++)
+    {
+        if (compact[i] != INVALID_COMPACT_INDEX)
+        {
+            handles[compact[i]] = i;
+            positions[compact[i]] = mesh.getVertexPosition(VertexHandle(i));
+        }
+    }
 
-    // k-nearest-neighbors
-    const int k = 1;
+    // Every vertex gets an entry up front, so the threads below only
+    // overwrite existing values
+    DenseVertexMap<Rgb8Color> vertexMap;
+    vertexMap.reserve(mesh.nextVertexIndex());
+    for (auto vertexH: mesh.vertices())
+    {
+        vertexMap.insert(vertexH, {0, 0, 0});
+    }
 
     UCharChannel colors = *(surface->pointBuffer()->getUCharChannel("colors"));
+    auto searchTree = surface->searchTree();
 
-    vector<size_t> cv;
-    for (auto vertexH: mesh.vertices())
+    // Search in batches to limit the memory needed for the results
+    const size_t batchSize = 1 << 20;
+    vector<size_t> indices;
+    vector<CoordT> distances;
+    for (size_t begin = 0; begin < numVertices; begin += batchSize)
     {
-        cv.clear();
-        auto p = mesh.getVertexPosition(vertexH);
-        surface->searchTree()->kSearch(p, k, cv);
-
-        float r = 0.0f, g = 0.0f, b = 0.0f;
+        const size_t count = std::min(batchSize, numVertices - begin);
+        indices.resize(count * k);
+        distances.resize(count * k);
+        searchTree->kSearchMany(positions.data() + begin, count, k, indices.data(), distances.data());
 
-        for (size_t pointIdx : cv)
+        #pragma omp parallel for
+        for (long i = 0; i < (long)count; i++)
         {
-            auto color = colors[pointIdx];
-            r += color[0];
-            g += color[1];
-            b += color[2];
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            float weightSum = 0.0f;
+
+            for (int j = 0; j < k; j++)
+            {
+                size_t pointIdx = indices[i * k + j];
+                if (pointIdx == std::numeric_limits<size_t>::max())
+                {
+                    continue;
+                }
+                float weight = knnWeight<CoordT>(weighting, distances[i * k + j]);
+                auto color = colors[pointIdx];
+                r += weight * color[0];
+                g += weight * color[1];
+                b += weight * color[2];
+                weightSum += weight;
+            }
+
+            if (weightSum > 0)
+            {
+                r /= weightSum;
+                g /= weightSum;
+                b /= weightSum;
+            }
+
+            vertexMap[VertexHandle(handles[begin + i])] = {
+                static_cast<uint8_t>(r),
+                static_cast<uint8_t>(g),
+                static_cast<uint8_t>(b)
+            };
         }
-
-        r /= k;
-        g /= k;
-        b /= k;
-
-        vertexMap.insert(vertexH, {
-            static_cast<uint8_t>(r),
-            static_cast<uint8_t>(g),
-            static_cast<uint8_t>(b)
-        });
     }
 
     return vertexMap;
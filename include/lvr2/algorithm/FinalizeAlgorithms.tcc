@@ -35,6 +35,8 @@
 #include <vector>
 #include <utility>
 #include <cmath>
+#include <algorithm>
+#include <numeric>
 
 #include "lvr2/algorithm/Materializer.hpp"
 
@@ -42,6 +44,7 @@
 #include "lvr2/io/Progress.hpp"
 
 #include "lvr2/util/Util.hpp"
+#include "lvr2/util/Parallel.hpp"
 
 namespace lvr2
 {
@@ -49,85 +52,108 @@ namespace lvr2
 template<typename BaseVecT>
 MeshBufferPtr SimpleFinalizer<BaseVecT>::apply(const BaseMesh <BaseVecT>& mesh)
 {
-    // Create vertex and normal buffer
-    DenseVertexMap<size_t> idxMap;
-    idxMap.reserve(mesh.numVertices());
-
-    vector<float> vertices;
-    vertices.reserve(mesh.numVertices() * 3);
-
-    vector<float> normals;
+    // Compute the buffer index of every vertex and face. Handles are numbered
+    // in ascending order, which is the order of the mesh iterators, so the
+    // resulting buffers are identical to the ones of a serial export.
+    vector<Index> vertexIdx;
+    const size_t numVertices = compactIndices(
+        mesh.nextVertexIndex(),
+        [&](Index i) { return mesh.containsVertex(VertexHandle(i)); },
+        vertexIdx
+    );
+
+    vector<Index> faceIdx;
+    const size_t numFaces = compactIndices(
+        mesh.nextFaceIndex(),
+        [&](Index i) { return mesh.containsFace(FaceHandle(i)); },
+        faceIdx
+    );
+
+    // Create vertex and attribute buffers
+    floatArr vertices(new float[numVertices * 3]);
+
+    floatArr normals;
     if (m_normalData)
     {
-        normals.reserve(mesh.numVertices() * 3);
+        normals = floatArr(new float[numVertices * 3]);
     }
 
-    vector<unsigned char> colors;
+    ucharArr colors;
     if (m_colorData)
     {
-        colors.reserve(mesh.numVertices() * 3);
+        colors = ucharArr(new unsigned char[numVertices * 3]);
     }
 
     // for all vertices
-    size_t vertexCount = 0;
-    for (auto vH : mesh.vertices())
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(vertexIdx.size()); i++)
     {
+        if (vertexIdx[i] == INVALID_COMPACT_INDEX)
+        {
+            continue;
+        }
+
+        VertexHandle vH(i);
+        const size_t bufferPos = vertexIdx[i] * 3;
         auto point = mesh.getVertexPosition(vH);
 
         // add vertex positions to buffer
-        vertices.push_back(point.x);
-        vertices.push_back(point.y);
-        vertices.push_back(point.z);
+        vertices[bufferPos + 0] = point.x;
+        vertices[bufferPos + 1] = point.y;
+        vertices[bufferPos + 2] = point.z;
 
         if (m_normalData)
         {
             // add normal data to buffer if given
             auto normal = (*m_normalData)[vH];
-            normals.push_back(normal.getX());
-            normals.push_back(normal.getY());
-            normals.push_back(normal.getZ());
+            normals[bufferPos + 0] = normal.getX();
+            normals[bufferPos + 1] = normal.getY();
+            normals[bufferPos + 2] = normal.getZ();
         }
 
         if (m_colorData)
         {
             // add color data to buffer if given
-            colors.push_back(static_cast<unsigned char>((*m_colorData)[vH][0]));
-            colors.push_back(static_cast<unsigned char>((*m_colorData)[vH][1]));
-            colors.push_back(static_cast<unsigned char>((*m_colorData)[vH][2]));
+            colors[bufferPos + 0] = static_cast<unsigned char>((*m_colorData)[vH][0]);
+            colors[bufferPos + 1] = static_cast<unsigned char>((*m_colorData)[vH][1]);
+            colors[bufferPos + 2] = static_cast<unsigned char>((*m_colorData)[vH][2]);
         }
-
-        // Save index of vertex for face mapping
-        idxMap.insert(vH, vertexCount);
-        vertexCount++;
     }
 
     // Create face buffer
-    vector<unsigned int> faces;
-    faces.reserve(mesh.numFaces() * 3);
-    for (auto fH : mesh.faces())
+    indexArray faces(new unsigned int[numFaces * 3]);
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(faceIdx.size()); i++)
     {
-        auto handles = mesh.getVerticesOfFace(fH);
-        for (auto handle : handles)
+        if (faceIdx[i] == INVALID_COMPACT_INDEX)
+        {
+            continue;
+        }
+
+        const size_t bufferPos = faceIdx[i] * 3;
+        auto handles = mesh.getVerticesOfFace(FaceHandle(i));
+        for (size_t j = 0; j < 3; j++)
         {
             // add faces to buffer
-            faces.push_back(idxMap[handle]);
+            faces[bufferPos + j] = vertexIdx[handles[j].idx()];
         }
     }
 
     // create buffer object and pass values
     MeshBufferPtr buffer( new MeshBuffer );
 
-    buffer->setVertices(Util::convert_vector_to_shared_array(vertices), vertices.size() / 3);
-    buffer->setFaceIndices(Util::convert_vector_to_shared_array(faces), faces.size() / 3);
+    buffer->setVertices(vertices, numVertices);
+    buffer->setFaceIndices(faces, numFaces);
 
     if (m_normalData)
     {
-        buffer->setVertexNormals(Util::convert_vector_to_shared_array(normals));
+        buffer->setVertexNormals(normals);
     }
 
     if (m_colorData)
     {
-        buffer->setVertexColors(Util::convert_vector_to_shared_array(colors));
+        buffer->setVertexColors(colors);
     }
 
     return buffer;
@@ -180,71 +206,95 @@ void TextureFinalizer<BaseVecT>::setMaterializerResult(const MaterializerResult<
 template<typename BaseVecT>
 MeshBufferPtr TextureFinalizer<BaseVecT>::apply(const BaseMesh<BaseVecT>& mesh)
 {
+    // Collect the cluster handles so that the clusters can be processed in
+    // parallel. Every cluster gets its own copy of its vertices, so the
+    // clusters write to disjoint ranges of the buffers.
+    vector<ClusterHandle> clusterHandles;
+    clusterHandles.reserve(m_cluster.numCluster());
+    for (auto clusterH: m_cluster)
+    {
+        clusterHandles.push_back(clusterH);
+    }
+    const long numClusters = static_cast<long>(clusterHandles.size());
+
+    // Count vertices and faces of all clusters
+    vector<size_t> clusterVertexOffsets(numClusters);
+    vector<size_t> clusterFaceOffsets(numClusters);
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long i = 0; i < numClusters; i++)
+    {
+        auto& cluster = m_cluster.getCluster(clusterHandles[i]);
+
+        vector<Index> clusterVertices;
+        clusterVertices.reserve(cluster.handles.size() * 3);
+        for (auto faceH: cluster.handles)
+        {
+            for (auto vertexH: mesh.getVerticesOfFace(faceH))
+            {
+                clusterVertices.push_back(vertexH.idx());
+            }
+        }
+        std::sort(clusterVertices.begin(), clusterVertices.end());
+
+        clusterVertexOffsets[i] = std::distance(
+            clusterVertices.begin(),
+            std::unique(clusterVertices.begin(), clusterVertices.end())
+        );
+        clusterFaceOffsets[i] = cluster.handles.size();
+    }
+
+    // The offsets of the clusters in the buffers are the same as the counters
+    // of a serial cluster-by-cluster export would be
+    const size_t numVertices = exclusivePrefixSum(clusterVertexOffsets);
+    const size_t numFaces = exclusivePrefixSum(clusterFaceOffsets);
+
     // Create vertex buffer and all buffers holding vertex attributes
-    vector<float> vertices;
-    vertices.reserve(mesh.numVertices() * 3 * 2);
+    floatArr vertices(new float[numVertices * 3]);
 
-    vector<float> normals;
+    floatArr normals;
     if (m_vertexNormals)
     {
-        normals.reserve(mesh.numVertices() * 3 * 2);
+        normals = floatArr(new float[numVertices * 3]);
     }
 
-    vector<unsigned char> colors;
-    if (m_clusterColors)
+    ucharArr colors;
+    if (m_vertexColors || m_clusterColors)
     {
-        colors.reserve(mesh.numVertices() * 3 * 2);
+        colors = ucharArr(new unsigned char[numVertices * 3]);
     }
 
+    // Create face buffer
+    indexArray faces(new unsigned int[numFaces * 3]);
+
     // Create buffer and variables for texturizing
     bool useTextures = false;
     if (m_materializerResult && m_materializerResult.get().m_textures)
     {
         useTextures = true;
     }
-    vector<float> texCoords;
-    vector<Material> materials;
-    vector<unsigned int> faceMaterials;
-    vector<unsigned int> clusterMaterials;
-    vector<Texture> textures;
-    vector<vector<unsigned int>> clusterFaceIndices;
-    size_t clusterCount = 0;
-    size_t faceCount = 0;
-
-    // Global material index will be used for indexing materials in the faceMaterialIndexBuffer
-    // The basic material will have the index 0
-    unsigned int globalMaterialIndex = 1;
-    // Create default material
-    unsigned char defaultR = 0, defaultG = 0, defaultB = 0;
-    Material m;
-    std::array<unsigned char, 3> arr = {defaultR, defaultG, defaultB};
-    m.m_color = std::move(arr);
-    materials.push_back(m);
-    // This map remembers which texture and material are associated with each other
-    std::map<int, unsigned int> textureMaterialMap; // Stores the ID of the material for each textureIndex
-    textureMaterialMap[-1] = 0; // texIndex -1 => no texture => default material with index 0
-
-    std::map<Rgb8Color, int> colorMaterialMap;
-
-    // Create face buffer
-    vector<unsigned int> faces;
-    faces.reserve(mesh.numFaces() * 3);
 
-    // This counter is used to determine the index of a newly inserted vertex
-    size_t vertexCount = 0;
+    floatArr texCoords;
+    if (m_materializerResult)
+    {
+        texCoords = floatArr(new float[numVertices * 2]);
+    }
 
     string comment = timestamp.getElapsedTime() + "Finalizing mesh ";
     ProgressBar progress(m_cluster.numCluster(), comment);
 
     // Loop over all clusters
-    for (auto clusterH: m_cluster)
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long i = 0; i < numClusters; i++)
     {
+        auto clusterH = clusterHandles[i];
+
         // This map remembers which vertex we already inserted and at what
         // position. This is important to create the face map.
         SparseVertexMap<size_t> idxMap;
 
-        // Vector for storing indices of created faces
-        vector<unsigned int> faceIndices;
+        size_t vertexCount = clusterVertexOffsets[i];
+        size_t faceCount = clusterFaceOffsets[i];
 
         ++progress;
 
@@ -253,41 +303,70 @@ MeshBufferPtr TextureFinalizer<BaseVecT>::apply(const BaseMesh<BaseVecT>& mesh)
         // Loop over all faces of the cluster
         for (auto faceH: cluster.handles)
         {
-            for (auto vertexH: mesh.getVerticesOfFace(faceH))
+            auto faceVertices = mesh.getVerticesOfFace(faceH);
+            for (size_t j = 0; j < 3; j++)
             {
+                auto vertexH = faceVertices[j];
+
                 // Check if we already inserted this vertex. If not...
                 if (!idxMap.containsKey(vertexH))
                 {
                     // ... insert it into the buffers (with all its attributes)
                     auto point = mesh.getVertexPosition(vertexH);
 
-                    vertices.push_back(point.x);
-                    vertices.push_back(point.y);
-                    vertices.push_back(point.z);
+                    vertices[vertexCount * 3 + 0] = point.x;
+                    vertices[vertexCount * 3 + 1] = point.y;
+                    vertices[vertexCount * 3 + 2] = point.z;
 
                     if (m_vertexNormals)
                     {
                         auto normal = (*m_vertexNormals)[vertexH];
-                        normals.push_back(normal.getX());
-                        normals.push_back(normal.getY());
-                        normals.push_back(normal.getZ());
+                        normals[vertexCount * 3 + 0] = normal.getX();
+                        normals[vertexCount * 3 + 1] = normal.getY();
+                        normals[vertexCount * 3 + 2] = normal.getZ();
                     }
 
                     // If individual vertex colors are present: use these
                     if (m_vertexColors)
                     {
-                        colors.push_back(static_cast<unsigned char>((*m_vertexColors)[vertexH][0]));
-                        colors.push_back(static_cast<unsigned char>((*m_vertexColors)[vertexH][1]));
-                        colors.push_back(static_cast<unsigned char>((*m_vertexColors)[vertexH][2]));
+                        colors[vertexCount * 3 + 0] = static_cast<unsigned char>((*m_vertexColors)[vertexH][0]);
+                        colors[vertexCount * 3 + 1] = static_cast<unsigned char>((*m_vertexColors)[vertexH][1]);
+                        colors[vertexCount * 3 + 2] = static_cast<unsigned char>((*m_vertexColors)[vertexH][2]);
                     }
                     else if (m_clusterColors)
                     {
                         // else: use cluster colors if present
-                        colors.push_back(static_cast<unsigned char>((*m_clusterColors)[clusterH][0]));
-                        colors.push_back(static_cast<unsigned char>((*m_clusterColors)[clusterH][1]));
-                        colors.push_back(static_cast<unsigned char>((*m_clusterColors)[clusterH][2]));
+                        colors[vertexCount * 3 + 0] = static_cast<unsigned char>((*m_clusterColors)[clusterH][0]);
+                        colors[vertexCount * 3 + 1] = static_cast<unsigned char>((*m_clusterColors)[clusterH][1]);
+                        colors[vertexCount * 3 + 2] = static_cast<unsigned char>((*m_clusterColors)[clusterH][2]);
                     } // else: no colors
 
+                    // Texture coordinates. Every vertex needs an entry in
+                    // this buffer, vertices without texture get (0, 0).
+                    if (m_materializerResult)
+                    {
+                        auto& vertexTexCoords = m_materializerResult.get().m_vertexTexCoords;
+                        bool vertexHasTexCoords = vertexTexCoords.is_initialized()
+                                                  ? static_cast<bool>(vertexTexCoords.get().get(vertexH))
+                                                  : false;
+
+                        if (useTextures && vertexHasTexCoords)
+                        {
+                            // Use tex coord vertex map to find texture coords
+                            const TexCoords coords = vertexTexCoords.get()
+                                .get(vertexH).get()
+                                .getTexCoords(clusterH);
+
+                            texCoords[vertexCount * 2 + 0] = coords.u;
+                            texCoords[vertexCount * 2 + 1] = coords.v;
+                        }
+                        else
+                        {
+                            texCoords[vertexCount * 2 + 0] = 0.0;
+                            texCoords[vertexCount * 2 + 1] = 0.0;
+                        }
+                    }
+
                     // Save index of vertex for face mapping
                     idxMap.insert(vertexH, vertexCount);
                     vertexCount++;
@@ -295,21 +374,54 @@ MeshBufferPtr TextureFinalizer<BaseVecT>::apply(const BaseMesh<BaseVecT>& mesh)
 
                 // At this point we know that the vertex is certainly in the
                 // map (and the buffers).
-                faces.push_back(idxMap[vertexH]);
+                faces[faceCount * 3 + j] = idxMap[vertexH];
             }
-            faceIndices.push_back(faceCount++);
+            faceCount++;
         }
+    }
 
-        clusterFaceIndices.push_back(faceIndices);
+    cout << endl;
+
+    MeshBufferPtr buffer = MeshBufferPtr( new MeshBuffer );
+    buffer->setVertices(vertices, numVertices);
+    buffer->setFaceIndices(faces, numFaces);
+
+    if (m_vertexNormals)
+    {
+        buffer->setVertexNormals(normals);
+    }
 
-        // When using textures,
-        // For each cluster:
-        if (m_materializerResult)
+    if (m_clusterColors || m_vertexColors)
+    {
+        buffer->setVertexColors(colors);
+    }
+
+    if (m_materializerResult)
+    {
+        vector<Material> materials;
+        vector<Texture> textures;
+
+        // Global material index will be used for indexing materials in the faceMaterialIndexBuffer
+        // The basic material will have the index 0
+        unsigned int globalMaterialIndex = 1;
+        // Create default material
+        unsigned char defaultR = 0, defaultG = 0, defaultB = 0;
+        Material m;
+        std::array<unsigned char, 3> arr = {defaultR, defaultG, defaultB};
+        m.m_color = std::move(arr);
+        materials.push_back(m);
+        // This map remembers which texture and material are associated with each other
+        std::map<int, unsigned int> textureMaterialMap; // Stores the ID of the material for each textureIndex
+        textureMaterialMap[-1] = 0; // texIndex -1 => no texture => default material with index 0
+
+        std::map<Rgb8Color, int> colorMaterialMap;
+
+        // Material indices are assigned in cluster order, so this is done
+        // serially. It is only one lookup per cluster.
+        indexArray clusterMaterials(new unsigned int[numClusters]);
+        for (long i = 0; i < numClusters; i++)
         {
-            // This map remembers which vertices were already visited for materials and textures
-            // Each vertex must be visited exactly once
-            SparseVertexMap<size_t> vertexVisitedMap;
-            size_t vertexVisitCount = 0;
+            auto clusterH = clusterHandles[i];
 
             Material m = m_materializerResult.get().m_clusterMaterials.get(clusterH).get();
             bool clusterHasTextures = static_cast<bool>(m.m_texture); // optional
@@ -365,95 +477,46 @@ MeshBufferPtr TextureFinalizer<BaseVecT>::apply(const BaseMesh<BaseVecT>& mesh)
                 materialIndex = 0;
             }
 
-            clusterMaterials.push_back(materialIndex);
-
-
-
-            // For each face in cluster:
-            // Materials
-            for (auto faceH : cluster.handles)
-            {
-
-                faceMaterials.push_back(materialIndex);
-
-                // For each vertex in face:
-                for (auto vertexH : mesh.getVerticesOfFace(faceH))
-                {
-                    if (!vertexVisitedMap.containsKey(vertexH))
-                    {
-                        auto& vertexTexCoords = m_materializerResult.get().m_vertexTexCoords;
-                        bool vertexHasTexCoords = vertexTexCoords.is_initialized()
-                                                  ? static_cast<bool>(vertexTexCoords.get().get(vertexH))
-                                                  : false;
-
-                        if (useTextures && vertexHasTexCoords)
-                        {
-                            // Use tex coord vertex map to find texture coords
-                            const TexCoords coords = m_materializerResult.get()
-                                .m_vertexTexCoords.get()
-                                .get(vertexH).get()
-                                .getTexCoords(clusterH);
-
-                            texCoords.push_back(coords.u);
-                            texCoords.push_back(coords.v);
-                            texCoords.push_back(0.0);
-                        } else {
-                            // Cluster does not have a texture, use default coords
-                            // Every vertex needs an entry in this buffer,
-                            // This is why 0's are inserted
-                            texCoords.push_back(0.0);
-                            texCoords.push_back(0.0);
-                            texCoords.push_back(0.0);
-                        }
-                        vertexVisitedMap.insert(vertexH, vertexVisitCount);
-                        vertexVisitCount++;
-                    }
-                }
-            }
+            clusterMaterials[i] = materialIndex;
         }
-    }
-
-    cout << endl;
 
-    MeshBufferPtr buffer = MeshBufferPtr( new MeshBuffer );
-    buffer->setVertices(Util::convert_vector_to_shared_array(vertices), vertices.size() / 3);
-    buffer->setFaceIndices(Util::convert_vector_to_shared_array(faces), faces.size() / 3);
-
-    if (m_vertexNormals)
-    {
-        buffer->setVertexNormals(Util::convert_vector_to_shared_array(normals));
-    }
+        // Every face gets the material of its cluster
+        indexArray faceMaterials(new unsigned int[numFaces]);
 
-    if (m_clusterColors || m_vertexColors)
-    {
-        buffer->setVertexColors(Util::convert_vector_to_shared_array(colors));
-    }
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (long i = 0; i < numClusters; i++)
+        {
+            auto& cluster = m_cluster.getCluster(clusterHandles[i]);
+            std::fill_n(
+                faceMaterials.get() + clusterFaceOffsets[i],
+                cluster.handles.size(),
+                clusterMaterials[i]
+            );
+        }
 
-    if (m_materializerResult)
-    {
         vector<Material> &mats = buffer->getMaterials();
         vector<Texture> &texts = buffer->getTextures();
         mats.insert(mats.end(), materials.begin(), materials.end());
         texts.insert(texts.end(), textures.begin(), textures.end());
 
-        buffer->setFaceMaterialIndices(Util::convert_vector_to_shared_array(faceMaterials));
-        buffer->addIndexChannel(Util::convert_vector_to_shared_array(clusterMaterials), "cluster_material_indices", clusterMaterials.size(), 1);
-
-        // convert from 3 floats per vertex to 2...
-        floatArr texCoordsArr = floatArr( new float[(texCoords.size() / 3) * 2] );
-
-        for (size_t i = 0; i < texCoords.size() / 3; i++)
-        {
-            texCoordsArr[i*2 + 0] = texCoords[i*3 + 0];
-            texCoordsArr[i*2 + 1] = texCoords[i*3 + 1];
-        }
-        buffer->setTextureCoordinates(texCoordsArr);
+        buffer->setFaceMaterialIndices(faceMaterials);
+        buffer->addIndexChannel(clusterMaterials, "cluster_material_indices", numClusters, 1);
+        buffer->setTextureCoordinates(texCoords);
 
         // TODO TALK TO THOMAS
-        for (size_t i = 0; i < clusterFaceIndices.size(); i++)
+        for (long i = 0; i < numClusters; i++)
         {
+            // The faces of a cluster are stored consecutively
+            const size_t clusterSize = m_cluster.getCluster(clusterHandles[i]).handles.size();
+            indexArray clusterFaceIndices(new unsigned int[clusterSize]);
+            std::iota(
+                clusterFaceIndices.get(),
+                clusterFaceIndices.get() + clusterSize,
+                static_cast<unsigned int>(clusterFaceOffsets[i])
+            );
+
             std::string cluster_name = "cluster" + std::to_string(i) + "_face_indices";
-            buffer->addIndexChannel(Util::convert_vector_to_shared_array(clusterFaceIndices[i]), cluster_name, clusterFaceIndices[i].size(), 1);
+            buffer->addIndexChannel(clusterFaceIndices, cluster_name, clusterSize, 1);
         }
     }
 
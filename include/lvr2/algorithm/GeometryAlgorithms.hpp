@@ -40,6 +40,22 @@
 namespace lvr2
 {
 
+/**
+ * @brief Defines which vertices belong to the local neighborhood of a vertex
+ *        in the roughness and height difference computations.
+ */
+enum class LocalNeighborhood
+{
+    /// All vertices within the radius that are connected to the vertex by a
+    /// path of edges that never leaves the radius (see
+    /// `visitLocalVertexNeighborhood()`)
+    CONNECTED = 0,
+    /// All vertices within the radius, regardless of the mesh topology. The
+    /// queries are answered by a uniform spatial hash of all vertex positions
+    /// that is built once.
+    EUCLIDEAN = 1,
+};
+
 /**
  * @brief   Calculates the local neighborhood of a given vertex (defined by it's handle).
  *
@@ -84,14 +100,19 @@ void visitLocalVertexNeighborhood(
 /**
  * @brief   Calculate the height difference value for each vertex of the given BaseMesh.
  *
- * @param mesh      The given BaseMesh for calculating vertex height differences.
- * @param radius    The radius which defines the border of the local neighborhood.
+ * @param mesh          The given BaseMesh for calculating vertex height differences.
+ * @param radius        The radius which defines the border of the local neighborhood.
+ * @param neighborhood  Whether the neighborhood has to be connected to the vertex.
  *
  * @return  A map filled with <Vertex, float>-entries, storing the height difference value
  *          of each vertex.
  */
 template<typename BaseVecT>
-DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT>& mesh, double radius);
+DenseVertexMap<float> calcVertexHeightDifferences(
+        const BaseMesh<BaseVecT>& mesh,
+        double radius,
+        LocalNeighborhood neighborhood = LocalNeighborhood::CONNECTED
+);
 
 /**
  * @brief Calculates the roughness for each vertex.
@@ -106,6 +127,7 @@ DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT>& mesh
  *                  the neighborhood.
  * @param normals   The vertex normals of the given mesh as a map.
  *                  The normals are necessary in this function for delegating them to the submethods.
+ * @param neighborhood  Whether the neighborhood has to be connected to the vertex.
  *
  * @return A map <vertex, float> filled with roughness values for each vertex.
  */
@@ -113,7 +135,8 @@ template<typename BaseVecT>
 DenseVertexMap<float> calcVertexRoughness(
         const BaseMesh<BaseVecT>& mesh,
         double radius,
-        const VertexMap<Normal<typename BaseVecT::CoordType>>& normals
+        const VertexMap<Normal<typename BaseVecT::CoordType>>& normals,
+        LocalNeighborhood neighborhood = LocalNeighborhood::CONNECTED
 );
 
 /**
@@ -162,6 +185,7 @@ DenseEdgeMap<float> calcVertexAngleEdges(
  * @param normals     The vertex normals of the given mesh.
  * @param roughness   The calculated roughness values for each vertex.
  * @param heightDiff  The calculated height difference values for each vertex.
+ * @param neighborhood  Whether the neighborhood has to be connected to the vertex.
  */
 template<typename BaseVecT>
 void calcVertexRoughnessAndHeightDifferences(
@@ -169,7 +193,8 @@ void calcVertexRoughnessAndHeightDifferences(
         double radius,
         const VertexMap<Normal<typename BaseVecT::CoordType>>& normals,
         DenseVertexMap<float>& roughness,
-        DenseVertexMap<float>& heightDiff
+        DenseVertexMap<float>& heightDiff,
+        LocalNeighborhood neighborhood = LocalNeighborhood::CONNECTED
 );
 
 /**
@@ -190,6 +215,8 @@ DenseEdgeMap<float> calcVertexDistances(const BaseMesh<BaseVecT>& mesh);
  * @param path        Resulted path from search
  *
  * @return true if a path between start and goals exists
+ *
+ * @see PathSearchContext for many queries on the same mesh
  */
 template<typename BaseVecT>
 bool Dijkstra(
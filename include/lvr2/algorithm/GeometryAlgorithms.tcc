@@ -30,12 +30,15 @@
  */
 
 #include <algorithm>
+#include <cstdint>
 #include <limits>
+#include <memory>
 #include <queue>
 #include <set>
 
 #include "lvr2/attrmaps/AttrMaps.hpp"
 #include "lvr2/io/Progress.hpp"
+#include "lvr2/util/Parallel.hpp"
 
 namespace lvr2
 {
@@ -119,68 +122,382 @@ void visitLocalVertexNeighborhood(
     }
 }
 
+namespace geometry_detail
+{
+
+/**
+ * @brief Visited flags for many consecutive graph walks.
+ *
+ * A vertex counts as visited if its stamp equals the current generation, so
+ * starting a new walk is O(1) instead of clearing a map.
+ */
+class VisitedStamps
+{
+public:
+    explicit VisitedStamps(size_t count) : m_stamps(count, 0), m_generation(0) {}
+
+    /// Forgets all visited vertices
+    void nextGeneration()
+    {
+        if (++m_generation == 0)
+        {
+            std::fill(m_stamps.begin(), m_stamps.end(), 0);
+            m_generation = 1;
+        }
+    }
+
+    /// Marks `vH` as visited and returns whether it was not visited before
+    bool visit(VertexHandle vH)
+    {
+        uint32_t& stamp = m_stamps[vH.idx()];
+        if (stamp == m_generation)
+        {
+            return false;
+        }
+        stamp = m_generation;
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> m_stamps;
+    uint32_t m_generation;
+};
+
+/**
+ * @brief Same walk as `visitLocalVertexNeighborhood()`, but all scratch
+ *        memory is owned by the caller and non manifold vertices are
+ *        appended to `invalid`, so one thread can reuse everything.
+ */
+template <typename BaseVecT, typename VisitorF>
+void walkLocalNeighborhood(
+    const BaseMesh<BaseVecT> &mesh,
+    VisitedStamps &visited,
+    vector<VertexHandle> &stack,
+    vector<VertexHandle> &directNeighbors,
+    vector<VertexHandle> &invalid,
+    VertexHandle vH,
+    double radius,
+    VisitorF visitor)
+{
+    auto vPos = mesh.getVertexPosition(vH);
+    const double radiusSquared = radius * radius;
+
+    visited.nextGeneration();
+    visited.visit(vH);
+    stack.clear();
+    stack.push_back(vH);
+
+    while (!stack.empty())
+    {
+        auto curVH = stack.back();
+        stack.pop_back();
+
+        directNeighbors.clear();
+        try
+        {
+            mesh.getNeighboursOfVertex(curVH, directNeighbors);
+        }
+        catch (const lvr2::PanicException&)
+        {
+            invalid.push_back(curVH);
+        }
+        for (auto newVH : directNeighbors)
+        {
+            auto distSquared = mesh.getVertexPosition(newVH).squaredDistanceFrom(vPos);
+            if (distSquared < radiusSquared && visited.visit(newVH))
+            {
+                visitor(newVH);
+                stack.push_back(newVH);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Uniform spatial hash over all vertex positions of a mesh.
+ *
+ * The vertices are sorted by the key of the cubic cell they fall into. Since
+ * the cells are at least as large as the query radius, a radius query only
+ * has to look at the 27 cells around the query point.
+ */
 template <typename BaseVecT>
-DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT> &mesh, double radius)
+class VertexSpatialHash
 {
-    // We create a map to store a height-diff for each vertex. We preallocate
-    // memory for all vertices. This is not only an optimization, but more
-    // importantly to avoid multithreading crashes. The parallelized loop
-    // further down inserts into this data structure; if there is no free
-    // memory left, it will reallocate which will crash horribly when multiple
-    // threads are involved.
-    DenseVertexMap<float> heightDiff;
-    heightDiff.reserve(mesh.nextVertexIndex());
+public:
+    VertexSpatialHash(const BaseMesh<BaseVecT> &mesh, double cellSize);
 
-    // Output
-    string msg = timestamp.getElapsedTime() + "Computing height differences...";
-    ProgressBar progress(mesh.numVertices(), msg);
-    ++progress;
+    /**
+     * @brief Calls `visitor` for every vertex (except `vH` itself) which is
+     *        closer to `vH` than `radius`. `radius` must not be larger than
+     *        the cell size.
+     */
+    template <typename VisitorF>
+    void visitBall(VertexHandle vH, const BaseVecT &pos, double radius, VisitorF visitor) const;
 
-    std::set<VertexHandle> invalid;
+private:
+    /// Bits per axis in a cell key
+    static constexpr int KEY_BITS = 21;
+
+    uint64_t cellKey(int64_t x, int64_t y, int64_t z) const
+    {
+        return (uint64_t(x) << (2 * KEY_BITS)) | (uint64_t(y) << KEY_BITS) | uint64_t(z);
+    }
 
-// Calculate height difference for each vertex
-#pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
+    int64_t cellCoord(float value, float min) const
     {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
+        return std::min<int64_t>(int64_t((value - min) * m_invCellSize), (int64_t(1) << KEY_BITS) - 1);
+    }
+
+    float m_invCellSize;
+    BaseVecT m_min;
+
+    /// Cell key, handle and position of every vertex, sorted by key
+    vector<uint64_t> m_keys;
+    vector<Index> m_handles;
+    vector<BaseVecT> m_positions;
+};
+
+template <typename BaseVecT>
+VertexSpatialHash<BaseVecT>::VertexSpatialHash(const BaseMesh<BaseVecT> &mesh, double cellSize)
+{
+    const long n = mesh.nextVertexIndex();
+
+    float minX = std::numeric_limits<float>::max();
+    float minY = minX, minZ = minX;
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = maxX, maxZ = maxX;
+
+    #pragma omp parallel for reduction(min:minX,minY,minZ) reduction(max:maxX,maxY,maxZ)
+    for (long i = 0; i < n; i++)
+    {
+        if (!mesh.containsVertex(VertexHandle(i)))
         {
             continue;
         }
+        auto p = mesh.getVertexPosition(VertexHandle(i));
+        minX = std::min(minX, p.x); maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y); maxY = std::max(maxY, p.y);
+        minZ = std::min(minZ, p.z); maxZ = std::max(maxZ, p.z);
+    }
+    m_min = BaseVecT(minX, minY, minZ);
+
+    // Grow the cells if the mesh is too large for the key width
+    double extent = std::max({maxX - minX, maxY - minY, maxZ - minZ, 0.0f});
+    cellSize = std::max(cellSize, extent / double((1 << KEY_BITS) - 2));
+    m_invCellSize = cellSize > 0 ? float(1.0 / cellSize) : 1.0f;
+
+    vector<std::pair<uint64_t, Index>> entries(mesh.numVertices());
+    vector<Index> compact;
+    compactIndices(n, [&](Index i) { return mesh.containsVertex(VertexHandle(i)); }, compact);
+
+    #pragma omp parallel for
+    for (long i = 0; i < n; i++)
+    {
+        if (compact[i] == INVALID_COMPACT_INDEX)
+        {
+            continue;
+        }
+        auto p = mesh.getVertexPosition(VertexHandle(i));
+        uint64_t key = cellKey(cellCoord(p.x, m_min.x), cellCoord(p.y, m_min.y), cellCoord(p.z, m_min.z));
+        entries[compact[i]] = std::make_pair(key, Index(i));
+    }
+
+    // All pairs are distinct, so this is a plain parallel sort
+    parallelSortUnique(entries);
+
+    m_keys.resize(entries.size());
+    m_handles.resize(entries.size());
+    m_positions.resize(entries.size());
+
+    #pragma omp parallel for
+    for (long i = 0; i < (long)entries.size(); i++)
+    {
+        m_keys[i] = entries[i].first;
+        m_handles[i] = entries[i].second;
+        m_positions[i] = mesh.getVertexPosition(VertexHandle(m_handles[i]));
+    }
+}
+
+template <typename BaseVecT>
+template <typename VisitorF>
+void VertexSpatialHash<BaseVecT>::visitBall(
+    VertexHandle vH,
+    const BaseVecT &pos,
+    double radius,
+    VisitorF visitor) const
+{
+    const double radiusSquared = radius * radius;
+    const int64_t maxCoord = (int64_t(1) << KEY_BITS) - 1;
+    const int64_t cx = cellCoord(pos.x, m_min.x);
+    const int64_t cy = cellCoord(pos.y, m_min.y);
+    const int64_t cz = cellCoord(pos.z, m_min.z);
+
+    for (int64_t x = std::max<int64_t>(cx - 1, 0); x <= std::min(cx + 1, maxCoord); x++)
+    {
+        for (int64_t y = std::max<int64_t>(cy - 1, 0); y <= std::min(cy + 1, maxCoord); y++)
+        {
+            // The cells along z are adjacent in key order
+            uint64_t first = cellKey(x, y, std::max<int64_t>(cz - 1, 0));
+            uint64_t last = cellKey(x, y, std::min(cz + 1, maxCoord));
+            size_t i = std::lower_bound(m_keys.begin(), m_keys.end(), first) - m_keys.begin();
+            for (; i < m_keys.size() && m_keys[i] <= last; i++)
+            {
+                if (m_handles[i] != vH.idx() && m_positions[i].squaredDistanceFrom(pos) < radiusSquared)
+                {
+                    visitor(VertexHandle(m_handles[i]));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Creates a map which already contains an entry for every vertex, so
+ *        multiple threads may assign values via `operator[]` without locking.
+ */
+template <typename BaseVecT>
+DenseVertexMap<float> prefilledVertexMap(const BaseMesh<BaseVecT> &mesh)
+{
+    DenseVertexMap<float> map;
+    map.reserve(mesh.nextVertexIndex());
+    for (auto vH : mesh.vertices())
+    {
+        map.insert(vH, 0);
+    }
+    return map;
+}
+
+/**
+ * @brief Computes roughness and/or height difference of all vertices in a
+ *        single pass over the local neighborhoods.
+ *
+ * `roughness` and `averageAngles` are either both null or both set;
+ * `heightDiff` may be null.
+ */
+template <typename BaseVecT>
+void calcLocalNeighborhoodValues(
+    const BaseMesh<BaseVecT> &mesh,
+    double radius,
+    LocalNeighborhood neighborhood,
+    const DenseVertexMap<float> *averageAngles,
+    DenseVertexMap<float> *roughness,
+    DenseVertexMap<float> *heightDiff,
+    const string &msg)
+{
+    if (roughness)
+    {
+        *roughness = prefilledVertexMap(mesh);
+    }
+    if (heightDiff)
+    {
+        *heightDiff = prefilledVertexMap(mesh);
+    }
+
+    std::unique_ptr<VertexSpatialHash<BaseVecT>> hash;
+    if (neighborhood == LocalNeighborhood::EUCLIDEAN)
+    {
+        hash.reset(new VertexSpatialHash<BaseVecT>(mesh, radius));
+    }
+
+    ProgressBar progress(mesh.numVertices(), timestamp.getElapsedTime() + msg);
+    ++progress;
+
+    vector<VertexHandle> invalid;
+    const long n = mesh.nextVertexIndex();
+
+    #pragma omp parallel
+    {
+        ProgressBarBatch progressBatch(progress);
+
+        // Scratch memory of this thread
+        std::unique_ptr<VisitedStamps> visited;
+        if (!hash)
+        {
+            visited.reset(new VisitedStamps(n));
+        }
+        vector<VertexHandle> stack;
+        vector<VertexHandle> directNeighbors;
+        vector<VertexHandle> localInvalid;
 
-        float minHeight = std::numeric_limits<float>::max();
-        float maxHeight = std::numeric_limits<float>::lowest();
+        #pragma omp for schedule(dynamic, 64)
+        for (long i = 0; i < n; i++)
+        {
+            auto vH = VertexHandle(i);
+            if (!mesh.containsVertex(vH))
+            {
+                continue;
+            }
 
-        visitLocalVertexNeighborhood(mesh, invalid, vH, radius, [&](auto neighbor) {
-            auto curPos = mesh.getVertexPosition(neighbor);
+            double sum = 0.0;
+            size_t count = 0;
+            float minHeight = std::numeric_limits<float>::max();
+            float maxHeight = std::numeric_limits<float>::lowest();
+
+            auto visitor = [&](VertexHandle neighbor) {
+                if (averageAngles)
+                {
+                    sum += (*averageAngles)[neighbor];
+                    count += 1;
+                }
+                if (heightDiff)
+                {
+                    auto curPos = mesh.getVertexPosition(neighbor);
+                    minHeight = std::min(minHeight, curPos.z);
+                    maxHeight = std::max(maxHeight, curPos.z);
+                }
+            };
+
+            if (hash)
+            {
+                hash->visitBall(vH, mesh.getVertexPosition(vH), radius, visitor);
+            }
+            else
+            {
+                walkLocalNeighborhood(mesh, *visited, stack, directNeighbors, localInvalid, vH, radius, visitor);
+            }
 
-            if (curPos.z < minHeight)
+            // Every vertex already has an entry, so these are plain writes
+            if (roughness)
             {
-                minHeight = curPos.z;
+                (*roughness)[vH] = count ? sum / count : 0;
             }
-            if (curPos.z > maxHeight)
+            if (heightDiff)
             {
-                maxHeight = curPos.z;
+                (*heightDiff)[vH] = maxHeight - minHeight;
             }
-        });
+            ++progressBatch;
+        }
 
-// Calculate the final height difference
-#pragma omp critical
+        #pragma omp critical
         {
-            heightDiff.insert(vH, maxHeight - minHeight);
-            ++progress;
+            invalid.insert(invalid.end(), localInvalid.begin(), localInvalid.end());
         }
     }
 
     if(!timestamp.isQuiet())
-    cout << endl;
+        cout << endl;
 
-  if (!invalid.empty())
+    parallelSortUnique(invalid);
+    if (!invalid.empty())
     {
         std::cerr << "Found " << invalid.size() << " invalid, non manifold "
             << "vertices." << std::endl;
     }
+}
+
+} // namespace geometry_detail
 
+template <typename BaseVecT>
+DenseVertexMap<float> calcVertexHeightDifferences(
+    const BaseMesh<BaseVecT> &mesh,
+    double radius,
+    LocalNeighborhood neighborhood)
+{
+    DenseVertexMap<float> heightDiff;
+    geometry_detail::calcLocalNeighborhoodValues(
+        mesh, radius, neighborhood, nullptr, nullptr, &heightDiff,
+        "Computing height differences..."
+    );
     return heightDiff;
 }
 
@@ -245,60 +562,16 @@ template <typename BaseVecT>
 DenseVertexMap<float> calcVertexRoughness(
     const BaseMesh<BaseVecT> &mesh,
     double radius,
-    const VertexMap<Normal<typename BaseVecT::CoordType>> &normals)
+    const VertexMap<Normal<typename BaseVecT::CoordType>> &normals,
+    LocalNeighborhood neighborhood)
 {
-    // We create a map to store the roughness for each vertex. We preallocate
-    // memory for all vertices. This is not only an optimization, but more
-    // importantly to avoid multithreading crashes. The parallelized loop
-    // further down inserts into this data structure; if there is no free
-    // memory left, it will reallocate which will crash horribly when multiple
-    // threads are involved.
-    DenseVertexMap<float> roughness;
-    roughness.reserve(mesh.nextVertexIndex());
-
     auto averageAngles = calcAverageVertexAngles(mesh, normals);
 
-    // Output
-    string msg = timestamp.getElapsedTime() + "Computing roughness";
-    ProgressBar progress(mesh.numVertices(), msg);
-    ++progress;
-
-    std::set<VertexHandle> invalid;
-
-// Calculate roughness for each vertex
-#pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
-    {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
-        {
-            continue;
-        }
-
-        float sum = 0.0;
-        size_t count = 0;
-
-        visitLocalVertexNeighborhood(mesh, invalid, vH, radius, [&](auto neighbor) {
-            sum += averageAngles[neighbor];
-            count += 1;
-        });
-
-#pragma omp critical
-        {
-            // Calculate the final roughness
-            roughness.insert(vH, count ? sum / count : 0);
-            ++progress;
-        }
-    }
-    if(!timestamp.isQuiet())
-        cout << endl;
-
-    if (!invalid.empty())
-    {
-        std::cerr << "Found " << invalid.size() << " invalid, non manifold "
-            << "vertices." << std::endl;
-    }
-    
+    DenseVertexMap<float> roughness;
+    geometry_detail::calcLocalNeighborhoodValues(
+        mesh, radius, neighborhood, &averageAngles, &roughness, nullptr,
+        "Computing roughness"
+    );
     return roughness;
 }
 
@@ -308,62 +581,15 @@ void calcVertexRoughnessAndHeightDifferences(
     double radius,
     const VertexMap<Normal<typename BaseVecT::CoordType>> &normals,
     DenseVertexMap<float> &roughness,
-    DenseVertexMap<float> &heightDiff)
+    DenseVertexMap<float> &heightDiff,
+    LocalNeighborhood neighborhood)
 {
-    // Reserving memory in those maps is important to avoid multi threading
-    // related crashes.
-    roughness.clear();
-    roughness.reserve(mesh.nextVertexIndex());
-    heightDiff.clear();
-    heightDiff.reserve(mesh.nextVertexIndex());
-
-    std::set<VertexHandle> invalid;
     auto averageAngles = calcAverageVertexAngles(mesh, normals);
 
-// Calculate roughness and height difference for each vertex
-#pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
-    {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
-        {
-            continue;
-        }
-
-        double sum = 0.0;
-        uint32_t count = 0;
-        float minHeight = std::numeric_limits<float>::max();
-        float maxHeight = std::numeric_limits<float>::lowest();
-
-        visitLocalVertexNeighborhood(mesh, invalid, vH, radius, [&](auto neighbor) {
-            sum += averageAngles[neighbor];
-            count += 1;
-
-            auto curPos = mesh.getVertexPosition(neighbor);
-            if (curPos.z < minHeight)
-            {
-                minHeight = curPos.z;
-            }
-            if (curPos.z > maxHeight)
-            {
-                maxHeight = curPos.z;
-            }
-        });
-
-#pragma omp critical
-        {
-            // Calculate the final roughness
-            roughness.insert(vH, count ? sum / count : 0);
-
-            // Calculate the final height difference
-            heightDiff.insert(vH, maxHeight - minHeight);
-        }
-    }
-    if (!invalid.empty())
-    {
-        std::cerr << "Found " << invalid.size() << " invalid, non manifold "
-            << "vertices." << std::endl;
-    }
+    geometry_detail::calcLocalNeighborhoodValues(
+        mesh, radius, neighborhood, &averageAngles, &roughness, &heightDiff,
+        "Computing roughness and height differences"
+    );
 }
 
 template <typename BaseVecT>
@@ -37,11 +37,15 @@
 
 #include "lvr2/algorithm/Texturizer.hpp"
 #include "lvr2/geometry/Normal.hpp"
+#include "lvr2/io/Timestamp.hpp"
 
 #include "lvr2/registration/TransformUtils.hpp"
 #include "lvr2/types/MatrixTypes.hpp"
 #include "lvr2/types/ScanTypes.hpp"
 
+#include <unordered_map>
+#include <vector>
+
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 
@@ -51,6 +55,14 @@ namespace lvr2
 /**
  * @brief A texturizer that uses images instead of pointcloud colors for creating the textures
  *        for meshes.
+ *
+ * All images of the scan project are prepared once before the first texture is
+ * generated: each image gets a precomputed 3x4 projection matrix from project
+ * coordinates to undistorted pixel coordinates and each camera gets a lookup
+ * table that maps undistorted to distorted pixel coordinates. For every cluster
+ * the bounding rectangle is then rasterized into the frustum of each image to
+ * find the images that can see it at all, so the texels of a cluster are only
+ * sampled from these candidate images, best view first.
  */
 template<typename BaseVecT>
 class ImageTexturizer : public Texturizer<BaseVecT> 
@@ -78,6 +90,10 @@ public:
     void set_project(ScanProject& project)
     {
         this->project = project;
+        this->images.clear();
+        this->luts.clear();
+        this->candidate_index.clear();
+        image_data_initialized = false;
     }
 
     /**
@@ -97,21 +113,76 @@ public:
         const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
     ) override;
 
+    /**
+     * @brief Returns the indices of the images that were used as candidates
+     *        for the texture with the given index, best view first. The list
+     *        is empty if no texture with this index was generated.
+     */
+    const std::vector<size_t>& candidate_images(int index) const;
+
 private:
     /// @cond internal
+
+    /// Maps undistorted to distorted pixel coordinates of one camera
+    struct DistortionLut
+    {
+        double fx, fy, cx, cy;
+
+        /// Distortion coefficients in OpenCV order (k1, k2, p1, p2, k3, k4, k5, k6)
+        double k[8];
+
+        /// False if the camera has no (known) distortion model
+        bool distorted;
+
+        /// Grid spacing in pixels and position of the first grid node
+        int step;
+        double origin_u, origin_v;
+        int cols, rows;
+
+        /// Distorted (u, v) pairs for every grid node, row major
+        std::vector<float> map;
+    };
+
+    /// An image together with everything needed to project into it
+    struct ProjectedImage
+    {
+        cv::Mat data;
+
+        /// Project coordinates to undistorted (homogeneous) pixel coordinates
+        Eigen::Matrix<double, 3, 4> projection;
+
+        /// Camera center and viewing direction in project coordinates
+        Eigen::Vector3d pos;
+        Eigen::Vector3d dir;
+
+        /// Homogeneous planes bounding the frustum covered by the lookup table
+        Eigen::Matrix<double, 5, 4> frustum;
+
+        /// Index into luts
+        size_t lut;
+    };
+
     ScanProject project;
 
     bool image_data_initialized;
-    std::vector<ScanImage> images;
+    std::vector<ProjectedImage> images;
+    std::vector<DistortionLut> luts;
+
+    /// Texture index -> candidate images
+    std::unordered_map<int, std::vector<size_t>> candidate_index;
 
     void init_image_data();
 
-    template<typename ValueType>
-    void undistorted_to_distorted_uv(ValueType &u, ValueType &v, const ScanImage &img);
+    void init_lut(DistortionLut& lut, const PinholeModeld& camera, int width, int height);
+
+    std::vector<size_t> find_candidate_images(
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect) const;
+
+    static void distort_exact(double &u, double &v, const DistortionLut &lut);
 
-    bool exclude_image(BaseVecT pos, const ScanImage &image_data);
+    void undistorted_to_distorted_uv(double &u, double &v, const DistortionLut &lut) const;
 
-    bool point_behind_camera(BaseVecT pos, const ScanImage &image_data);
+    bool project_to_image(const Eigen::Vector3d& p, const ProjectedImage& img, int& col, int& row) const;
     /// @endcond
 };
 
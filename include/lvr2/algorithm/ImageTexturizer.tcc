@@ -25,33 +25,200 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <tuple>
+
 namespace lvr2
 {
 
 template<typename BaseVecT>
-bool ImageTexturizer<BaseVecT>::exclude_image(BaseVecT pos, const ScanImage &image_data)
+const std::vector<size_t>& ImageTexturizer<BaseVecT>::candidate_images(int index) const
+{
+    static const std::vector<size_t> none;
+
+    auto it = candidate_index.find(index);
+    return it == candidate_index.end() ? none : it->second;
+}
+
+template<typename BaseVecT>
+void ImageTexturizer<BaseVecT>::distort_exact(double &u, double &v, const DistortionLut &lut)
+{
+    const double* k = lut.k;
+
+    double x = (u - lut.cx) / lut.fx;
+    double y = (v - lut.cy) / lut.fy;
+
+    double r_2 = x * x + y * y;
+    double r_4 = r_2 * r_2;
+    double r_6 = r_4 * r_2;
+
+    double radial = (1.0 + k[0] * r_2 + k[1] * r_4 + k[4] * r_6)
+                  / (1.0 + k[5] * r_2 + k[6] * r_4 + k[7] * r_6);
+
+    double xd = x * radial + 2.0 * k[2] * x * y + k[3] * (r_2 + 2.0 * x * x);
+    double yd = y * radial + k[2] * (r_2 + 2.0 * y * y) + 2.0 * k[3] * x * y;
+
+    u = xd * lut.fx + lut.cx;
+    v = yd * lut.fy + lut.cy;
+}
+
+template<typename BaseVecT>
+void ImageTexturizer<BaseVecT>::undistorted_to_distorted_uv(
+    double &u,
+    double &v,
+    const DistortionLut &lut) const
 {
-    if (point_behind_camera(pos, image_data)) {
-        return true;
+    if (!lut.distorted)
+    {
+        return;
+    }
+
+    double gu = (u - lut.origin_u) / lut.step;
+    double gv = (v - lut.origin_v) / lut.step;
+
+    int c = static_cast<int>(std::floor(gu));
+    int r = static_cast<int>(std::floor(gv));
+
+    // Outside of the table: fall back to the exact model
+    if (c < 0 || r < 0 || c >= lut.cols - 1 || r >= lut.rows - 1)
+    {
+        distort_exact(u, v, lut);
+        return;
     }
 
-    // @TODO raytracing for objects between point and camera...
+    double a = gu - c;
+    double b = gv - r;
 
-    return false;
+    const float* n00 = &lut.map[2 * (r * lut.cols + c)];
+    const float* n01 = n00 + 2;
+    const float* n10 = n00 + 2 * lut.cols;
+    const float* n11 = n10 + 2;
+
+    u = (1 - b) * ((1 - a) * n00[0] + a * n01[0]) + b * ((1 - a) * n10[0] + a * n11[0]);
+    v = (1 - b) * ((1 - a) * n00[1] + a * n01[1]) + b * ((1 - a) * n10[1] + a * n11[1]);
 }
 
 template<typename BaseVecT>
-bool ImageTexturizer<BaseVecT>::point_behind_camera(BaseVecT pos, const ScanImage &image_data)
+bool ImageTexturizer<BaseVecT>::project_to_image(
+    const Eigen::Vector3d& p,
+    const ProjectedImage& img,
+    int& col,
+    int& row) const
 {
-    BaseVecT diff = image_data.pos - pos;
-    
-    Normal<double> norm(diff.x, diff.y, diff.z);
-    norm.normalize();
-    if (norm.dot(image_data.dir) >= 0.0f) {
-        return true;
+    Eigen::Vector3d proj = img.projection * p.homogeneous(); // [s * u, s * v, s]
+
+    // Point is behind the camera
+    if (proj[2] <= 0.0)
+    {
+        return false;
     }
 
-    return false;
+    double u = proj[0] / proj[2];
+    double v = proj[1] / proj[2];
+
+    undistorted_to_distorted_uv(u, v, luts[img.lut]);
+
+    if (!(u >= 0.0 && v >= 0.0))
+    {
+        return false;
+    }
+
+    col = static_cast<int>(u);
+    row = static_cast<int>(v);
+
+    return col < img.data.cols && row < img.data.rows;
+}
+
+template<typename BaseVecT>
+std::vector<size_t> ImageTexturizer<BaseVecT>::find_candidate_images(
+    const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect) const
+{
+    // Samples per side used to rasterize the rectangle into each frustum
+    const int samples = 5;
+
+    auto rectPoint = [&](double a, double b)
+    {
+        BaseVecT p = boundingRect.m_supportVector
+            + boundingRect.m_vec1 * (boundingRect.m_minDistA + a * (boundingRect.m_maxDistA - boundingRect.m_minDistA))
+            + boundingRect.m_vec2 * (boundingRect.m_minDistB + b * (boundingRect.m_maxDistB - boundingRect.m_minDistB));
+        return Eigen::Vector3d(p.x, p.y, p.z);
+    };
+
+    Eigen::Vector4d corners[4] = {
+        rectPoint(0, 0).homogeneous(),
+        rectPoint(1, 0).homogeneous(),
+        rectPoint(0, 1).homogeneous(),
+        rectPoint(1, 1).homogeneous()
+    };
+    Eigen::Vector3d center = rectPoint(0.5, 0.5);
+    Eigen::Vector3d normal(boundingRect.m_normal.x, boundingRect.m_normal.y, boundingRect.m_normal.z);
+
+    // (coverage, view quality, image)
+    std::vector<std::tuple<int, double, size_t>> found;
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        const ProjectedImage& img = images[i];
+
+        // Conservative rejection: all corners outside of one frustum plane
+        bool outside = false;
+        for (int plane = 0; plane < 5 && !outside; plane++)
+        {
+            outside = true;
+            for (const Eigen::Vector4d& corner : corners)
+            {
+                if (img.frustum.row(plane).dot(corner) >= 0.0)
+                {
+                    outside = false;
+                    break;
+                }
+            }
+        }
+        if (outside)
+        {
+            continue;
+        }
+
+        // Rasterize the rectangle into the image to estimate how much of it is covered
+        int coverage = 0;
+        for (int sy = 0; sy < samples; sy++)
+        {
+            for (int sx = 0; sx < samples; sx++)
+            {
+                int col, row;
+                if (project_to_image(rectPoint(sx / (samples - 1.0), sy / (samples - 1.0)), img, col, row))
+                {
+                    coverage++;
+                }
+            }
+        }
+
+        // Prefer close cameras looking straight onto the rectangle
+        Eigen::Vector3d toCam = img.pos - center;
+        double dist = toCam.norm();
+        double quality = dist > 0.0 ? std::abs(normal.dot(toCam)) / (dist * dist) : 0.0;
+
+        found.emplace_back(coverage, quality, i);
+    }
+
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b)
+    {
+        if (std::get<0>(a) != std::get<0>(b))
+        {
+            return std::get<0>(a) > std::get<0>(b);
+        }
+        return std::get<1>(a) > std::get<1>(b);
+    });
+
+    std::vector<size_t> candidates;
+    candidates.reserve(found.size());
+    for (const auto& f : found)
+    {
+        candidates.push_back(std::get<2>(f));
+    }
+    return candidates;
 }
 
 template<typename BaseVecT>
@@ -68,107 +235,54 @@ TextureHandle ImageTexturizer<BaseVecT>::generateTexture(
     // Create texture
     Texture texture(index, sizeX, sizeY, 3, 1, this->m_texelSize);
 
-    cout << "images: " << images.size() << endl;
-
     // load images if not already done
     if (!image_data_initialized)
     {
         this->init_image_data();
     }
 
-
+    std::vector<size_t> candidates;
     if (image_data_initialized)
     {
-        #pragma omp parallel for collapse(2)
+        candidates = find_candidate_images(boundingRect);
+    }
+
+    if (!candidates.empty())
+    {
+        #pragma omp parallel for schedule(dynamic)
         for (int y = 0; y < sizeY; y++)
         {
             for (int x = 0; x < sizeX; x++)
             {
-
                 BaseVecT currentPos =
                     boundingRect.m_supportVector
                     + boundingRect.m_vec1 * (x * this->m_texelSize + boundingRect.m_minDistA - this->m_texelSize / 2.0)
                     + boundingRect.m_vec2 * (y * this->m_texelSize + boundingRect.m_minDistB - this->m_texelSize / 2.0);
 
-                int c = 0;
+                Eigen::Vector3d p(currentPos[0], currentPos[1], currentPos[2]);
 
                 // Init pixel with red color
                 texture.m_data[(sizeX * y + x) * 3 + 0] = 255;
                 texture.m_data[(sizeX * y + x) * 3 + 1] = 0;
                 texture.m_data[(sizeX * y + x) * 3 + 2] = 0;
 
-                for (const ImageData<BaseVecT> &img_data : images)
+                // @TODO raytracing for objects between point and camera...
+                for (size_t i : candidates)
                 {
-                    
-                    double ac_angle = (36.0 + 72.0 * c);
-                    ac_angle *= (M_PI/180.0);
-
-                    Eigen::Vector3d direction(1.0, 0.0, 0.0);
-                    Eigen::Matrix3d angle_rot;
-                    angle_rot = Eigen::AngleAxisd(ac_angle, Eigen::Vector3d::UnitZ());
-
-                    Eigen::Vector3d p(currentPos[0], currentPos[1], currentPos[2]);
-
-                    Intrinsicsd intrinsics;
-                    intrinsics  <<
-                        2395.4336550315002 , 0 , 3027.8728609530291 ,         // UOS
-                        0 , 2393.3126174899603 , 2031.02743729632 ,
-                        0 , 0 , 1;
-
-                    Transformd tmp; 
-                    tmp << -0.16570779, -0.00014603, 0.98617489, -0.19101685,
-                        -0.02101020, -0.99977249, -0.00367840, -0.00125086,
-                        0.98595106, -0.02132927,  0.16566702, -0.05212102,
-                        0, 0, 0, 1;
-
-//                    img_data.extrinsics = tmp;
-
-                    //cout << "Projection: " << intrinsics << endl;
+                    const ProjectedImage& img = images[i];
 
-                    p = angle_rot * p;
-
-                    //cout << "P:" << p << endl;
-
-                    double angle = p.dot(direction);
-
-                    if (angle > 0) // is in view direction
+                    int col, row;
+                    if (project_to_image(p, img, col, row))
                     {
-                        // TODO I think this should maybe be done in homogeneous coords
-                        p = tmp.block<3, 3>(0, 0) * p; // rotation
-                        p = p + tmp.block<3, 1>(0, 3); // translation
-
-                        Eigen::Vector3d proj = intrinsics * p; // [s * u, s * v, s * 1] = s * [u, v, 1]
-                        proj /= proj[2];                       //  (s * [u, v, 1] ) / s
-
-                        //cout << "Undist: " << proj[0] << " " << proj[1] << endl;
-
-                        undistorted_to_distorted_uv(proj[0], proj[1], img_data);
-
-                        //cout << "Dist:   " << proj[0] << " " << proj[1] << endl;
-
-                        // TODO fix negated logic...
-                        // if (proj[0] < 0 || std::floor(proj[0]) >= img_data.data.cols ||
-                        //     proj[1] < 0 || std::floor(proj[1]) >= img_data.data.rows)
-                        
-                        // Check if projected point is within current image
-                        if(std::floor(proj[0]) < img_data.data.cols && std::floor(proj[1]) < img_data.data.rows)
-                        {
-                            // Visibility check
-                            if(proj[0] >= 0  && proj[1] >= 0 )
-                            {
-                                cv::Vec3b p = img_data.data.template at<cv::Vec3b>(std::floor(proj[1]), std::floor(proj[0]));
-                                texture.m_data[(sizeX * y + x) * 3 + 0] = p[2];
-                                texture.m_data[(sizeX * y + x) * 3 + 1] = p[1];
-                                texture.m_data[(sizeX * y + x) * 3 + 2] = p[0];
-
-                                // We found a valid value for this point so we can stop
-                                // for know. For later optimization a best found point
-                                // should be used
-                                break;
-                            }
-                        }
+                        const cv::Vec3b& c = img.data.template at<cv::Vec3b>(row, col);
+                        texture.m_data[(sizeX * y + x) * 3 + 0] = c[2];
+                        texture.m_data[(sizeX * y + x) * 3 + 1] = c[1];
+                        texture.m_data[(sizeX * y + x) * 3 + 2] = c[0];
+
+                        // Candidates are sorted best view first, so the
+                        // first hit is the one we want
+                        break;
                     }
-                    c++;
                 }
             }
         }
@@ -187,80 +301,160 @@ TextureHandle ImageTexturizer<BaseVecT>::generateTexture(
 
     }
 
+    candidate_index[index] = std::move(candidates);
+
     return this->m_textures.push(texture);
 }
 
 template<typename BaseVecT>
-void ImageTexturizer<BaseVecT>::init_image_data()
+void ImageTexturizer<BaseVecT>::init_lut(
+    DistortionLut& lut,
+    const PinholeModeld& camera,
+    int width,
+    int height)
 {
-    // orthogonal projection matrix is the same for every image
-    for (const ScanPosition &pos : project.scans)
+    lut.fx = camera.fx;
+    lut.fy = camera.fy;
+    lut.cx = camera.cx;
+    lut.cy = camera.cy;
+
+    std::fill(lut.k, lut.k + 8, 0.0);
+    lut.distorted = false;
+    if (camera.distortionModel == "opencv")
     {
-        for (const ImageFile &img : pos.images)
+        for (size_t i = 0; i < camera.k.size() && i < 8; i++)
         {
-            ImageData<BaseVecT> image_data;
+            lut.k[i] = camera.k[i];
+            lut.distorted |= (camera.k[i] != 0.0);
+        }
+    }
 
-            cout << "INIT ADD: " << img.image_file.string() << endl;
+    // The table also covers a border around the image because
+    // barrel distortion pulls points from outside into the image
+    lut.step = 8;
+    int marginU = width / 4;
+    int marginV = height / 4;
+    lut.origin_u = -marginU;
+    lut.origin_v = -marginV;
+    lut.cols = (width + 2 * marginU) / lut.step + 2;
+    lut.rows = (height + 2 * marginV) / lut.step + 2;
+
+    lut.map.clear();
+    if (!lut.distorted)
+    {
+        return;
+    }
+
+    lut.map.resize(2 * static_cast<size_t>(lut.cols) * lut.rows);
+
+    #pragma omp parallel for
+    for (int r = 0; r < lut.rows; r++)
+    {
+        for (int c = 0; c < lut.cols; c++)
+        {
+            double u = lut.origin_u + c * lut.step;
+            double v = lut.origin_v + r * lut.step;
+            distort_exact(u, v, lut);
+            lut.map[2 * (r * lut.cols + c) + 0] = u;
+            lut.map[2 * (r * lut.cols + c) + 1] = v;
+        }
+    }
+}
 
-            //load image
-            image_data.data = cv::imread(img.image_file.string(), CV_LOAD_IMAGE_COLOR);
+template<typename BaseVecT>
+void ImageTexturizer<BaseVecT>::init_image_data()
+{
+    images.clear();
+    luts.clear();
 
-            cv::rotate(image_data.data, image_data.data, cv::ROTATE_90_CLOCKWISE);
+    for (const ScanPositionPtr &pos : project.positions)
+    {
+        if (!pos)
+        {
+            continue;
+        }
 
-            // skip image if we weren't able to load it
-            if (image_data.data.empty())
+        for (const ScanCameraPtr &cam : pos->cams)
+        {
+            if (!cam)
             {
                 continue;
             }
 
-            for (int i = 0; i < 6; i++)
-            {
-                image_data.distortion_params[i] = img.distortion_params[i];
-            }
+            // All images of one camera share the intrinsics and thus the lookup table
+            size_t lutIndex = luts.size();
+            bool lutInitialized = false;
 
-            for (int i = 0; i < 4; i++)
+            for (const ScanImagePtr &img : cam->images)
             {
-                image_data.intrinsic_params[i] = img.intrinsic_params[i];
-            }
+                if (!img)
+                {
+                    continue;
+                }
+
+                ProjectedImage image_data;
+
+                //load image
+                image_data.data = img->image;
+                if (image_data.data.empty() && !img->imageFile.empty())
+                {
+                    image_data.data = cv::imread(img->imageFile.string(), cv::IMREAD_COLOR);
+                }
+
+                // skip image if we weren't able to load it
+                if (image_data.data.empty() || image_data.data.type() != CV_8UC3)
+                {
+                    std::cout << timestamp << "ImageTexturizer: Skipping image '"
+                              << img->imageFile.string() << "'." << std::endl;
+                    continue;
+                }
+
+                int width = image_data.data.cols;
+                int height = image_data.data.rows;
 
-            //calculate transformation matrix
-            Intrinsicsd pro;
-            double* projection = pro.data();
-            projection[0] = img.intrinsic_params[0];
-            projection[5] = img.intrinsic_params[1];
-            projection[2] = img.intrinsic_params[2];
-            projection[6] = img.intrinsic_params[3];
-
-            //Transformd transform;
-            image_data.orientation = img.orientation_transform.transpose();
-            image_data.extrinsics = img.extrinsic_transform.transpose();
- 
-            //Transformd orientation = img.orientation_transform;
-
-            // because matrix multipl. is CM and our matrices are RM we have to do it this way
-            // transform = lvr2::slam6dToLvr(pos.transform).inverse();
-            // transform = transform * orientation.inverse();
-            // transform = transform * img.extrinsic_transform;
-            // Transformd transform_inverse = transform.inverse();
-            // transform_inverse.transposeInPlace();
-
-            //caluclate cam direction and cam pos for image in project space
-            BaseVecT cam_pos(0.0f, 0.0f, 0.0f);
-            Normal<double> cam_dir(0.0f, 0.0f, 1.0f);
-            // cam_pos = transform_inverse * cam_pos;
-            // cam_dir = transform_inverse * cam_dir;
-
-            image_data.pos = cam_pos;
-            image_data.dir = cam_dir;
-
-            // transform from project space to image space incl orthogonal projection
-            // image_data.project_to_image_transform = transform * pro;
-            // image_data.project_to_image_transform.transposeInPlace();
-
-            images.push_back(image_data);
+                if (!lutInitialized)
+                {
+                    luts.emplace_back();
+                    init_lut(luts.back(), cam->camera, width, height);
+                    lutInitialized = true;
+                }
+                image_data.lut = lutIndex;
+
+                Intrinsicsd intrinsics;
+                intrinsics <<
+                    cam->camera.fx, 0, cam->camera.cx,
+                    0, cam->camera.fy, cam->camera.cy,
+                    0, 0, 1;
+
+                // Camera to project coordinates and its inverse
+                Transformd camToProject = pos->registration * img->extrinsics;
+                Transformd projectToCam = camToProject.inverse();
+
+                image_data.projection = intrinsics * projectToCam.block<3, 4>(0, 0);
+                image_data.pos = camToProject.block<3, 1>(0, 3);
+                image_data.dir = camToProject.block<3, 1>(0, 2).normalized();
+
+                // Planes of the frustum covered by the lookup table:
+                // u >= umin, u <= umax, v >= vmin, v <= vmax, in front of the camera
+                const DistortionLut& lut = luts[lutIndex];
+                double umin = lut.origin_u;
+                double vmin = lut.origin_v;
+                double umax = width - lut.origin_u;
+                double vmax = height - lut.origin_v;
+                const auto& P = image_data.projection;
+                image_data.frustum.row(0) = P.row(0) - umin * P.row(2);
+                image_data.frustum.row(1) = umax * P.row(2) - P.row(0);
+                image_data.frustum.row(2) = P.row(1) - vmin * P.row(2);
+                image_data.frustum.row(3) = vmax * P.row(2) - P.row(1);
+                image_data.frustum.row(4) = P.row(2);
+
+                images.push_back(image_data);
+            }
         }
     }
 
+    std::cout << timestamp << "ImageTexturizer: Prepared " << images.size() << " images." << std::endl;
+
     // only if we have images we should try to texturize with them...
     if (!images.empty())
     {
@@ -268,42 +462,4 @@ void ImageTexturizer<BaseVecT>::init_image_data()
     }
 }
 
-template<typename BaseVecT>
-template<typename ValueType>
-void ImageTexturizer<BaseVecT>::undistorted_to_distorted_uv(
-    ValueType &u,
-    ValueType &v,
-    const ImageData<BaseVecT> &img)
-{
-    ValueType x, y, ud, vd, r_2, r_4, r_6, r_8, fx, fy, Cx, Cy, k1, k2, k3, k4, p1, p2;
-
-    fx = img.intrinsic_params[0];
-    fy = img.intrinsic_params[1];
-    Cx = img.intrinsic_params[2];
-    Cy = img.intrinsic_params[3];
-
-    k1 = img.distortion_params[0];
-    k2 = img.distortion_params[1];
-    k3 = img.distortion_params[2];
-    k4 = img.distortion_params[3];
-    p1 = img.distortion_params[4];
-    p2 = img.distortion_params[5];
-
-    x = (u - Cx)/fx;
-    y = (v - Cy)/fy;
-
-    //r_2 = std::pow(x, 2) + std::pow(y, 2);
-    //r_2 = std::atan(std::sqrt(std::pow(x, 2) + std::pow(y, 2)));
-    r_2 = std::pow(std::atan(std::sqrt(std::pow(x, 2) + std::pow(y, 2))), 2);
-    r_4 = std::pow(r_2, 2);
-    r_6 = std::pow(r_2, 3);
-    r_8 = std::pow(r_2, 4);
-
-    ud = u + x*fx*(k1*r_2 + k2*r_4 + k3*r_6 + k4*r_8) + 2*fx*x*y*p1 + p2*fx*(r_2 + 2*std::pow(x, 2));
-    vd = v + y*fy*(k1*r_2 + k2*r_4 + k3*r_6 + k4*r_8) + 2*fy*x*y*p2 + p1*fy*(r_2 + 2*std::pow(y, 2));
-
-    u = ud;
-    v = vd;
-}
-
 } // namespace lvr2
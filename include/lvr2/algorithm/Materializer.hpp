@@ -47,6 +47,7 @@
 #include "lvr2/reconstruction/PointsetSurface.hpp"
 #include "lvr2/texture/ClusterTexCoordMapping.hpp"
 #include "lvr2/texture/Texture.hpp"
+#include "lvr2/texture/TextureAtlas.hpp"
 #include "lvr2/util/ClusterBiMap.hpp"
 #include "lvr2/texture/Material.hpp"
 #include "lvr2/geometry/BoundingRectangle.hpp"
@@ -154,6 +155,18 @@ public:
      */
     void setTexturizer(Texturizer<BaseVecT>& texturizer);
 
+    /**
+     * @brief Enables packing of the generated textures into a texture atlas
+     *
+     * Instead of one texture per cluster, `generateMaterials()` then returns a few atlas pages of at most
+     * `pageSize` x `pageSize` texels (see `packTextureAtlas()`). The materials refer to the pages and the
+     * texture coordinates are remapped accordingly.
+     *
+     * @param pageSize The maximum edge length of an atlas page; 0 disables the atlas
+     * @param padding The number of texels around each texture that repeat its border
+     */
+    void setTextureAtlas(unsigned int pageSize, unsigned int padding = 2);
+
     /**
      * @brief Generates materials
      *
@@ -174,12 +187,24 @@ public:
     MaterializerResult<BaseVecT> generateMaterials();
 
     /**
-     * @brief Saves the textures by calling the `saveTextures()` method of the texturizer
+     * @brief Saves the textures by calling the `saveTextures()` method of the texturizer, or the atlas pages
+     *        if a texture atlas was generated
      */
     void saveTextures();
 
 private:
 
+    /**
+     * @brief Packs `textures` into atlas pages and updates the materials and texture coordinates
+     *
+     * @return The atlas pages
+     */
+    StableVector<TextureHandle, Texture> packTextures(
+        const StableVector<TextureHandle, Texture>& textures,
+        DenseClusterMap<Material>& clusterMaterials,
+        SparseVertexMap<ClusterTexCoordMapping>& vertexTexCoords
+    );
+
     /// Mesh
     const BaseMesh<BaseVecT>& m_mesh;
     /// Clusters
@@ -192,6 +217,13 @@ private:
     /// Texturizer
     boost::optional<Texturizer<BaseVecT>&> m_texturizer;
 
+    /// Maximum edge length of an atlas page, 0 if no atlas is generated
+    unsigned int m_atlasPageSize;
+    /// Padding around each texture in the atlas
+    unsigned int m_atlasPadding;
+    /// The atlas pages of the last call to `generateMaterials()`
+    boost::optional<StableVector<TextureHandle, Texture>> m_atlasPages;
+
 };
 
 } // namespace lvr2
@@ -51,7 +51,9 @@ Materializer<BaseVecT>::Materializer(
     m_mesh(mesh),
     m_cluster(cluster),
     m_normals(normals),
-    m_surface(surface)
+    m_surface(surface),
+    m_atlasPageSize(0),
+    m_atlasPadding(2)
 {
 }
 
@@ -61,15 +63,86 @@ void Materializer<BaseVecT>::setTexturizer(Texturizer<BaseVecT>& texturizer)
     m_texturizer = texturizer;
 }
 
+template<typename BaseVecT>
+void Materializer<BaseVecT>::setTextureAtlas(unsigned int pageSize, unsigned int padding)
+{
+    m_atlasPageSize = pageSize;
+    m_atlasPadding = padding;
+}
+
 template<typename BaseVecT>
 void Materializer<BaseVecT>::saveTextures()
 {
-    if (m_texturizer)
+    if (m_atlasPages)
+    {
+        for (auto h : m_atlasPages.get())
+        {
+            m_atlasPages.get()[h].save();
+        }
+    }
+    else if (m_texturizer)
     {
         m_texturizer.get().saveTextures();
     }
 }
 
+template<typename BaseVecT>
+StableVector<TextureHandle, Texture> Materializer<BaseVecT>::packTextures(
+    const StableVector<TextureHandle, Texture>& textures,
+    DenseClusterMap<Material>& clusterMaterials,
+    SparseVertexMap<ClusterTexCoordMapping>& vertexTexCoords
+)
+{
+    // Texture handle -> position in the list of textures to pack
+    std::vector<const Texture*> textureList;
+    std::vector<size_t> textureSlot(textures.size(), 0);
+    for (auto texH : textures)
+    {
+        textureSlot[texH.idx()] = textureList.size();
+        textureList.push_back(&textures[texH]);
+    }
+
+    std::vector<AtlasRegion> regions;
+    std::vector<Texture> pages = packTextureAtlas(textureList, m_atlasPageSize, m_atlasPadding, regions);
+
+    StableVector<TextureHandle, Texture> atlas;
+    std::vector<TextureHandle> pageHandles;
+    for (auto& page : pages)
+    {
+        pageHandles.push_back(atlas.push(std::move(page)));
+    }
+
+    // Texture coordinates of the cluster textures -> coordinates in the pages
+    for (auto vertexH : vertexTexCoords)
+    {
+        ClusterTexCoordMapping& mapping = vertexTexCoords[vertexH];
+        for (size_t i = 0; i < mapping.size(); i++)
+        {
+            const Material& material = clusterMaterials[mapping[i].first];
+            if (material.m_texture)
+            {
+                const AtlasRegion& region = regions[textureSlot[material.m_texture.get().idx()]];
+                mapping[i].second = region.mapTexCoords(mapping[i].second);
+            }
+        }
+    }
+
+    // Let the materials refer to the pages
+    for (auto clusterH : clusterMaterials)
+    {
+        Material& material = clusterMaterials[clusterH];
+        if (material.m_texture)
+        {
+            material.m_texture = pageHandles[regions[textureSlot[material.m_texture.get().idx()]].m_page];
+        }
+    }
+
+    cout << timestamp << "Packed " << textureList.size() << " textures into "
+         << pages.size() << " atlas pages" << endl;
+
+    return atlas;
+}
+
 template<typename BaseVecT>
 MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
 {
@@ -265,9 +338,17 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
 
         cout << timestamp << "Generated " << textureCount << " textures" << endl;
 
+        StableVector<TextureHandle, Texture> textures = m_texturizer.get().getTextures();
+        m_atlasPages = boost::none;
+        if (m_atlasPageSize > 0)
+        {
+            textures = packTextures(textures, clusterMaterials, vertexTexCoords);
+            m_atlasPages = textures;
+        }
+
         return MaterializerResult<BaseVecT>(
             clusterMaterials,
-            m_texturizer.get().getTextures(),
+            textures,
             vertexTexCoords,
             keypoints_map
         );
@@ -43,6 +43,7 @@
 #include "lvr2/util/ClusterBiMap.hpp"
 #include "lvr2/geometry/Normal.hpp"
 #include "lvr2/reconstruction/PointsetSurface.hpp"
+#include "lvr2/reconstruction/SearchTree.hpp"
 #include "lvr2/attrmaps/AttrMaps.hpp"
 
 namespace lvr2
@@ -82,16 +83,21 @@ boost::optional<Normal<typename BaseVecT::CoordType>> interpolatedVertexNormal(
  * @brief Calculates a normal for each vertex in the mesh.
  *
  * The normal is calculated by first attempting to interpolate from the
- * adjacent faces. If a vertex doesn't have adjacent faces, the normal from
- * the nearest point in the point cloud is used.
+ * adjacent faces. If a vertex doesn't have adjacent faces, the averaged normal
+ * of the `k` nearest points in the point cloud is used. Both steps run in
+ * parallel; the nearest neighbours are searched in batches.
  *
- * @param surface A point cloud with normal information
+ * @param surface   A point cloud with normal information
+ * @param k         The number of points to average
+ * @param weighting How the `k` points are weighted
  */
 template<typename BaseVecT>
 DenseVertexMap<Normal<typename BaseVecT::CoordType>> calcVertexNormals(
     const BaseMesh<BaseVecT>& mesh,
     const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
-    const PointsetSurface<BaseVecT>& surface
+    const PointsetSurface<BaseVecT>& surface,
+    int k = 1,
+    KnnWeighting weighting = KnnWeighting::UNIFORM
 );
 
 /**
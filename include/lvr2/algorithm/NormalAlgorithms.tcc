@@ -33,11 +33,15 @@
  * @author Johan M. von Behren <johan@vonbehren.eu>
  */
 
+#include <algorithm>
+#include <limits>
 #include <vector>
 
 using std::vector;
 
 #include "lvr2/geometry/Normal.hpp"
+#include "lvr2/util/Panic.hpp"
+#include "lvr2/util/Parallel.hpp"
 
 namespace lvr2
 {
@@ -102,54 +106,143 @@ template<typename BaseVecT>
 DenseVertexMap<Normal<typename BaseVecT::CoordType>> calcVertexNormals(
     const BaseMesh<BaseVecT>& mesh,
     const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
-    const PointsetSurface<BaseVecT>& surface
+    const PointsetSurface<BaseVecT>& surface,
+    int k,
+    KnnWeighting weighting
 )
 {
+    using CoordT = typename BaseVecT::CoordType;
 
-    DenseVertexMap<Normal<typename BaseVecT::CoordType>> normalMap;
-    normalMap.reserve(mesh.numVertices());
-
+    // Every vertex gets an entry up front, so the threads below only
+    // overwrite existing values
+    DenseVertexMap<Normal<CoordT>> normalMap;
+    normalMap.reserve(mesh.nextVertexIndex());
     for (auto vH: mesh.vertices())
     {
-        // Use averaged normals from adjacent faces
-        if (auto normal = interpolatedVertexNormal(mesh, normals, vH))
+        normalMap.insert(vH, Normal<CoordT>(0, 0, 1));
+    }
+
+    // Use averaged normals from adjacent faces and remember the vertices
+    // which need the point cloud instead
+    const long n = mesh.nextVertexIndex();
+    vector<uint8_t> fromPointCloud(n, 0);
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (long i = 0; i < n; i++)
+    {
+        VertexHandle vH(i);
+        if (!mesh.containsVertex(vH))
+        {
+            continue;
+        }
+        // Exceptions must not leave the parallel loop, so broken vertices
+        // use the point cloud as well
+        boost::optional<Normal<CoordT>> normal;
+        try
+        {
+            normal = interpolatedVertexNormal(mesh, normals, vH);
+        }
+        catch (lvr2::PanicException&)
+        {
+        }
+
+        if (normal)
         {
-            normalMap.insert(vH, *normal);
+            normalMap[vH] = *normal;
         }
         else
         {
-            // Fall back to normals from point cloud
-            if (!surface.pointBuffer()->hasNormals())
-            {
-                // The panic is justified here: in the process of creating the
-                // mesh, normals have to be estimated. These normals are
-                // written to the point buffer.
-                panic("the point buffer needs normals!");
-            }
+            fromPointCloud[i] = 1;
+        }
+    }
 
-            // Get idx for nearest point to vertex from point cloud
-            auto vertex = mesh.getVertexPosition(vH);
-            vector<size_t> pointIdx;
-            surface.searchTree()->kSearch(vertex, 1, pointIdx);
-            if (pointIdx.empty())
-            {
-                panic("no near point found!");
-            }
+    vector<Index> compact;
+    const size_t numFallback = compactIndices(n, [&](Index i) { return fromPointCloud[i] != 0; }, compact);
+    if (numFallback == 0)
+    {
+        return normalMap;
+    }
+
+    // Fall back to normals from point cloud
+    if (!surface.pointBuffer()->hasNormals())
+    {
+        // The panic is justified here: in the process of creating the
+        // mesh, normals have to be estimated. These normals are
+        // written to the point buffer.
+        panic("the point buffer needs normals!");
+    }
+    FloatChannelOptional pointNormals = surface.pointBuffer()->getFloatChannel("normals");
+    if (!pointNormals)
+    {
+        panic("no normal for point found!");
+    }
+
+    // Gather the positions of these vertices in one contiguous array
+    vector<Index> handles(numFallback);
+    vector<BaseVecT> positions(numFallback);
+
+    #pragma omp parallel for
+    for (long i = 0; i < n; i++)
+    {
+        if (compact[i] != INVALID_COMPACT_INDEX)
+        {
+            handles[compact[i]] = i;
+            positions[compact[i]] = mesh.getVertexPosition(VertexHandle(i));
+        }
+    }
+
+    // Search in batches to limit the memory needed for the results
+    auto searchTree = surface.searchTree();
+    const size_t batchSize = 1 << 20;
+    vector<size_t> indices;
+    vector<CoordT> distances;
+    bool missingNeighbor = false;
+    for (size_t begin = 0; begin < numFallback; begin += batchSize)
+    {
+        const size_t count = std::min(batchSize, numFallback - begin);
+        indices.resize(count * k);
+        distances.resize(count * k);
+        searchTree->kSearchMany(positions.data() + begin, count, k, indices.data(), distances.data());
 
-            // Get normal for nearest vertex neighbour from point cloud
-            FloatChannelOptional normals = surface.pointBuffer()->getFloatChannel("normals");
-            if(normals)
+        #pragma omp parallel for reduction(||:missingNeighbor)
+        for (long i = 0; i < (long)count; i++)
+        {
+            BaseVecT sum(0, 0, 0);
+            boost::optional<BaseVecT> nearest;
+
+            for (int j = 0; j < k; j++)
             {
-                Normal<typename BaseVecT::CoordType> normal = (*normals)[pointIdx[0]];
-                normalMap.insert(vH, normal);
+                size_t pointIdx = indices[i * k + j];
+                if (pointIdx == std::numeric_limits<size_t>::max())
+                {
+                    continue;
+                }
+                BaseVecT pointNormal = (*pointNormals)[pointIdx];
+                sum += pointNormal * knnWeight<CoordT>(weighting, distances[i * k + j]);
+                if (!nearest)
+                {
+                    nearest = pointNormal;
+                }
             }
-            else
+
+            if (!nearest)
             {
-                panic("no normal for point found!");
+                missingNeighbor = true;
+                continue;
             }
+
+            // Opposing normals may cancel out, use the nearest one then
+            normalMap[VertexHandle(handles[begin + i])] = sum.length2() > 0
+                ? Normal<CoordT>(sum)
+                : Normal<CoordT>(*nearest);
         }
     }
 
+    if (missingNeighbor)
+    {
+        panic("no near point found!");
+    }
+
     return normalMap;
 }
 
@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PathSearchContext.hpp
+ *
+ *  @date 18.10.2026
+ */
+
+#ifndef LVR2_ALGORITHM_PATHSEARCHCONTEXT_H_
+#define LVR2_ALGORITHM_PATHSEARCHCONTEXT_H_
+
+#include <cstdint>
+#include <list>
+#include <vector>
+
+#include "lvr2/attrmaps/AttrMaps.hpp"
+#include "lvr2/geometry/BaseMesh.hpp"
+#include "lvr2/geometry/Handles.hpp"
+#include "lvr2/util/Meap.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Reusable state for many shortest path queries on the same mesh.
+ *
+ * In contrast to `Dijkstra()`, nothing is allocated per query: the adjacency
+ * of the mesh is flattened into arrays once, distances and predecessors live
+ * in dense arrays indexed by vertex handle, and generation counters mark
+ * which entries belong to the current query, so the arrays never have to be
+ * cleared. The open set is a `Meap`, i.e. an indexed heap which supports
+ * decrease-key instead of lazy deletion.
+ *
+ * The mesh must not be changed while the context is in use. A context is not
+ * thread safe; use one context per thread for parallel queries.
+ */
+template<typename BaseVecT>
+class PathSearchContext
+{
+public:
+    /**
+     * @brief Prepares path searches on `mesh`.
+     *
+     * @param mesh       The mesh to search on
+     * @param edgeCosts  Non-negative cost of every edge, e.g. from `calcVertexDistances()`
+     */
+    PathSearchContext(const BaseMesh<BaseVecT>& mesh, const DenseEdgeMap<float>& edgeCosts);
+
+    /**
+     * @brief Replaces the edge costs used by all following queries.
+     */
+    void setEdgeCosts(const DenseEdgeMap<float>& edgeCosts);
+
+    /**
+     * @brief Excludes vertices from all following queries.
+     *
+     * Like in `Dijkstra()`, a vertex can't be entered if its cost is at
+     * least `lethalCost`. The start vertex of a query is never excluded.
+     */
+    void setVertexCosts(const DenseVertexMap<float>& vertexCosts, float lethalCost = 1);
+
+    /**
+     * @brief Sets the factor of the A* heuristic.
+     *
+     * The heuristic of a vertex is the euclidean distance to the goal times
+     * `scale`. Paths are only guaranteed to be optimal if no edge is cheaper
+     * than its length times `scale`. The default of 1 is correct for the
+     * edge costs of `calcVertexDistances()`.
+     */
+    void setHeuristicScale(float scale);
+
+    /**
+     * @brief Finds the cheapest path from `start` to `goal`.
+     *
+     * @param start     Start vertex
+     * @param goal      Goal vertex
+     * @param path      The path including `start` and `goal`, empty if there is none
+     * @param useAStar  Guide the search with the A* heuristic instead of
+     *                  running plain Dijkstra
+     *
+     * @return true if a path between start and goal exists
+     */
+    bool findPath(VertexHandle start, VertexHandle goal, std::list<VertexHandle>& path, bool useAStar = true);
+
+    /**
+     * @brief Computes the costs of the cheapest paths from `start` to all
+     *        `goals` with a single Dijkstra run.
+     *
+     * The search stops as soon as every goal is settled. Afterwards the path
+     * to each goal can be retrieved via `getPath()`.
+     *
+     * @param start  Start vertex
+     * @param goals  The goal vertices
+     * @param costs  Output: the path cost for every goal, infinity if it is unreachable
+     *
+     * @return The number of reachable goals
+     */
+    size_t findPaths(VertexHandle start, const std::vector<VertexHandle>& goals, std::vector<float>& costs);
+
+    /**
+     * @brief The cost of the cheapest path to `vH` found by the last query,
+     *        or infinity if `vH` was not settled by it.
+     */
+    float distance(VertexHandle vH) const;
+
+    /**
+     * @brief Reconstructs the path from the start of the last query to `goal`.
+     *
+     * @return false if `goal` was not settled by the last query
+     */
+    bool getPath(VertexHandle goal, std::list<VertexHandle>& path) const;
+
+private:
+    /// Starts a new query: invalidates all distances
+    void nextGeneration();
+
+    /// Whether `idx` was reached in the current query
+    bool reached(Index idx) const { return m_reachedStamp[idx] == m_generation; }
+
+    /// Whether `idx` was settled in the current query
+    bool settled(Index idx) const { return m_settledStamp[idx] == m_generation; }
+
+    /// The A* heuristic of `idx` for the goal at `goalPos`
+    float heuristic(Index idx, const BaseVecT& goalPos) const;
+
+    /**
+     * @brief Runs the search from `start` until `done(idx)` returns true for
+     *        a settled vertex or the open set is empty.
+     */
+    template<typename DoneF>
+    void search(VertexHandle start, const BaseVecT* goalPos, DoneF done);
+
+    /// Adjacency in compressed sparse row form: the neighbors of vertex `i`
+    /// are `m_targets[m_offsets[i]]` to `m_targets[m_offsets[i + 1] - 1]`
+    std::vector<size_t> m_offsets;
+    std::vector<Index> m_targets;
+    std::vector<Index> m_edges;
+    std::vector<float> m_costs;
+
+    /// Vertex positions for the heuristic
+    std::vector<BaseVecT> m_positions;
+
+    /// Vertices that can't be entered
+    std::vector<uint8_t> m_blocked;
+
+    /// Per-query state, valid where the matching stamp equals `m_generation`
+    std::vector<float> m_distances;
+    std::vector<Index> m_predecessors;
+    std::vector<uint32_t> m_reachedStamp;
+    std::vector<uint32_t> m_settledStamp;
+    uint32_t m_generation;
+
+    /// Goal markers for `findPaths()`
+    std::vector<uint32_t> m_goalStamp;
+
+    /// The open set, keyed by vertex with the (estimated) total cost as value
+    Meap<VertexHandle, float> m_open;
+
+    float m_heuristicScale;
+    Index m_start;
+};
+
+} // namespace lvr2
+
+#include "lvr2/algorithm/PathSearchContext.tcc"
+
+#endif /* LVR2_ALGORITHM_PATHSEARCHCONTEXT_H_ */
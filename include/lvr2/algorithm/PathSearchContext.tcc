@@ -0,0 +1,312 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PathSearchContext.tcc
+ *
+ *  @date 18.10.2026
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#include "lvr2/util/Panic.hpp"
+#include "lvr2/util/Parallel.hpp"
+
+namespace lvr2
+{
+
+template<typename BaseVecT>
+PathSearchContext<BaseVecT>::PathSearchContext(
+    const BaseMesh<BaseVecT>& mesh,
+    const DenseEdgeMap<float>& edgeCosts)
+    : m_generation(0)
+    , m_heuristicScale(1)
+    , m_start(0)
+{
+    const long n = mesh.nextVertexIndex();
+    m_offsets.assign(n + 1, 0);
+    m_positions.resize(n);
+
+    // Count the edges of every vertex
+    size_t invalid = 0;
+    #pragma omp parallel reduction(+:invalid)
+    {
+        std::vector<EdgeHandle> edges;
+
+        #pragma omp for schedule(dynamic, 1024)
+        for (long i = 0; i < n; i++)
+        {
+            VertexHandle vH(i);
+            if (!mesh.containsVertex(vH))
+            {
+                continue;
+            }
+            m_positions[i] = mesh.getVertexPosition(vH);
+
+            edges.clear();
+            try
+            {
+                mesh.getEdgesOfVertex(vH, edges);
+            }
+            catch (lvr2::PanicException&)
+            {
+                // Non manifold vertices are treated as isolated
+                edges.clear();
+                invalid++;
+            }
+            m_offsets[i] = edges.size();
+        }
+    }
+    if (invalid > 0)
+    {
+        std::cerr << "Found " << invalid << " invalid, non manifold "
+            << "vertices." << std::endl;
+    }
+
+    const size_t total = exclusivePrefixSum(m_offsets);
+    m_targets.resize(total);
+    m_edges.resize(total);
+
+    // Fill in the neighbors
+    #pragma omp parallel
+    {
+        std::vector<EdgeHandle> edges;
+
+        #pragma omp for schedule(dynamic, 1024)
+        for (long i = 0; i < n; i++)
+        {
+            if (m_offsets[i] == m_offsets[i + 1])
+            {
+                continue;
+            }
+            edges.clear();
+            mesh.getEdgesOfVertex(VertexHandle(i), edges);
+
+            size_t k = m_offsets[i];
+            for (auto eH : edges)
+            {
+                auto vertices = mesh.getVerticesOfEdge(eH);
+                m_targets[k] = vertices[0].idx() == Index(i) ? vertices[1].idx() : vertices[0].idx();
+                m_edges[k] = eH.idx();
+                k++;
+            }
+        }
+    }
+
+    m_blocked.assign(n, 0);
+    m_distances.resize(n);
+    m_predecessors.resize(n);
+    m_reachedStamp.assign(n, 0);
+    m_settledStamp.assign(n, 0);
+    m_goalStamp.assign(n, 0);
+    m_open = Meap<VertexHandle, float>(n);
+
+    setEdgeCosts(edgeCosts);
+}
+
+template<typename BaseVecT>
+void PathSearchContext<BaseVecT>::setEdgeCosts(const DenseEdgeMap<float>& edgeCosts)
+{
+    m_costs.resize(m_edges.size());
+
+    #pragma omp parallel for
+    for (long k = 0; k < (long)m_edges.size(); k++)
+    {
+        m_costs[k] = edgeCosts[EdgeHandle(m_edges[k])];
+    }
+}
+
+template<typename BaseVecT>
+void PathSearchContext<BaseVecT>::setVertexCosts(const DenseVertexMap<float>& vertexCosts, float lethalCost)
+{
+    #pragma omp parallel for
+    for (long i = 0; i < (long)m_blocked.size(); i++)
+    {
+        VertexHandle vH(i);
+        m_blocked[i] = vertexCosts.containsKey(vH) && vertexCosts[vH] >= lethalCost;
+    }
+}
+
+template<typename BaseVecT>
+void PathSearchContext<BaseVecT>::setHeuristicScale(float scale)
+{
+    m_heuristicScale = scale;
+}
+
+template<typename BaseVecT>
+void PathSearchContext<BaseVecT>::nextGeneration()
+{
+    if (++m_generation == 0)
+    {
+        // The counter wrapped around, so old stamps could look valid again
+        std::fill(m_reachedStamp.begin(), m_reachedStamp.end(), 0);
+        std::fill(m_settledStamp.begin(), m_settledStamp.end(), 0);
+        std::fill(m_goalStamp.begin(), m_goalStamp.end(), 0);
+        m_generation = 1;
+    }
+}
+
+template<typename BaseVecT>
+float PathSearchContext<BaseVecT>::heuristic(Index idx, const BaseVecT& goalPos) const
+{
+    return m_heuristicScale * m_positions[idx].distance(goalPos);
+}
+
+template<typename BaseVecT>
+template<typename DoneF>
+void PathSearchContext<BaseVecT>::search(VertexHandle start, const BaseVecT* goalPos, DoneF done)
+{
+    m_open.clear();
+
+    const Index startIdx = start.idx();
+    m_start = startIdx;
+    m_distances[startIdx] = 0;
+    m_predecessors[startIdx] = startIdx;
+    m_reachedStamp[startIdx] = m_generation;
+    m_open.insert(start, goalPos ? heuristic(startIdx, *goalPos) : 0);
+
+    while (!m_open.isEmpty())
+    {
+        const Index current = m_open.popMin().key().idx();
+        m_settledStamp[current] = m_generation;
+        if (done(current))
+        {
+            return;
+        }
+
+        const float currentDist = m_distances[current];
+        for (size_t k = m_offsets[current]; k < m_offsets[current + 1]; k++)
+        {
+            const Index next = m_targets[k];
+            if (settled(next) || m_blocked[next])
+            {
+                continue;
+            }
+
+            const float dist = currentDist + m_costs[k];
+            if (!reached(next))
+            {
+                m_reachedStamp[next] = m_generation;
+                m_distances[next] = dist;
+                m_predecessors[next] = current;
+                m_open.insert(VertexHandle(next), goalPos ? dist + heuristic(next, *goalPos) : dist);
+            }
+            else if (dist < m_distances[next])
+            {
+                m_distances[next] = dist;
+                m_predecessors[next] = current;
+                m_open.updateValue(VertexHandle(next), goalPos ? dist + heuristic(next, *goalPos) : dist);
+            }
+        }
+    }
+}
+
+template<typename BaseVecT>
+bool PathSearchContext<BaseVecT>::findPath(
+    VertexHandle start,
+    VertexHandle goal,
+    std::list<VertexHandle>& path,
+    bool useAStar)
+{
+    path.clear();
+    nextGeneration();
+
+    const Index goalIdx = goal.idx();
+    const BaseVecT goalPos = m_positions[goalIdx];
+    search(start, useAStar ? &goalPos : nullptr, [&](Index idx) { return idx == goalIdx; });
+
+    return getPath(goal, path);
+}
+
+template<typename BaseVecT>
+size_t PathSearchContext<BaseVecT>::findPaths(
+    VertexHandle start,
+    const std::vector<VertexHandle>& goals,
+    std::vector<float>& costs)
+{
+    nextGeneration();
+
+    // Count distinct goals, so the search can stop once all are settled
+    size_t remaining = 0;
+    for (auto goal : goals)
+    {
+        if (m_goalStamp[goal.idx()] != m_generation)
+        {
+            m_goalStamp[goal.idx()] = m_generation;
+            remaining++;
+        }
+    }
+
+    search(start, nullptr, [&](Index idx) {
+        return m_goalStamp[idx] == m_generation && --remaining == 0;
+    });
+
+    costs.resize(goals.size());
+    size_t found = 0;
+    for (size_t i = 0; i < goals.size(); i++)
+    {
+        costs[i] = distance(goals[i]);
+        if (costs[i] != std::numeric_limits<float>::infinity())
+        {
+            found++;
+        }
+    }
+    return found;
+}
+
+template<typename BaseVecT>
+float PathSearchContext<BaseVecT>::distance(VertexHandle vH) const
+{
+    if (m_generation == 0 || !settled(vH.idx()))
+    {
+        return std::numeric_limits<float>::infinity();
+    }
+    return m_distances[vH.idx()];
+}
+
+template<typename BaseVecT>
+bool PathSearchContext<BaseVecT>::getPath(VertexHandle goal, std::list<VertexHandle>& path) const
+{
+    path.clear();
+    if (m_generation == 0 || !settled(goal.idx()))
+    {
+        return false;
+    }
+
+    Index current = goal.idx();
+    path.push_front(goal);
+    while (current != m_start)
+    {
+        current = m_predecessors[current];
+        path.push_front(VertexHandle(current));
+    }
+    return true;
+}
+
+} // namespace lvr2
@@ -67,11 +67,44 @@ namespace lvr2
  *                         FaceMap containing normals; it is expected to return
  *                         an optional float. `boost::none` means that this
  *                         edge cannot be collapsed.
+ * @param[in] parallelCosts If true, the initial costs of all edges are
+ *                          computed in parallel. Every thread then calls its
+ *                          own copy of `collapseCost`, so the function must
+ *                          not modify state it shares with its copies (e.g.
+ *                          buffers captured by reference). The result is the
+ *                          same as in the serial case.
  *
  * @return The number of edges actually collapsed.
  */
 template<typename BaseVecT, typename CostF>
 size_t iterativeEdgeCollapse(
+    BaseMesh<BaseVecT>& mesh,
+    const size_t count,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    CostF collapseCost,
+    bool parallelCosts = false
+);
+
+/**
+ * @brief Collapses up to `count` many edges of `mesh` in rounds of
+ *        independent collapses.
+ *
+ * Instead of collapsing the globally cheapest edge one at a time, every round
+ * takes the cheapest edges (a fixed fraction of all collapsable ones) and
+ * greedily selects those whose 1-rings do not overlap. These collapses do not
+ * influence each other, so the costs of all vertices touched in a round can
+ * be recomputed in parallel afterwards. The order of collapses only follows
+ * the costs approximately, but much less work is spent on keeping a global
+ * order, which pays off for very large reductions.
+ *
+ * The parameters have the same meaning as in `iterativeEdgeCollapse()`.
+ * `collapseCost` is always called from multiple threads, each with its own
+ * copy.
+ *
+ * @return The number of edges actually collapsed.
+ */
+template<typename BaseVecT, typename CostF>
+size_t batchedEdgeCollapse(
     BaseMesh<BaseVecT>& mesh,
     const size_t count,
     FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
@@ -80,12 +113,16 @@ size_t iterativeEdgeCollapse(
 
 /**
  * @brief Like `iterativeEdgeCollapse` but with a fixed cost function.
+ *
+ * @param[in] batched Use `batchedEdgeCollapse()` instead of
+ *                    `iterativeEdgeCollapse()`.
  */
 template<typename BaseVecT>
 size_t simpleMeshReduction(
     BaseMesh<BaseVecT>& mesh,
     const size_t count,
-    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    bool batched = false
 );
 
 } // namespace lvr2
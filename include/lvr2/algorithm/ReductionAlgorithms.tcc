@@ -29,7 +29,10 @@
  * ReductionAlgorithms.tcc
  */
 
+#include <algorithm>
+#include <limits>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "lvr2/io/Progress.hpp"
@@ -81,12 +84,95 @@ public:
 namespace lvr2
 {
 
+namespace reduction_detail
+{
+
+/**
+ * @brief Finds the outgoing edge of `fromH` with the smallest collapse cost.
+ *
+ * @return `true` if there is a collapsable edge; `bestToH` and `bestCost` are
+ *         only written in this case.
+ */
+template<typename BaseVecT, typename CostF>
+bool findBestCollapse(
+    const BaseMesh<BaseVecT>& mesh,
+    VertexHandle fromH,
+    const FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    CostF& collapseCost,
+    vector<VertexHandle>& neighbours,
+    VertexHandle& bestToH,
+    float& bestCost
+)
+{
+    neighbours.clear();
+    mesh.getNeighboursOfVertex(fromH, neighbours);
+
+    // We are trying to find the outgoing edge with the best score.
+    bool found = false;
+    bestCost = std::numeric_limits<float>::max();
+
+    for (const auto toH: neighbours)
+    {
+        auto maybeCost = collapseCost(fromH, toH, faceNormals);
+        if (maybeCost)
+        {
+            if (*maybeCost < bestCost)
+            {
+                bestCost = *maybeCost;
+                bestToH = toH;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief Recalculates the normals of all faces around `vH` and removes the
+ *        normals of the faces that were removed by the collapse.
+ */
+template<typename BaseVecT>
+void updateNormalsAfterCollapse(
+    BaseMesh<BaseVecT>& mesh,
+    const EdgeCollapseResult& result,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    vector<FaceHandle>& facesAroundMidpoint
+)
+{
+    // We update the normal of all faces touching the midpoint.
+    facesAroundMidpoint.clear();
+    mesh.getFacesOfVertex(result.midPoint, facesAroundMidpoint);
+    for (auto fH: facesAroundMidpoint)
+    {
+        auto maybeNormal = getFaceNormal(mesh.getVertexPositionsOfFace(fH));
+        auto normal = maybeNormal
+            ? *maybeNormal
+            : Normal<typename BaseVecT::CoordType>(0, 0, 1);
+
+        faceNormals[fH] = normal;
+    }
+
+    // Remove all entries from that map that belong to now invalid handles
+    // and add values for the handles that were created.
+    for (auto neighbor: result.neighbors)
+    {
+        if (neighbor)
+        {
+            faceNormals.erase(neighbor->removedFace);
+        }
+    }
+}
+
+} // namespace reduction_detail
+
 template<typename BaseVecT, typename CostF>
 size_t iterativeEdgeCollapse(
     BaseMesh<BaseVecT>& mesh,
     const size_t count,
     FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
-    CostF collapseCost
+    CostF collapseCost,
+    bool parallelCosts
 )
 {
 
@@ -109,29 +195,11 @@ size_t iterativeEdgeCollapse(
     vector<VertexHandle> vertexUpdateNeighbors;
     auto updateVertex = [&](VertexHandle fromH)
     {
-        vertexUpdateNeighbors.clear();
-        mesh.getNeighboursOfVertex(fromH, vertexUpdateNeighbors);
-
-        // We are trying to find the outgoing edge with the best score. The
-        // second vertex is the vertex itself if no outgoing edge is
-        // collapsable.
-        auto bestToH = fromH;
-        auto bestCost = std::numeric_limits<float>::max();
-
-        for (const auto toH: vertexUpdateNeighbors)
-        {
-            auto maybeCost = collapseCost(fromH, toH, constFaceNormals);
-            if (maybeCost)
-            {
-                if (*maybeCost < bestCost)
-                {
-                    bestCost = *maybeCost;
-                    bestToH = toH;
-                }
-            }
-        }
-
-        if (bestToH != fromH)
+        VertexHandle bestToH = fromH;
+        float bestCost;
+        if (reduction_detail::findBestCollapse(
+            mesh, fromH, constFaceNormals, collapseCost, vertexUpdateNeighbors, bestToH, bestCost
+        ))
         {
             queue.insert(fromH, bestCost);
             bestEdge.insert(fromH, bestToH);
@@ -149,10 +217,55 @@ size_t iterativeEdgeCollapse(
     ++progress_init;
 
     // Calculate initial costs of all edges
-    for (const auto fromH: mesh.vertices())
+    if (parallelCosts)
     {
-        updateVertex(fromH);
-        ++progress_init;
+        // Evaluate the costs in parallel and fill the queue afterwards in
+        // ascending handle order, so that it is the same as in the serial
+        // case.
+        const size_t numVertexIndices = mesh.nextVertexIndex();
+        vector<VertexHandle> initialBestTo(numVertexIndices, VertexHandle(0));
+        vector<float> initialCost(numVertexIndices);
+        vector<char> collapsable(numVertexIndices, false);
+
+        #pragma omp parallel
+        {
+            // Every thread works with its own copy of the cost function
+            CostF threadCollapseCost(collapseCost);
+            vector<VertexHandle> neighbours;
+            ProgressBarBatch threadProgress(progress_init);
+
+            #pragma omp for schedule(dynamic, 1024)
+            for (long i = 0; i < static_cast<long>(numVertexIndices); i++)
+            {
+                VertexHandle fromH(i);
+                if (!mesh.containsVertex(fromH))
+                {
+                    continue;
+                }
+                collapsable[i] = reduction_detail::findBestCollapse(
+                    mesh, fromH, constFaceNormals, threadCollapseCost, neighbours,
+                    initialBestTo[i], initialCost[i]
+                );
+                ++threadProgress;
+            }
+        }
+
+        for (size_t i = 0; i < numVertexIndices; i++)
+        {
+            if (collapsable[i])
+            {
+                queue.insert(VertexHandle(i), initialCost[i]);
+                bestEdge.insert(VertexHandle(i), initialBestTo[i]);
+            }
+        }
+    }
+    else
+    {
+        for (const auto fromH: mesh.vertices())
+        {
+            updateVertex(fromH);
+            ++progress_init;
+        }
     }
 
     // Output
@@ -208,31 +321,207 @@ size_t iterativeEdgeCollapse(
             updateVertex(vH);
         }
 
-        // We update the normal of all faces touching the midpoint.
-        mesh.getFacesOfVertex(result.midPoint, facesAroundMidpoint);
-        for (auto fH: facesAroundMidpoint)
+        // Update the normals of all faces touching the midpoint
+        reduction_detail::updateNormalsAfterCollapse(mesh, result, faceNormals, facesAroundMidpoint);
+    }
+
+
+    cout << endl << timestamp << "Collapsed " << collapsedEdgeCount << " edges..." << endl;
+
+    return collapsedEdgeCount;
+}
+
+template<typename BaseVecT, typename CostF>
+size_t batchedEdgeCollapse(
+    BaseMesh<BaseVecT>& mesh,
+    const size_t count,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    CostF collapseCost
+)
+{
+    std::cout << timestamp << "Reduce mesh by collapsing " << count
+              << " edges in independent batches" << std::endl;
+
+    // In every round, at most this fraction of the collapsable vertices is
+    // considered for collapsing. Smaller values follow the cost order more
+    // closely, larger values need fewer rounds.
+    const size_t BATCH_FRACTION = 16;
+
+    const auto& constFaceNormals = faceNormals;
+
+    // Best outgoing edge of every vertex. `collapsable` is false if the
+    // vertex has no collapsable edge or if its best edge could not be
+    // collapsed; this is only reset when the vertex is touched again.
+    const size_t numVertexIndices = mesh.nextVertexIndex();
+    vector<VertexHandle> bestTo(numVertexIndices, VertexHandle(0));
+    vector<float> bestCost(numVertexIndices, std::numeric_limits<float>::max());
+    vector<char> collapsable(numVertexIndices, false);
+
+    // Round in which a vertex was last locked or marked dirty. Using the
+    // round number as stamp avoids clearing these arrays in every round.
+    vector<size_t> lockedInRound(numVertexIndices, 0);
+    vector<size_t> dirtyInRound(numVertexIndices, 0);
+
+    // Vertices whose costs have to be (re)computed
+    vector<VertexHandle> dirty;
+    dirty.reserve(numVertexIndices);
+    for (auto vH: mesh.vertices())
+    {
+        dirty.push_back(vH);
+    }
+
+    // These are only used later, but are created here to avoid unnecessary
+    // heap allocations.
+    vector<std::pair<float, VertexHandle>> candidates;
+    vector<std::pair<VertexHandle, VertexHandle>> batch;
+    vector<VertexHandle> neighbours;
+    vector<VertexHandle> lockNeighbours;
+    vector<FaceHandle> facesAroundMidpoint;
+
+    string msg = timestamp.getElapsedTime()
+        + "Collapsing up to "
+        + std::to_string(count)
+        + " of the edges ";
+    ProgressBar progress(count + 1, msg);
+    ++progress;
+
+    size_t collapsedEdgeCount = 0;
+    size_t round = 0;
+
+    while (collapsedEdgeCount < count)
+    {
+        ++round;
+
+        // Recompute the costs of all dirty vertices in parallel. The mesh is
+        // not modified while doing so.
+        #pragma omp parallel
+        {
+            // Every thread works with its own copy of the cost function
+            CostF threadCollapseCost(collapseCost);
+            vector<VertexHandle> threadNeighbours;
+
+            #pragma omp for schedule(dynamic, 1024)
+            for (long i = 0; i < static_cast<long>(dirty.size()); i++)
+            {
+                auto fromH = dirty[i];
+                collapsable[fromH.idx()] = reduction_detail::findBestCollapse(
+                    mesh, fromH, constFaceNormals, threadCollapseCost, threadNeighbours,
+                    bestTo[fromH.idx()], bestCost[fromH.idx()]
+                );
+            }
+        }
+
+        // Collect the cheapest collapsable edges. Ties are broken by handle
+        // to make the order deterministic.
+        candidates.clear();
+        for (size_t i = 0; i < numVertexIndices; i++)
+        {
+            if (collapsable[i] && mesh.containsVertex(VertexHandle(i)))
+            {
+                candidates.push_back({ bestCost[i], VertexHandle(i) });
+            }
+        }
+        if (candidates.empty())
+        {
+            break;
+        }
+
+        size_t batchSize = std::min(
+            count - collapsedEdgeCount,
+            std::max<size_t>(1, candidates.size() / BATCH_FRACTION)
+        );
+        batchSize = std::min(batchSize, candidates.size());
+        auto byCost = [](const auto& a, const auto& b)
         {
-            auto maybeNormal = getFaceNormal(mesh.getVertexPositionsOfFace(fH));
-            auto normal = maybeNormal
-                ? *maybeNormal
-                : Normal<typename BaseVecT::CoordType>(0, 0, 1);
+            return a.first < b.first || (a.first == b.first && a.second.idx() < b.second.idx());
+        };
+        std::nth_element(candidates.begin(), candidates.begin() + (batchSize - 1), candidates.end(), byCost);
+        std::sort(candidates.begin(), candidates.begin() + batchSize, byCost);
+
+        // Greedily select edges whose closed 1-rings are pairwise disjoint.
+        // Collapsing such an edge only changes its own 1-ring, so none of
+        // the selected collapses influences another one.
+        batch.clear();
+        for (size_t c = 0; c < batchSize; c++)
+        {
+            auto fromH = candidates[c].second;
+            auto toH = bestTo[fromH.idx()];
+
+            neighbours.clear();
+            mesh.getNeighboursOfVertex(fromH, neighbours);
+            mesh.getNeighboursOfVertex(toH, neighbours);
+
+            bool independent = lockedInRound[fromH.idx()] != round && lockedInRound[toH.idx()] != round;
+            for (auto vH: neighbours)
+            {
+                independent = independent && lockedInRound[vH.idx()] != round;
+            }
+            if (!independent)
+            {
+                continue;
+            }
 
-            faceNormals[fH] = normal;
+            lockedInRound[fromH.idx()] = round;
+            lockedInRound[toH.idx()] = round;
+            for (auto vH: neighbours)
+            {
+                lockedInRound[vH.idx()] = round;
+            }
+            batch.push_back({ fromH, toH });
         }
 
-        // Remove all entries from that map that belong to now invalid handles
-        // and add values for the handles that were created.
-        for (auto neighbor: result.neighbors)
+        // Collapse the selected edges. Changing the topology is not thread
+        // safe, so this is done serially.
+        dirty.clear();
+        size_t collapsedInRound = 0;
+        for (auto& edge: batch)
         {
-            if (neighbor)
+            auto fromH = edge.first;
+            auto toH = edge.second;
+            const auto edgeMin = mesh.getEdgeBetween(fromH, toH).unwrap();
+
+            if (!mesh.isCollapsable(edgeMin))
             {
-                faceNormals.erase(neighbor->removedFace);
+                // Like in `iterativeEdgeCollapse()`, we ignore this vertex
+                // until one of its neighbours changes.
+                collapsable[fromH.idx()] = false;
+                continue;
+            }
+
+            auto toPos = mesh.getVertexPosition(toH);
+            auto result = mesh.collapseEdge(edgeMin);
+            collapsedInRound += 1;
+            ++progress;
+
+            // Set correct position of the new vertex
+            mesh.getVertexPosition(result.midPoint) = toPos;
+
+            // The vertex which was removed must not be a candidate anymore
+            collapsable[fromH.idx()] = false;
+            collapsable[toH.idx()] = false;
+
+            // Update the normals of all faces touching the midpoint
+            reduction_detail::updateNormalsAfterCollapse(mesh, result, faceNormals, facesAroundMidpoint);
+
+            // The costs of the midpoint and its neighbours have to be updated
+            lockNeighbours.clear();
+            mesh.getNeighboursOfVertex(result.midPoint, lockNeighbours);
+            lockNeighbours.push_back(result.midPoint);
+            for (auto vH: lockNeighbours)
+            {
+                if (dirtyInRound[vH.idx()] != round)
+                {
+                    dirtyInRound[vH.idx()] = round;
+                    dirty.push_back(vH);
+                }
             }
         }
-    }
 
+        collapsedEdgeCount += collapsedInRound;
+    }
 
-    cout << endl << timestamp << "Collapsed " << collapsedEdgeCount << " edges..." << endl;
+    cout << endl << timestamp << "Collapsed " << collapsedEdgeCount << " edges in "
+         << round << " rounds..." << endl;
 
     return collapsedEdgeCount;
 }
@@ -241,17 +530,17 @@ template<typename BaseVecT>
 size_t simpleMeshReduction(
     BaseMesh<BaseVecT>& mesh,
     const size_t count,
-    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    bool batched
 )
 {
-    vector<EdgeHandle> edgesAroundFrom;
-    vector<FaceHandle> facesAroundFrom;
-
-    return iterativeEdgeCollapse(mesh, count, faceNormals, [&](
+    // The buffers are captured by value, so that every copy of the cost
+    // function (one per thread) has its own.
+    auto collapseCost = [&mesh, edgesAroundFrom = vector<EdgeHandle>(), facesAroundFrom = vector<FaceHandle>()](
         VertexHandle fromH,
         VertexHandle toH,
         const FaceMap<Normal<typename BaseVecT::CoordType>>& normals
-    ) -> boost::optional<float>
+    ) mutable -> boost::optional<float>
     {
         // The minimal value of the dot product between two normals that is allowed.
         const float MIN_NORMAL_DIFF = 0.5;
@@ -353,7 +642,13 @@ size_t simpleMeshReduction(
         auto length = mesh.getVertexPosition(fromH).distanceFrom(mesh.getVertexPosition(toH));
 
         return length * curvature;
-    });
+    };
+
+    if (batched)
+    {
+        return batchedEdgeCollapse(mesh, count, faceNormals, collapseCost);
+    }
+    return iterativeEdgeCollapse(mesh, count, faceNormals, collapseCost, true);
 }
 
 } // namespace lvr2
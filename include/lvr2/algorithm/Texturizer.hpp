@@ -134,7 +134,8 @@ public:
      *
      * Create a grid, based on given information (texel size, bounding rectangle).
      * For each cell in the grid (which represents a texel), let the `PointsetSurface` find the closest point in the
-     * point cloud and use that point's color as color for the texel.
+     * point cloud and use that point's color as color for the texel. The texels are searched in batches of whole
+     * rows via `SearchTree::kSearchMany()`.
      *
      * @param index The index the texture will get
      * @param surface The point cloud
@@ -37,6 +37,9 @@
 #include "lvr2/io/Timestamp.hpp"
 #include "lvr2/algorithm/ColorAlgorithms.hpp"
 
+#include <algorithm>
+#include <limits>
+
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
@@ -131,7 +134,8 @@ TextureHandle Texturizer<BaseVecT>::generateTexture(
     const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
 )
 {
-    cout << "Wrong" << endl;
+    using CoordT = typename BaseVecT::CoordType;
+
     // Calculate the texture size
     unsigned short int sizeX = ceil((boundingRect.m_maxDistA - boundingRect.m_minDistA) / m_texelSize);
     unsigned short int sizeY = ceil((boundingRect.m_maxDistB - boundingRect.m_minDistB) / m_texelSize);
@@ -139,59 +143,72 @@ TextureHandle Texturizer<BaseVecT>::generateTexture(
     // Create texture
     Texture texture(index, sizeX, sizeY, 3, 1, m_texelSize);
 
-    string comment = timestamp.getElapsedTime() + "Computing texture pixels ";
-    ProgressBar progress(sizeX * sizeY, comment);
-
     if (surface.pointBuffer()->hasColors())
     {
         UCharChannel colors = *(surface.pointBuffer()->getUCharChannel("colors"));
+        auto searchTree = surface.searchTree();
 
-        // For each texel find the color of the nearest point
-        #pragma omp parallel for schedule(dynamic,1) collapse(2)
-        for (int y = 0; y < sizeY; y++)
-        {
-            for (int x = 0; x < sizeX; x++)
-            {
-                int k = 1; // k-nearest-neighbors
+        string comment = timestamp.getElapsedTime() + "Computing texture pixels ";
+        ProgressBar progress(sizeX * sizeY, comment);
 
-                vector<size_t> cv;
+        // For each texel find the color of the nearest point. The texels are
+        // queried in batches of whole rows: neighbouring queries are close to
+        // each other, so they mostly visit the same parts of the search tree.
+        const size_t rowsPerBatch = std::max<size_t>(1, (1 << 16) / std::max<size_t>(1, sizeX));
+        vector<BaseVecT> positions;
+        vector<size_t> indices;
+        vector<CoordT> distances;
 
-                BaseVecT currentPos =
+        for (size_t firstRow = 0; firstRow < sizeY; firstRow += rowsPerBatch)
+        {
+            const size_t numRows = std::min<size_t>(rowsPerBatch, sizeY - firstRow);
+            const size_t count = numRows * sizeX;
+            positions.resize(count);
+            indices.resize(count);
+            distances.resize(count);
+
+            #pragma omp parallel for
+            for (long row = 0; row < (long)numRows; row++)
+            {
+                const int y = firstRow + row;
+                BaseVecT rowStart =
                     boundingRect.m_supportVector
-                    + boundingRect.m_vec1 * (x * m_texelSize + boundingRect.m_minDistA - m_texelSize / 2.0)
                     + boundingRect.m_vec2 * (y * m_texelSize + boundingRect.m_minDistB - m_texelSize / 2.0);
+                for (int x = 0; x < sizeX; x++)
+                {
+                    positions[row * sizeX + x] = rowStart
+                        + boundingRect.m_vec1 * (x * m_texelSize + boundingRect.m_minDistA - m_texelSize / 2.0);
+                }
+            }
 
-                surface.searchTree()->kSearch(currentPos, k, cv);
-
-                uint8_t r = 0, g = 0, b = 0;
+            searchTree->kSearchMany(positions.data(), count, 1, indices.data(), distances.data());
 
-                for (size_t pointIdx : cv)
+            #pragma omp parallel for
+            for (long row = 0; row < (long)numRows; row++)
+            {
+                const int y = firstRow + row;
+                unsigned char* out = texture.m_data + (sizeY - y - 1) * (sizeX * 3);
+                for (int x = 0; x < sizeX; x++)
                 {
+                    size_t pointIdx = indices[row * sizeX + x];
+                    if (pointIdx == std::numeric_limits<size_t>::max())
+                    {
+                        out[3 * x + 0] = out[3 * x + 1] = out[3 * x + 2] = 0;
+                        continue;
+                    }
                     auto cur_color = colors[pointIdx];
-                    r += cur_color[0];
-                    g += cur_color[1];
-                    b += cur_color[2];
+                    out[3 * x + 0] = cur_color[0];
+                    out[3 * x + 1] = cur_color[1];
+                    out[3 * x + 2] = cur_color[2];
                 }
-
-                r /= k;
-                g /= k;
-                b /= k;
-
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 0] = r;
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 1] = g;
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 2] = b;
-
-                ++progress;
             }
+            progress += count;
         }
         std::cout << std::endl;
     }
     else
     {
-        for (int i = 0; i < sizeX * sizeY; i++)
-        {
-            texture.m_data[i] = 0;
-        }
+        std::fill_n(texture.m_data, sizeX * sizeY * 3, 0);
     }
 
     return m_textures.push(texture);
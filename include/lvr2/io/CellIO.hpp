@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * CellIO.hpp
+ *
+ *  @date 18.10.2026
+ */
+
+#ifndef LVR2_IO_CELLIO_H_
+#define LVR2_IO_CELLIO_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace lvr2
+{
+
+/// Version of the columnar cell file format written by writeCellFile()
+constexpr uint32_t CELL_FILE_VERSION = 1;
+
+/**
+ * @brief Writes the cells of a grid partition to a columnar cell file.
+ *
+ * The file starts with a fixed size header (magic, version, number of cells
+ * and a descriptor for every column), followed by three contiguous arrays:
+ * the cell centers (3 floats per cell), the extrusion flags (1 byte per
+ * cell) and the signed distances of the eight cell corners (8 floats per
+ * cell). Uncompressed columns can be memory mapped and used in place.
+ *
+ * If `compress` is true, the float columns are stored byte-shuffled and
+ * LZ4 compressed in independent blocks. This is lossless.
+ *
+ * @throws std::runtime_error if the file cannot be written
+ */
+void writeCellFile(
+    const std::string& filename,
+    size_t numCells,
+    const float* centers,
+    const unsigned char* extruded,
+    const float* distances,
+    bool compress = false
+);
+
+/**
+ * @brief Read-only view on a cell file written by writeCellFile().
+ *
+ * The file is memory mapped. Uncompressed columns are accessed in place,
+ * compressed ones are decoded into buffers owned by the reader. Files in the
+ * legacy format of HashGrid::saveCells() (a cell count followed by one
+ * record per cell) are detected and converted on load.
+ */
+class CellFileReader
+{
+public:
+    /**
+     * @brief Maps the given file
+     *
+     * @throws std::runtime_error if the file cannot be opened or is malformed
+     */
+    explicit CellFileReader(const std::string& filename);
+
+    /// Number of cells in the file
+    size_t numCells() const { return m_numCells; }
+
+    /// Format version of the file, 0 for the legacy format
+    uint32_t version() const { return m_version; }
+
+    /// Cell centers, 3 floats per cell
+    const float* centers() const { return m_centers; }
+
+    /// Extrusion flags, one per cell
+    const unsigned char* extruded() const { return m_extruded; }
+
+    /// Distances of the cell corners, 8 floats per cell
+    const float* distances() const { return m_distances; }
+
+private:
+    void readLegacy(const char* data, size_t size);
+
+    boost::iostreams::mapped_file_source m_file;
+
+    size_t m_numCells;
+    uint32_t m_version;
+
+    const float* m_centers;
+    const unsigned char* m_extruded;
+    const float* m_distances;
+
+    /// Buffers for columns which can not be used in place
+    std::vector<float> m_centerBuffer;
+    std::vector<unsigned char> m_extrudedBuffer;
+    std::vector<float> m_distanceBuffer;
+};
+
+} // namespace lvr2
+
+#endif // LVR2_IO_CELLIO_H_
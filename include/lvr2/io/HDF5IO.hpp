@@ -166,6 +166,25 @@ class HDF5IO : public BaseIO, public AttributeMeshIOBase
             std::string groupName, std::string datasetName,
             std::vector<size_t>& dim);
 
+    /**
+     * @brief Returns the dimensions of a dataset without reading its data.
+     *        The returned vector is empty if the dataset does not exist.
+     */
+    std::vector<size_t> getDimensions(std::string groupName, std::string datasetName);
+
+    /**
+     * @brief Reads the entries [offset, offset + count) along the first dimension
+     *        of a dataset into the given buffer using a hyperslab selection. All
+     *        other dimensions are read completely, so the buffer has to hold
+     *        count times the product of the remaining dimensions.
+     *
+     * @return false if the dataset does not exist or the range is out of bounds
+     */
+    template<typename T>
+    bool getArraySlice(
+            std::string groupName, std::string datasetName,
+            size_t offset, size_t count, T* buffer);
+
     template<typename T>
     void addArray(
             std::string groupName,
@@ -183,6 +183,40 @@ boost::shared_array<T> HDF5IO::getArray(
     return ret;
 }
 
+template<typename T>
+bool HDF5IO::getArraySlice(
+        std::string groupName, std::string datasetName,
+        size_t offset, size_t count, T* buffer)
+{
+    if(!m_hdf5_file || !exist(groupName))
+    {
+        return false;
+    }
+
+    HighFive::Group g = getGroup(groupName, false);
+    if (!g.exist(datasetName))
+    {
+        return false;
+    }
+
+    HighFive::DataSet dataset = g.getDataSet(datasetName);
+    std::vector<size_t> dim = dataset.getSpace().getDimensions();
+
+    if (dim.empty() || offset + count > dim[0])
+    {
+        return false;
+    }
+
+    std::vector<size_t> sliceOffset(dim.size(), 0);
+    std::vector<size_t> sliceCount(dim);
+    sliceOffset[0] = offset;
+    sliceCount[0] = count;
+
+    dataset.select(sliceOffset, sliceCount).read(buffer);
+
+    return true;
+}
+
 template <typename T>
 boost::shared_array<T> HDF5IO::reduceData(boost::shared_array<T> data, size_t dataCount, size_t dataWidth, unsigned int reductionFactor, size_t *reducedDataCount)
 {
@@ -47,6 +47,8 @@ using std::string;
 using std::wstring;
 using std::wcout;
 
+#include <atomic>
+
 #include <boost/thread/mutex.hpp>
 
 namespace lvr2
@@ -82,6 +84,10 @@ public:
 
     /**
      * @brief Increases the counter of performed iterations
+     *
+     * The counter is atomic, a lock is only taken when the printed
+     * percentage changes. In tight parallel loops, use a
+     * \ref ProgressBarBatch per thread to reduce contention further.
      */
     void operator++();
 
@@ -111,16 +117,25 @@ protected:
     /// Prints the output
     void print_bar();
 
+    /// Prints all percent steps reached by the current counter
+    void update();
+
+    /// Returns the counter value at which the next percent step is reached
+    size_t nextUpdateVal() const;
+
     /// The prefix string
     string 			m_prefix;
 
     /// The number of iterations
     size_t			m_maxVal;
 
-        /// The current counter
-    size_t	 		m_currentVal;
+    /// The current counter
+    std::atomic<size_t> m_currentVal;
 
-    /// A mutex object for counter increment (for parallel executions)
+    /// Counter value at which the output has to be updated next
+    std::atomic<size_t> m_nextUpdateVal;
+
+    /// A mutex object for output generation (for parallel executions)
     boost::mutex 	m_mutex;
 
     /// The current progress in percent
@@ -137,6 +152,81 @@ protected:
 };
 
 
+/**
+ * @brief   A thread local front end for a \ref ProgressBar
+ *
+ * Collects increments locally and forwards them to the shared progress
+ * bar in batches, so that threads in a parallel loop do not compete for
+ * the shared counter on every iteration. The remaining increments are
+ * forwarded on destruction:
+ *
+ * @code
+ * ProgressBar progress(n, "Working");
+ * #pragma omp parallel
+ * {
+ *     ProgressBarBatch batch(progress);
+ *     #pragma omp for
+ *     for (size_t i = 0; i < n; i++)
+ *     {
+ *         ...
+ *         ++batch;
+ *     }
+ * }
+ * @endcode
+ */
+class ProgressBarBatch
+{
+public:
+
+    /**
+     * @brief Ctor.
+     *
+     * @param bar       The shared progress bar
+     * @param batchSize Number of local increments forwarded at once
+     */
+    ProgressBarBatch(ProgressBar& bar, size_t batchSize = 256)
+        : m_bar(bar), m_batchSize(batchSize), m_count(0) {}
+
+    ~ProgressBarBatch() { flush(); }
+
+    ProgressBarBatch(const ProgressBarBatch&) = delete;
+    ProgressBarBatch& operator=(const ProgressBarBatch&) = delete;
+
+    /**
+     * @brief Increases the local counter
+     */
+    void operator++()
+    {
+        if (++m_count >= m_batchSize)
+        {
+            flush();
+        }
+    }
+
+    /**
+     * @brief Forwards all local increments to the progress bar
+     */
+    void flush()
+    {
+        if (m_count)
+        {
+            m_bar += m_count;
+            m_count = 0;
+        }
+    }
+
+private:
+
+    /// The shared progress bar
+    ProgressBar&    m_bar;
+
+    /// Number of increments forwarded at once
+    size_t          m_batchSize;
+
+    /// Local increments not yet forwarded
+    size_t          m_count;
+};
+
 /**
  * @brief	A progress counter class
  *
@@ -163,8 +253,8 @@ public:
 
 protected:
 
-    /// Prints the current state
-    void print_progress();
+    /// Prints the given counter value
+    void print_progress(size_t val);
 
     /// The prefix string
     string 			m_prefix;
@@ -173,9 +263,9 @@ protected:
     size_t			m_stepVal;
 
     /// The current counter value
-    size_t			m_currentVal;
+    std::atomic<size_t> m_currentVal;
 
-    /// A mutex object for counter increment (for parallel executions)
+    /// A mutex object for output generation (for parallel executions)
     boost::mutex 	m_mutex;
 
     /// A string stream for output generation
@@ -54,6 +54,10 @@ class ChunkIO
     template <typename T>
     T loadChunk(std::string layer, int x, int y, int z);
 
+    void saveLodErrors(std::string layer, const std::vector<float>& errors);
+
+    std::vector<float> loadLodErrors(std::string layer);
+
   protected:
     Derived* m_file_access                 = static_cast<Derived*>(this);
     ArrayIO<Derived>* m_array_io           = static_cast<ArrayIO<Derived>*>(m_file_access);
@@ -63,6 +67,7 @@ class ChunkIO
     const std::string m_amountName      = "amount";
     const std::string m_chunkSizeName   = "size";
     const std::string m_boundingBoxName = "bounding_box";
+    const std::string m_lodErrorName    = "lod_errors";
 };
 
 } // namespace hdf5features
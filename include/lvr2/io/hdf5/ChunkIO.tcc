@@ -134,6 +134,34 @@ T ChunkIO<Derived>::loadChunk(std::string layer, int x, int y, int z)
         ->load(m_chunkName + "/" + layer + "/" + chunkName);
 }
 
+template <typename Derived>
+void ChunkIO<Derived>::saveLodErrors(std::string layer, const std::vector<float>& errors)
+{
+    boost::shared_array<float> errorArr(new float[errors.size()]);
+    std::copy(errors.begin(), errors.end(), errorArr.get());
+    m_array_io->save(m_chunkName + "/" + layer, m_lodErrorName, errors.size(), errorArr);
+}
+
+template <typename Derived>
+std::vector<float> ChunkIO<Derived>::loadLodErrors(std::string layer)
+{
+    std::vector<float> errors;
+    if (!hdf5util::exist(m_file_access->m_hdf5_file,
+                         m_chunkName + "/" + layer + "/" + m_lodErrorName))
+    {
+        return errors;
+    }
+
+    size_t dimensionErrors;
+    boost::shared_array<float> errorArr
+        = m_array_io->template load<float>(m_chunkName + "/" + layer, m_lodErrorName, dimensionErrors);
+    if (errorArr)
+    {
+        errors.assign(errorArr.get(), errorArr.get() + dimensionErrors);
+    }
+    return errors;
+}
+
 } // namespace hdf5features
 
 } // namespace lvr2
@@ -176,7 +176,11 @@ void AdaptiveKSearchSurface<BaseVecT>::calculateSurfaceNormals()
     string comment = timestamp.getElapsedTime() + "Estimating normals ";
     lvr2::ProgressBar progress(numPoints, comment);
 
-    #pragma omp parallel for schedule(dynamic, 12)
+    #pragma omp parallel
+    {
+    lvr2::ProgressBarBatch progressBatch(progress);
+
+    #pragma omp for schedule(dynamic, 12)
     for(size_t i = 0; i < numPoints; i++) {
         // We have to fit these vector to have the
         // correct return values when performing the
@@ -307,7 +311,8 @@ void AdaptiveKSearchSurface<BaseVecT>::calculateSurfaceNormals()
         normals[i*3 + 1] = normal.y;
         normals[i*3 + 2] = normal.z;
 
-        ++progress;
+        ++progressBatch;
+    }
     }
     cout << endl;
 
@@ -335,7 +340,11 @@ void AdaptiveKSearchSurface<BaseVecT>::interpolateSurfaceNormals()
     lvr2::ProgressBar progress(numPoints, comment);
 
     // Interpolate normals
-    #pragma omp parallel for schedule(dynamic, 12)
+    #pragma omp parallel
+    {
+    lvr2::ProgressBarBatch progressBatch(progress);
+
+    #pragma omp for schedule(dynamic, 12)
     for( int i = 0; i < (int)numPoints; i++)
     {
         vector<size_t> id;
@@ -365,7 +374,8 @@ void AdaptiveKSearchSurface<BaseVecT>::interpolateSurfaceNormals()
                 normals[id[j]] = mean_normal;
             }
         }
-        ++progress;
+        ++progressBatch;
+    }
     }
     cout << endl;
     cout << timestamp.getElapsedTime() << "Copying normals..." << endl;
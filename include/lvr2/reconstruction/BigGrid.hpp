@@ -37,10 +37,14 @@
 
 #include "lvr2/geometry/BoundingBox.hpp"
 #include "lvr2/io/DataStruct.hpp"
+#include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/util/ScratchDirectory.hpp"
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/iostreams/device/mapped_file.hpp>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -67,6 +71,18 @@ struct CellInfo
     size_t iz;
 };
 
+/**
+ * @brief Compact copy of the CellInfo fields needed for box queries
+ */
+struct CellSpan
+{
+    uint32_t ix;
+    uint32_t iy;
+    uint32_t iz;
+    size_t offset;
+    size_t size;
+};
+
 template <typename BaseVecT>
 class BigGrid
 {
@@ -75,17 +91,27 @@ class BigGrid
      * Constructor:
      * @param cloudPath path to PointCloud in ASCII xyz Format // Todo: Add other file formats
      * @param voxelsize
+     * @param scratchDir directory for the memory mapped point, normal and color files. Every
+     *                   instance creates its own subdirectory, which is removed on destruction.
+     *                   Empty: current working directory.
      */
-    BigGrid(std::vector<std::string> cloudPath, float voxelsize, float scale = 0, size_t bufferSize = 1024);
+    BigGrid(std::vector<std::string> cloudPath, float voxelsize, float scale = 0, size_t bufferSize = 1024,
+            std::string scratchDir = "");
 
     /**
      * Constructor: specific case for incremental reconstruction/chunking. also compatible with simple reconstruction
      * @param voxelsize specified voxelsize
      * @param project ScanProject, which contain one or more Scans
      * @param scale scale value of for current scans
+     * @param scratchDir directory for the memory mapped files, see above
      */
-    BigGrid(float voxelsize,ScanProjectEditMarkPtr project, float scale = 0);
+    BigGrid(float voxelsize,ScanProjectEditMarkPtr project, float scale = 0, std::string scratchDir = "");
 
+    /**
+     * Constructor: loads a grid written with serialize(). The memory mapped files
+     * referenced by the serialized grid are not removed on destruction.
+     * @param path serialized grid
+     */
     BigGrid(std::string path);
 
     /**
@@ -136,6 +162,17 @@ class BigGrid
 
     lvr2::ucharArr colors(
         float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints);
+
+    /**
+     * Points and normals (if available) that are within the bounding box defined by a
+     * min and max point, gathered in a single pass over the cells of the box
+     * @param withColors also gather the colors, if available
+     * @return PointBuffer containing the points, normals and, if requested, colors
+     */
+    lvr2::PointBufferPtr pointBuffer(
+        float minx, float miny, float minz, float maxx, float maxy, float maxz,
+        bool withColors = false);
+
     /**
      * return numbers of points in a specific area (defined by the params) of the grid
      * @param minx
@@ -148,6 +185,16 @@ class BigGrid
      */
     size_t getSizeofBox(float minx, float miny, float minz, float maxx, float maxy, float maxz);
 
+    /**
+     * @return all non-empty cells of the grid with their number of points. The cell
+     *         indices are relative to the minimum of the bounding box.
+     */
+    std::vector<CellSpan> getCells();
+
+    /**
+     * Writes the grid to the given file. The memory mapped files of this instance are
+     * kept after destruction, since the serialized grid references them.
+     */
     void serialize(std::string path = "serinfo.ls");
 
     lvr2::floatArr getPointCloud(size_t& numPoints);
@@ -188,12 +235,47 @@ class BigGrid
     inline bool hasColors() { return m_has_color; }
     inline bool hasNormals() { return m_has_normal; }
 
+    /// Memory mapped files of this grid
+    const std::string& pointFile() const { return m_pointFile; }
+    const std::string& normalFile() const { return m_normalFile; }
+    const std::string& colorFile() const { return m_colorFile; }
+    const std::string& distanceFile() const { return m_distanceFile; }
+
   private:
     inline int calcIndex(float f) { return f < 0 ? f - .5 : f + .5; }
 
     bool exists(int i, int j, int k);
     void insert(float x, float y, float z);
 
+    /// Creates the scratch directory and the names of the memory mapped files within
+    void initFiles(const std::string& scratchDir);
+
+    /// Expected access patterns of the memory mapped files
+    enum AccessPattern
+    {
+        ACCESS_SEQUENTIAL,
+        ACCESS_RANDOM,
+        ACCESS_WILLNEED
+    };
+
+    /// Hints the access pattern of a range of a mapped file to the kernel (posix_madvise)
+    void adviseAccess(const void* addr, size_t length, AccessPattern pattern);
+
+    /// Builds the brick directory on the first box query
+    void buildBrickIndex();
+
+    /// Cells that are within the given (inclusive) index range, sorted by their file offset
+    std::vector<CellSpan> cellsInBox(
+        size_t idxmin, size_t idymin, size_t idzmin, size_t idxmax, size_t idymax, size_t idzmax);
+
+    /// Clamps the box to the grid's bounding box and returns the cells within
+    std::vector<CellSpan> cellsInClampedBox(
+        float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints);
+
+    /// Copies the three components per point of the given cells from a mapped file
+    template <typename T>
+    boost::shared_array<T> gatherCells(const std::string& file, const std::vector<CellSpan>& cells, size_t numPoints);
+
     size_t m_maxIndexSquare;
     size_t m_maxIndex;
     size_t m_maxIndexX;
@@ -223,6 +305,21 @@ class BigGrid
 
     std::unordered_map<size_t, CellInfo> m_gridNumPoints;
     float m_scale;
+
+    /// Unique per-instance directory of the memory mapped files, null for loaded grids
+    std::shared_ptr<ScratchDirectory> m_scratch;
+    std::string m_pointFile;
+    std::string m_normalFile;
+    std::string m_colorFile;
+    std::string m_distanceFile;
+
+    /// Coarse brick directory: brick hash -> occupied cells within the brick
+    static constexpr size_t m_brickSize = 16;
+    std::unordered_map<size_t, std::vector<CellSpan>> m_bricks;
+    size_t m_numBricksX = 0;
+    size_t m_numBricksY = 0;
+    size_t m_numBricksZ = 0;
+    bool m_brickIndexBuilt = false;
 };
 
 } // namespace lvr2
@@ -43,12 +43,19 @@
 #include "lvr2/io/hdf5/VariantChannelIO.hpp"
 #include "lvr2/reconstruction/FastReconstructionTables.hpp"
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/optional/optional_io.hpp>
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 namespace lvr2
@@ -58,11 +65,13 @@ template <typename BaseVecT>
 BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
                            float voxelsize,
                            float scale,
-                           size_t bufferSize)
+                           size_t bufferSize,
+                           std::string scratchDir)
     : m_maxIndex(0), m_maxIndexSquare(0), m_maxIndexX(0), m_maxIndexY(0), m_maxIndexZ(0),
       m_numPoints(0), m_extrude(true), m_scale(scale), m_has_normal(false), m_has_color(false),
       m_pointBufferSize(1024)
 {
+    initFiles(scratchDir);
 
     boost::filesystem::path selectedFile(cloudPath[0]);
     string extension = selectedFile.extension().string();
@@ -358,32 +367,37 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
     lineReader.rewind();
 
     boost::iostreams::mapped_file_params mmfparam;
-    mmfparam.path = "points.mmf";
+    mmfparam.path = m_pointFile;
     mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
     mmfparam.new_file_size = sizeof(float) * m_numPoints * 3;
 
     boost::iostreams::mapped_file_params mmfparam_normal;
-    mmfparam_normal.path = "normals.mmf";
+    mmfparam_normal.path = m_normalFile;
     mmfparam_normal.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
     mmfparam_normal.new_file_size = sizeof(float) * m_numPoints * 3;
 
     boost::iostreams::mapped_file_params mmfparam_color;
-    mmfparam_color.path = "colors.mmf";
+    mmfparam_color.path = m_colorFile;
     mmfparam_color.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
     mmfparam_color.new_file_size = sizeof(unsigned char) * m_numPoints * 3;
 
+    // The points are written in input order, i.e. scattered over the cells of the
+    // files. Disable the read-ahead, which would only fetch pages that are overwritten.
     m_PointFile.open(mmfparam);
+    adviseAccess(m_PointFile.data(), m_PointFile.size(), ACCESS_RANDOM);
     float* mmfdata_normal;
     unsigned char* mmfdata_color;
     if (lineReader.getFileType() == XYZNRGB || lineReader.getFileType() == XYZN)
     {
         m_NomralFile.open(mmfparam_normal);
+        adviseAccess(m_NomralFile.data(), m_NomralFile.size(), ACCESS_RANDOM);
         mmfdata_normal = (float*)m_NomralFile.data();
         m_has_normal = true;
     }
     if (lineReader.getFileType() == XYZNRGB || lineReader.getFileType() == XYZRGB)
     {
         m_ColorFile.open(mmfparam_color);
+        adviseAccess(m_ColorFile.data(), m_ColorFile.size(), ACCESS_RANDOM);
         mmfdata_color = (unsigned char*)m_ColorFile.data();
         m_has_color = true;
     }
@@ -524,7 +538,8 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
     //    }
     m_PointFile.close();
     m_NomralFile.close();
-    mmfparam.path = "distances.mmf";
+    m_ColorFile.close();
+    mmfparam.path = m_distanceFile;
     mmfparam.new_file_size = sizeof(float) * size() * 8;
 
     m_PointFile.open(mmfparam);
@@ -533,7 +548,7 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
 
 
 template <typename BaseVecT>
-BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, float scale)
+BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, float scale, std::string scratchDir)
         : m_maxIndex(0), m_maxIndexSquare(0), m_maxIndexX(0), m_maxIndexY(0), m_maxIndexZ(0),
           m_numPoints(0), m_extrude(true), m_scale(scale), m_has_normal(false), m_has_color(false)
 {
@@ -550,6 +565,8 @@ BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, floa
     }
     else
     {
+        initFiles(scratchDir);
+
         float ix, iy, iz;
 
         string comment = lvr2::timestamp.getElapsedTime() + "Building grid... ";
@@ -685,22 +702,22 @@ BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, floa
 
         boost::iostreams::mapped_file_params mmfparam;
 
-        mmfparam.path = "points.mmf";
+        mmfparam.path = m_pointFile;
         mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
         mmfparam.new_file_size = sizeof(float) * m_numPoints * 3;
 
         boost::iostreams::mapped_file_params mmfparam_normal;
-        mmfparam_normal.path = "normals.mmf";
+        mmfparam_normal.path = m_normalFile;
         mmfparam_normal.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
         mmfparam_normal.new_file_size = sizeof(float) * m_numPoints * 3;
 
         boost::iostreams::mapped_file_params mmfparam_color;
-        mmfparam_color.path = "colors.mmf";
+        mmfparam_color.path = m_colorFile;
         mmfparam_color.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
         mmfparam_color.new_file_size = sizeof(unsigned char) * m_numPoints * 3;
 
         m_PointFile.open(mmfparam);
-
+        adviseAccess(m_PointFile.data(), m_PointFile.size(), ACCESS_RANDOM);
         float* mmfdata = (float*)m_PointFile.data();
 
 
@@ -751,7 +768,7 @@ BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, floa
         
         m_PointFile.close();
         m_NomralFile.close();
-        mmfparam.path = "distances.mmf";
+        mmfparam.path = m_distanceFile;
         mmfparam.new_file_size = sizeof(float) * size() * 8;
 
         m_PointFile.open(mmfparam);
@@ -760,6 +777,49 @@ BigGrid<BaseVecT>::BigGrid(float voxelsize, ScanProjectEditMarkPtr project, floa
     }
 }
 
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::initFiles(const std::string& scratchDir)
+{
+    m_scratch = std::make_shared<ScratchDirectory>(scratchDir, "biggrid");
+    m_pointFile = m_scratch->file("points.mmf");
+    m_normalFile = m_scratch->file("normals.mmf");
+    m_colorFile = m_scratch->file("colors.mmf");
+    m_distanceFile = m_scratch->file("distances.mmf");
+}
+
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::adviseAccess(const void* addr, size_t length, AccessPattern pattern)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (addr == nullptr || length == 0)
+    {
+        return;
+    }
+
+    // posix_madvise() expects a page aligned address
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)addr;
+    uintptr_t alignedBegin = begin - begin % pageSize;
+
+    int advice = POSIX_MADV_NORMAL;
+    switch (pattern)
+    {
+    case ACCESS_SEQUENTIAL:
+        advice = POSIX_MADV_SEQUENTIAL;
+        break;
+    case ACCESS_RANDOM:
+        advice = POSIX_MADV_RANDOM;
+        break;
+    case ACCESS_WILLNEED:
+        advice = POSIX_MADV_WILLNEED;
+        break;
+    }
+
+    // Only a hint, failures are harmless
+    posix_madvise((void*)alignedBegin, length + (begin - alignedBegin), advice);
+#endif
+}
+
 template <typename BaseVecT>
 BigGrid<BaseVecT>::~BigGrid()
 {
@@ -827,6 +887,24 @@ BigGrid<BaseVecT>::BigGrid(std::string path)
         ifs.read((char*)&c.iz, sizeof(size_t));
         m_gridNumPoints[hash] = c;
     }
+
+    // Grids serialized before the scratch directory was configurable use
+    // the files in the current working directory
+    m_pointFile = "points.mmf";
+    m_normalFile = "normals.mmf";
+    m_colorFile = "colors.mmf";
+    m_distanceFile = "distances.mmf";
+    std::string* files[] = {&m_pointFile, &m_normalFile, &m_colorFile, &m_distanceFile};
+    for (std::string* file : files)
+    {
+        size_t length;
+        if (!ifs.read((char*)&length, sizeof(length)))
+        {
+            break;
+        }
+        file->resize(length);
+        ifs.read(&(*file)[0], length);
+    }
 }
 
 template <typename BaseVecT>
@@ -873,7 +951,22 @@ void BigGrid<BaseVecT>::serialize(std::string path)
         ofs.write((char*)&it->second.iy, sizeof(size_t));
         ofs.write((char*)&it->second.iz, sizeof(size_t));
     }
+
+    // The serialized grid references the memory mapped files of this instance
+    const std::string* files[] = {&m_pointFile, &m_normalFile, &m_colorFile, &m_distanceFile};
+    for (const std::string* file : files)
+    {
+        std::string absolute = boost::filesystem::absolute(*file).string();
+        size_t length = absolute.size();
+        ofs.write((char*)&length, sizeof(length));
+        ofs.write(absolute.data(), length);
+    }
     ofs.close();
+
+    if (m_scratch)
+    {
+        m_scratch->keep();
+    }
 }
 
 template <typename BaseVecT>
@@ -907,83 +1000,116 @@ template <typename BaseVecT>
 lvr2::floatArr BigGrid<BaseVecT>::points(int i, int j, int k, size_t& numPoints)
 {
     lvr2::floatArr points;
+    numPoints = 0;
     size_t h = hashValue(i, j, k);
     auto it = m_gridNumPoints.find(h);
     if (it != m_gridNumPoints.end())
     {
-        size_t cellSize = m_gridNumPoints[h].size;
-
-        points = lvr2::floatArr(new float[3 * cellSize]);
-        boost::iostreams::mapped_file_params mmfparam;
-        mmfparam.path = "points.mmf";
-        mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-
-        m_PointFile.open(mmfparam);
-        float* mmfdata = (float*)m_PointFile.data();
-
-        memcpy(points.get(), mmfdata, 3 * pointSize() * sizeof(float));
-
-        numPoints = pointSize();
+        CellSpan cell;
+        cell.offset = it->second.offset;
+        cell.size = it->second.size;
+        numPoints = cell.size;
+        points = gatherCells<float>(m_pointFile, std::vector<CellSpan>(1, cell), numPoints);
     }
     return points;
 }
 
 template <typename BaseVecT>
-lvr2::floatArr BigGrid<BaseVecT>::points(
-    float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
+void BigGrid<BaseVecT>::buildBrickIndex()
 {
-    minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
-    miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
-    minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
-    maxx = (maxx < m_bb.getMax()[0]) ? maxx : m_bb.getMax()[0];
-    maxy = (maxy < m_bb.getMax()[1]) ? maxy : m_bb.getMax()[1];
-    maxz = (maxz < m_bb.getMax()[2]) ? maxz : m_bb.getMax()[2];
+    m_bricks.clear();
+    m_numBricksX = m_maxIndexX / m_brickSize + 1;
+    m_numBricksY = m_maxIndexY / m_brickSize + 1;
+    m_numBricksZ = m_maxIndexZ / m_brickSize + 1;
 
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
+    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    {
+        const CellInfo& cell = it->second;
+        if (cell.size == 0 || cell.inserted == 0)
+        {
+            // ix, iy and iz are only set once a point was inserted
+            continue;
+        }
 
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
+        size_t bx = std::min(cell.ix / m_brickSize, m_numBricksX - 1);
+        size_t by = std::min(cell.iy / m_brickSize, m_numBricksY - 1);
+        size_t bz = std::min(cell.iz / m_brickSize, m_numBricksZ - 1);
+        size_t brick = (bx * m_numBricksY + by) * m_numBricksZ + bz;
+
+        CellSpan span;
+        span.ix = cell.ix;
+        span.iy = cell.iy;
+        span.iz = cell.iz;
+        span.offset = cell.offset;
+        span.size = cell.size;
+        m_bricks[brick].push_back(span);
+    }
 
+    m_brickIndexBuilt = true;
+}
 
-    lvr2::floatArr points(new float[numPoints * 3]);
-    size_t p_index = 0;
+template <typename BaseVecT>
+std::vector<CellSpan> BigGrid<BaseVecT>::cellsInBox(
+    size_t idxmin, size_t idymin, size_t idzmin, size_t idxmax, size_t idymax, size_t idzmax)
+{
+    if (!m_brickIndexBuilt)
+    {
+        buildBrickIndex();
+    }
+
+    std::vector<CellSpan> cells;
+    if (idxmin > idxmax || idymin > idymax || idzmin > idzmax)
+    {
+        return cells;
+    }
 
-    boost::iostreams::mapped_file_source mmfs("points.mmf");
-    float* mmfdata = (float*)mmfs.data();
+    // Only visit the bricks overlapping the box
+    size_t bxmax = std::min(idxmax / m_brickSize, m_numBricksX - 1);
+    size_t bymax = std::min(idymax / m_brickSize, m_numBricksY - 1);
+    size_t bzmax = std::min(idzmax / m_brickSize, m_numBricksZ - 1);
 
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    // Cells beyond the maximum index are stored in the last brick
+    size_t bxmin = std::min(idxmin / m_brickSize, m_numBricksX - 1);
+    size_t bymin = std::min(idymin / m_brickSize, m_numBricksY - 1);
+    size_t bzmin = std::min(idzmin / m_brickSize, m_numBricksZ - 1);
+
+    for (size_t bx = bxmin; bx <= bxmax; bx++)
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
+        for (size_t by = bymin; by <= bymax; by++)
         {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
+            for (size_t bz = bzmin; bz <= bzmax; bz++)
             {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
+                auto it = m_bricks.find((bx * m_numBricksY + by) * m_numBricksZ + bz);
+                if (it == m_bricks.end())
+                {
+                    continue;
+                }
+
+                for (const CellSpan& cell : it->second)
+                {
+                    if (cell.ix >= idxmin && cell.iy >= idymin && cell.iz >= idzmin &&
+                        cell.ix <= idxmax && cell.iy <= idymax && cell.iz <= idzmax)
+                    {
+                        cells.push_back(cell);
+                    }
+                }
             }
         }
     }
-    return points;
+
+    // Sorting by offset makes the reads from the mapped files sequential
+    std::sort(cells.begin(), cells.end(), [](const CellSpan& a, const CellSpan& b)
+    {
+        return a.offset < b.offset;
+    });
+
+    return cells;
 }
 
 template <typename BaseVecT>
-lvr2::floatArr BigGrid<BaseVecT>::normals(
+std::vector<CellSpan> BigGrid<BaseVecT>::cellsInClampedBox(
     float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
 {
-    std::ifstream ifs("normals.mmf");
-    if (!ifs.good())
-    {
-        numPoints = 0;
-        lvr2::floatArr arr;
-        return arr;
-    }
     minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
     miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
     minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
@@ -998,83 +1124,122 @@ lvr2::floatArr BigGrid<BaseVecT>::normals(
     size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
     size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
 
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
+    std::vector<CellSpan> cells = cellsInBox(idxmin, idymin, idzmin, idxmax, idymax, idzmax);
 
-    lvr2::floatArr points(new float[numPoints * 3]);
-    size_t p_index = 0;
+    numPoints = 0;
+    for (const CellSpan& cell : cells)
+    {
+        numPoints += cell.size;
+    }
+    return cells;
+}
 
-    boost::iostreams::mapped_file_source mmfs("normals.mmf");
-    float* mmfdata = (float*)mmfs.data();
+template <typename BaseVecT>
+template <typename T>
+boost::shared_array<T> BigGrid<BaseVecT>::gatherCells(
+    const std::string& file, const std::vector<CellSpan>& cells, size_t numPoints)
+{
+    boost::shared_array<T> data(new T[numPoints * 3]);
+    if (numPoints == 0)
+    {
+        return data;
+    }
 
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    // Only the pages of the spans that are copied are read from disk
+    boost::iostreams::mapped_file_source mmfs(file);
+    const T* mmfdata = (const T*)mmfs.data();
+    adviseAccess(mmfs.data(), mmfs.size(), ACCESS_SEQUENTIAL);
+
+    // merge cells that are stored back to back into one copy
+    std::vector<std::pair<size_t, size_t>> spans;
+    size_t i = 0;
+    while (i < cells.size())
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
+        size_t offset = cells[i].offset;
+        size_t count = cells[i].size;
+        for (i++; i < cells.size() && cells[i].offset == offset + count; i++)
         {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
-            {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
-            }
+            count += cells[i].size;
         }
+        spans.push_back(std::make_pair(offset, count));
     }
 
-    return points;
+    // Let the kernel read all spans ahead while the first ones are copied
+    for (const auto& span : spans)
+    {
+        adviseAccess(mmfdata + span.first * 3, span.second * 3 * sizeof(T), ACCESS_WILLNEED);
+    }
+
+    size_t p_index = 0;
+    for (const auto& span : spans)
+    {
+        std::memcpy(data.get() + p_index, mmfdata + span.first * 3, span.second * 3 * sizeof(T));
+        p_index += span.second * 3;
+    }
+
+    return data;
+}
+
+template <typename BaseVecT>
+lvr2::floatArr BigGrid<BaseVecT>::points(
+    float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
+{
+    std::vector<CellSpan> cells = cellsInClampedBox(minx, miny, minz, maxx, maxy, maxz, numPoints);
+    return gatherCells<float>(m_pointFile, cells, numPoints);
+}
+
+template <typename BaseVecT>
+lvr2::floatArr BigGrid<BaseVecT>::normals(
+    float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
+{
+    std::ifstream ifs(m_normalFile);
+    if (!ifs.good())
+    {
+        numPoints = 0;
+        lvr2::floatArr arr;
+        return arr;
+    }
+
+    std::vector<CellSpan> cells = cellsInClampedBox(minx, miny, minz, maxx, maxy, maxz, numPoints);
+    return gatherCells<float>(m_normalFile, cells, numPoints);
 }
 
 template <typename BaseVecT>
 lvr2::ucharArr BigGrid<BaseVecT>::colors(
     float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
 {
-    std::ifstream ifs("colors.mmf");
+    std::ifstream ifs(m_colorFile);
     if (!ifs.good())
     {
         numPoints = 0;
         lvr2::ucharArr arr;
         return arr;
     }
-    minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
-    miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
-    minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
-    maxx = (maxx < m_bb.getMax()[0]) ? maxx : m_bb.getMax()[0];
-    maxy = (maxy < m_bb.getMax()[1]) ? maxy : m_bb.getMax()[1];
-    maxz = (maxz < m_bb.getMax()[2]) ? maxz : m_bb.getMax()[2];
 
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
-
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
+    std::vector<CellSpan> cells = cellsInClampedBox(minx, miny, minz, maxx, maxy, maxz, numPoints);
+    return gatherCells<unsigned char>(m_colorFile, cells, numPoints);
+}
 
-    lvr2::ucharArr points(new unsigned char[numPoints * 3]);
-    size_t p_index = 0;
+template <typename BaseVecT>
+lvr2::PointBufferPtr BigGrid<BaseVecT>::pointBuffer(
+    float minx, float miny, float minz, float maxx, float maxy, float maxz, bool withColors)
+{
+    size_t numPoints;
+    std::vector<CellSpan> cells = cellsInClampedBox(minx, miny, minz, maxx, maxy, maxz, numPoints);
 
-    boost::iostreams::mapped_file_source mmfs("colors.mmf");
-    unsigned char* mmfdata = (unsigned char*)mmfs.data();
+    lvr2::PointBufferPtr buffer(new lvr2::PointBuffer);
+    buffer->setPointArray(gatherCells<float>(m_pointFile, cells, numPoints), numPoints);
 
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    if (m_has_normal && std::ifstream(m_normalFile).good())
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
-            {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
-            }
-        }
+        buffer->setNormalArray(gatherCells<float>(m_normalFile, cells, numPoints), numPoints);
+    }
+    if (withColors && m_has_color && std::ifstream(m_colorFile).good())
+    {
+        buffer->setColorArray(gatherCells<unsigned char>(m_colorFile, cells, numPoints), numPoints);
     }
 
-    return points;
+    return buffer;
 }
 
 template <typename BaseVecT>
@@ -1093,20 +1258,21 @@ void BigGrid<BaseVecT>::insert(float x, float y, float z)
 template <typename BaseVecT>
 lvr2::floatArr BigGrid<BaseVecT>::getPointCloud(size_t& numPoints)
 {
-    lvr2::floatArr points(new float[3 * pointSize()]);
-    boost::iostreams::mapped_file_params mmfparam;
-    mmfparam.path = "points.mmf";
-    mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
+    numPoints = pointSize();
+    lvr2::floatArr points(new float[3 * numPoints]);
+    if (numPoints == 0)
+    {
+        return points;
+    }
 
-    m_PointFile.open(mmfparam);
-    float* mmfdata = (float*)m_PointFile.data();
-    memcpy(points.get(), mmfdata, 3 * pointSize() * sizeof(float));
+    boost::iostreams::mapped_file_source mmfs(m_pointFile);
+    adviseAccess(mmfs.data(), mmfs.size(), ACCESS_SEQUENTIAL);
+    memcpy(points.get(), mmfs.data(), 3 * numPoints * sizeof(float));
 
-    numPoints = pointSize();
     return points;
 }
 
-    template <typename BaseVecT>
+template <typename BaseVecT>
 size_t BigGrid<BaseVecT>::getSizeofBox(
     float minx, float miny, float minz, float maxx, float maxy, float maxz)
 {
@@ -1118,38 +1284,28 @@ size_t BigGrid<BaseVecT>::getSizeofBox(
     size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
 
     size_t numPoints = 0;
-
-    // Overhead of saving indices needed to speedup size lookup
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    for (const CellSpan& cell : cellsInBox(idxmin, idymin, idzmin, idxmax, idymax, idzmax))
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            numPoints += it->second.size;
-        }
+        numPoints += cell.size;
     }
 
-    //    #pragma omp parallel for schedule(dynamic,1) collapse(3)
-    //    for(size_t i = idxmin ; i<=idxmax ; i++)
-    //    {
-    //        for(size_t j = idymin ; j<=idymax ; j++)
-    //        {
-    //            for(size_t k = idzmin ; k<=idzmax ; k++)
-    //            {
-    //
-    //                size_t h = hashValue(i,j,k);
-    //                auto it = m_gridNumPoints.find(h);
-    //                if(it != m_gridNumPoints.end())
-    //                {
-    //                    omp_set_lock(&m_lock);
-    //                    numPoints+=it->second.size;
-    //                    omp_unset_lock(&m_lock);
-    //                }
-    //
-    //            }
-    //        }
-    //    }
     return numPoints;
 }
 
+template <typename BaseVecT>
+std::vector<CellSpan> BigGrid<BaseVecT>::getCells()
+{
+    if (!m_brickIndexBuilt)
+    {
+        buildBrickIndex();
+    }
+
+    std::vector<CellSpan> cells;
+    for (const auto& brick : m_bricks)
+    {
+        cells.insert(cells.end(), brick.second.begin(), brick.second.end());
+    }
+    return cells;
+}
+
 } // namespace lvr2
@@ -37,6 +37,7 @@
 #include "BigGrid.hpp"
 #include "lvr2/geometry/BoundingBox.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -60,7 +61,7 @@ class BigGridKdTree
                   BigGrid<BaseVecT>* grid,
                   float voxelsize,
                   size_t numPoints = 0);
-    virtual ~BigGridKdTree();
+    virtual ~BigGridKdTree() = default;
 
     /**
      * inserts a nodes in to the kd-Tree
@@ -68,17 +69,29 @@ class BigGridKdTree
      * @param pos
      */
     void insert(size_t numPoints, BaseVecT pos);
+
+    /**
+     * Builds the kd-tree from the point counts of all grid cells at once. Nodes with more
+     * than maxNodePoints points are split at the weighted median of their cells along the
+     * longest side, so both children get about the same number of points. The nodes of
+     * each level are split in parallel. The result only depends on the given cells, not
+     * on their order.
+     * @param cells non-empty cells of the grid, e.g. BigGrid::getCells(). The cell indices
+     *              are relative to the minimum of the bounding box of this node
+     */
+    void partition(const std::vector<CellSpan>& cells);
+
     /**
      * returns the leafs of the kd-tree (or final PartitionBB which can be converted to the
      * sub-mesh)
      * @return leafs
      */
-    static std::vector<BigGridKdTree*> getLeafs();
+    std::vector<BigGridKdTree*> getLeafs();
     /**
      *
      * @return nodes
      */
-    static std::vector<BigGridKdTree*> getNodes() { return s_nodes; }
+    std::vector<BigGridKdTree*> getNodes();
     /**
      *
      * @return number of points
@@ -98,31 +111,51 @@ class BigGridKdTree
     /**
      * children nodes of a specific node
      */
-    std::vector<BigGridKdTree*> m_children;
+    std::vector<std::unique_ptr<BigGridKdTree>> m_children;
+
+    float m_voxelsize;
 
     /**
-     * constructor reserved for intern nodes and leafs
-     * @param bb
-     * @param numPoints
+     * maximum nodes allowed in a leaf, defined by user
      */
-    BigGridKdTree(BoundingBox<BaseVecT>& bb, size_t numPoints = 0);
+    size_t m_maxNodePoints;
 
     /**
-     * global list of all created nodes
+     * grid of the whole tree
      */
-    static std::vector<BigGridKdTree*> s_nodes;
+    BigGrid<BaseVecT>* m_grid;
 
-    static float s_voxelsize;
+    /**
+     * constructor reserved for intern nodes and leafs
+     * @param bb
+     * @param parent node the settings are taken from
+     * @param numPoints
+     */
+    BigGridKdTree(BoundingBox<BaseVecT>& bb, const BigGridKdTree& parent, size_t numPoints = 0);
 
     /**
-     * maximum nodes allowed in a leaf, defined by user
+     * range of cells of a node during partition() with the (inclusive) cell indices it covers
      */
-    static size_t s_maxNodePoints;
+    struct CellRange
+    {
+        size_t begin;
+        size_t end;
+        uint32_t min[3];
+        uint32_t max[3];
+    };
 
     /**
-     * global grid, set once at the start
+     * splits this node at the weighted median of the cells in range and reorders the cells,
+     * so that the ranges of the children are consecutive
+     * @return false, if the cells can not be split along any axis
      */
-    static BigGrid<BaseVecT>* m_grid;
+    bool splitCells(std::vector<CellSpan>& cells,
+                    const CellRange& range,
+                    const BaseVecT& origin,
+                    CellRange& left,
+                    CellRange& right);
+
+    void collectNodes(std::vector<BigGridKdTree*>& nodes, bool leafsOnly);
 
     /**
      * checks, if position "pos" is within the BoundingBox
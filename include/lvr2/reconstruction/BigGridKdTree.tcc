@@ -35,21 +35,12 @@
 #include "lvr2/io/Timestamp.hpp"
 #include "lvr2/reconstruction/BigGridKdTree.hpp"
 
+#include <algorithm>
+#include <iostream>
+
 namespace lvr2
 {
 
-template <typename BaseVecT>
-float BigGridKdTree<BaseVecT>::s_voxelsize;
-
-template <typename BaseVecT>
-size_t BigGridKdTree<BaseVecT>::s_maxNodePoints;
-
-template <typename BaseVecT>
-BigGrid<BaseVecT>* BigGridKdTree<BaseVecT>::m_grid;
-
-template <typename BaseVecT>
-std::vector<BigGridKdTree<BaseVecT>*> BigGridKdTree<BaseVecT>::s_nodes;
-
 template <typename BaseVecT>
 BigGridKdTree<BaseVecT>::BigGridKdTree(lvr2::BoundingBox<BaseVecT>& bb,
                                        size_t maxNodePoints,
@@ -58,34 +49,19 @@ BigGridKdTree<BaseVecT>::BigGridKdTree(lvr2::BoundingBox<BaseVecT>& bb,
                                        size_t numPoints)
     :
 
-      m_bb(bb), m_numPoints(numPoints)
-
-{
-    s_maxNodePoints = maxNodePoints;
-    s_voxelsize = voxelsize;
-    s_nodes.push_back(this);
-    m_grid = grid;
-}
+      m_bb(bb), m_numPoints(numPoints), m_voxelsize(voxelsize), m_maxNodePoints(maxNodePoints),
+      m_grid(grid)
 
-template <typename BaseVecT>
-BigGridKdTree<BaseVecT>::BigGridKdTree(lvr2::BoundingBox<BaseVecT>& bb, size_t numPoints)
-    : m_bb(bb), m_numPoints(0)
 {
-    s_nodes.push_back(this);
-    insert(numPoints, m_bb.getCentroid());
 }
 
 template <typename BaseVecT>
-BigGridKdTree<BaseVecT>::~BigGridKdTree()
+BigGridKdTree<BaseVecT>::BigGridKdTree(lvr2::BoundingBox<BaseVecT>& bb,
+                                       const BigGridKdTree& parent,
+                                       size_t numPoints)
+    : m_bb(bb), m_numPoints(numPoints), m_voxelsize(parent.m_voxelsize),
+      m_maxNodePoints(parent.m_maxNodePoints), m_grid(parent.m_grid)
 {
-    if (this == s_nodes[0] && s_nodes.size() > 0)
-    {
-        for (int i = 1; i < s_nodes.size(); i++)
-        {
-            delete s_nodes[i];
-        }
-        s_nodes.clear();
-    }
 }
 
 template <typename BaseVecT>
@@ -107,7 +83,7 @@ void BigGridKdTree<BaseVecT>::insert(size_t numPoints, BaseVecT pos)
     {
 
         // If the new size is larger then max. size, split tree
-        if (m_numPoints + numPoints > s_maxNodePoints)
+        if (m_numPoints + numPoints > m_maxNodePoints)
         {
 
             // Split at X-Axis
@@ -118,7 +94,7 @@ void BigGridKdTree<BaseVecT>::insert(size_t numPoints, BaseVecT pos)
             if (m_bb.getXSize() >= m_bb.getYSize() && m_bb.getXSize() >= m_bb.getZSize())
             {
                 float left_size = m_bb.getXSize() / 2.0;
-                float split_value = m_bb.getMin().x + ceil(left_size / s_voxelsize) * s_voxelsize;
+                float split_value = m_bb.getMin().x + ceil(left_size / m_voxelsize) * m_voxelsize;
 
                 leftbb = lvr2::BoundingBox<BaseVecT>(
                     BaseVecT(m_bb.getMin().x, m_bb.getMin().y, m_bb.getMin().z),
@@ -141,7 +117,7 @@ void BigGridKdTree<BaseVecT>::insert(size_t numPoints, BaseVecT pos)
                     */
                     ignoreSplit = true;
                     std::cout << "WARNING: m_numPoints + numPoints = " << m_numPoints + numPoints
-                              << " > " << s_maxNodePoints << ". Ignoring x-split" << std::endl;
+                              << " > " << m_maxNodePoints << ". Ignoring x-split" << std::endl;
                 }
             }
             // Split at Y-Axis
@@ -149,7 +125,7 @@ void BigGridKdTree<BaseVecT>::insert(size_t numPoints, BaseVecT pos)
             {
 
                 float left_size = m_bb.getYSize() / 2.0;
-                float split_value = m_bb.getMin().y + ceil(left_size / s_voxelsize) * s_voxelsize;
+                float split_value = m_bb.getMin().y + ceil(left_size / m_voxelsize) * m_voxelsize;
 
                 leftbb = lvr2::BoundingBox<BaseVecT>(
                     BaseVecT(m_bb.getMin().x, m_bb.getMin().y, m_bb.getMin().z),
@@ -170,14 +146,14 @@ void BigGridKdTree<BaseVecT>::insert(size_t numPoints, BaseVecT pos)
                     */
                     ignoreSplit = true;
                     std::cout << "WARNING: m_numPoints + numPoints = " << m_numPoints + numPoints
-                              << " > " << s_maxNodePoints << ". Ignoring y-split" << std::endl;
+                              << " > " << m_maxNodePoints << ". Ignoring y-split" << std::endl;
                 }
             }
             // Split at Z-Axis
             else
             {
                 float left_size = m_bb.getZSize() / 2.0;
-                float split_value = m_bb.getMin().z + ceil(left_size / s_voxelsize) * s_voxelsize;
+                float split_value = m_bb.getMin().z + ceil(left_size / m_voxelsize) * m_voxelsize;
 
                 leftbb = lvr2::BoundingBox<BaseVecT>(
                     BaseVecT(m_bb.getMin().x, m_bb.getMin().y, m_bb.getMin().z),
@@ -198,7 +174,7 @@ void BigGridKdTree<BaseVecT>::insert(size_t numPoints, BaseVecT pos)
                     */
                     ignoreSplit = true;
                     std::cout << "WARNING: m_numPoints + numPoints = " << m_numPoints + numPoints
-                              << " > " << s_maxNodePoints << ". Ignoring z-split" << std::endl;
+                              << " > " << m_maxNodePoints << ". Ignoring z-split" << std::endl;
                 }
             }
 
@@ -220,10 +196,10 @@ void BigGridKdTree<BaseVecT>::insert(size_t numPoints, BaseVecT pos)
                                                        leftbb.getMax().z);
 
                 // std::cout << lvr2::timestamp << " size_end "  << std::endl;
-                BigGridKdTree* leftChild = new BigGridKdTree(leftbb, leftSize);
-                BigGridKdTree* rightChild = new BigGridKdTree(rightbb, rightSize);
-                m_children.push_back(leftChild);
-                m_children.push_back(rightChild);
+                m_children.emplace_back(new BigGridKdTree(leftbb, *this));
+                m_children.emplace_back(new BigGridKdTree(rightbb, *this));
+                m_children[0]->insert(leftSize, leftbb.getCentroid());
+                m_children[1]->insert(rightSize, rightbb.getCentroid());
             }
         }
         else
@@ -234,17 +210,230 @@ void BigGridKdTree<BaseVecT>::insert(size_t numPoints, BaseVecT pos)
 }
 
 template <typename BaseVecT>
-std::vector<BigGridKdTree<BaseVecT>*> BigGridKdTree<BaseVecT>::getLeafs()
+void BigGridKdTree<BaseVecT>::partition(const std::vector<CellSpan>& cells)
 {
-    std::vector<BigGridKdTree*> leafs;
-    for (int i = 0; i < s_nodes.size(); i++)
+    m_children.clear();
+
+    // The cells are reordered, so that the cells of every node are consecutive
+    std::vector<CellSpan> nodeCells(cells);
+
+    size_t numPoints = 0;
+    uint32_t minX = UINT32_MAX, minY = UINT32_MAX, minZ = UINT32_MAX;
+    uint32_t maxX = 0, maxY = 0, maxZ = 0;
+
+    #pragma omp parallel for reduction(+:numPoints) reduction(min:minX,minY,minZ) reduction(max:maxX,maxY,maxZ)
+    for (size_t i = 0; i < nodeCells.size(); i++)
+    {
+        const CellSpan& cell = nodeCells[i];
+        numPoints += cell.size;
+        minX = std::min(minX, cell.ix);
+        minY = std::min(minY, cell.iy);
+        minZ = std::min(minZ, cell.iz);
+        maxX = std::max(maxX, cell.ix);
+        maxY = std::max(maxY, cell.iy);
+        maxZ = std::max(maxZ, cell.iz);
+    }
+
+    m_numPoints = numPoints;
+    if (nodeCells.empty())
+    {
+        return;
+    }
+
+    CellRange root;
+    root.begin = 0;
+    root.end = nodeCells.size();
+    root.min[0] = minX;
+    root.min[1] = minY;
+    root.min[2] = minZ;
+    root.max[0] = maxX;
+    root.max[1] = maxY;
+    root.max[2] = maxZ;
+
+    BaseVecT origin = m_bb.getMin();
+    size_t numUnsplit = 0;
+
+    // Split level by level. The nodes of a level are independent, the next level is
+    // collected in order, so the tree does not depend on the scheduling.
+    std::vector<std::pair<BigGridKdTree*, CellRange>> level = {{this, root}};
+    while (!level.empty())
+    {
+        std::vector<CellRange> left(level.size());
+        std::vector<CellRange> right(level.size());
+        std::vector<char> split(level.size(), 0);
+
+        // A single node is split with all threads in splitCells()
+        #pragma omp parallel for schedule(dynamic) if(level.size() > 1)
+        for (size_t i = 0; i < level.size(); i++)
+        {
+            BigGridKdTree* node = level[i].first;
+            if (node->m_numPoints > m_maxNodePoints)
+            {
+                split[i] = node->splitCells(nodeCells, level[i].second, origin, left[i], right[i]);
+            }
+        }
+
+        std::vector<std::pair<BigGridKdTree*, CellRange>> next;
+        for (size_t i = 0; i < level.size(); i++)
+        {
+            BigGridKdTree* node = level[i].first;
+            if (split[i])
+            {
+                next.push_back({node->m_children[0].get(), left[i]});
+                next.push_back({node->m_children[1].get(), right[i]});
+            }
+            else if (node->m_numPoints > m_maxNodePoints)
+            {
+                numUnsplit++;
+            }
+        }
+        level.swap(next);
+    }
+
+    if (numUnsplit > 0)
+    {
+        std::cout << "WARNING: " << numUnsplit << " partitions have more than " << m_maxNodePoints
+                  << " points, but consist of a single cell. Ignoring split" << std::endl;
+    }
+}
+
+template <typename BaseVecT>
+bool BigGridKdTree<BaseVecT>::splitCells(std::vector<CellSpan>& cells,
+                                         const CellRange& range,
+                                         const BaseVecT& origin,
+                                         CellRange& left,
+                                         CellRange& right)
+{
+    auto cellIndex = [](const CellSpan& cell, int axis) -> uint32_t
+    {
+        return axis == 0 ? cell.ix : (axis == 1 ? cell.iy : cell.iz);
+    };
+
+    // Prefer the longest side, as the geometric split does
+    int axes[3] = {0, 1, 2};
+    float sizes[3] = {m_bb.getXSize(), m_bb.getYSize(), m_bb.getZSize()};
+    std::stable_sort(axes, axes + 3, [&](int a, int b) { return sizes[a] > sizes[b]; });
+
+    for (int axis : axes)
     {
-        if (s_nodes[i]->m_children.size() == 0 && s_nodes[i]->m_numPoints > 0)
+        uint32_t minIndex = range.min[axis];
+        if (minIndex == range.max[axis])
+        {
+            continue;
+        }
+
+        // Number of points per slice of cells along the axis
+        size_t numSlices = range.max[axis] - minIndex + 1;
+        std::vector<size_t> weights(numSlices, 0);
+        #pragma omp parallel
+        {
+            std::vector<size_t> localWeights(numSlices, 0);
+            #pragma omp for nowait
+            for (size_t i = range.begin; i < range.end; i++)
+            {
+                localWeights[cellIndex(cells[i], axis) - minIndex] += cells[i].size;
+            }
+
+            #pragma omp critical(bigGridKdTreeWeights)
+            {
+                for (size_t j = 0; j < numSlices; j++)
+                {
+                    weights[j] += localWeights[j];
+                }
+            }
+        }
+
+        size_t total = 0;
+        for (size_t weight : weights)
+        {
+            total += weight;
+        }
+
+        // Weighted median: the first slice of the right child, so that the left child gets
+        // as close to half of the points as possible. Both children must contain points.
+        size_t splitSlice = 0;
+        size_t leftPoints = 0;
+        size_t bestDiff = total;
+        size_t sum = 0;
+        for (size_t s = 1; s < numSlices && sum < total; s++)
+        {
+            sum += weights[s - 1];
+            if (sum == 0 || sum == total)
+            {
+                continue;
+            }
+
+            size_t diff = 2 * sum > total ? 2 * sum - total : total - 2 * sum;
+            if (diff < bestDiff)
+            {
+                bestDiff = diff;
+                splitSlice = s;
+                leftPoints = sum;
+            }
+        }
+
+        if (splitSlice == 0)
         {
-            leafs.push_back(s_nodes[i]);
+            continue;
         }
+
+        uint32_t splitIndex = minIndex + splitSlice;
+        auto mid = std::partition(cells.begin() + range.begin,
+                                  cells.begin() + range.end,
+                                  [&](const CellSpan& cell) { return cellIndex(cell, axis) < splitIndex; });
+
+        left = range;
+        right = range;
+        left.end = mid - cells.begin();
+        right.begin = left.end;
+        left.max[axis] = splitIndex - 1;
+        right.min[axis] = splitIndex;
+
+        // The cell with index i covers [i - 0.5, i + 0.5) voxels from the origin
+        float split_value = origin[axis] + (splitIndex - 0.5f) * m_voxelsize;
+        BaseVecT leftMax = m_bb.getMax();
+        BaseVecT rightMin = m_bb.getMin();
+        leftMax[axis] = split_value;
+        rightMin[axis] = split_value;
+
+        lvr2::BoundingBox<BaseVecT> leftbb(m_bb.getMin(), leftMax);
+        lvr2::BoundingBox<BaseVecT> rightbb(rightMin, m_bb.getMax());
+        m_children.emplace_back(new BigGridKdTree(leftbb, *this, leftPoints));
+        m_children.emplace_back(new BigGridKdTree(rightbb, *this, total - leftPoints));
+        return true;
+    }
+
+    return false;
+}
+
+template <typename BaseVecT>
+void BigGridKdTree<BaseVecT>::collectNodes(std::vector<BigGridKdTree*>& nodes, bool leafsOnly)
+{
+    if (!leafsOnly || (m_children.size() == 0 && m_numPoints > 0))
+    {
+        nodes.push_back(this);
     }
+
+    for (auto& child : m_children)
+    {
+        child->collectNodes(nodes, leafsOnly);
+    }
+}
+
+template <typename BaseVecT>
+std::vector<BigGridKdTree<BaseVecT>*> BigGridKdTree<BaseVecT>::getLeafs()
+{
+    std::vector<BigGridKdTree*> leafs;
+    collectNodes(leafs, true);
     return leafs;
 }
 
+template <typename BaseVecT>
+std::vector<BigGridKdTree<BaseVecT>*> BigGridKdTree<BaseVecT>::getNodes()
+{
+    std::vector<BigGridKdTree*> nodes;
+    collectNodes(nodes, false);
+    return nodes;
+}
+
 } // namespace lvr2
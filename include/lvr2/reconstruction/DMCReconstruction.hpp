@@ -120,13 +120,12 @@ protected:
         char pos);
 
     /**
-     * @brief Builds a tree level respectively creates the child nodes of a root node.
+     * @brief Builds the adaptive octree level by level. The split decisions
+     *        of all cells of a level are evaluated in parallel.
      *
-     * @param parentPoints Points inside the parent node.
-     * @param parent       Reference to the parent node.
-     * @param childCenter  Centers of the children.
-     * @param size         Actually voxelsize.
-     * @param parentCenter Center of the parent node.
+     * @param parent       Reference to the octree.
+     * @param levels       Number of levels of the octree.
+     * @param dual         Whether the point fitting is done on dual cells.
      */
     void buildTree(
         C_Octree<BaseVecT, BoxT, my_dummy> &parent,
@@ -134,7 +133,26 @@ protected:
         bool dual);
 
     /**
-     * @brief Traverses the octree and insert for each leaf the getSurface-function into the thread pool.
+     * @brief Checks whether the points of a cell (or of the dual cells around
+     *        its corners) fit well to the local reconstruction. Only reads the
+     *        octree, so it can be called for many cells in parallel.
+     *
+     * @param parent    Reference to the octree
+     * @param ch        The cell to check
+     * @param cur_Level Level of the cell
+     * @param levels    Number of levels of the octree
+     * @param dual      Whether dual cells should be checked
+     * @return          The cells that have to be split
+     */
+    vector<CellHandle> getCellsToSplit(
+        C_Octree<BaseVecT, BoxT, my_dummy> &parent,
+        CellHandle ch,
+        int cur_Level,
+        int levels,
+        bool dual);
+
+    /**
+     * @brief Traverses the octree and calls the getSurface-function for each leaf in parallel.
      *
      * @param mesh       The reconstructed mesh.
      * @param node       Actually node.
@@ -232,14 +250,11 @@ protected:
     /**
      * @brief Performs a local reconstruction according to the standard Marching Cubes table from Paul Bourke.
      *
-     * @param mesh The reconstructed mesh
+     * @param triangles Buffer the vertices of the created triangles are appended to (three per triangle)
      * @param leaf A octree leaf.
-     * @param cells
      */
-    void getSurface(BaseMesh<BaseVecT> &mesh,
-        DualLeaf<BaseVecT, BoxT> *leaf,
-        int cells,
-        short level);
+    void getSurface(vector<BaseVecT> &triangles,
+        DualLeaf<BaseVecT, BoxT> *leaf);
 
     /**
      * @brief Saves the octree as wireframe. WORKS ONLY SINGLE THREADED!
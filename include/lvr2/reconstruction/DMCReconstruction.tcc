@@ -33,6 +33,7 @@
  */
 
 #include "lvr2/geometry/BaseMesh.hpp"
+#include <array>
 #include <vector>
 #include <random>
 using std::vector;
@@ -100,6 +101,18 @@ void DMCReconstruction<BaseVecT, BoxT>::buildTree(
     int max_cells = (1 << m_maxLevel);
     float* max_bb_width = std::max_element(bb_size, bb_size+3);
 
+    // cells of every level that still have to be visited
+    vector< vector<CellHandle> > frontiers(levels + 1);
+    CellHandle ch_end = parent.end();
+    for (CellHandle ch = parent.root(); ch != ch_end; ++ch)
+    {
+        int level = parent.level(ch);
+        if (level > 0 && level <= levels)
+        {
+            frontiers[level].push_back(ch);
+        }
+    }
+
     for(int cur_Level = levels; cur_Level > 0; --cur_Level)
     {
         // calculating stepwidth at current level for transformation into real world coordinates
@@ -110,407 +123,426 @@ void DMCReconstruction<BaseVecT, BoxT>::buildTree(
         }
         float stepWidth = *max_bb_width / cells;
 
-        CellHandle ch_end = parent.end();
+        // visit the cells in the order of the octree
+        vector<CellHandle>& frontier = frontiers[cur_Level];
+        std::sort(frontier.begin(), frontier.end());
 
-        int cellCounter = 0;
+        // decide which cells have to be split. All cells of the level are
+        // checked against the tree as it was at the beginning of the level.
+        vector< vector<CellHandle> > toSplit(frontier.size());
 
-        // visiting all cells of the octree
-        for (CellHandle ch = parent.root(); ch != ch_end; ++ch)
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (long i = 0; i < static_cast<long>(frontier.size()); i++)
         {
-            //  visiting cells that matches the current level
-            if ((parent.level(ch) == cur_Level))
-            {
-                cellCounter++;
+            toSplit[i] = getCellsToSplit(parent, frontier[i], cur_Level, levels, dual);
+        }
 
-                // get the points of the current (dual) cell(s)
-                vector< vector<coord<float>*> > cellPoints;
-                std::vector<CellHandle> cellHandles;
-                std::vector<uint> markers;
-                if(dual && cur_Level < levels - 2)
+        // collect the cells to split in the order of the serial traversal,
+        // avoid splitting the same cell twice and never split the finest level
+        vector<CellHandle> splitCells;
+        vector<bool> marked(parent.size(), false);
+        for (auto& handles : toSplit)
+        {
+            for (CellHandle cellHandle : handles)
+            {
+                if (!marked[cellHandle.idx()] && parent.is_leaf(cellHandle) && parent.level(cellHandle) > 0)
                 {
-                    int cells_tmp = 2;
-                    for(int i = 1; i < m_maxLevel; i++)
-                    {
-                        cells_tmp *= 2;
-                    }
+                    marked[cellHandle.idx()] = true;
+                    splitCells.push_back(cellHandle);
+                }
+            }
+        }
 
-                    for(int position = 0; position < 8; position++)
-                    {
-                        std::vector<CellHandle> cellHandles_tmp;
-                        std::vector<uint> markers_tmp;
-                        std::tie(cellHandles_tmp, markers_tmp) = parent.all_corner_neighbors(ch, position);
+        // sort the points of the split cells to the corresponding children
+        vector< std::array<vector<coord<float>*>, 8> > childrenPoints(splitCells.size());
 
-                        cellHandles.insert(cellHandles.end(), cellHandles_tmp.begin(), cellHandles_tmp.end());
-                        markers.insert(markers.end(), markers_tmp.begin(), markers_tmp.end());
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (long i = 0; i < static_cast<long>(splitCells.size()); i++)
+        {
+            vector<coord<float>*> points = m_pointHandler->getContainedPoints(splitCells[i].idx());
 
-                        for(int ch_idx = 0; ch_idx < 8; ch_idx++)
-                        {
-                            vector<coord<float>*> p;
-                            cellPoints.push_back(p);
-                            vector<coord<float>*> tmp = m_pointHandler->getContainedPoints(cellHandles_tmp[ch_idx].idx());
-                            for (vector<coord<float>*>::iterator it = tmp.begin(); it != tmp.end(); it++)
-                            {
-                                BaseVecT center = parent.cell_center(cellHandles_tmp[ch_idx]);
-                                center = center * (*max_bb_width / cells_tmp);
-                                center = center + bb_min;
-                                if( parent.getChildIndex(center, *it) == (7 - ch_idx) )
-                                {
-                                    cellPoints[position].push_back(*it);
-                                }
-                            }
-                        }
-                    }
-                }
-                else {
-                    vector<coord<float>*> p;
-                    p = m_pointHandler->getContainedPoints(ch.idx());
-                    cellPoints.push_back(p);
-                }
+            BaseVecT cellCenter = parent.cell_center(splitCells[i]);
+            cellCenter /= max_cells;
+            cellCenter *= stepWidth;
+            cellCenter += bb_min;
 
-                // check each (dual) cell
-                vector<int> splitting_pos;
-                float highest_error = 0;
-                bool markToSplit = false;
-                int idx = 0;
+            for (vector<coord<float>*>::iterator it = points.begin(); it != points.end(); it++)
+            {
+                childrenPoints[i][parent.getChildIndex(cellCenter, *it)].push_back(*it);
+            }
+        }
+
+        // split the cells. This has to be done serially, because the point
+        // handler stores the points in the order the cells are created.
+        for (size_t i = 0; i < splitCells.size(); i++)
+        {
+            m_pointHandler->split(splitCells[i].idx(), childrenPoints[i].data(), m_dual);
+            for (auto& points : childrenPoints[i])
+            {
+                vector<coord<float>*>().swap(points);
+            }
+
+            parent.split(splitCells[i]);
+            m_leaves += 7;
 
-                // iterate over one primal cell or over 8 dual cells until error ist to high
-                while (idx < cellPoints.size() && (!markToSplit || dual))
+            int childLevel = parent.level(splitCells[i]) - 1;
+            if (childLevel > 0 && childLevel < cur_Level)
+            {
+                for (int c = 0; c < 8; c++)
                 {
-                    // get cell points
-                    vector<coord<float>*> points = cellPoints[idx];
+                    frontiers[childLevel].push_back(parent.child(splitCells[i], c));
+                }
+            }
+        }
 
-                    // when the cell holds points check whether tey fit well to a trinangle
-                    if(points.size() > 12)
-                    {
-                        // get corner vertices of the cell
-                        BaseVecT corners[8];
+        std::cout << frontier.size() << " cells at level " << cur_Level << std::endl;
+        vector<CellHandle>().swap(frontier);
+    // end of visiting the current level
+    }
+}
 
-                        int cells_tmp = 2;
-                        for(int i = 1; i < m_maxLevel; i++)
-                        {
-                            cells_tmp *= 2;
-                        }
+template<typename BaseVecT, typename BoxT>
+vector<CellHandle> DMCReconstruction<BaseVecT, BoxT>::getCellsToSplit(
+        C_Octree<BaseVecT, BoxT, my_dummy> &parent,
+        CellHandle ch,
+        int cur_Level,
+        int levels,
+        bool dual)
+{
+    float* max_bb_width = std::max_element(bb_size, bb_size+3);
 
-                        // calculation for dual cells
-                        if(dual && cur_Level < levels - 2)
-                        {
-                            for(int i = 0; i < 8; i++)
-                            {
-                                BaseVecT tmp;
-                                detectVertexForDualCell(parent, cellHandles[idx * 8 + i], cells_tmp, *max_bb_width, i, markers[idx * 8 + i], tmp);
-                                corners[i] = BaseVecT(tmp[0], tmp[1], tmp[2]);
-                            }
+    // get the points of the current (dual) cell(s)
+    vector< vector<coord<float>*> > cellPoints;
+    std::vector<CellHandle> cellHandles;
+    std::vector<uint> markers;
+    if(dual && cur_Level < levels - 2)
+    {
+        int cells_tmp = 2;
+        for(int i = 1; i < m_maxLevel; i++)
+        {
+            cells_tmp *= 2;
+        }
 
-                            // swap position of the corners
-                            BaseVecT tmp = corners[2];
-                            corners[2] = corners[3];
-                            corners[3] = tmp;
-                            tmp = corners[6];
-                            corners[6] = corners[7];
-                            corners[7] = tmp;
+        for(int position = 0; position < 8; position++)
+        {
+            std::vector<CellHandle> cellHandles_tmp;
+            std::vector<uint> markers_tmp;
+            std::tie(cellHandles_tmp, markers_tmp) = parent.all_corner_neighbors(ch, position);
 
-                            /*for(int i = 0; i < 8; i++)
-                            {
-                                std::cout << corners[i][0] << "; " << corners[i][1] << "; " << corners[i][2] << std::endl;
-                            }
-                            std::cout << "-----------" << std::endl;
-                            int test = 0;
-                            while(test < points.size())
-                            {
-                                std::cout << (*points[test])[0] << "; " << (*points[test])[1] << "; " << (*points[test])[2] << std::endl;
-                                test += 15;
-                            }
-                            std::cout << "+++++++++++" << std::endl;*/
+            cellHandles.insert(cellHandles.end(), cellHandles_tmp.begin(), cellHandles_tmp.end());
+            markers.insert(markers.end(), markers_tmp.begin(), markers_tmp.end());
 
-                        }
-                        // calculation for primal cells
-                        else
-                        {
-                            // calculating the real world positions of the corners
-                            Location loc = parent.location(ch);
-                            int binary_cell_size = 1 << loc.level();
-                            corners[0] = BaseVecT(loc.loc_x(),                    loc.loc_y(),                    loc.loc_z());
-                            corners[1] = BaseVecT(loc.loc_x() + binary_cell_size, loc.loc_y(),                    loc.loc_z());
-                            corners[2] = BaseVecT(loc.loc_x() + binary_cell_size, loc.loc_y() + binary_cell_size, loc.loc_z());
-                            corners[3] = BaseVecT(loc.loc_x(),                    loc.loc_y() + binary_cell_size, loc.loc_z());
-                            corners[4] = BaseVecT(loc.loc_x(),                    loc.loc_y(),                    loc.loc_z() + binary_cell_size);
-                            corners[5] = BaseVecT(loc.loc_x() + binary_cell_size, loc.loc_y(),                    loc.loc_z() + binary_cell_size);
-                            corners[6] = BaseVecT(loc.loc_x() + binary_cell_size, loc.loc_y() + binary_cell_size, loc.loc_z() + binary_cell_size);
-                            corners[7] = BaseVecT(loc.loc_x(),                    loc.loc_y() + binary_cell_size, loc.loc_z() + binary_cell_size);
-
-                            for(unsigned char a = 0; a < 8; a++)
-                            {
-                                corners[a] = corners[a] * (*max_bb_width / cells_tmp);
-                                corners[a] = corners[a] + bb_min;
-                            }
-                        }
+            for(int ch_idx = 0; ch_idx < 8; ch_idx++)
+            {
+                vector<coord<float>*> p;
+                cellPoints.push_back(p);
+                vector<coord<float>*> tmp = m_pointHandler->getContainedPoints(cellHandles_tmp[ch_idx].idx());
+                for (vector<coord<float>*>::iterator it = tmp.begin(); it != tmp.end(); it++)
+                {
+                    BaseVecT center = parent.cell_center(cellHandles_tmp[ch_idx]);
+                    center = center * (*max_bb_width / cells_tmp);
+                    center = center + bb_min;
+                    if( parent.getChildIndex(center, *it) == (7 - ch_idx) )
+                    {
+                        cellPoints[position].push_back(*it);
+                    }
+                }
+            }
+        }
+    }
+    else {
+        vector<coord<float>*> p;
+        p = m_pointHandler->getContainedPoints(ch.idx());
+        cellPoints.push_back(p);
+    }
 
-                        // this is not necessarily a dual leaf
-                        DualLeaf<BaseVecT, BoxT> *leaf = new DualLeaf<BaseVecT, BoxT>(corners);
+    // check each (dual) cell
+    vector<int> splitting_pos;
+    float highest_error = 0;
+    bool markToSplit = false;
+    int idx = 0;
 
-                        // calculate distances
-                        float distances[8];
-                        BaseVecT vertex_positions[12];
-                        float projectedDistance;
-                        float euklideanDistance;
-                        for (unsigned char i = 0; i < 8; i++)
-                        {
-                            float projectedDistance;
-                            float euklideanDistance;
-                            std::tie(projectedDistance, euklideanDistance) = this->m_surface->distance(corners[i]);
-                            distances[i] = projectedDistance;
-                        }
-                        leaf->getIntersections(corners, distances, vertex_positions);
+    // iterate over one primal cell or over 8 dual cells until error ist to high
+    while (idx < cellPoints.size() && (!markToSplit || dual))
+    {
+        // get cell points
+        const vector<coord<float>*>& points = cellPoints[idx];
 
-                        /*for(int z = 0; z < 8; z++)
-                        {
-                            std::cout << distances[z] << std::endl;
-                        }
-                        std::cout << "-------" << std::endl;*/
+        // when the cell holds points check whether tey fit well to a trinangle
+        if(points.size() > 12)
+        {
+            // get corner vertices of the cell
+            BaseVecT corners[8];
 
-                        // check for valid length of the distances
-                        bool distancesValid = true;
-                        bool d_all_null = false;
+            int cells_tmp = 2;
+            for(int i = 1; i < m_maxLevel; i++)
+            {
+                cells_tmp *= 2;
+            }
 
-                        // calculate max tolerated distance
-                        float length = 0;
-                        if(!dual)
-                        {
-                            length = corners[1][0] - corners[0][0];
-                            length *= 1.7;
-                        }
-                        else
-                        {
-                            for(uint s = 0; s < 12; s++)
-                            {
-                                BaseVecT vec_tmp = corners[edgeDistanceTable[s][0]] - corners[edgeDistanceTable[s][1]];
-                                float float_tmp = sqrt(vec_tmp[0] * vec_tmp[0] + vec_tmp[1] * vec_tmp[1] + vec_tmp[2] * vec_tmp[2]);
-                                if(float_tmp > length)
-                                {
-                                    length = float_tmp;
-                                }
-                            }
-                            // length *= 1.7;
-                        }
+            // calculation for dual cells
+            if(dual && cur_Level < levels - 2)
+            {
+                for(int i = 0; i < 8; i++)
+                {
+                    BaseVecT tmp;
+                    detectVertexForDualCell(parent, cellHandles[idx * 8 + i], cells_tmp, *max_bb_width, i, markers[idx * 8 + i], tmp);
+                    corners[i] = BaseVecT(tmp[0], tmp[1], tmp[2]);
+                }
 
-                        for(unsigned char a = 0; a < 8; a++)
-                        {
-                            if(abs(distances[a]) > length)
-                            {
-                                distancesValid = false;
-                                /*if(dual && cur_Level < levels - 2)
-                                {
-                                    markToSplit = false;
-                                }*/
-                            }
-                            else if(distances[a] > 0)
-                            {
-                                d_all_null = false;
-                            }
-                        }
-                        if(distancesValid)
-                        {
-                            bool pointsFittingWell = true;
+                // swap position of the corners
+                BaseVecT tmp = corners[2];
+                corners[2] = corners[3];
+                corners[3] = tmp;
+                tmp = corners[6];
+                corners[6] = corners[7];
+                corners[7] = tmp;
 
-                            vector< vector<BaseVecT> > triangles;
-                            int index = leaf->getIndex(distances);
-                            /*if(index == 0 || index == 255)
-                            {
-                                for(int a = 0; a < 8; a++)
-                                {
-                                    std::cout << corners[a][0] << "; " << corners[a][1] << "; " << corners[a][2] << std::endl;
-                                }
-                                std::cout << "++++++++++++" << std::endl;
-                                for(unsigned char a = 0; a < 8; a++)
-                                {
-                                    std::cout << distances[a] << std::endl;
-                                }
-                                std::cout << "------------" << std::endl;
-                            }*/
-                            if(!d_all_null)
-                            {
-                                uint edge_index = 0;
+                /*for(int i = 0; i < 8; i++)
+                {
+                    std::cout << corners[i][0] << "; " << corners[i][1] << "; " << corners[i][2] << std::endl;
+                }
+                std::cout << "-----------" << std::endl;
+                int test = 0;
+                while(test < points.size())
+                {
+                    std::cout << (*points[test])[0] << "; " << (*points[test])[1] << "; " << (*points[test])[2] << std::endl;
+                    test += 15;
+                }
+                std::cout << "+++++++++++" << std::endl;*/
 
-                                for(unsigned char a = 0; MCTable[index][a] != -1; a+= 3)
-                                {
-                                    vector<BaseVecT> triangle_vertices;
-                                    for(unsigned char b = 0; b < 3; b++)
-                                    {
-                                        edge_index = MCTable[index][a + b];
-                                        triangle_vertices.push_back(vertex_positions[edge_index]);
-                                    }
-                                    triangles.push_back(triangle_vertices);
-                                }
+            }
+            // calculation for primal cells
+            else
+            {
+                // calculating the real world positions of the corners
+                Location loc = parent.location(ch);
+                int binary_cell_size = 1 << loc.level();
+                corners[0] = BaseVecT(loc.loc_x(),                    loc.loc_y(),                    loc.loc_z());
+                corners[1] = BaseVecT(loc.loc_x() + binary_cell_size, loc.loc_y(),                    loc.loc_z());
+                corners[2] = BaseVecT(loc.loc_x() + binary_cell_size, loc.loc_y() + binary_cell_size, loc.loc_z());
+                corners[3] = BaseVecT(loc.loc_x(),                    loc.loc_y() + binary_cell_size, loc.loc_z());
+                corners[4] = BaseVecT(loc.loc_x(),                    loc.loc_y(),                    loc.loc_z() + binary_cell_size);
+                corners[5] = BaseVecT(loc.loc_x() + binary_cell_size, loc.loc_y(),                    loc.loc_z() + binary_cell_size);
+                corners[6] = BaseVecT(loc.loc_x() + binary_cell_size, loc.loc_y() + binary_cell_size, loc.loc_z() + binary_cell_size);
+                corners[7] = BaseVecT(loc.loc_x(),                    loc.loc_y() + binary_cell_size, loc.loc_z() + binary_cell_size);
+
+                for(unsigned char a = 0; a < 8; a++)
+                {
+                    corners[a] = corners[a] * (*max_bb_width / cells_tmp);
+                    corners[a] = corners[a] + bb_min;
+                }
+            }
 
-                                // check, whether the points are fitting well
-                                vector<float*> matrices = vector<float*>();
+            // this is not necessarily a dual leaf
+            DualLeaf<BaseVecT, BoxT> *leaf = new DualLeaf<BaseVecT, BoxT>(corners);
 
-                                // calculate rotation matrix of every triangle
-                                for ( uint a = 0; a < triangles.size(); a++ )
-                                {
-                                    float matrix[9] = { 0 };
-                                    BaseVecT v1 = triangles[a][0];
-                                    BaseVecT v2 = triangles[a][1];
-                                    BaseVecT v3 = triangles[a][2];
-                                    getRotationMatrix(matrix, v1, v2, v3);
+            // calculate distances
+            float distances[8];
+            BaseVecT vertex_positions[12];
+            float projectedDistance;
+            float euklideanDistance;
+            for (unsigned char i = 0; i < 8; i++)
+            {
+                float projectedDistance;
+                float euklideanDistance;
+                std::tie(projectedDistance, euklideanDistance) = this->m_surface->distance(corners[i]);
+                distances[i] = projectedDistance;
+            }
+            leaf->getIntersections(corners, distances, vertex_positions);
 
-                                    matrices.push_back(matrix);
-                                }
+            /*for(int z = 0; z < 8; z++)
+            {
+                std::cout << distances[z] << std::endl;
+            }
+            std::cout << "-------" << std::endl;*/
 
-                                vector<float> error(triangles.size(), 0);
-                                vector<int> counter(triangles.size(), 0);
+            // check for valid length of the distances
+            bool distancesValid = true;
+            bool d_all_null = false;
 
-                                // for every point check to which trinagle it is the nearest
-                                if(triangles.size() > 0)
-                                {
-                                    for ( uint a = 0; a < points.size(); a++ )
-                                    {
-                                        signed char min_dist_pos = -1;
-                                        float min_dist = -1;
-
-                                        // check which triangle is nearest
-                                        for ( uint b = 0; b < triangles.size(); b++ )
-                                        {
-                                            BaseVecT tmp = {(*points[a])[0] - (triangles[b][0])[0],
-                                                            (*points[a])[1] - (triangles[b][0])[1],
-                                                            (*points[a])[2] - (triangles[b][0])[2]};
-
-                                            // use rotation matrix for triangle and point
-                                            BaseVecT t1 = triangles[b][0] - triangles[b][0];
-                                            BaseVecT t2 = triangles[b][1] - triangles[b][0];
-                                            BaseVecT t3 = triangles[b][2] - triangles[b][0];
-                                            matrixDotVector(matrices[b], &t1);
-                                            matrixDotVector(matrices[b], &t2);
-                                            matrixDotVector(matrices[b], &t3);
-                                            matrixDotVector(matrices[b], &tmp);
-
-                                            // calculate distance from point to triangle
-                                            float d = getDistance(tmp, t1, t2, t3);
-
-                                            if( min_dist == -1 )
-                                            {
-                                                min_dist = d;
-                                                min_dist_pos = b;
-                                            }
-                                            else if( d < min_dist )
-                                            {
-                                                min_dist = d;
-                                                min_dist_pos = b;
-                                            }
-                                        }
-
-                                        error[min_dist_pos] += (min_dist * min_dist);
-                                        counter[min_dist_pos] += 1;
-                                    }
-
-                                    uint a = 0;
-                                    while(a < error.size() && pointsFittingWell)
-                                    {
-                                        error[a] /= counter[a];
-                                        error[a] = sqrt(error[a]);
-
-                                        if(error[a] > m_maxError)
-                                        {
-                                            splitting_pos.push_back(idx);
-                                            pointsFittingWell = false;
-                                        }
-                                        a++;
-                                    }
-                                }
-                            }
-                            if(MCTable[index][0] == -1 || !pointsFittingWell)
-                            // if((!dual && MCTable[index][0] == -1) || cur_Level >= levels - 2 || !pointsFittingWell)
-                            {
-                                markToSplit = true;
-                            }
-                        }
-                        delete(leaf);
+            // calculate max tolerated distance
+            float length = 0;
+            if(!dual)
+            {
+                length = corners[1][0] - corners[0][0];
+                length *= 1.7;
+            }
+            else
+            {
+                for(uint s = 0; s < 12; s++)
+                {
+                    BaseVecT vec_tmp = corners[edgeDistanceTable[s][0]] - corners[edgeDistanceTable[s][1]];
+                    float float_tmp = sqrt(vec_tmp[0] * vec_tmp[0] + vec_tmp[1] * vec_tmp[1] + vec_tmp[2] * vec_tmp[2]);
+                    if(float_tmp > length)
+                    {
+                        length = float_tmp;
                     }
-                    idx++;
                 }
-                if(markToSplit)
+                // length *= 1.7;
+            }
+
+            for(unsigned char a = 0; a < 8; a++)
+            {
+                if(abs(distances[a]) > length)
                 {
-                    vector<coord<float>*> points;
-                    CellHandle cellHandle;
-                    if(dual && cur_Level < levels - 2)
+                    distancesValid = false;
+                    /*if(dual && cur_Level < levels - 2)
                     {
-                        // get the correct cellHandle depending on the split_positions
-                        std::vector<CellHandle> cellHandles;
-                        std::vector<uint> markers;
-                        std::vector<CellHandle> cellHandles_tmp;
-                        std::vector<uint> markers_tmp;
+                        markToSplit = false;
+                    }*/
+                }
+                else if(distances[a] > 0)
+                {
+                    d_all_null = false;
+                }
+            }
+            if(distancesValid)
+            {
+                bool pointsFittingWell = true;
 
-                        sort(splitting_pos.begin(), splitting_pos.end());
-                        splitting_pos.erase(unique(splitting_pos.begin(), splitting_pos.end()), splitting_pos.end());
+                vector< vector<BaseVecT> > triangles;
+                int index = leaf->getIndex(distances);
+                /*if(index == 0 || index == 255)
+                {
+                    for(int a = 0; a < 8; a++)
+                    {
+                        std::cout << corners[a][0] << "; " << corners[a][1] << "; " << corners[a][2] << std::endl;
+                    }
+                    std::cout << "++++++++++++" << std::endl;
+                    for(unsigned char a = 0; a < 8; a++)
+                    {
+                        std::cout << distances[a] << std::endl;
+                    }
+                    std::cout << "------------" << std::endl;
+                }*/
+                if(!d_all_null)
+                {
+                    uint edge_index = 0;
 
-                        for(int j = 0; j < splitting_pos.size(); j++)
+                    for(unsigned char a = 0; MCTable[index][a] != -1; a+= 3)
+                    {
+                        vector<BaseVecT> triangle_vertices;
+                        for(unsigned char b = 0; b < 3; b++)
                         {
-                            std::tie(cellHandles_tmp, markers_tmp) = parent.all_corner_neighbors(ch, splitting_pos[j]);
-                            cellHandles.insert(cellHandles.end(), cellHandles_tmp.begin(), cellHandles_tmp.end());
-                            markers.insert(markers.end(), markers_tmp.begin(), markers_tmp.end());
+                            edge_index = MCTable[index][a + b];
+                            triangle_vertices.push_back(vertex_positions[edge_index]);
                         }
+                        triangles.push_back(triangle_vertices);
+                    }
 
-                        // (idx - 1) is the position of the dual cell that violates the splitting condition
-                        // std::tie(cellHandles, markers) = parent.all_corner_neighbors(ch, idx - 1);
+                    // check, whether the points are fitting well
+                    vector<std::array<float, 9>> matrices(triangles.size());
 
-                        // avoid splitting the same cell twice
-                        sort(cellHandles.begin(), cellHandles.end());
-                        cellHandles.erase(unique(cellHandles.begin(), cellHandles.end()), cellHandles.end());
+                    // calculate rotation matrix of every triangle
+                    for ( uint a = 0; a < triangles.size(); a++ )
+                    {
+                        BaseVecT v1 = triangles[a][0];
+                        BaseVecT v2 = triangles[a][1];
+                        BaseVecT v3 = triangles[a][2];
+                        getRotationMatrix(matrices[a].data(), v1, v2, v3);
+                    }
 
-                        for(int w = 0; w < cellHandles.size(); w++)
-                        {
-                            cellHandle = cellHandles[w];
-                            points = m_pointHandler->getContainedPoints(cellHandle.idx());
+                    vector<float> error(triangles.size(), 0);
+                    vector<int> counter(triangles.size(), 0);
 
-                            BaseVecT cellCenter = parent.cell_center(cellHandle);
-                            cellCenter /= max_cells;
-                            cellCenter *= stepWidth;
-                            cellCenter += bb_min;
+                    // for every point check to which trinagle it is the nearest
+                    if(triangles.size() > 0)
+                    {
+                        for ( uint a = 0; a < points.size(); a++ )
+                        {
+                            signed char min_dist_pos = -1;
+                            float min_dist = -1;
 
-                            // sort the points to the corresponding children
-                            vector<coord<float>*> childrenPoints[8];
-                            for (vector<coord<float>*>::iterator it = points.begin(); it != points.end(); it++)
+                            // check which triangle is nearest
+                            for ( uint b = 0; b < triangles.size(); b++ )
                             {
-                                childrenPoints[parent.getChildIndex(cellCenter, *it)].push_back(*it);
+                                BaseVecT tmp = {(*points[a])[0] - (triangles[b][0])[0],
+                                                (*points[a])[1] - (triangles[b][0])[1],
+                                                (*points[a])[2] - (triangles[b][0])[2]};
+
+                                // use rotation matrix for triangle and point
+                                BaseVecT t1 = triangles[b][0] - triangles[b][0];
+                                BaseVecT t2 = triangles[b][1] - triangles[b][0];
+                                BaseVecT t3 = triangles[b][2] - triangles[b][0];
+                                matrixDotVector(matrices[b].data(), &t1);
+                                matrixDotVector(matrices[b].data(), &t2);
+                                matrixDotVector(matrices[b].data(), &t3);
+                                matrixDotVector(matrices[b].data(), &tmp);
+
+                                // calculate distance from point to triangle
+                                float d = getDistance(tmp, t1, t2, t3);
+
+                                if( min_dist == -1 )
+                                {
+                                    min_dist = d;
+                                    min_dist_pos = b;
+                                }
+                                else if( d < min_dist )
+                                {
+                                    min_dist = d;
+                                    min_dist_pos = b;
+                                }
                             }
-                            m_pointHandler->split(cellHandle.idx(), childrenPoints, m_dual);
 
-                            // split the cell
-                            parent.split( cellHandle );
-                            m_leaves += 7;
+                            error[min_dist_pos] += (min_dist * min_dist);
+                            counter[min_dist_pos] += 1;
                         }
-                    }
-                    else
-                    {
-                        cellHandle = ch;
-                        // points = cellPoints[idx - 1];
-                        points = m_pointHandler->getContainedPoints(cellHandle.idx());
-
-                        vector<coord<float>*> childrenPoints[8];
-                        BaseVecT cellCenter = parent.cell_center(cellHandle);
-                        cellCenter /= max_cells;
-                        cellCenter *= stepWidth;
-                        cellCenter += bb_min;
-
-                        // sort the points to the corresponding children
-                        for (vector<coord<float>*>::iterator it = points.begin(); it != points.end(); it++)
+
+                        uint a = 0;
+                        while(a < error.size() && pointsFittingWell)
                         {
-                            childrenPoints[parent.getChildIndex(cellCenter, *it)].push_back(*it);
-                        }
-                        m_pointHandler->split(cellHandle.idx(), childrenPoints, m_dual);
+                            error[a] /= counter[a];
+                            error[a] = sqrt(error[a]);
 
-                        // split the cell
-                        parent.split( cellHandle );
-                        m_leaves += 7;
+                            if(error[a] > m_maxError)
+                            {
+                                splitting_pos.push_back(idx);
+                                pointsFittingWell = false;
+                            }
+                            a++;
+                        }
                     }
                 }
-            // end of visiting cell at current level
+                if(MCTable[index][0] == -1 || !pointsFittingWell)
+                // if((!dual && MCTable[index][0] == -1) || cur_Level >= levels - 2 || !pointsFittingWell)
+                {
+                    markToSplit = true;
+                }
             }
-        // end of visiting all cells of the octree
+            delete(leaf);
+        }
+        idx++;
+    }
+
+    vector<CellHandle> cellsToSplit;
+    if(markToSplit)
+    {
+        if(dual && cur_Level < levels - 2)
+        {
+            // get the correct cellHandles depending on the split_positions
+            std::vector<CellHandle> cellHandles_tmp;
+            std::vector<uint> markers_tmp;
+
+            sort(splitting_pos.begin(), splitting_pos.end());
+            splitting_pos.erase(unique(splitting_pos.begin(), splitting_pos.end()), splitting_pos.end());
+
+            for(int j = 0; j < splitting_pos.size(); j++)
+            {
+                std::tie(cellHandles_tmp, markers_tmp) = parent.all_corner_neighbors(ch, splitting_pos[j]);
+                cellsToSplit.insert(cellsToSplit.end(), cellHandles_tmp.begin(), cellHandles_tmp.end());
+            }
+
+            // avoid splitting the same cell twice
+            sort(cellsToSplit.begin(), cellsToSplit.end());
+            cellsToSplit.erase(unique(cellsToSplit.begin(), cellsToSplit.end()), cellsToSplit.end());
+        }
+        else
+        {
+            cellsToSplit.push_back(ch);
         }
-        std::cout << cellCounter << " cells at level " << cur_Level << std::endl;
-    // end of visiting the current level
     }
+    return cellsToSplit;
 }
 
 template<typename BaseVecT, typename BoxT>
@@ -763,22 +795,57 @@ void DMCReconstruction<BaseVecT, BoxT>::traverseTree(
         cells *= 2;
     }
 
+    vector<CellHandle> leaves;
     for (CellHandle ch = octree.root(); ch != ch_end; ++ch)
     {
         if (octree.is_leaf(ch))
         {
-            for(unsigned char c = 0; c < 8; c++)
+            leaves.push_back(ch);
+        }
+    }
+
+    // every block of leaves writes its triangles into its own buffer. The
+    // buffers are added to the mesh in order, so the result does not depend
+    // on the number of threads.
+    const size_t blockSize = 64;
+    const size_t numBlocks = (leaves.size() + blockSize - 1) / blockSize;
+    vector< vector<BaseVecT> > triangleBuffers(numBlocks);
+
+    #pragma omp parallel
+    {
+        ProgressBarBatch progress(*m_progressBar);
+
+        #pragma omp for schedule(dynamic, 1)
+        for (long block = 0; block < static_cast<long>(numBlocks); block++)
+        {
+            const size_t end = std::min(leaves.size(), (block + 1) * blockSize);
+            for (size_t i = block * blockSize; i < end; i++)
             {
-                DualLeaf<BaseVecT, BoxT> *dualLeaf = getDualLeaf(ch, cells, octree, c);
+                for(unsigned char c = 0; c < 8; c++)
+                {
+                    DualLeaf<BaseVecT, BoxT> *dualLeaf = getDualLeaf(leaves[i], cells, octree, c);
 
-                getSurface(mesh, dualLeaf, cells, (short)octree.level(ch));
+                    getSurface(triangleBuffers[block], dualLeaf);
 
-                // free memory
-                delete dualLeaf;
+                    // free memory
+                    delete dualLeaf;
+                }
+                ++progress;
             }
-            ++(*m_progressBar);
         }
     }
+
+    for (auto& triangles : triangleBuffers)
+    {
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            VertexHandle v1 = mesh.addVertex(triangles[i]);
+            VertexHandle v2 = mesh.addVertex(triangles[i + 1]);
+            VertexHandle v3 = mesh.addVertex(triangles[i + 2]);
+            mesh.addFace(v1, v2, v3);
+        }
+        vector<BaseVecT>().swap(triangles);
+    }
     return;
 }
 
@@ -832,17 +899,14 @@ void DMCReconstruction<BaseVecT, BoxT>::detectVertexForDualCell(
 
 template<typename BaseVecT, typename BoxT>
 void DMCReconstruction<BaseVecT, BoxT>::getSurface(
-        BaseMesh<BaseVecT> &mesh,
-        DualLeaf<BaseVecT, BoxT> *leaf,
-        int cells,
-        short level)
+        vector<BaseVecT> &triangles,
+        DualLeaf<BaseVecT, BoxT> *leaf)
 {
     BaseVecT edges[8];
     float distances[8];
     BaseVecT vertex_positions[12];
     float projectedDistance;
     float euklideanDistance;
-    HalfEdgeMesh<BaseVecT> *meshCast;
 
     leaf->getVertices(edges);
 
@@ -898,16 +962,11 @@ void DMCReconstruction<BaseVecT, BoxT>::getSurface(
 
     for(unsigned char a = 0; MCTable[index][a] != -1; a+= 3)
     {
-        vector<VertexHandle> triangle_vertices;
         for(unsigned char b = 0; b < 3; b++)
         {
             edge_index = MCTable[index][a + b];
-            BaseVecT v = vertex_positions[edge_index];
-            // VertexHandle vh = mesh.addVertex(v, level);
-            VertexHandle vh = mesh.addVertex(v);
-            triangle_vertices.push_back(vh);
+            triangles.push_back(vertex_positions[edge_index]);
         }
-        mesh.addFace(triangle_vertices[0], triangle_vertices[1], triangle_vertices[2]);
     }
 }
 
@@ -35,6 +35,7 @@
 #ifndef _LVR2_RECONSTRUCTION_HASHGRID_H_
 #define _LVR2_RECONSTRUCTION_HASHGRID_H_
 
+#include <array>
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -135,7 +136,7 @@ public:
     /***
      * @brief Construct a new Hash Grid object
      *
-     * @param files
+     * @param files vector of cell files written by saveCells() (current or legacy format)
      * @param boundingBox
      * @param voxelsize
      */
@@ -145,7 +146,7 @@ public:
     /***
      * @brief Construct a new Hash Grid object
      *
-     * @param files vector of strings to the files which contain the voxel-grid data for the chunks
+     * @param files vector of cell files written by saveCells() (current or legacy format)
      * @param innerBoxes vector of BoundingBoxes. Each chunk is only used for the BoundingBox.
      *                          This is important because the data in the chunks may overlap.
      * @param boundingBox bounding box of the complete grid
@@ -178,6 +179,22 @@ public:
      */
     virtual void addLatticePoint(int i, int j, int k, float distance = 0.0);
 
+    /**
+     * @brief   Adds the cells with the given discrete positions at once.
+     *
+     * If extrusion is enabled, the 26 neighbors of every position are added
+     * as well. The cells are then created as if addLatticePoint() (without
+     * extrusion) was called for every unique cell in lexicographic order, so
+     * the query point indices do not depend on the order of `indices` or on
+     * the number of threads. This is done in parallel if the grid is empty,
+     * otherwise addLatticePoint() is called for every position.
+     *
+     * @param indices   Discrete (x, y, z) positions within the grid. May
+     *                  contain duplicates.
+     * @param distance  Signed distance of the created query points
+     */
+    void addLatticePoints(std::vector<std::array<int, 3>> indices, float distance = 0.0);
+
     /**
      * @brief   Saves a representation of the grid to the given file
      *
@@ -188,9 +205,13 @@ public:
     /**
      * @brief Saves a representation of the cells to the given file
      *
-     * @param file Output file name.
+     * The cells are stored in the columnar format of writeCellFile(),
+     * which can be memory mapped when the grid is loaded again.
+     *
+     * @param file      Output file name.
+     * @param compress  Losslessly compress the distances and cell centers
      */
-    void saveCells(string file);
+    void saveCells(string file, bool compress = false);
 
     virtual void serialize(string file);
 
@@ -275,6 +296,14 @@ public:
      */
     void calcIndices();
 
+    /**
+     * @brief   Adds the cells of a file written by saveCells() to the grid.
+     *
+     * @param file      Cell file
+     * @param innerBox  If not null, only cells with a center inside of this box are added
+     */
+    void addCells(const string& file, const BoundingBox<BaseVecT>* innerBox);
+
 
 protected:
 
@@ -33,14 +33,18 @@
  */
 
 #include "lvr2/geometry/BaseMesh.hpp"
+#include "lvr2/io/CellIO.hpp"
 #include "lvr2/io/ChunkIO.hpp"
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/io/Timestamp.hpp"
 #include "lvr2/reconstruction/FastReconstructionTables.hpp"
 #include "lvr2/reconstruction/HashGrid.hpp"
+#include "lvr2/util/Parallel.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <limits>
 
 namespace lvr2
 {
@@ -205,87 +209,11 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
                                    float voxelsize)
     : m_boundingBox(boundingBox), m_voxelsize(voxelsize), m_globalIndex(0)
 {
-    unsigned int INVALID = BoxT::INVALID_INDEX;
     calcIndices();
-    float distances[8];
-    BaseVecT box_center;
-    bool extruded;
-    float vsh = 0.5 * this->m_voxelsize;
     for (int numFiles = 0; numFiles < files.size(); numFiles++)
     {
-        unsigned int current_index = 0;
         cout << "Loading grid: " << numFiles << "/" << files.size() << endl;
-
-        FILE* pFile = fopen(files[numFiles].c_str(), "rb");
-        size_t numCells;
-        size_t r = fread(&numCells, sizeof(size_t), 1, pFile);
-
-        for (size_t cellCount = 0; cellCount < numCells; cellCount++)
-        {
-            r = fread(&(box_center[0]), sizeof(float), 1, pFile);
-            r = fread(&(box_center[1]), sizeof(float), 1, pFile);
-            r = fread(&(box_center[2]), sizeof(float), 1, pFile);
-
-            r = fread(&extruded, sizeof(bool), 1, pFile);
-
-            r = fread(&(distances[0]), sizeof(float), 8, pFile);
-
-            size_t idx = calcIndex((box_center[0] - m_boundingBox.getMin()[0]) / m_voxelsize);
-            size_t idy = calcIndex((box_center[1] - m_boundingBox.getMin()[1]) / m_voxelsize);
-            size_t idz = calcIndex((box_center[2] - m_boundingBox.getMin()[2]) / m_voxelsize);
-            size_t hash = hashValue(idx, idy, idz);
-            auto cell_it = this->m_cells.find(hash);
-            if (cell_it == this->m_cells.end() && !extruded)
-            {
-                BoxT* box = new BoxT(box_center);
-                for (int i = 0; i < 8; i++)
-                {
-                    current_index = this->findQueryPoint(i, idx, idy, idz);
-                    if (current_index != INVALID)
-                        box->setVertex(i, current_index);
-                    else
-                    {
-                        BaseVecT position(box_center[0] + box_creation_table[i][0] * vsh,
-                                          box_center[1] + box_creation_table[i][1] * vsh,
-                                          box_center[2] + box_creation_table[i][2] * vsh);
-                        this->m_queryPoints.push_back(QueryPoint<BaseVecT>(position, distances[i]));
-                        box->setVertex(i, this->m_globalIndex);
-                        this->m_globalIndex++;
-                    }
-                }
-                // Set pointers to the neighbors of the current box
-                int neighbor_index = 0;
-                size_t neighbor_hash = 0;
-
-                for (int a = -1; a < 2; a++)
-                {
-                    for (int b = -1; b < 2; b++)
-                    {
-                        for (int c = -1; c < 2; c++)
-                        {
-
-                            // Calculate hash value for current neighbor cell
-                            neighbor_hash = this->hashValue(idx + a, idy + b, idz + c);
-
-                            // Try to find this cell in the grid
-                            auto neighbor_it = this->m_cells.find(neighbor_hash);
-
-                            // If it exists, save pointer in box
-                            if (neighbor_it != this->m_cells.end())
-                            {
-                                box->setNeighbor(neighbor_index, (*neighbor_it).second);
-                                (*neighbor_it).second->setNeighbor(26 - neighbor_index, box);
-                            }
-
-                            neighbor_index++;
-                        }
-                    }
-                }
-
-                this->m_cells[hash] = box;
-            }
-        }
-        fclose(pFile);
+        addCells(files[numFiles], nullptr);
     }
 }
 
@@ -296,99 +224,97 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
                                    float voxelsize)
         : m_boundingBox(boundingBox), m_voxelsize(voxelsize), m_globalIndex(0)
 {
-    unsigned int INVALID = BoxT::INVALID_INDEX;
     calcIndices();
-    float distances[8];
-    BaseVecT box_center;
-    bool extruded;
-    float vsh = 0.5 * this->m_voxelsize;
     for (int numFiles = 0; numFiles < files.size(); numFiles++)
     {
-        // get the min and max vector of the inner chunk bounding box
-        BaseVecT innerChunkMin = innerBoxes.at(numFiles).getMin();
-        BaseVecT innerChunkMax = innerBoxes.at(numFiles).getMax();
-
-        unsigned int current_index = 0;
         cout << "Loading grid: " << numFiles << "/" << files.size() << endl;
+        addCells(files[numFiles], &innerBoxes.at(numFiles));
+    }
+}
 
-        FILE* pFile = fopen(files[numFiles].c_str(), "rb");
-        size_t numCells;
-        size_t r = fread(&numCells, sizeof(size_t), 1, pFile);
-
-        for (size_t cellCount = 0; cellCount < numCells; cellCount++)
-        {
-            r = fread(&(box_center[0]), sizeof(float), 1, pFile);
-            r = fread(&(box_center[1]), sizeof(float), 1, pFile);
-            r = fread(&(box_center[2]), sizeof(float), 1, pFile);
+template <typename BaseVecT, typename BoxT>
+void HashGrid<BaseVecT, BoxT>::addCells(const string& file, const BoundingBox<BaseVecT>* innerBox)
+{
+    unsigned int INVALID = BoxT::INVALID_INDEX;
+    unsigned int current_index = 0;
+    float vsh = 0.5 * this->m_voxelsize;
 
-            r = fread(&extruded, sizeof(bool), 1, pFile);
+    CellFileReader reader(file);
+    const float* centers = reader.centers();
+    const unsigned char* extruded = reader.extruded();
+    const float* distances = reader.distances();
 
-            r = fread(&(distances[0]), sizeof(float), 8, pFile);
+    for (size_t cellCount = 0; cellCount < reader.numCells(); cellCount++)
+    {
+        BaseVecT box_center(centers[3 * cellCount], centers[3 * cellCount + 1], centers[3 * cellCount + 2]);
 
-            // Check if the voxel is inside of our bounding box.
-            // If not, we skip it, because some other chunk is responsible for the voxel.
+        // Check if the voxel is inside of the inner bounding box.
+        // If not, we skip it, because some other chunk is responsible for the voxel.
+        if (innerBox)
+        {
+            BaseVecT innerChunkMin = innerBox->getMin();
+            BaseVecT innerChunkMax = innerBox->getMax();
             if(box_center.x < innerChunkMin.x || box_center.y < innerChunkMin.y || box_center.z < innerChunkMin.z ||
                     box_center.x > innerChunkMax.x || box_center.y > innerChunkMax.y || box_center.z > innerChunkMax.z )
             {
                 continue;
             }
+        }
 
-            size_t idx = calcIndex((box_center[0] - m_boundingBox.getMin()[0]) / m_voxelsize);
-            size_t idy = calcIndex((box_center[1] - m_boundingBox.getMin()[1]) / m_voxelsize);
-            size_t idz = calcIndex((box_center[2] - m_boundingBox.getMin()[2]) / m_voxelsize);
-            size_t hash = hashValue(idx, idy, idz);
-            auto cell_it = this->m_cells.find(hash);
-            if (cell_it == this->m_cells.end() && !extruded)
+        size_t idx = calcIndex((box_center[0] - m_boundingBox.getMin()[0]) / m_voxelsize);
+        size_t idy = calcIndex((box_center[1] - m_boundingBox.getMin()[1]) / m_voxelsize);
+        size_t idz = calcIndex((box_center[2] - m_boundingBox.getMin()[2]) / m_voxelsize);
+        size_t hash = hashValue(idx, idy, idz);
+        auto cell_it = this->m_cells.find(hash);
+        if (cell_it == this->m_cells.end() && !extruded[cellCount])
+        {
+            BoxT* box = new BoxT(box_center);
+            for (int i = 0; i < 8; i++)
             {
-                BoxT* box = new BoxT(box_center);
-                for (int i = 0; i < 8; i++)
+                current_index = this->findQueryPoint(i, idx, idy, idz);
+                if (current_index != INVALID)
+                    box->setVertex(i, current_index);
+                else
                 {
-                    current_index = this->findQueryPoint(i, idx, idy, idz);
-                    if (current_index != INVALID)
-                        box->setVertex(i, current_index);
-                    else
-                    {
-                        BaseVecT position(box_center[0] + box_creation_table[i][0] * vsh,
-                                          box_center[1] + box_creation_table[i][1] * vsh,
-                                          box_center[2] + box_creation_table[i][2] * vsh);
-                        this->m_queryPoints.push_back(QueryPoint<BaseVecT>(position, distances[i]));
-                        box->setVertex(i, this->m_globalIndex);
-                        this->m_globalIndex++;
-                    }
+                    BaseVecT position(box_center[0] + box_creation_table[i][0] * vsh,
+                                      box_center[1] + box_creation_table[i][1] * vsh,
+                                      box_center[2] + box_creation_table[i][2] * vsh);
+                    this->m_queryPoints.push_back(QueryPoint<BaseVecT>(position, distances[8 * cellCount + i]));
+                    box->setVertex(i, this->m_globalIndex);
+                    this->m_globalIndex++;
                 }
-                // Set pointers to the neighbors of the current box
-                int neighbor_index = 0;
-                size_t neighbor_hash = 0;
+            }
+            // Set pointers to the neighbors of the current box
+            int neighbor_index = 0;
+            size_t neighbor_hash = 0;
 
-                for (int a = -1; a < 2; a++)
+            for (int a = -1; a < 2; a++)
+            {
+                for (int b = -1; b < 2; b++)
                 {
-                    for (int b = -1; b < 2; b++)
+                    for (int c = -1; c < 2; c++)
                     {
-                        for (int c = -1; c < 2; c++)
-                        {
 
-                            // Calculate hash value for current neighbor cell
-                            neighbor_hash = this->hashValue(idx + a, idy + b, idz + c);
+                        // Calculate hash value for current neighbor cell
+                        neighbor_hash = this->hashValue(idx + a, idy + b, idz + c);
 
-                            // Try to find this cell in the grid
-                            auto neighbor_it = this->m_cells.find(neighbor_hash);
-
-                            // If it exists, save pointer in box
-                            if (neighbor_it != this->m_cells.end())
-                            {
-                                box->setNeighbor(neighbor_index, (*neighbor_it).second);
-                                (*neighbor_it).second->setNeighbor(26 - neighbor_index, box);
-                            }
+                        // Try to find this cell in the grid
+                        auto neighbor_it = this->m_cells.find(neighbor_hash);
 
-                            neighbor_index++;
+                        // If it exists, save pointer in box
+                        if (neighbor_it != this->m_cells.end())
+                        {
+                            box->setNeighbor(neighbor_index, (*neighbor_it).second);
+                            (*neighbor_it).second->setNeighbor(26 - neighbor_index, box);
                         }
+
+                        neighbor_index++;
                     }
                 }
-
-                this->m_cells[hash] = box;
             }
+
+            this->m_cells[hash] = box;
         }
-        fclose(pFile);
     }
 }
 
@@ -642,6 +568,210 @@ void HashGrid<BaseVecT, BoxT>::addLatticePoint(int index_x,
     }
 }
 
+template <typename BaseVecT, typename BoxT>
+void HashGrid<BaseVecT, BoxT>::addLatticePoints(std::vector<std::array<int, 3>> indices, float distance)
+{
+    parallelSortUnique(indices);
+
+    if (!m_cells.empty())
+    {
+        for (auto& index: indices)
+        {
+            addLatticePoint(index[0], index[1], index[2], distance);
+        }
+        return;
+    }
+
+    // Add the surrounding cells of every position if extrusion is enabled
+    if (this->m_extrude)
+    {
+        std::vector<std::array<int, 3>> extruded(27 * indices.size());
+
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < static_cast<long>(indices.size()); i++)
+        {
+            int n = 0;
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dz = -1; dz <= 1; dz++)
+                    {
+                        extruded[27 * i + n++] = { indices[i][0] + dx, indices[i][1] + dy, indices[i][2] + dz };
+                    }
+                }
+            }
+        }
+        indices = std::move(extruded);
+        parallelSortUnique(indices);
+    }
+
+    const size_t numCells = indices.size();
+    const size_t NOT_FOUND = std::numeric_limits<size_t>::max();
+
+    // Position of a cell in the sorted cell array
+    auto rankOf = [&](int x, int y, int z)
+    {
+        std::array<int, 3> key = { x, y, z };
+        auto it = std::lower_bound(indices.begin(), indices.end(), key);
+        return (it != indices.end() && *it == key) ? static_cast<size_t>(it - indices.begin()) : NOT_FOUND;
+    };
+
+    float vsh = 0.5 * this->m_voxelsize;
+    auto v_min = this->m_boundingBox.getMin();
+
+    // Create the boxes
+    std::vector<BoxT*> boxes(numCells);
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(numCells); i++)
+    {
+        BaseVecT box_center(indices[i][0] * this->m_voxelsize + v_min.x,
+                            indices[i][1] * this->m_voxelsize + v_min.y,
+                            indices[i][2] * this->m_voxelsize + v_min.z);
+
+        BoxT* box = new BoxT(box_center);
+
+        if (box_center[0] <= m_boundingBox.getMin().x + m_voxelsize * 5 ||
+            box_center[1] <= m_boundingBox.getMin().y + m_voxelsize * 5 ||
+            box_center[2] <= m_boundingBox.getMin().z + m_voxelsize * 5)
+        {
+            box->m_duplicate = true;
+        }
+        else if (box_center[0] >= m_boundingBox.getMax().x - m_voxelsize * 5 ||
+                 box_center[1] >= m_boundingBox.getMax().y - m_voxelsize * 5 ||
+                 box_center[2] >= m_boundingBox.getMax().z - m_voxelsize * 5)
+        {
+            box->m_duplicate = true;
+        }
+        boxes[i] = box;
+    }
+
+    // Link the boxes to their neighbors
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(numCells); i++)
+    {
+        int neighbor_index = 0;
+        for (int a = -1; a < 2; a++)
+        {
+            for (int b = -1; b < 2; b++)
+            {
+                for (int c = -1; c < 2; c++)
+                {
+                    size_t rank = rankOf(indices[i][0] + a, indices[i][1] + b, indices[i][2] + c);
+                    if (rank != NOT_FOUND && rank != static_cast<size_t>(i))
+                    {
+                        boxes[i]->setNeighbor(neighbor_index, boxes[rank]);
+                    }
+                    neighbor_index++;
+                }
+            }
+        }
+    }
+
+    // A corner is shared by up to eight cells. A serial run over the sorted
+    // cells creates its query point in the smallest of them, i.e. the one
+    // reached by the lexicographically smallest offset. Returns the entry of
+    // shared_vertex_table of the owner, or -1 if the cell owns the corner.
+    auto ownerOf = [&](size_t i, int k)
+    {
+        int owner = -1;
+        for (int n = 0; n < 7; n++)
+        {
+            const int* entry = &shared_vertex_table[k][4 * n];
+            if (entry[0] > 0 || (entry[0] == 0 && (entry[1] > 0 || (entry[1] == 0 && entry[2] > 0))))
+            {
+                continue;
+            }
+            if (!boxes[i]->getNeighbor((entry[0] + 1) * 9 + (entry[1] + 1) * 3 + entry[2] + 1))
+            {
+                continue;
+            }
+            if (owner == -1 || std::lexicographical_compare(entry, entry + 3,
+                                                            &shared_vertex_table[k][4 * owner],
+                                                            &shared_vertex_table[k][4 * owner + 3]))
+            {
+                owner = n;
+            }
+        }
+        return owner;
+    };
+
+    // Count the query points created by every cell
+    std::vector<unsigned char> ownedCorners(numCells);
+    std::vector<size_t> offsets(numCells);
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(numCells); i++)
+    {
+        unsigned char mask = 0;
+        size_t count = 0;
+        for (int k = 0; k < 8; k++)
+        {
+            if (ownerOf(i, k) == -1)
+            {
+                mask |= 1 << k;
+                count++;
+            }
+        }
+        ownedCorners[i] = mask;
+        offsets[i] = count;
+    }
+
+    const size_t numQueryPoints = exclusivePrefixSum(offsets);
+    const unsigned int firstIndex = this->m_globalIndex;
+    this->m_queryPoints.resize(firstIndex + numQueryPoints);
+
+    // Create the owned query points, numbered in cell and corner order
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(numCells); i++)
+    {
+        unsigned int next = firstIndex + offsets[i];
+        BaseVecT box_center = boxes[i]->getCenter();
+        for (int k = 0; k < 8; k++)
+        {
+            if (ownedCorners[i] & (1 << k))
+            {
+                BaseVecT position(box_center.x + box_creation_table[k][0] * vsh,
+                                  box_center.y + box_creation_table[k][1] * vsh,
+                                  box_center.z + box_creation_table[k][2] * vsh);
+                this->m_queryPoints[next] = QueryPoint<BaseVecT>(position, distance);
+                boxes[i]->setVertex(k, next);
+                next++;
+            }
+        }
+    }
+
+    // Take the remaining corners from their owners
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(numCells); i++)
+    {
+        for (int k = 0; k < 8; k++)
+        {
+            if (!(ownedCorners[i] & (1 << k)))
+            {
+                const int* entry = &shared_vertex_table[k][4 * ownerOf(i, k)];
+                BoxT* owner = static_cast<BoxT*>(boxes[i]->getNeighbor((entry[0] + 1) * 9 + (entry[1] + 1) * 3 + entry[2] + 1));
+                boxes[i]->setVertex(k, owner->getVertex(entry[3]));
+            }
+        }
+    }
+
+    // Bounding box of the new query points
+    for (size_t i = firstIndex; i < this->m_queryPoints.size(); i++)
+    {
+        qp_bb.expand(this->m_queryPoints[i].m_position);
+    }
+
+    this->m_globalIndex += numQueryPoints;
+
+    m_cells.reserve(numCells);
+    for (size_t i = 0; i < numCells; i++)
+    {
+        m_cells[hashValue(indices[i][0], indices[i][1], indices[i][2])] = boxes[i];
+    }
+}
+
 template <typename BaseVecT, typename BoxT>
 void HashGrid<BaseVecT, BoxT>::setCoordinateScaling(float x, float y, float z)
 {
@@ -756,29 +886,36 @@ void HashGrid<BaseVecT, BoxT>::saveGrid(string filename)
 }
 
 template <typename BaseVecT, typename BoxT>
-void HashGrid<BaseVecT, BoxT>::saveCells(string file)
+void HashGrid<BaseVecT, BoxT>::saveCells(string file, bool compress)
 {
-    FILE* pFile = fopen(file.c_str(), "wb");
-    size_t csize = m_cells.size();
-    fwrite(&csize, sizeof(size_t), 1, pFile);
+    // Gather the cells first, so that the columns can be filled in parallel
+    std::vector<BoxT*> boxes;
+    boxes.reserve(m_cells.size());
     for (auto it = this->firstCell(); it != this->lastCell(); it++)
     {
-        fwrite(&it->second->getCenter()[0], sizeof(float), 1, pFile);
-        fwrite(&it->second->getCenter()[1], sizeof(float), 1, pFile);
-        fwrite(&it->second->getCenter()[2], sizeof(float), 1, pFile);
+        boxes.push_back(it->second);
+    }
 
-        fwrite(&it->second->m_extruded, sizeof(bool), 1, pFile);
+    const size_t csize = boxes.size();
+    std::vector<float> centers(3 * csize);
+    std::vector<unsigned char> extruded(csize);
+    std::vector<float> distances(8 * csize);
 
-        fwrite(&m_queryPoints[it->second->getVertex(0)].m_distance, sizeof(float), 1, pFile);
-        fwrite(&m_queryPoints[it->second->getVertex(1)].m_distance, sizeof(float), 1, pFile);
-        fwrite(&m_queryPoints[it->second->getVertex(2)].m_distance, sizeof(float), 1, pFile);
-        fwrite(&m_queryPoints[it->second->getVertex(3)].m_distance, sizeof(float), 1, pFile);
-        fwrite(&m_queryPoints[it->second->getVertex(4)].m_distance, sizeof(float), 1, pFile);
-        fwrite(&m_queryPoints[it->second->getVertex(5)].m_distance, sizeof(float), 1, pFile);
-        fwrite(&m_queryPoints[it->second->getVertex(6)].m_distance, sizeof(float), 1, pFile);
-        fwrite(&m_queryPoints[it->second->getVertex(7)].m_distance, sizeof(float), 1, pFile);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(csize); i++)
+    {
+        BoxT* box = boxes[i];
+        centers[3 * i] = box->getCenter()[0];
+        centers[3 * i + 1] = box->getCenter()[1];
+        centers[3 * i + 2] = box->getCenter()[2];
+        extruded[i] = box->m_extruded;
+        for (int k = 0; k < 8; k++)
+        {
+            distances[8 * i + k] = m_queryPoints[box->getVertex(k)].m_distance;
+        }
     }
-    fclose(pFile);
+
+    writeCellFile(file, csize, centers.data(), extruded.data(), distances.data(), compress);
 }
 // <<<<<<< HEAD
 // =======
@@ -116,6 +116,12 @@ namespace lvr2
         // Threshold for fusing line segments while tesselating.
         float lineFusionThreshold = 0.01;
 
+        // Directory for intermediate files (BigGrid memory mapped files, cell files). Empty: current working directory.
+        std::string scratchDir = "";
+
+        // Losslessly compress the intermediate cell files.
+        bool compressCells = false;
+
         vector<float> getFlipPoint() const
         {
             std::vector<float> dest = flipPoint;
@@ -149,7 +155,8 @@ namespace lvr2
                 uint nodeSize, int partMethod,int ki, int kd, int kn, bool useRansac, std::vector<float> flipPoint,
                 bool extrude, int removeDanglingArtifacts, int cleanContours, int fillHoles, bool optimizePlanes,
                 float getNormalThreshold, int planeIterations, int minPlaneSize, int smallRegionThreshold,
-                bool retesselate, float lineFusionThreshold, bool bigMesh, bool debugChunks, bool useGPU);
+                bool retesselate, float lineFusionThreshold, bool bigMesh, bool debugChunks, bool useGPU,
+                std::string scratchDir = "", bool compressCells = false);
 
         /**
          * Constructor with parameters in a struct
@@ -288,6 +295,12 @@ namespace lvr2
         // Threshold for fusing line segments while tesselating. Default: 0.01
         float m_lineFusionThreshold;
 
+        // Directory for intermediate files. Default: "" (current working directory)
+        std::string m_scratchDir;
+
+        // Losslessly compress the intermediate cell files. Default: false
+        bool m_compressCells = false;
+
 
     };
 } // namespace lvr2
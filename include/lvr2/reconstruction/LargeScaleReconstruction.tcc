@@ -26,6 +26,7 @@
  */
 
 #include <iostream>
+#include <boost/filesystem.hpp>
 #include "lvr2/types/ScanTypes.hpp"
 #include "lvr2/io/hdf5/HDF5FeatureBase.hpp"
 #include "lvr2/io/hdf5/ChannelIO.hpp"
@@ -44,6 +45,7 @@
 #include "lvr2/algorithm/CleanupAlgorithms.hpp"
 #include "lvr2/algorithm/NormalAlgorithms.hpp"
 #include "lvr2/algorithm/Tesselator.hpp"
+#include "lvr2/util/StageTimer.hpp"
 
 
 #include "LargeScaleReconstruction.hpp"
@@ -93,7 +95,8 @@ namespace lvr2
                                                                  float planeNormalThreshold, int planeIterations,
                                                                  int minPlaneSize, int smallRegionThreshold,
                                                                  bool retesselate, float lineFusionThreshold,
-                                                                 bool bigMesh, bool debugChunks, bool useGPU)
+                                                                 bool bigMesh, bool debugChunks, bool useGPU,
+                                                                 std::string scratchDir, bool compressCells)
             : m_voxelSizes(voxelSizes), m_bgVoxelSize(bgVoxelSize),
               m_scale(scale),m_nodeSize(nodeSize),
               m_partMethod(partMethod), m_ki(ki), m_kd(kd), m_kn(kn), m_useRansac(useRansac),
@@ -101,7 +104,8 @@ namespace lvr2
               m_cleanContours(cleanContours), m_fillHoles(fillHoles), m_optimizePlanes(optimizePlanes),
               m_planeNormalThreshold(planeNormalThreshold), m_planeIterations(planeIterations),
               m_minPlaneSize(minPlaneSize), m_smallRegionThreshold(smallRegionThreshold),
-              m_retesselate(retesselate), m_lineFusionThreshold(lineFusionThreshold),m_bigMesh(bigMesh), m_debugChunks(debugChunks), m_useGPU(useGPU)
+              m_retesselate(retesselate), m_lineFusionThreshold(lineFusionThreshold),m_bigMesh(bigMesh), m_debugChunks(debugChunks), m_useGPU(useGPU),
+              m_scratchDir(scratchDir), m_compressCells(compressCells)
     {
         std::cout << "Reconstruction Instance generated..." << std::endl;
     }
@@ -115,7 +119,8 @@ namespace lvr2
               options.cleanContours, options.fillHoles, options.optimizePlanes,
               options.planeNormalThreshold, options.planeIterations,
               options.minPlaneSize, options.smallRegionThreshold,
-              options.retesselate, options.lineFusionThreshold, options.bigMesh, options.debugChunks, options.useGPU)
+              options.retesselate, options.lineFusionThreshold, options.bigMesh, options.debugChunks, options.useGPU,
+              options.scratchDir, options.compressCells)
     {
     }
 
@@ -130,7 +135,10 @@ namespace lvr2
         }
 
         cout << lvr2::timestamp << "Starting BigGrid" << endl;
-        BigGrid<BaseVecT> bg( m_bgVoxelSize ,project, m_scale);
+        StageTimer bigGridTimer("big_grid");
+        BigGrid<BaseVecT> bg(m_bgVoxelSize, project, m_scale, m_scratchDir);
+        bigGridTimer.addItems(bg.pointSize());
+        bigGridTimer.stop();
         cout << lvr2::timestamp << "BigGrid finished " << endl;
 
         BoundingBox<BaseVecT> bb = bg.getBB();
@@ -143,25 +151,37 @@ namespace lvr2
         BoundingBox<BaseVecT> cbb(bb_min, bb_max);
 
         cout << lvr2::timestamp << "generating tree" << endl;
+        StageTimer partitionTimer("partitioning");
         BigGridKdTree<BaseVecT> gridKd(bg.getBB(), m_nodeSize, &bg, m_bgVoxelSize);
-        gridKd.insert(bg.pointSize(), bg.getBB().getCentroid());
+        // split at the weighted medians of the cells, so all partitions have about the same size
+        gridKd.partition(bg.getCells());
         ofstream partBoxOfs("KdTree.ser");
-        partitionBoxes = shared_ptr<vector<BoundingBox<BaseVecT>>>(new vector<BoundingBox<BaseVecT>>(gridKd.getLeafs().size()));
-        for (size_t i = 0; i < gridKd.getLeafs().size(); i++)
+        auto leafs = gridKd.getLeafs();
+        partitionBoxes = shared_ptr<vector<BoundingBox<BaseVecT>>>(new vector<BoundingBox<BaseVecT>>(leafs.size()));
+        for (size_t i = 0; i < leafs.size(); i++)
         {
-            BoundingBox<BaseVecT> partBB = gridKd.getLeafs()[i]->getBB();
+            BoundingBox<BaseVecT> partBB = leafs[i]->getBB();
             partitionBoxes->at(i) = partBB;
             partBoxOfs << partBB.getMin()[0] << " " << partBB.getMin()[1] << " "
                        << partBB.getMin()[2] << " " << partBB.getMax()[0] << " "
                        << partBB.getMax()[1] << " " << partBB.getMax()[2] << std::endl;
         }
 
+        partitionTimer.addItems(partitionBoxes->size());
+        partitionTimer.stop();
         cout << lvr2::timestamp << "finished tree" << endl;
         std::cout << lvr2::timestamp << "got: " << partitionBoxes->size() << " leafs, saving leafs"
                   << std::endl;
 
         uint partitionBoxesSkipped = 0;
 
+        // Intermediate cell files are written to the scratch directory, if given
+        boost::filesystem::path cellDir(m_scratchDir);
+        if (!cellDir.empty())
+        {
+            boost::filesystem::create_directories(cellDir);
+        }
+
         for(int h = 0; h < m_voxelSizes.size(); h++)
         {
             //vector to store relevant chunks as .ser
@@ -171,15 +191,16 @@ namespace lvr2
                 string name_id;
                 name_id = std::to_string(i);
 
-                size_t numPoints;
+                StageTimer pointsTimer("partition_points");
+                lvr2::PointBufferPtr p_loader = bg.pointBuffer(partitionBoxes->at(i).getMin().x - m_voxelSizes[h] * 3,
+                                                               partitionBoxes->at(i).getMin().y - m_voxelSizes[h] * 3,
+                                                               partitionBoxes->at(i).getMin().z - m_voxelSizes[h] * 3,
+                                                               partitionBoxes->at(i).getMax().x + m_voxelSizes[h] * 3,
+                                                               partitionBoxes->at(i).getMax().y + m_voxelSizes[h] * 3,
+                                                               partitionBoxes->at(i).getMax().z + m_voxelSizes[h] * 3);
+                size_t numPoints = p_loader->numPoints();
 
-                floatArr points = bg.points(partitionBoxes->at(i).getMin().x - m_voxelSizes[h] * 3,
-                                            partitionBoxes->at(i).getMin().y - m_voxelSizes[h] * 3,
-                                            partitionBoxes->at(i).getMin().z - m_voxelSizes[h] * 3,
-                                            partitionBoxes->at(i).getMax().x + m_voxelSizes[h] * 3,
-                                            partitionBoxes->at(i).getMax().y + m_voxelSizes[h] * 3,
-                                            partitionBoxes->at(i).getMax().z + m_voxelSizes[h] * 3,
-                                            numPoints);
+                pointsTimer.addItems(numPoints);
 
                 // remove boxes with less than 50 points
                 if (numPoints <= 50)
@@ -198,23 +219,11 @@ namespace lvr2
 
                 cout << "\n" <<  lvr2::timestamp <<"box: " << i << "/" << partitionBoxes->size() - 1 << endl;
 
-                lvr2::PointBufferPtr p_loader(new lvr2::PointBuffer);
-                p_loader->setPointArray(points, numPoints);
-
-                if (bg.hasNormals())
+                if (p_loader->hasNormals())
                 {
-                    size_t numNormals;
-                    lvr2::floatArr normals = bg.normals(partitionBoxes->at(i).getMin().x - m_voxelSizes[h] * 3,
-                                                        partitionBoxes->at(i).getMin().y - m_voxelSizes[h] * 3,
-                                                        partitionBoxes->at(i).getMin().z - m_voxelSizes[h] * 3,
-                                                        partitionBoxes->at(i).getMax().x + m_voxelSizes[h] * 3,
-                                                        partitionBoxes->at(i).getMax().y + m_voxelSizes[h] * 3,
-                                                        partitionBoxes->at(i).getMax().z + m_voxelSizes[h] * 3,
-                                                        numNormals);
-
-                    p_loader->setNormalArray(normals, numNormals);
-                    cout << "got " << numNormals << " normals" << endl;
+                    cout << "got " << numPoints << " normals" << endl;
                 }
+                pointsTimer.stop();
 
                 lvr2::PointBufferPtr p_loader_reduced;
                 //if(numPoints > (m_chunkSize*500000)) // reduction TODO add options
@@ -228,6 +237,7 @@ namespace lvr2
                     p_loader_reduced = p_loader;
                 }
 
+                StageTimer normalTimer("normal_estimation");
                 lvr2::PointsetSurfacePtr<Vec> surface;
                 surface = make_shared<lvr2::AdaptiveKSearchSurface<Vec>>(p_loader_reduced,
                                                                          "FLANN",
@@ -268,17 +278,25 @@ namespace lvr2
                     }
                 }
 
+                normalTimer.addItems(p_loader_reduced->numPoints());
+                normalTimer.stop();
+
+                StageTimer distanceTimer("distance_values");
                 auto ps_grid = std::make_shared<lvr2::PointsetGrid<Vec, lvr2::FastBox<Vec>>>(
                         m_voxelSizes[h], surface, gridbb, true, m_extrude);
 
                 ps_grid->setBB(gridbb);
                 ps_grid->calcIndices();
                 ps_grid->calcDistanceValues();
-
-                std::stringstream ss2;
-                ss2 << name_id << ".ser";
-                ps_grid->saveCells(ss2.str());
-                grid_files.push_back(ss2.str());
+                distanceTimer.addItems(ps_grid->getNumberOfCells());
+                distanceTimer.stop();
+
+                StageTimer saveCellsTimer("save_cells");
+                string cellFile = (cellDir / (name_id + ".ser")).string();
+                ps_grid->saveCells(cellFile, m_compressCells);
+                saveCellsTimer.addItems(ps_grid->getNumberOfCells());
+                saveCellsTimer.stop();
+                grid_files.push_back(cellFile);
                 partitionBoxesNew.push_back(partitionBoxes->at(i));
             }
             std::cout << lvr2::timestamp << "Skipped PartitionBoxes: " << partitionBoxesSkipped << std::endl;
@@ -294,13 +312,21 @@ namespace lvr2
             cbb.expand(vmin);
             cbb.expand(vmax);
 
+            StageTimer mergeTimer("merge_cells");
             auto hg = std::make_shared<HashGrid<BaseVecT, lvr2::FastBox<Vec>>>(grid_files, partitionBoxesNew, cbb, m_voxelSizes[h]);
+            mergeTimer.addItems(hg->getNumberOfCells());
+            mergeTimer.stop();
 
             auto reconstruction = make_unique<lvr2::FastReconstruction<Vec, lvr2::FastBox<Vec>>>(hg);
 
             lvr2::HalfEdgeMesh<Vec> mesh;
 
+            StageTimer meshTimer("mesh_extraction");
             reconstruction->getMesh(mesh);
+            meshTimer.addItems(mesh.numFaces());
+            meshTimer.stop();
+
+            StageTimer optimizationTimer("mesh_optimization");
 
             if (m_removeDanglingArtifacts)
             {
@@ -343,17 +369,26 @@ namespace lvr2
                 clusterBiMap = planarClusterGrowing(mesh, faceNormals, m_planeNormalThreshold);
             }
 
+            optimizationTimer.addItems(mesh.numFaces());
+            optimizationTimer.stop();
+
             stringstream largeScale;
             string voxelSize = std::to_string(m_voxelSizes[h]);
             std::replace( voxelSize.begin(), voxelSize.end(), '.', '_');
             largeScale << "largeScale_" << voxelSize <<".ply";
 
             // Finalize mesh
+            StageTimer finalizeTimer("finalize");
             lvr2::SimpleFinalizer<Vec> finalize;
             auto meshBuffer = finalize.apply(mesh);
+            finalizeTimer.addItems(meshBuffer->numFaces());
+            finalizeTimer.stop();
 
+            StageTimer saveTimer("save_mesh");
             auto m = ModelPtr(new Model(meshBuffer));
             ModelFactory::saveModel(m, largeScale.str());
+            saveTimer.addItems(meshBuffer->numFaces());
+            saveTimer.stop();
         }
 
         // Is the return value actually used somewhere???
@@ -376,7 +411,10 @@ namespace lvr2
         }
 
         cout << lvr2::timestamp << "Starting BigGrid" << endl;
-        BigGrid<BaseVecT> bg( m_bgVoxelSize ,project, m_scale);
+        StageTimer bigGridTimer("big_grid");
+        BigGrid<BaseVecT> bg(m_bgVoxelSize, project, m_scale, m_scratchDir);
+        bigGridTimer.addItems(bg.pointSize());
+        bigGridTimer.stop();
         cout << lvr2::timestamp << "BigGrid finished " << endl;
 
         BoundingBox<BaseVecT> bb = bg.getBB();
@@ -390,6 +428,7 @@ namespace lvr2
 
         BoundingBox<BaseVecT> partbb = bg.getpartialBB();
         cout << lvr2::timestamp << "generating VGrid" << endl;
+        StageTimer partitionTimer("partitioning");
 
         VirtualGrid<BaseVecT> vGrid(
                     bg.getpartialBB(), m_chunkSize, m_bgVoxelSize);
@@ -399,6 +438,8 @@ namespace lvr2
         BaseVecT addMax = BaseVecT(std::ceil(partbb.getMax().x / m_chunkSize) * m_chunkSize, std::ceil(partbb.getMax().y / m_chunkSize) * m_chunkSize, std::ceil(partbb.getMax().z / m_chunkSize) * m_chunkSize);
         newChunksBB.expand(addMin);
         newChunksBB.expand(addMax);
+        partitionTimer.addItems(partitionBoxes->size());
+        partitionTimer.stop();
         cout << lvr2::timestamp << "finished vGrid" << endl;
         std::cout << lvr2::timestamp << "got: " << partitionBoxes->size() << " Chunks"
                       << std::endl;
@@ -442,15 +483,16 @@ namespace lvr2
                             "_" + std::to_string((int)floor(partitionBoxes->at(i).getCentroid().z / m_chunkSize));
 
 
-                size_t numPoints;
+                StageTimer pointsTimer("partition_points");
+                lvr2::PointBufferPtr p_loader = bg.pointBuffer(partitionBoxes->at(i).getMin().x - m_voxelSizes[h] *3,
+                                                               partitionBoxes->at(i).getMin().y - m_voxelSizes[h] *3,
+                                                               partitionBoxes->at(i).getMin().z - m_voxelSizes[h] *3,
+                                                               partitionBoxes->at(i).getMax().x + m_voxelSizes[h] *3,
+                                                               partitionBoxes->at(i).getMax().y + m_voxelSizes[h] *3,
+                                                               partitionBoxes->at(i).getMax().z + m_voxelSizes[h] *3);
+                size_t numPoints = p_loader->numPoints();
 
-                floatArr points = bg.points(partitionBoxes->at(i).getMin().x - m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMin().y - m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMin().z - m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMax().x + m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMax().y + m_voxelSizes[h] *3,
-                                            partitionBoxes->at(i).getMax().z + m_voxelSizes[h] *3,
-                                            numPoints);
+                pointsTimer.addItems(numPoints);
 
                 // remove chunks with less than 50 points
                 if (numPoints <= 50)
@@ -469,23 +511,11 @@ namespace lvr2
 
                 cout << "\n" <<  lvr2::timestamp <<"grid: " << i << "/" << partitionBoxes->size() - 1 << endl;
 
-                lvr2::PointBufferPtr p_loader(new lvr2::PointBuffer);
-                p_loader->setPointArray(points, numPoints);
-
-                if (bg.hasNormals())
+                if (p_loader->hasNormals())
                 {
-                    size_t numNormals;
-                    lvr2::floatArr normals = bg.normals(partitionBoxes->at(i).getMin().x -m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMin().y -m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMin().z -m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMax().x +m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMax().y +m_voxelSizes[h] *3,
-                                                        partitionBoxes->at(i).getMax().z +m_voxelSizes[h] *3,
-                                                        numNormals);
-
-                    p_loader->setNormalArray(normals, numNormals);
-                    cout << "got " << numNormals << " normals" << endl;
+                    cout << "got " << numPoints << " normals" << endl;
                 }
+                pointsTimer.stop();
 
                 lvr2::PointBufferPtr p_loader_reduced;
                 //if(numPoints > (m_chunkSize*500000)) // reduction TODO add options
@@ -499,6 +529,7 @@ namespace lvr2
                     p_loader_reduced = p_loader;
                 }
 
+                StageTimer normalTimer("normal_estimation");
                 lvr2::PointsetSurfacePtr<Vec> surface;
                 surface = make_shared<lvr2::AdaptiveKSearchSurface<Vec>>(p_loader_reduced,
                                                                          "FLANN",
@@ -542,12 +573,18 @@ namespace lvr2
 
 
 
+                normalTimer.addItems(p_loader_reduced->numPoints());
+                normalTimer.stop();
+
+                StageTimer distanceTimer("distance_values");
                 auto ps_grid = std::make_shared<lvr2::PointsetGrid<Vec, lvr2::FastBox<Vec>>>(
                         m_voxelSizes[h], surface, gridbb, true, m_extrude);
 
                 ps_grid->setBB(gridbb);
                 ps_grid->calcIndices();
                 ps_grid->calcDistanceValues();
+                distanceTimer.addItems(ps_grid->getNumberOfCells());
+                distanceTimer.stop();
 
 
 
@@ -558,7 +595,10 @@ namespace lvr2
                 int z = (int)floor(partitionBoxes->at(i).getCentroid().z / m_chunkSize);
 
 
+                StageTimer chunkTimer("save_cells");
                 addTSDFChunkManager(x, y, z, ps_grid, chunkManager, layerName);
+                chunkTimer.addItems(ps_grid->getNumberOfCells());
+                chunkTimer.stop();
                 BaseVector<int> chunkCoordinates(x, y, z);
                 // also save the grid coordinates of the chunk added to the ChunkManager
                 newChunks.push_back(chunkCoordinates);
@@ -609,6 +649,7 @@ namespace lvr2
                 // don't read from HDF5 - get the chunks from the ChunkManager
                 // auto hg = std::make_shared<HashGrid<BaseVecT, lvr2::FastBox<Vec>>>(m_filePath, newChunks, cbb);
                 // TODO: don't do the following reconstruction in ChunkingPipline-Workflow (put it in extra function for lsr_tool)
+                StageTimer mergeTimer("merge_cells");
                 std::vector<PointBufferPtr> tsdfChunks;
                 for (BaseVector<int> coord : newChunks) {
                     boost::optional<shared_ptr<PointBuffer>> chunk = chunkManager->getChunk<PointBufferPtr>(layerName,
@@ -625,11 +666,19 @@ namespace lvr2
                 auto hg = std::make_shared<HashGrid<BaseVecT, lvr2::FastBox<Vec>>>(tsdfChunks, partitionBoxesNew, cbb,
                                                                                    m_voxelSizes[0]);
                 tsdfChunks.clear();
+                mergeTimer.addItems(hg->getNumberOfCells());
+                mergeTimer.stop();
+
                 auto reconstruction = make_unique<lvr2::FastReconstruction<Vec, lvr2::FastBox<Vec>>>(hg);
 
                 lvr2::HalfEdgeMesh<Vec> mesh;
 
+                StageTimer meshTimer("mesh_extraction");
                 reconstruction->getMesh(mesh);
+                meshTimer.addItems(mesh.numFaces());
+                meshTimer.stop();
+
+                StageTimer optimizationTimer("mesh_optimization");
 
                 if (m_removeDanglingArtifacts) {
                     cout << timestamp << "Removing dangling artifacts" << endl;
@@ -672,9 +721,15 @@ namespace lvr2
 
 
 
+                optimizationTimer.addItems(mesh.numFaces());
+                optimizationTimer.stop();
+
                 // Finalize mesh
+                StageTimer finalizeTimer("finalize");
                 lvr2::SimpleFinalizer<Vec> finalize;
                 auto meshBuffer = finalize.apply(mesh);
+                finalizeTimer.addItems(meshBuffer->numFaces());
+                finalizeTimer.stop();
 
                 time_t now = time(0);
 
@@ -682,8 +737,11 @@ namespace lvr2
                 stringstream largeScale;
                 largeScale << 1900 + time->tm_year << "_" << 1+ time->tm_mon << "_" << time->tm_mday << "_" <<  time->tm_hour << "h_" << 1 + time->tm_min << "m_" << 1 + time->tm_sec << "s.ply";
 
+                StageTimer saveTimer("save_mesh");
                 auto m = ModelPtr(new Model(meshBuffer));
                 ModelFactory::saveModel(m, largeScale.str());
+                saveTimer.addItems(meshBuffer->numFaces());
+                saveTimer.stop();
             }
             std::cout << lvr2::timestamp << "added/changed " << newChunks.size() << " chunks in layer " << layerName << std::endl;
         }
@@ -56,13 +56,18 @@ PointsetGrid<BaseVecT, BoxT>::PointsetGrid(
 
     FloatChannel pts = *(m_surface->pointBuffer()->getFloatChannel("points"));
 
-    // Iterator over all points, calc lattice indices and add lattice points to the grid
-    for(size_t i = 0; i < numPoint; i++)
+    // Calc lattice indices of all points and add the lattice points to the grid
+    std::vector<std::array<int, 3>> indices(numPoint);
+
+    #pragma omp parallel for schedule(static)
+    for(long i = 0; i < static_cast<long>(numPoint); i++)
     {
         BaseVecT pt = pts[i];
         auto index = (pt - v_min) / this->m_voxelsize;
-        this->addLatticePoint(calcIndex(index.x), calcIndex(index.y), calcIndex(index.z));
+        indices[i] = { calcIndex(index.x), calcIndex(index.y), calcIndex(index.z) };
     }
+
+    this->addLatticePoints(std::move(indices));
 }
 
 
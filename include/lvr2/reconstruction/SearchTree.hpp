@@ -35,11 +35,41 @@
 #ifndef LVR2_RECONSTRUCTION_SEARCHTREE_H_
 #define LVR2_RECONSTRUCTION_SEARCHTREE_H_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
 #include <vector>
 
 namespace lvr2
 {
 
+/**
+ * @brief How the neighbours found by a k-nearest-neighbour search are
+ *        weighted when their attributes are interpolated.
+ */
+enum class KnnWeighting
+{
+    /// All neighbours count the same
+    UNIFORM = 0,
+    /// Neighbours are weighted by their inverse distance to the query point
+    INVERSE_DISTANCE = 1,
+};
+
+/**
+ * @brief Returns the weight of a neighbour with the given squared distance
+ *        to the query point.
+ */
+template<typename CoordT>
+inline CoordT knnWeight(KnnWeighting weighting, CoordT squaredDistance)
+{
+    if (weighting == KnnWeighting::INVERSE_DISTANCE)
+    {
+        return CoordT(1) / std::max(std::sqrt(squaredDistance), CoordT(1e-6));
+    }
+    return CoordT(1);
+}
+
 /**
  * @brief Abstract interface for storing and
  *        searching through a set of points.
@@ -96,6 +126,28 @@ public:
         std::vector<size_t>& indices
     ) const;
 
+    /**
+     * @brief Performs a k-next-neighbor search for many query points at once.
+     *
+     * The default implementation runs `kSearch()` for all queries in
+     * parallel. If fewer than `k` neighbours are found for a query, the
+     * remaining indices are set to `std::numeric_limits<size_t>::max()`.
+     *
+     * @param query       The `n` query points.
+     * @param n           The number of query points.
+     * @param k           The number of neighbours per query point.
+     * @param indices     Output: `n * k` indices, the neighbours of query
+     *                    point `i` start at `i * k`.
+     * @param distances   Output: `n * k` squared distances, same layout.
+     */
+    virtual void kSearchMany(
+        const BaseVecT* query,
+        size_t n,
+        int k,
+        size_t* indices,
+        CoordT* distances
+    ) const;
+
     // /**
     //  * @brief Set the number of neighbours used to estimate and interpolate normals.
     //  */
@@ -36,6 +36,7 @@
 #include "lvr2/io/Timestamp.hpp"
 
 #include <iostream>
+#include <limits>
 using std::cout;
 using std::endl;
 
@@ -53,6 +54,39 @@ int SearchTree<BaseVecT>::kSearch(
     return this->kSearch(qp, neighbours, indices, distances);
 }
 
+template<typename BaseVecT>
+void SearchTree<BaseVecT>::kSearchMany(
+    const BaseVecT* query,
+    size_t n,
+    int k,
+    size_t* indices,
+    CoordT* distances
+) const
+{
+    #pragma omp parallel
+    {
+        std::vector<size_t> queryIndices;
+        std::vector<CoordT> queryDistances;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (long i = 0; i < (long)n; i++)
+        {
+            queryIndices.clear();
+            queryDistances.clear();
+            int found = this->kSearch(query[i], k, queryIndices, queryDistances);
+            found = std::min<int>(found, std::min(queryIndices.size(), queryDistances.size()));
+
+            size_t* outIndices = indices + i * k;
+            CoordT* outDistances = distances + i * k;
+            for (int j = 0; j < k; j++)
+            {
+                outIndices[j] = j < found ? queryIndices[j] : std::numeric_limits<size_t>::max();
+                outDistances[j] = j < found ? queryDistances[j] : std::numeric_limits<CoordT>::infinity();
+            }
+        }
+    }
+}
+
 // template<typename BaseVecT>
 // void SearchTree<BaseVecT>::setKi(int ki)
 // {
@@ -38,6 +38,9 @@
 
 #include "lvr2/util/Panic.hpp"
 
+#include <algorithm>
+#include <limits>
+
 #ifndef __APPLE__
 #include <omp.h>
 #endif
@@ -105,7 +108,7 @@ void SearchTreeFlann<BaseVecT>::radiusSearch(
 template<typename BaseVecT>
 void SearchTreeFlann<BaseVecT>::kSearchMany(
     const BaseVecT* query,
-    int n,
+    size_t n,
     int k,
     size_t* indices,
     CoordT* distances
@@ -113,15 +116,19 @@ void SearchTreeFlann<BaseVecT>::kSearchMany(
 {
     CoordT* queries = new CoordT[n * 3];
     flann::Matrix<CoordT> queries_mat(queries, n, 3);
-    flann::Matrix<size_t> indices_mat(indices, n, 1);
-    flann::Matrix<CoordT> distances_mat(distances, n, 1);
+    flann::Matrix<size_t> indices_mat(indices, n, k);
+    flann::Matrix<CoordT> distances_mat(distances, n, k);
 
     #pragma omp parallel for
-    for (size_t i = 0; i < n; i++)
+    for (long i = 0; i < (long)n; i++)
     {
         queries_mat[i][0] = query[i].x;
         queries_mat[i][1] = query[i].y;
         queries_mat[i][2] = query[i].z;
+
+        // FLANN leaves the slots of missing neighbours untouched
+        std::fill(indices_mat[i], indices_mat[i] + k, std::numeric_limits<size_t>::max());
+        std::fill(distances_mat[i], distances_mat[i] + k, std::numeric_limits<CoordT>::infinity());
     }
 
     flann::SearchParams params;
@@ -130,7 +137,7 @@ void SearchTreeFlann<BaseVecT>::kSearchMany(
     #else
     params.cores = 4;
     #endif
-    m_tree->knnSearch(queries_mat, indices_mat, distances_mat, 1, params);
+    m_tree->knnSearch(queries_mat, indices_mat, distances_mat, k, params);
 
     delete[] queries;
 }
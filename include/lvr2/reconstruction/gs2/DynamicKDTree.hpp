@@ -5,6 +5,9 @@
 #ifndef LAS_VEGAS_DYNAMICKDTREE_HPP
 #define LAS_VEGAS_DYNAMICKDTREE_HPP
 
+#include <limits>
+#include <vector>
+
 namespace lvr2{
 
     template <typename BaseVecT>
@@ -48,6 +51,14 @@ namespace lvr2{
 
         std::pair<Index, float> findNearestRec(Node<BaseVecT>* node, BaseVecT point, int depth, Index minDist, float minDistSq, BaseVecT currentBest);
 
+        void clearRec(Node<BaseVecT>* node);
+
+        Node<BaseVecT>* buildRec(std::vector<Index>& order, size_t begin, size_t end, unsigned int depth,
+                                 const std::vector<BaseVecT>& points, const std::vector<VertexHandle>& handles);
+
+        void findNearestExactRec(const Node<BaseVecT>* node, const BaseVecT& point, int depth,
+                                 Index& best, float& bestDistSq) const;
+
     public:
         void insert(BaseVecT point, VertexHandle vH);
 
@@ -57,13 +68,28 @@ namespace lvr2{
 
         Index findNearest(BaseVecT point);
 
+        /**
+         * Discards all nodes and builds a balanced tree from the given points. Used as a
+         * static index that is rebuilt whenever the points have moved too much.
+         */
+        void rebuild(const std::vector<BaseVecT>& points, const std::vector<VertexHandle>& handles);
+
+        /**
+         * Exact nearest neighbor search for many points in parallel. The tree must not be
+         * modified meanwhile. Entries of result are std::numeric_limits<int>::max() if the
+         * tree is empty.
+         */
+        void findNearestMany(const std::vector<BaseVecT>& points, std::vector<Index>& result) const;
+
         explicit DynamicKDTree(int k) : k(k)
         {
             root = NULL;
         }
 
-        //TODO
-        ~DynamicKDTree() = default;
+        ~DynamicKDTree()
+        {
+            clearRec(root);
+        }
 
     };
 }
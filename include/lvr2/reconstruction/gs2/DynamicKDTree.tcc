@@ -2,6 +2,8 @@
 // Created by patrick on 4/11/19.
 //
 
+#include <algorithm>
+
 namespace lvr2{
 
     /**
@@ -324,5 +326,111 @@ namespace lvr2{
         return findNearestRec(root, point, 0, std::numeric_limits<int>::max(), max,BaseVecT(max,max,max)).first;
     }
 
+    /**
+     * Deletes the (sub-)tree beginning with the given node
+     * @tparam BaseVecT
+     * @param node      root of the subtree
+     */
+    template <typename BaseVecT>
+    void DynamicKDTree<BaseVecT>::clearRec(Node<BaseVecT>* node)
+    {
+        if(node == NULL) return;
+        clearRec(node->left);
+        clearRec(node->right);
+        delete node;
+    }
+
+    /**
+     * Builds a balanced subtree by splitting at the median of the current dimension
+     * @tparam BaseVecT
+     * @param order     point indices, reordered during the build
+     * @param begin     first index of the subtree in order
+     * @param end       one past the last index of the subtree in order
+     * @param depth     current depth in the tree
+     * @return          the root of the subtree
+     */
+    template <typename BaseVecT>
+    Node<BaseVecT>* DynamicKDTree<BaseVecT>::buildRec(std::vector<Index>& order, size_t begin, size_t end, unsigned int depth,
+                                                     const std::vector<BaseVecT>& points, const std::vector<VertexHandle>& handles)
+    {
+        if(begin >= end) return NULL;
+
+        unsigned cd = depth % k;
+        size_t mid = begin + (end - begin) / 2;
+
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](Index a, Index b) { return points[a][cd] < points[b][cd]; });
+
+        Node<BaseVecT>* node = newNode(points[order[mid]], handles[order[mid]]);
+        node->left = buildRec(order, begin, mid, depth + 1, points, handles);
+        node->right = buildRec(order, mid + 1, end, depth + 1, points, handles);
+        return node;
+    }
+
+    template <typename BaseVecT>
+    void DynamicKDTree<BaseVecT>::rebuild(const std::vector<BaseVecT>& points, const std::vector<VertexHandle>& handles)
+    {
+        clearRec(root);
+
+        std::vector<Index> order(points.size());
+        for(size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+
+        root = buildRec(order, 0, order.size(), 0, points, handles);
+    }
+
+    /**
+     * Recursive exact nearest neighbor search, pruning subtrees that are farther away
+     * than the best point found so far
+     * @tparam BaseVecT
+     * @param node          current node
+     * @param point         query point
+     * @param depth         current depth in the tree
+     * @param best          index of the closest vertex found so far
+     * @param bestDistSq    squared distance to the closest vertex found so far
+     */
+    template <typename BaseVecT>
+    void DynamicKDTree<BaseVecT>::findNearestExactRec(const Node<BaseVecT>* node, const BaseVecT& point, int depth,
+                                                      Index& best, float& bestDistSq) const
+    {
+        if(node == NULL) return;
+
+        float distance = point.distance2(node->point);
+        if(distance < bestDistSq)
+        {
+            bestDistSq = distance;
+            best = node->vH;
+        }
+
+        int cd = depth % k;
+        float diff = point[cd] - node->point[cd];
+
+        const Node<BaseVecT>* nearSide = diff < 0 ? node->left : node->right;
+        const Node<BaseVecT>* farSide = diff < 0 ? node->right : node->left;
+
+        findNearestExactRec(nearSide, point, depth + 1, best, bestDistSq);
+        if(diff * diff < bestDistSq)
+        {
+            findNearestExactRec(farSide, point, depth + 1, best, bestDistSq);
+        }
+    }
+
+    template <typename BaseVecT>
+    void DynamicKDTree<BaseVecT>::findNearestMany(const std::vector<BaseVecT>& points, std::vector<Index>& result) const
+    {
+        result.resize(points.size());
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for(size_t i = 0; i < points.size(); i++)
+        {
+            Index best = std::numeric_limits<int>::max();
+            float bestDistSq = std::numeric_limits<float>::max();
+            findNearestExactRec(root, points[i], 0, best, bestDistSq);
+            result[i] = best;
+        }
+    }
+
 } //end namespace lvr2
 
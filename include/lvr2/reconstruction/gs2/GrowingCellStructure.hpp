@@ -12,6 +12,8 @@
 #include "lvr2/reconstruction/gs2/DynamicKDTree.hpp"
 #include "lvr2/reconstruction/gs2/TumbleTree.hpp"
 
+#include <algorithm>
+
 namespace lvr2
 {
 
@@ -104,6 +106,23 @@ class GrowingCellStructure
 
     void setNumBalances(int m_balances) { GrowingCellStructure::m_balances = m_balances; }
 
+    /**
+     * Number of random samples drawn per batched basic step. With a batch size of 1 (default)
+     * the basic steps run sequentially with a linear search for the winner vertex. Larger
+     * batches resolve the winners of all samples in parallel against a kd-tree that is
+     * rebuilt once per batch, trading some accuracy (winners are found for the positions at
+     * the start of the batch) for much shorter runtimes.
+     */
+    void setBatchSize(int m_batchSize) { GrowingCellStructure::m_batchSize = m_batchSize; }
+
+    int getBatchSize() const { return m_batchSize; }
+
+    // MESH QUALITY OF THE LAST getMesh() CALL
+
+    std::pair<double, double> equilaterality();
+
+    double avgValence();
+
   private:
     PointsetSurfacePtr<BaseVecT>* m_surface; // helper-surface
     HalfEdgeMesh<BaseVecT>* m_mesh;
@@ -119,6 +138,7 @@ class GrowingCellStructure
     bool m_filterChain; // should a filter chain be applied?
     bool m_interior;    // should the interior be reconstructed or the exterior?
     int m_balances;
+    int m_batchSize = 1;  // samples per batched basic step
     float m_avgSignalCounter = 0;
 
     // "GCS" related members
@@ -150,6 +170,12 @@ class GrowingCellStructure
 
     void executeBasicStep(PacmanProgressBar& progress_bar);
 
+    void executeBatchedBasicStep(int batchSize, PacmanProgressBar& progress_bar);
+
+    void moveWinner(VertexHandle winnerH, BaseVecT random_point);
+
+    void updateSignalCounter(VertexHandle winnerH);
+
     void executeVertexSplit();
 
     void executeEdgeCollapse();
@@ -172,10 +198,6 @@ class GrowingCellStructure
 
     int numVertexValences(int minValence);
 
-    std::pair<double, double> equilaterality();
-
-    double avgValence();
-
     // void coalescing();
 
     // ADDITIONAL FUNCTIONS
@@ -7,6 +7,7 @@
 #include "lvr2/reconstruction/PointsetSurface.hpp"
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/reconstruction/LBKdTree.hpp"
+#include "lvr2/util/StageTimer.hpp"
 #include <cmath>
 
 
@@ -52,11 +53,17 @@ namespace lvr2 {
         //get initial tetrahedron mesh
         getInitialMesh();
 
-        //progress bar
+        //progress bar, counting visited vertices (sequential) or random points (batched)
         size_t runtime_length = (size_t)((((size_t)m_runtime*(size_t)m_numSplits)
                                           *(((size_t)m_numSplits*(size_t)m_runtime)+1)/(size_t)2) * (size_t)m_basicSteps);
+        if(m_batchSize > 1)
+        {
+            runtime_length = (size_t)m_runtime * (size_t)m_numSplits * (size_t)m_basicSteps;
+        }
         PacmanProgressBar progress_bar(runtime_length);
 
+        StageTimer growingTimer(m_batchSize > 1 ? "gcs_growing_batched" : "gcs_growing");
+
         //algorithm
         for(int i = 0; i < getRuntime(); i++)
         {
@@ -69,9 +76,19 @@ namespace lvr2 {
 
             for(int j = 0; j < getNumSplits(); j++)
             {
-                for(int k = 0; k < getBasicSteps(); k++)
+                if(m_batchSize > 1)
+                {
+                    for(int k = 0; k < getBasicSteps(); k += m_batchSize)
+                    {
+                        executeBatchedBasicStep(std::min(m_batchSize, getBasicSteps() - k), progress_bar);
+                    }
+                }
+                else
                 {
-                    executeBasicStep(progress_bar);
+                    for(int k = 0; k < getBasicSteps(); k++)
+                    {
+                        executeBasicStep(progress_bar);
+                    }
                 }
                 executeVertexSplit(); //TODO: execute vertex split after a specific number of basic steps
 
@@ -83,6 +100,9 @@ namespace lvr2 {
 
         }
 
+        growingTimer.addItems((size_t)getRuntime() * getNumSplits() * getBasicSteps());
+        growingTimer.stop();
+
         //final operations on the mesh (like removing wrong faces and filling the holes)
 
         /*int counter = 0;
@@ -141,70 +161,212 @@ namespace lvr2 {
         //cout << "basic step" << endl;
         if(!m_useGSS) //if only gcs is used (gcs basic step)
         {
-            VertexHandle winnerH = this->getClosestPointInMesh(random_point, progress_bar); //TODO: better runtime efficency(kd-tree)
-            /*Index winnerIndex = kd_tree->findNearest(random_point);
-            VertexHandle winnerH(winnerIndex);*/
+            VertexHandle winnerH = this->getClosestPointInMesh(random_point, progress_bar);
 
-            //smooth the winning vertex
-            BaseVecT &winner = m_mesh->getVertexPosition(winnerH);
-            //kd_tree->deleteNode(winner);
-            winner += (random_point - winner) * getLearningRate();
-            //kd_tree->insert(winner, winnerH);
+            moveWinner(winnerH, random_point);
+            updateSignalCounter(winnerH);
+        }
+        else //GSS TODO: INCLUDE GSS ADDITIONS
+        {
+            std::cout << "Using GSS" << endl;
+            //find closest structure
 
-            //smooth the winning vertices' neighbors (laplacian smoothing)
+            //set approx error(s) and age of faces (using HashMap)
 
-            vector<VertexHandle> neighborsOfWinner;
-            m_mesh->getNeighboursOfVertex(winnerH, neighborsOfWinner);
+            //smoothing
 
-            //perform laplacian smoothing on all the neighbors of the winning vertex
-            for(auto v : neighborsOfWinner)
-            {
-                BaseVecT& nb = m_mesh->getVertexPosition(v);
-                //kd_tree->deleteNode(nb);
+            //coalescing
 
-                nb += (random_point - winner) * getNeighborLearningRate();
-                if(m_mesh->numVertices() > 100) performLaplacianSmoothing(v, random_point, getNeighborLearningRate());
+            //filter chain
+        }
+    }
 
-                //kd_tree->insert(nb, v);
-            }
 
+    /**
+     * Moves the winning vertex towards the random point and smoothes its neighbors (GCS)
+     *
+     * @tparam BaseVecT
+     * @tparam NormalT
+     * @param winnerH the vertex closest to the random point
+     * @param random_point the random point of the pointcloud
+     */
+    template <typename BaseVecT, typename NormalT>
+    void GrowingCellStructure<BaseVecT, NormalT>::moveWinner(VertexHandle winnerH, BaseVecT random_point)
+    {
+        //smooth the winning vertex
+        BaseVecT &winner = m_mesh->getVertexPosition(winnerH);
+        //kd_tree->deleteNode(winner);
+        winner += (random_point - winner) * getLearningRate();
+        //kd_tree->insert(winner, winnerH);
+
+        //smooth the winning vertices' neighbors (laplacian smoothing)
+
+        vector<VertexHandle> neighborsOfWinner;
+        m_mesh->getNeighboursOfVertex(winnerH, neighborsOfWinner);
+
+        //perform laplacian smoothing on all the neighbors of the winning vertex
+        for(auto v : neighborsOfWinner)
+        {
+            BaseVecT& nb = m_mesh->getVertexPosition(v);
+            //kd_tree->deleteNode(nb);
+
+            nb += (random_point - winner) * getNeighborLearningRate();
+            if(m_mesh->numVertices() > 100) performLaplacianSmoothing(v, random_point, getNeighborLearningRate());
+
+            //kd_tree->insert(nb, v);
+        }
+    }
+
+    /**
+     * Increases the signal counter of the winning vertex and decreases all others (GCS)
+     *
+     * @tparam BaseVecT
+     * @tparam NormalT
+     * @param winnerH the vertex closest to the random point
+     */
+    template <typename BaseVecT, typename NormalT>
+    void GrowingCellStructure<BaseVecT, NormalT>::updateSignalCounter(VertexHandle winnerH)
+    {
+        Cell* winnerNode = cellArr[winnerH.idx()];
+
+        //TODO: determine mistake in remove operation in basic step. why on earth is there a prob here
+
+        //we need to remove the winner before updating.
+        double winnerSC = tumble_tree->remove(winnerNode, winnerH); //remove the winning vertex from the tumble tree, get the real sc
+
+        //decrease signal counter of others by a fraction according to hennings implementation
+        if(m_decreaseFactor == 1.0)
+        {
+            size_t n = m_allowMiss * m_mesh->numVertices();
+            float dynamicDecrease = 1 - (float)pow(m_collapseThreshold, (1 / n));
+            tumble_tree->updateSC(dynamicDecrease);
+
+        }
+        else
+        {
+            tumble_tree->updateSC(m_decreaseFactor);
+
+        }
+        //reinsert the winner's vH with updated sc
+        cellArr[winnerH.idx()] = tumble_tree->insert(winnerSC + 1, winnerH);
+    }
 
-            Cell* winnerNode = cellArr[winnerH.idx()];
 
-            //TODO: determine mistake in remove operation in basic step. why on earth is there a prob here
+    /**
+     * Executes batchSize basic steps at once (GCS): the winners of all random points are found in
+     * parallel using the kd-tree, which is rebuilt for the current vertex positions beforehand.
+     * The winners thus refer to the positions at the start of the batch.
+     *
+     * A basic step writes the winner and its neighbors and reads their neighbors for the laplacian
+     * smoothing. Steps whose 2-rings don't overlap the 2-ring of an earlier step are independent and
+     * move their vertices in parallel. The remaining steps and all signal counter updates (the tumble
+     * tree is not thread safe) are executed sequentially in the order of the random points afterwards.
+     *
+     * @tparam BaseVecT
+     * @tparam NormalT
+     * @param batchSize number of random points
+     * @param progress_bar counts the random points
+     */
+    template <typename BaseVecT, typename NormalT>
+    void GrowingCellStructure<BaseVecT, NormalT>::executeBatchedBasicStep(int batchSize, PacmanProgressBar& progress_bar)
+    {
+        //get the random points sequentially, so they are the same as in the sequential basic steps
+        vector<BaseVecT> random_points(batchSize);
+        for(auto& random_point : random_points)
+        {
+            random_point = this->getRandomPointFromPointcloud();
+        }
 
-            //we need to remove the winner before updating.
-            double winnerSC = tumble_tree->remove(winnerNode, winnerH); //remove the winning vertex from the tumble tree, get the real sc
+        //rebuild the index for the current vertex positions
+        vector<BaseVecT> positions;
+        vector<VertexHandle> handles;
+        positions.reserve(m_mesh->numVertices());
+        handles.reserve(m_mesh->numVertices());
+        for(auto vertexH : m_mesh->vertices())
+        {
+            handles.push_back(vertexH);
+            positions.push_back(m_mesh->getVertexPosition(vertexH));
+        }
+        kd_tree->rebuild(positions, handles);
+
+        vector<Index> winners;
+        kd_tree->findNearestMany(random_points, winners);
 
-            //decrease signal counter of others by a fraction according to hennings implementation
-            if(m_decreaseFactor == 1.0)
+        const Index notFound = numeric_limits<int>::max();
+
+        //collect the 2-ring of every winner
+        vector<vector<VertexHandle>> rings(batchSize);
+        #pragma omp parallel for schedule(dynamic, 16)
+        for(int i = 0; i < batchSize; i++)
+        {
+            if(winners[i] == notFound) continue;
+
+            vector<VertexHandle>& ring = rings[i];
+            ring.push_back(VertexHandle(winners[i]));
+            m_mesh->getNeighboursOfVertex(VertexHandle(winners[i]), ring);
+
+            size_t numNeighbors = ring.size();
+            for(size_t j = 1; j < numNeighbors; j++)
             {
-                size_t n = m_allowMiss * m_mesh->numVertices();
-                float dynamicDecrease = 1 - (float)pow(m_collapseThreshold, (1 / n));
-                tumble_tree->updateSC(dynamicDecrease);
+                m_mesh->getNeighboursOfVertex(ring[j], ring);
+            }
+        }
+
+        //claim the 2-rings in the order of the random points
+        vector<int> claimedBy(m_mesh->nextVertexIndex(), -1);
+        vector<int> independent;
+        vector<int> dependent;
+        for(int i = 0; i < batchSize; i++)
+        {
+            if(winners[i] == notFound) continue;
+
+            bool isFree = true;
+            for(VertexHandle vH : rings[i])
+            {
+                if(claimedBy[vH.idx()] != -1 && claimedBy[vH.idx()] != i)
+                {
+                    isFree = false;
+                    break;
+                }
+            }
 
+            if(isFree)
+            {
+                for(VertexHandle vH : rings[i])
+                {
+                    claimedBy[vH.idx()] = i;
+                }
+                independent.push_back(i);
             }
             else
             {
-                tumble_tree->updateSC(m_decreaseFactor);
-
+                dependent.push_back(i);
             }
-            //reinsert the winner's vH with updated sc
-            cellArr[winnerH.idx()] = tumble_tree->insert(winnerSC + 1, winnerH);
-
         }
-        else //GSS TODO: INCLUDE GSS ADDITIONS
-        {
-            std::cout << "Using GSS" << endl;
-            //find closest structure
 
-            //set approx error(s) and age of faces (using HashMap)
-
-            //smoothing
+        #pragma omp parallel for schedule(dynamic, 16)
+        for(size_t j = 0; j < independent.size(); j++)
+        {
+            int i = independent[j];
+            moveWinner(VertexHandle(winners[i]), random_points[i]);
+        }
 
-            //coalescing
+        for(int i : dependent)
+        {
+            moveWinner(VertexHandle(winners[i]), random_points[i]);
+        }
 
-            //filter chain
+        for(int i = 0; i < batchSize; i++)
+        {
+            if(winners[i] == notFound)
+            {
+                notFoundCounter++;
+            }
+            else
+            {
+                updateSignalCounter(VertexHandle(winners[i]));
+            }
+            ++progress_bar;
         }
     }
 
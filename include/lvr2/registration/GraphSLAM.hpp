@@ -37,9 +37,13 @@
 #include "SLAMScanWrapper.hpp"
 #include "SLAMOptions.hpp"
 #include "KDTree.hpp"
+#include "ScanPoseIndex.hpp"
 
 #include <Eigen/SparseCore>
 
+#include <memory>
+#include <unordered_map>
+
 namespace lvr2
 {
 
@@ -55,6 +59,19 @@ namespace lvr2
  */
 bool findCloseScans(const std::vector<SLAMScanPtr>& scans, size_t scan, const SLAMOptions& options, std::vector<size_t>& output);
 
+/**
+ * @brief finds Scans that are "close" to a Scan using a ScanPoseIndex
+ *
+ * @param scans   A vector with all Scans
+ * @param scan    The index of the scan
+ * @param options The options on how to search
+ * @param index   An index that is up to date for all Scans up to 'scan'
+ * @param output  Will be filled with the indices of all close Scans
+ *
+ * @return true if any Scans were found, false otherwise
+ */
+bool findCloseScans(const std::vector<SLAMScanPtr>& scans, size_t scan, const SLAMOptions& options, const ScanPoseIndex& index, std::vector<size_t>& output);
+
 /**
  * @brief Wrapper class for running GraphSLAM on Scans
  */
@@ -96,10 +113,56 @@ protected:
      * @param vec Outputs the GraphVector
      * */
     void fillEquation(const std::vector<SLAMScanPtr>& scans, const Graph& graph, GraphMatrix& mat, GraphVector& vec) const;
-    
-    void eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outMat, Vector6d& outVec) const;
+
+    /**
+     * @brief Calculates the covariance of the point pairs between two scans.
+     * @param tree KDTree of the first scan in its local coordinate frame
+     * @param treePose the current pose of the first scan
+     * @param scan the second scan
+     * @param outMat Outputs the covariance matrix
+     * @param outVec Outputs the covariance vector
+     * */
+    void eulerCovariance(KDTreePtr tree, const Transformd& treePose, SLAMScanPtr scan, Matrix6d& outMat, Vector6d& outVec) const;
+
+    /**
+     * @brief Returns the KDTrees of the given scans in their local coordinate frames.
+     *
+     * The scans only move rigidly during GraphSLAM, so the trees are kept between
+     * iterations and calls of doGraphSLAM. Missing trees are built in parallel.
+     * @param scans reference to a vector containing the SlamScanPtr
+     * @param indices the scans to return trees for
+     * @param trees Outputs the trees, indexed like scans
+     * */
+    void localTrees(const std::vector<SLAMScanPtr>& scans, const std::vector<size_t>& indices, std::vector<KDTreePtr>& trees) const;
+
+    /// Removes the least recently used trees until the cache fits into SLAMOptions::slamTreeCacheSize
+    void trimTreeCache() const;
+
+    /// A KDTree of a scan in its local coordinate frame
+    struct CachedTree
+    {
+        /// The scan, to detect scans that were destroyed
+        std::weak_ptr<SLAMScanWrapper> scan;
+
+        /// Points and number of points the tree was built from, to detect reduced scans
+        const Vector3f* points;
+        size_t numPoints;
+
+        KDTreePtr tree;
+        size_t bytes;
+
+        /// Value of m_treeCacheTick at the last use
+        size_t lastUse;
+    };
 
     const SLAMOptions*     m_options;
+
+    mutable std::unordered_map<const SLAMScanWrapper*, CachedTree> m_treeCache;
+    mutable size_t         m_treeCacheBytes;
+    mutable size_t         m_treeCacheTick;
+
+    /// Candidates for the Edges of the Graph
+    mutable ScanPoseIndex  m_poseIndex;
 };
 
 } /* namespace lvr2 */
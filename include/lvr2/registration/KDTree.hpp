@@ -39,6 +39,7 @@
 #include "SLAMScanWrapper.hpp"
 
 #include <memory>
+#include <vector>
 #include <limits>
 #include <boost/shared_array.hpp>
 
@@ -65,6 +66,41 @@ public:
      */
     static std::shared_ptr<KDTree> create(SLAMScanPtr scan, int maxLeafSize = 20);
 
+    /**
+     * @brief Creates a new KDTree from the Points of the Scan in its local coordinate frame.
+     *
+     * The tree stays valid when the Scan is transformed. Use the nearestNeighbors overload
+     * with a transformation to search it.
+     *
+     * @param scan          The Scan
+     * @param maxLeafSize   The maximum number of points to use for a Leaf in the Tree
+     */
+    static std::shared_ptr<KDTree> createLocal(SLAMScanPtr scan, int maxLeafSize = 20);
+
+    /**
+     * @brief Creates a new KDTree from an array of Points. The tree keeps the array and
+     *        reorders its content.
+     *
+     * @param points        The Points
+     * @param n             The number of points in 'points'
+     * @param maxLeafSize   The maximum number of points to use for a Leaf in the Tree
+     */
+    static std::shared_ptr<KDTree> create(boost::shared_array<Point> points, size_t n, int maxLeafSize = 20);
+
+    /**
+     * @brief Combines several KDTrees into one that searches all of them.
+     *
+     * Neighbors point into the Points of the individual trees.
+     *
+     * @param trees         The trees to combine
+     */
+    static std::shared_ptr<KDTree> create(std::vector<std::shared_ptr<KDTree>> trees);
+
+    /**
+     * @brief Returns an estimate of the memory used by a tree over n points in bytes
+     */
+    static size_t estimateMemory(size_t n, int maxLeafSize = 20);
+
     /**
      * @brief Finds the nearest neighbor of 'point' that is within 'maxDistance' (defaults to infinity).
      *        The resulting neighbor is written into 'neighbor' (or nullptr if none is found).
@@ -121,6 +157,22 @@ public:
      */
     static size_t nearestNeighbors(KDTreePtr tree, SLAMScanPtr scan, KDTree::Neighbor* neighbors, double maxDistance);
 
+    /**
+     * @brief Finds the nearest neighbors of all points in a Scan in a tree that is not in
+     *        global coordinates, e.g. one created with createLocal
+     *
+     * @param tree          The KDTree to search in
+     * @param scan          The Scan to search for
+     * @param transform     Transformation from the local coordinates of 'scan' to the
+     *                      coordinates of the tree
+     * @param neighbors     An array to store the results in. neighbors[i] is set to a Pointer to the
+     *                      neighbor of points[i] (in the coordinates of the tree) or nullptr if none was found
+     * @param maxDistance   The maximum Distance for a Neighbor
+     *
+     * @return size_t The number of neighbors that were found
+     */
+    static size_t nearestNeighbors(KDTreePtr tree, SLAMScanPtr scan, const Transformd& transform, KDTree::Neighbor* neighbors, double maxDistance);
+
 protected:
     KDTree() = default;
     KDTree(const KDTree&&) = delete;
@@ -128,6 +180,7 @@ protected:
     virtual void nnInternal(const Point& point, Neighbor& neighbor, double& maxDist) const = 0;
 
     friend class KDNode;
+    friend class KDForest;
 
     boost::shared_array<Point> points;
 };
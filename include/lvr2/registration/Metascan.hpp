@@ -35,6 +35,9 @@
 #define METASCAN_HPP_
 
 #include "SLAMScanWrapper.hpp"
+#include "KDTree.hpp"
+
+#include <vector>
 
 namespace lvr2
 {
@@ -43,11 +46,22 @@ namespace lvr2
  * @brief Represents several Scans as part of a single Scan
  * 
  * Note that most methods of Scan don't make sense on a Metascan, like reductions or Pose getters.
+ *
+ * The search tree is a logarithmic forest: the Scans are grouped into blocks whose sizes
+ * roughly double from the newest to the oldest block, and every block has its own KDTree.
+ * Adding a Scan only merges the smallest blocks, so every point is part of O(log n) tree
+ * builds instead of one build per added Scan.
  */
 class Metascan : public SLAMScanWrapper
 {
 public:
-    Metascan();
+    /**
+     * @brief Creates an empty Metascan
+     *
+     * @param window If > 0, Scans older than the last 'window' Scans are dropped. Scans are
+     *               dropped block-wise, so up to 1.5 * window Scans are kept.
+     */
+    Metascan(size_t window = 0);
 
     virtual ~Metascan() = default;
 
@@ -56,8 +70,39 @@ public:
 
     void addScan(SLAMScanPtr scan);
 
+    /**
+     * @brief Returns a KDTree over the current points of all Scans.
+     *
+     * Only blocks that were merged or contain Scans that moved since the last call are rebuilt.
+     *
+     * @param maxLeafSize The maximum number of points to use for a Leaf in the Tree
+     */
+    KDTreePtr searchTree(int maxLeafSize = 20);
+
 protected:
+    struct Block
+    {
+        /// Range of the Scans in m_scans
+        size_t                  first;
+        size_t                  count;
+        size_t                  numPoints;
+
+        /// The tree and the poses of the Scans it was built with
+        KDTreePtr               tree;
+        std::vector<Transformd> poses;
+    };
+
+    /// Builds the tree of a block from the current points of its Scans
+    void buildBlock(Block& block, int maxLeafSize);
+
+    /// Drops the oldest blocks that are completely outside of the window
+    void dropOld();
+
     std::vector<SLAMScanPtr> m_scans;
+
+    std::vector<Block>       m_blocks;
+    size_t                   m_window;
+    int                      m_maxLeafSize;
 };
 
 } /* namespace lvr2 */
@@ -181,6 +181,7 @@ protected:
     SLAMScanPtr              m_metascan;
 
     GraphSLAM                m_graph;
+    ScanPoseIndex            m_poseIndex;
     bool                     m_foundLoop;
     int                      m_loopIndexCount;
 
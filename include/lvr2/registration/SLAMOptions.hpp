@@ -52,6 +52,9 @@ struct SLAMOptions
     /// Match scans to the combined Pointcloud of all previous Scans instead of just the last Scan
     bool    metascan = false;
 
+    /// Only match against the last metascanWindow Scans when using metascan. 0 uses all previous Scans
+    int     metascanWindow = 0;
+
     /// Keep track of all previous Transformations of Scans for Animation purposes like 'show' from slam6D
     bool    createFrames = false;
 
@@ -61,6 +64,10 @@ struct SLAMOptions
     /// Indicates if a HDF file containing the scans should be used
     bool    useHDF = false;
 
+    /// Read the Points of Scans directly from their point channel instead of copying them.
+    /// The Points are still copied if a reduction changes them
+    bool    sharePoints = false;
+
     // ==================== Reduction Options ====================================================
 
     /// The Voxel size for Octree based reduction
@@ -103,6 +110,10 @@ struct SLAMOptions
     /// Mutually exclusive to closeLoopDistance
     int     closeLoopPairs = -1;
 
+    /// Accept the voxel based estimate of the pair overlap instead of counting the pairs with
+    /// a nearest neighbor search. Only used with closeLoopPairs
+    bool    estimateOverlap = false;
+
     /// The minimum number of Scans to be considered a Loop to prevent Loopclosing from triggering on adjacent Scans.
     /// Also used in GraphSLAM when considering other Scans for Edges.
     /// For Loopclosing, this value needs to be at least 6, for GraphSLAM at least 1
@@ -117,6 +128,10 @@ struct SLAMOptions
     /// The epsilon difference of SLAM corrections for the stop criterion of SLAM
     double  slamEpsilon = 0.5;
 
+    /// Memory in MB for the KDTrees that GraphSLAM keeps between iterations and calls.
+    /// The least recently used trees are rebuilt when needed again
+    double  slamTreeCacheSize = 2048;
+
     /// max difference of position (euclidean distance) new and old
     double diffPosition = 50;
 
@@ -69,11 +69,18 @@ public:
      * @brief Construct a new SLAMScanWrapper object as a Wrapper around the Scan
      * 
      * @param scan The Scan to wrap around
+     * @param sharePoints If true, the Points are read directly from the point channel of the
+     *                    Scan instead of being copied. They are only copied once they are
+     *                    modified by a reduction, see materialize()
      */
-    SLAMScanWrapper(ScanPtr scan);
+    SLAMScanWrapper(ScanPtr scan, bool sharePoints = false);
 
     virtual ~SLAMScanWrapper() = default;
 
+    /// m_pointData may point into m_points
+    SLAMScanWrapper(const SLAMScanWrapper&) = delete;
+    SLAMScanWrapper& operator=(const SLAMScanWrapper&) = delete;
+
     /**
      * @brief Access to the Scan that this instance is wrapped around
      * 
@@ -132,6 +139,17 @@ public:
      */
     void trim();
 
+    /**
+     * @brief Copies shared Points into memory owned by the Wrapper. Does nothing if
+     *        the Points are already owned.
+     */
+    void materialize();
+
+    /**
+     * @brief Returns true if the Points are read from the point channel of the Scan
+     */
+    bool sharesPoints() const;
+
 
     /**
      * @brief Returns the Point at the specified index in global Coordinates
@@ -213,6 +231,12 @@ protected:
     std::vector<Vector3f> m_points;
     size_t                m_numPoints;
 
+    /// The point channel of the Scan if the Points are shared
+    floatArr              m_sharedPoints;
+
+    /// Either m_points.data() or the shared point channel
+    const Vector3f*       m_pointData;
+
     Transformd            m_deltaPose;
 
     std::vector<std::pair<Transformd, FrameUse>> m_frames;
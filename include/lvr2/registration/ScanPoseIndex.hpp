@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * ScanPoseIndex.hpp
+ *
+ *  @date 18.10.2026
+ */
+#ifndef SCANPOSEINDEX_HPP_
+#define SCANPOSEINDEX_HPP_
+
+#include "SLAMScanWrapper.hpp"
+#include "SLAMOptions.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief A spatial index over the poses of Scans to find loop closing candidates
+ *        without testing all previous Scans.
+ *
+ * Scan positions are kept in a hash grid, so distance queries only visit the
+ * Scans in the neighboring cells. For point pair based loop closing, every Scan
+ * additionally gets a bounding box and a voxel occupancy (voxel size
+ * slamMaxDistance) in global coordinates. Both are used to discard Scans that
+ * can't have enough point pairs before any nearest neighbor search happens.
+ *
+ * Entries are updated in update() when the pose of a Scan changes.
+ */
+class ScanPoseIndex
+{
+public:
+
+    /**
+     * @brief Creates an empty index
+     *
+     * @param options The loop closing options. The pointer has to stay valid.
+     */
+    ScanPoseIndex(const SLAMOptions* options);
+
+    /**
+     * @brief Adds new Scans and updates the entries of moved Scans
+     *
+     * @param scans A vector with all Scans
+     * @param last  The index of the last Scan to index. Later Scans are removed from the index
+     */
+    void update(const std::vector<SLAMScanPtr>& scans, size_t last);
+
+    /**
+     * @brief Finds all Scans with an index below 'end' whose position is closer than
+     *        'radius' to 'position'. The result is sorted by index.
+     */
+    void scansNear(const Vector3d& position, double radius, size_t end, std::vector<size_t>& output) const;
+
+    /**
+     * @brief Finds all Scans with an index below 'end' whose bounding box is closer
+     *        than slamMaxDistance to the bounding box of 'scan'. The result is sorted by index.
+     */
+    void scansOverlapping(size_t scan, size_t end, std::vector<size_t>& output) const;
+
+    /**
+     * @brief Counts the points of 'other' in voxels that are next to an occupied voxel of 'scan'.
+     *
+     * This is an upper bound of the number of points of 'other' that have a neighbor
+     * within slamMaxDistance in 'scan', i.e. of the result of KDTree::nearestNeighbors.
+     */
+    size_t estimatePairs(size_t scan, size_t other) const;
+
+    /**
+     * @brief Returns the number of indexed Scans
+     */
+    size_t size() const { return m_entries.size(); }
+
+private:
+
+    struct Entry
+    {
+        /// Scan, pose and number of points the entry was computed for
+        const SLAMScanWrapper* scan = nullptr;
+        Transformd          pose;
+        size_t              numPoints = 0;
+        bool                valid = false;
+
+        /// Bounding box of the Scan in local coordinates
+        Vector3d            localMin;
+        Vector3d            localMax;
+
+        /// Position and conservative bounding box in global coordinates
+        Vector3d            position;
+        Vector3d            min;
+        Vector3d            max;
+
+        /// Grid cell of the position
+        uint64_t            cell = 0;
+
+        /// Occupied voxels (sorted) and the number of points in them
+        std::vector<std::pair<uint64_t, uint32_t>> voxels;
+    };
+
+    /// Packs integer cell coordinates into one key
+    static uint64_t key(int64_t x, int64_t y, int64_t z);
+
+    /// Cell coordinate of a value in the position grid
+    int64_t cellCoord(double value) const;
+
+    /// (Re-)computes the entry of a Scan for its current pose
+    void updateEntry(size_t index, const SLAMScanPtr& scan, bool voxels);
+
+    /// Moves an entry to the grid cell of its position
+    void insertIntoGrid(size_t index);
+    void removeFromGrid(size_t index);
+
+    /// Rebuilds the grid with a new cell size
+    void rebuildGrid(double cellSize);
+
+    /// Calls f(index) for every Scan whose position is in a cell overlapping [min, max]
+    template<typename F>
+    void forEachInBox(const Vector3d& min, const Vector3d& max, F f) const;
+
+    const SLAMOptions*  m_options;
+
+    std::vector<Entry>  m_entries;
+
+    /// Hash grid over the Scan positions
+    std::unordered_map<uint64_t, std::vector<size_t>> m_cells;
+    double              m_cellSize;
+
+    /// Largest distance between the position of a Scan and a corner of its bounding box
+    double              m_maxRadius;
+
+    /// Edge length of the occupancy voxels
+    double              m_voxelSize;
+
+    /// Whether the entries have voxels
+    bool                m_pairs;
+};
+
+} /* namespace lvr2 */
+
+#endif /* SCANPOSEINDEX_HPP_ */
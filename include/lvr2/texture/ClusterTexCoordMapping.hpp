@@ -38,9 +38,16 @@
 
 #include "lvr2/geometry/Handles.hpp"
 
+#include <array>
+#include <iostream>
 #include <vector>
 #include <utility>
 
+#include <boost/optional.hpp>
+
+using std::array;
+using std::cout;
+using std::endl;
 using std::vector;
 using std::pair;
 
@@ -125,6 +132,29 @@ public:
         return TexCoords();
     }
 
+    /**
+     * @brief Returns the number of stored pairs
+     */
+    inline size_t size() const
+    {
+        return m_len;
+    }
+
+    /**
+     * @brief Returns the i-th stored pair of cluster handle and texture coordinates
+     */
+    inline pair<ClusterHandle, TexCoords>& operator[](size_t i)
+    {
+        return *m_mapping[i];
+    }
+
+    /**
+     * @brief Returns the i-th stored pair of cluster handle and texture coordinates
+     */
+    inline const pair<ClusterHandle, TexCoords>& operator[](size_t i) const
+    {
+        return *m_mapping[i];
+    }
 
 
 };
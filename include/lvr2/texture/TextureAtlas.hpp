@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * TextureAtlas.hpp
+ *
+ *  @date 18.10.2026
+ */
+
+#ifndef LVR2_TEXTURE_TEXTUREATLAS_HPP_
+#define LVR2_TEXTURE_TEXTUREATLAS_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include "lvr2/texture/ClusterTexCoordMapping.hpp"
+#include "lvr2/texture/Texture.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Position of a texture inside a page of a texture atlas.
+ */
+struct AtlasRegion
+{
+    /// Index of the page in the list of pages
+    size_t m_page;
+
+    /// Top left pixel of the texture in the page (padding excluded)
+    unsigned int m_x, m_y;
+
+    /// Size of the texture
+    unsigned int m_width, m_height;
+
+    /// Size of the page
+    unsigned int m_pageWidth, m_pageHeight;
+
+    /**
+     * @brief Maps texture coordinates of the original texture to texture
+     *        coordinates of the page.
+     *
+     * Like all textures in lvr2, v = 0 refers to the last image row.
+     */
+    TexCoords mapTexCoords(const TexCoords& coords) const
+    {
+        float u = (m_x + coords.u * m_width) / m_pageWidth;
+        float v = 1.0f - (m_y + (1.0f - coords.v) * m_height) / m_pageHeight;
+        return TexCoords(u, v);
+    }
+};
+
+/**
+ * @brief Packs rectangles into a fixed size area with the skyline
+ *        bottom-left heuristic.
+ *
+ * The skyline is the upper contour of all rectangles placed so far. A new
+ * rectangle is put at the position on the skyline where its top edge ends up
+ * lowest (ties are broken by the x position).
+ */
+class SkylinePacker
+{
+public:
+    /**
+     * @brief Creates an empty area of `width` x `height` pixels.
+     */
+    SkylinePacker(unsigned int width, unsigned int height);
+
+    /**
+     * @brief Places a rectangle.
+     *
+     * @param width     Width of the rectangle
+     * @param height    Height of the rectangle
+     * @param x         Output: left edge of the placed rectangle
+     * @param y         Output: top edge of the placed rectangle
+     *
+     * @return false if the rectangle does not fit anymore
+     */
+    bool insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y);
+
+    /// The width of the bounding box of all placed rectangles
+    unsigned int usedWidth() const { return m_usedWidth; }
+
+    /// The height of the bounding box of all placed rectangles
+    unsigned int usedHeight() const { return m_usedHeight; }
+
+private:
+    /// A horizontal piece of the skyline
+    struct Segment
+    {
+        unsigned int x, y, width;
+    };
+
+    std::vector<Segment> m_skyline;
+    unsigned int m_width, m_height;
+    unsigned int m_usedWidth, m_usedHeight;
+};
+
+/**
+ * @brief Packs many small textures into a few large pages.
+ *
+ * The textures are sorted by height and packed with a `SkylinePacker` into
+ * pages of at most `pageSize` x `pageSize` pixels; each page is cropped to
+ * the area that is actually used. Every texture is surrounded by `padding`
+ * pixels that repeat its border, so filtering does not bleed into the
+ * neighbouring textures. Textures which are too large or use a different pixel
+ * format than the first texture get a page of their own, in their own format.
+ * Empty textures are mapped to a single cleared pixel.
+ *
+ * @param textures      The textures to pack
+ * @param pageSize      The maximum edge length of a page
+ * @param padding       Border around every texture, in pixels
+ * @param regions       Output: the position of each texture in the pages
+ * @param firstIndex    The `m_index` of the first page; the others follow
+ *
+ * @return The pages
+ */
+std::vector<Texture> packTextureAtlas(
+    const std::vector<const Texture*>& textures,
+    unsigned int pageSize,
+    unsigned int padding,
+    std::vector<AtlasRegion>& regions,
+    int firstIndex = 0
+);
+
+} // namespace lvr2
+
+#endif /* LVR2_TEXTURE_TEXTUREATLAS_HPP_ */
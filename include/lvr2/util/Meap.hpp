@@ -34,11 +34,14 @@
 
 #include <vector>
 #include <utility>
+#include <limits>
+#include <type_traits>
 #include <unordered_map>
 
 #include <boost/optional.hpp>
 
 #include "lvr2/attrmaps/AttributeMap.hpp"
+#include "lvr2/geometry/Handles.hpp"
 
 using std::unordered_map;
 using std::pair;
@@ -82,6 +85,87 @@ private:
     ValueT m_value;
 };
 
+namespace meap_detail
+{
+
+/**
+ * @brief Lookup from key to heap index for arbitrary hashable keys.
+ */
+template<typename KeyT, typename Enable = void>
+class MeapIndexMap
+{
+public:
+    void reserve(size_t capacity) { m_indices.reserve(capacity); }
+    void clear() { m_indices.clear(); }
+
+    boost::optional<size_t> get(const KeyT& key) const
+    {
+        auto it = m_indices.find(key);
+        if (it == m_indices.end())
+        {
+            return boost::none;
+        }
+        return it->second;
+    }
+
+    void insert(const KeyT& key, size_t idx) { m_indices[key] = idx; }
+    void erase(const KeyT& key) { m_indices.erase(key); }
+    size_t& operator[](const KeyT& key) { return m_indices[key]; }
+
+private:
+    unordered_map<KeyT, size_t> m_indices;
+};
+
+/**
+ * @brief Lookup from key to heap index for handle keys.
+ *
+ * Handles are dense indices, so the heap index is stored in a plain vector
+ * indexed by `key.idx()`, which avoids hashing on every heap operation.
+ */
+template<typename KeyT>
+class MeapIndexMap<KeyT, typename std::enable_if<std::is_base_of<BaseHandle<Index>, KeyT>::value>::type>
+{
+public:
+    void reserve(size_t capacity) { m_indices.reserve(capacity); }
+    void clear() { m_indices.clear(); }
+
+    boost::optional<size_t> get(const KeyT& key) const
+    {
+        if (key.idx() >= m_indices.size() || m_indices[key.idx()] == none())
+        {
+            return boost::none;
+        }
+        return m_indices[key.idx()];
+    }
+
+    void insert(const KeyT& key, size_t idx) { (*this)[key] = idx; }
+
+    void erase(const KeyT& key)
+    {
+        if (key.idx() < m_indices.size())
+        {
+            m_indices[key.idx()] = none();
+        }
+    }
+
+    size_t& operator[](const KeyT& key)
+    {
+        if (key.idx() >= m_indices.size())
+        {
+            m_indices.resize(key.idx() + 1, none());
+        }
+        return m_indices[key.idx()];
+    }
+
+private:
+    /// Marks keys which are not in the heap
+    static size_t none() { return std::numeric_limits<size_t>::max(); }
+
+    std::vector<size_t> m_indices;
+};
+
+} // namespace meap_detail
+
 /**
  * @brief A map combined with a binary heap.
  *
@@ -94,6 +178,9 @@ private:
  *
  * This implementation is a min heap: the smallest value sits "at the top" and
  * can be retrieved in O(1) via `popMin()` or `peekMin()`.
+ *
+ * If `KeyT` is a handle type, the position of each key within the heap is
+ * stored in a dense array indexed by the handle instead of a hash map.
  */
 template<typename KeyT, typename ValueT>
 class Meap
@@ -154,7 +241,7 @@ private:
 
     // This is a map to quickly look up the index within `m_heap` at which a
     // specific key lives.
-    unordered_map<KeyT, size_t> m_indices;
+    meap_detail::MeapIndexMap<KeyT> m_indices;
 
     /**
      * @brief Returns the index of the father of the child at index `child`.
@@ -39,23 +39,22 @@ template<typename KeyT, typename ValueT>
 Meap<KeyT, ValueT>::Meap(size_t capacity)
 {
     m_heap.reserve(capacity);
-    // TODO: maybe add `reserve()` to the attribute map interface and add this
     m_indices.reserve(capacity);
 }
 
 template<typename KeyT, typename ValueT>
 bool Meap<KeyT, ValueT>::containsKey(KeyT key) const
 {
-    return m_indices.find(key) != m_indices.end();
+    return static_cast<bool>(m_indices.get(key));
 }
 
 template<typename KeyT, typename ValueT>
 boost::optional<ValueT> Meap<KeyT, ValueT>::insert(KeyT key, const ValueT& value)
 {
-    auto previous = m_indices.find(key);
-    if (previous != m_indices.end())
+    auto previous = m_indices.get(key);
+    if (previous)
     {
-        auto prevValue = m_heap[previous->second].value();
+        auto prevValue = m_heap[*previous].value();
         updateValue(key, value);
         return prevValue;
     }
@@ -64,7 +63,7 @@ boost::optional<ValueT> Meap<KeyT, ValueT>::insert(KeyT key, const ValueT& value
         // Insert to the back of the vector
         auto idx = m_heap.size();
         m_heap.push_back({ key, value });
-        m_indices.insert({key, idx});
+        m_indices.insert(key, idx);
 
         // Correct heap by bubbling up
         bubbleUp(idx);
@@ -75,14 +74,20 @@ boost::optional<ValueT> Meap<KeyT, ValueT>::insert(KeyT key, const ValueT& value
 template<typename KeyT, typename ValueT>
 void Meap<KeyT, ValueT>::clear()
 {
+    // Only forget the keys that are actually in the heap: this keeps the cost
+    // proportional to the size of the heap and keeps the dense index of
+    // handle keys allocated, so a meap can be reused cheaply.
+    for (auto& elem : m_heap)
+    {
+        m_indices.erase(elem.key());
+    }
     m_heap.clear();
-    m_indices.clear();
 }
 
 template<typename KeyT, typename ValueT>
 size_t Meap<KeyT, ValueT>::numValues() const
 {
-    return m_indices.size();
+    return m_heap.size();
 }
 
 template<typename KeyT, typename ValueT>
@@ -159,13 +164,13 @@ void Meap<KeyT, ValueT>::updateValue(const KeyT& key, const ValueT& newValue)
 template<typename KeyT, typename ValueT>
 boost::optional<ValueT> Meap<KeyT, ValueT>::erase(KeyT key)
 {
-    const auto maybeIndex = m_indices.find(key);
-    if (maybeIndex == m_indices.end())
+    const auto maybeIndex = m_indices.get(key);
+    if (!maybeIndex)
     {
         return boost::none;
     }
 
-    auto index = maybeIndex->second;
+    auto index = *maybeIndex;
 
     // Swap the element to remove with the last element in the vector
     auto swapKey = m_heap.back().key();
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Parallel.hpp
+ *
+ *  @date 18.10.2026
+ */
+
+#ifndef LVR2_UTIL_PARALLEL_H_
+#define LVR2_UTIL_PARALLEL_H_
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+
+#include "lvr2/geometry/Handles.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Marker for entries of an index remapping that do not get a compact
+ *        index (e.g. deleted handles).
+ */
+constexpr Index INVALID_COMPACT_INDEX = std::numeric_limits<Index>::max();
+
+/**
+ * @brief Replaces every entry of `values` with the sum of all preceding
+ *        entries (exclusive prefix sum).
+ *
+ * The sum is computed blockwise in parallel if OpenMP is enabled. The
+ * result does not depend on the number of threads.
+ *
+ * @param values The values to scan. They are overwritten with the result.
+ *
+ * @return The sum of all values.
+ */
+template<typename T>
+T exclusivePrefixSum(std::vector<T>& values);
+
+/**
+ * @brief Assigns consecutive indices to all used positions in [0, n).
+ *
+ * Position `i` is considered used if `isUsed(i)` returns true. Used positions
+ * are numbered in ascending order, so the resulting indices are exactly
+ * those a serial loop over all used positions would assign. This is
+ * typically used to remap the sparse handles of a `StableVector` to dense
+ * buffer indices, e.g. `isUsed = [&](Index i) { return mesh.containsVertex(VertexHandle(i)); }`.
+ *
+ * `isUsed` is called concurrently from multiple threads.
+ *
+ * @param n         Number of positions (e.g. `mesh.nextVertexIndex()`)
+ * @param isUsed    Predicate that tells whether a position is used
+ * @param indices   Output: compact index for each used position and
+ *                  `INVALID_COMPACT_INDEX` for all others
+ *
+ * @return The number of used positions.
+ */
+template<typename PredT>
+size_t compactIndices(size_t n, PredT isUsed, std::vector<Index>& indices);
+
+/**
+ * @brief Sorts `values` and removes duplicates, like `std::sort` followed
+ *        by `std::unique` and `erase`.
+ *
+ * Blocks are sorted concurrently and then merged pairwise in parallel. Since
+ * equal elements are removed, the result does not depend on the number of
+ * threads.
+ *
+ * @param values    The values to sort. They are overwritten with the result.
+ * @param comp      Strict weak ordering; elements are equal if neither is less
+ */
+template<typename T, typename Compare = std::less<T>>
+void parallelSortUnique(std::vector<T>& values, Compare comp = Compare());
+
+/**
+ * @brief Union-find (disjoint set) structure whose `find()` and `unite()`
+ *        may be called concurrently from multiple threads.
+ *
+ * Parents are stored in atomics. A root is always linked below the smaller
+ * of the two roots, so after all `unite()` calls are done, the root of every
+ * set is its smallest element, no matter in which order the calls happened.
+ */
+class ConcurrentUnionFind
+{
+public:
+    /// Creates `n` singleton sets {0}, {1}, ..., {n - 1}
+    explicit ConcurrentUnionFind(size_t n);
+
+    /// Returns the current root of the set containing `i` (compresses paths)
+    Index find(Index i);
+
+    /// Merges the sets containing `a` and `b`
+    void unite(Index a, Index b);
+
+    /// Number of elements
+    size_t size() const { return m_size; }
+
+private:
+    std::unique_ptr<std::atomic<Index>[]> m_parent;
+    size_t m_size;
+};
+
+} // namespace lvr2
+
+#include "lvr2/util/Parallel.tcc"
+
+#endif // LVR2_UTIL_PARALLEL_H_
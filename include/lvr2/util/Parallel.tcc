@@ -0,0 +1,267 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Parallel.tcc
+ *
+ *  @date 18.10.2026
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include "lvr2/config/lvropenmp.hpp"
+
+namespace lvr2
+{
+
+namespace parallel_detail
+{
+
+/// Below this size, the overhead of starting threads is not worth it
+constexpr size_t MIN_PARALLEL_SIZE = 1 << 14;
+
+/// Number of blocks used to split a range of n elements
+inline size_t numBlocks(size_t n)
+{
+    if (n < MIN_PARALLEL_SIZE)
+    {
+        return 1;
+    }
+    return std::min(n, static_cast<size_t>(OpenMPConfig::getNumThreads()));
+}
+
+} // namespace parallel_detail
+
+template<typename T>
+T exclusivePrefixSum(std::vector<T>& values)
+{
+    const size_t n = values.size();
+    const size_t blocks = parallel_detail::numBlocks(n);
+    const size_t blockSize = (n + blocks - 1) / std::max<size_t>(blocks, 1);
+
+    // Sum of every block
+    std::vector<T> blockSums(blocks + 1, T());
+
+    #pragma omp parallel for schedule(static, 1)
+    for (long b = 0; b < static_cast<long>(blocks); b++)
+    {
+        const size_t begin = b * blockSize;
+        const size_t end = std::min(n, begin + blockSize);
+        T sum = T();
+        for (size_t i = begin; i < end; i++)
+        {
+            T value = values[i];
+            values[i] = sum;
+            sum += value;
+        }
+        blockSums[b + 1] = sum;
+    }
+
+    // Offsets of the blocks (serial, there are only a few)
+    for (size_t b = 1; b <= blocks; b++)
+    {
+        blockSums[b] += blockSums[b - 1];
+    }
+
+    #pragma omp parallel for schedule(static, 1)
+    for (long b = 1; b < static_cast<long>(blocks); b++)
+    {
+        const size_t begin = b * blockSize;
+        const size_t end = std::min(n, begin + blockSize);
+        for (size_t i = begin; i < end; i++)
+        {
+            values[i] += blockSums[b];
+        }
+    }
+
+    return blockSums[blocks];
+}
+
+template<typename PredT>
+size_t compactIndices(size_t n, PredT isUsed, std::vector<Index>& indices)
+{
+    indices.resize(n);
+
+    const size_t blocks = parallel_detail::numBlocks(n);
+    const size_t blockSize = (n + blocks - 1) / std::max<size_t>(blocks, 1);
+
+    // Count used positions per block
+    std::vector<size_t> blockOffsets(blocks, 0);
+
+    #pragma omp parallel for schedule(static, 1)
+    for (long b = 0; b < static_cast<long>(blocks); b++)
+    {
+        const size_t begin = b * blockSize;
+        const size_t end = std::min(n, begin + blockSize);
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            if (isUsed(static_cast<Index>(i)))
+            {
+                indices[i] = 0;
+                count++;
+            }
+            else
+            {
+                indices[i] = INVALID_COMPACT_INDEX;
+            }
+        }
+        blockOffsets[b] = count;
+    }
+
+    size_t total = exclusivePrefixSum(blockOffsets);
+
+    // Number the used positions of every block starting at its offset
+    #pragma omp parallel for schedule(static, 1)
+    for (long b = 0; b < static_cast<long>(blocks); b++)
+    {
+        const size_t begin = b * blockSize;
+        const size_t end = std::min(n, begin + blockSize);
+        Index next = static_cast<Index>(blockOffsets[b]);
+        for (size_t i = begin; i < end; i++)
+        {
+            if (indices[i] != INVALID_COMPACT_INDEX)
+            {
+                indices[i] = next++;
+            }
+        }
+    }
+
+    return total;
+}
+
+template<typename T, typename Compare>
+void parallelSortUnique(std::vector<T>& values, Compare comp)
+{
+    auto equal = [&](const T& a, const T& b) { return !comp(a, b) && !comp(b, a); };
+
+    const size_t n = values.size();
+    const size_t blocks = parallel_detail::numBlocks(n);
+    const size_t blockSize = (n + blocks - 1) / std::max<size_t>(blocks, 1);
+
+    // Sort every block and remove duplicates within it
+    std::vector<std::vector<T>> runs(blocks);
+
+    #pragma omp parallel for schedule(static, 1)
+    for (long b = 0; b < static_cast<long>(blocks); b++)
+    {
+        const size_t begin = std::min(n, b * blockSize);
+        const size_t end = std::min(n, begin + blockSize);
+        std::vector<T>& run = runs[b];
+        run.assign(values.begin() + begin, values.begin() + end);
+        std::sort(run.begin(), run.end(), comp);
+        run.erase(std::unique(run.begin(), run.end(), equal), run.end());
+    }
+
+    // Merge pairs of runs until one is left
+    while (runs.size() > 1)
+    {
+        std::vector<std::vector<T>> merged((runs.size() + 1) / 2);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (long r = 0; r < static_cast<long>(merged.size()); r++)
+        {
+            if (2 * r + 1 == static_cast<long>(runs.size()))
+            {
+                merged[r] = std::move(runs[2 * r]);
+                continue;
+            }
+            std::vector<T>& left = runs[2 * r];
+            std::vector<T>& right = runs[2 * r + 1];
+            merged[r].reserve(left.size() + right.size());
+            std::merge(left.begin(), left.end(), right.begin(), right.end(),
+                       std::back_inserter(merged[r]), comp);
+            merged[r].erase(std::unique(merged[r].begin(), merged[r].end(), equal), merged[r].end());
+
+            std::vector<T>().swap(left);
+            std::vector<T>().swap(right);
+        }
+        runs = std::move(merged);
+    }
+
+    if (runs.empty())
+    {
+        values.clear();
+    }
+    else
+    {
+        values = std::move(runs[0]);
+    }
+}
+
+inline ConcurrentUnionFind::ConcurrentUnionFind(size_t n)
+    : m_parent(new std::atomic<Index>[n]), m_size(n)
+{
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(n); i++)
+    {
+        m_parent[i].store(static_cast<Index>(i), std::memory_order_relaxed);
+    }
+}
+
+inline Index ConcurrentUnionFind::find(Index i)
+{
+    Index parent = m_parent[i].load(std::memory_order_relaxed);
+    while (parent != i)
+    {
+        // Path halving: point i to its grandparent. Losing this race is
+        // harmless, parents only ever move closer to the root.
+        Index grandParent = m_parent[parent].load(std::memory_order_relaxed);
+        m_parent[i].compare_exchange_weak(parent, grandParent, std::memory_order_relaxed);
+        i = parent;
+        parent = m_parent[i].load(std::memory_order_relaxed);
+    }
+    return i;
+}
+
+inline void ConcurrentUnionFind::unite(Index a, Index b)
+{
+    while (true)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+        {
+            return;
+        }
+
+        // Link the larger root below the smaller one. This only succeeds if
+        // the larger one is still a root, otherwise try again.
+        if (a < b)
+        {
+            std::swap(a, b);
+        }
+        Index expected = a;
+        if (m_parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+} // namespace lvr2
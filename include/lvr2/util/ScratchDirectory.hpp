@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * ScratchDirectory.hpp
+ *
+ *  @date 18.10.2026
+ */
+
+#ifndef LVR2_UTIL_SCRATCHDIRECTORY_HPP
+#define LVR2_UTIL_SCRATCHDIRECTORY_HPP
+
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+
+namespace lvr2
+{
+
+/**
+ * @brief A uniquely named directory for the temporary files of one object.
+ *
+ * The directory is created in the constructor and removed together with all
+ * its contents in the destructor, unless \ref keep() was called. Several
+ * instances, also in different processes, can share the same parent
+ * directory without interfering with each other.
+ */
+class ScratchDirectory
+{
+public:
+
+    /**
+     * @brief Creates a new, uniquely named directory.
+     *
+     * @param parent    Directory in which the scratch directory is created. It
+     *                  is created if it does not exist. Empty: current working
+     *                  directory.
+     * @param prefix    Prefix of the generated directory name
+     *
+     * @throws boost::filesystem::filesystem_error if the directory can't be created
+     */
+    explicit ScratchDirectory(const std::string& parent = "", const std::string& prefix = "scratch");
+
+    /**
+     * @brief Removes the directory and its contents unless \ref keep() was called.
+     */
+    ~ScratchDirectory();
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    /**
+     * @brief Returns the path of the file with the given name inside the directory.
+     */
+    std::string file(const std::string& name) const;
+
+    /**
+     * @brief Returns the path of the directory.
+     */
+    const boost::filesystem::path& path() const { return m_path; }
+
+    /**
+     * @brief Keeps the directory and its contents after destruction, e.g.
+     *        because a serialized object still references them.
+     */
+    void keep() { m_keep = true; }
+
+private:
+
+    /// Path of the directory
+    boost::filesystem::path m_path;
+
+    /// Do not remove the directory in the destructor
+    bool                    m_keep;
+};
+
+} // namespace lvr2
+
+#endif // LVR2_UTIL_SCRATCHDIRECTORY_HPP
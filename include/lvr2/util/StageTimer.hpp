@@ -0,0 +1,218 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * StageTimer.hpp
+ *
+ *  @date 18.10.2026
+ */
+
+#ifndef LVR2_UTIL_STAGETIMER_HPP
+#define LVR2_UTIL_STAGETIMER_HPP
+
+#include <atomic>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+namespace lvr2
+{
+
+/**
+ * @brief Accumulated statistics of one pipeline stage
+ */
+struct StageRecord
+{
+    /// Name of the stage
+    std::string name;
+
+    /// Number of times the stage was executed
+    size_t      calls = 0;
+
+    /// Accumulated wall clock time in seconds
+    double      wallTime = 0.0;
+
+    /// Accumulated process CPU time (all threads) in seconds
+    double      cpuTime = 0.0;
+
+    /// Accumulated number of processed items (points, faces, ...)
+    size_t      items = 0;
+
+    /// Peak resident set size of the process at the end of the stage in bytes
+    size_t      peakRss = 0;
+};
+
+/**
+ * @brief Global registry that collects the statistics of all pipeline stages
+ *        timed with a \ref StageTimer.
+ *
+ * Stages with the same name are accumulated, e.g. when a stage is executed
+ * once per partition. The records are kept in the order in which the stages
+ * were executed first. All methods are thread-safe.
+ */
+class StageTimerRegistry
+{
+public:
+
+    /**
+     * @brief Returns the process wide registry.
+     */
+    static StageTimerRegistry& instance();
+
+    /**
+     * @brief Adds the statistics of one execution of the given stage.
+     */
+    void add(const std::string& stage, double wallTime, double cpuTime, size_t items, size_t peakRss);
+
+    /**
+     * @brief Returns a copy of all records.
+     */
+    std::vector<StageRecord> records() const;
+
+    /**
+     * @brief Removes all records.
+     */
+    void clear();
+
+    /**
+     * @brief Writes all records as a JSON document to the given stream.
+     */
+    void writeJSON(std::ostream& os) const;
+
+    /**
+     * @brief Writes all records as a JSON document to the given file.
+     *
+     * @return false if the file could not be written
+     */
+    bool writeJSON(const std::string& filename) const;
+
+    /**
+     * @brief Writes all records to the given file when the program exits.
+     *
+     * Calling this again replaces the file name. An empty file name
+     * disables the output.
+     */
+    void writeJSONAtExit(const std::string& filename);
+
+    /**
+     * @brief Returns the file set with \ref writeJSONAtExit (may be empty).
+     */
+    std::string exitFile() const;
+
+    /// Returns the CPU time used by the process (all threads) in seconds
+    static double processCpuTime();
+
+    /// Returns the peak resident set size of the process in bytes (0 if unknown)
+    static size_t processPeakRss();
+
+private:
+
+    StageTimerRegistry() = default;
+
+    /// Protects the records
+    mutable boost::mutex        m_mutex;
+
+    /// The records in order of first execution
+    std::vector<StageRecord>    m_records;
+
+    /// Maps stage names to positions in m_records
+    std::map<std::string, size_t> m_index;
+
+    /// File the records are written to at exit
+    std::string                 m_exitFile;
+
+    /// True if the exit handler was registered
+    bool                        m_exitHandlerRegistered = false;
+};
+
+/**
+ * @brief Measures wall time, CPU time and peak memory of a pipeline stage
+ *        and reports it to the \ref StageTimerRegistry.
+ *
+ * The measurement starts on construction and ends when \ref stop() is
+ * called or the timer is destroyed:
+ *
+ * @code
+ * {
+ *     StageTimer timer("marching_cubes");
+ *     reconstruction->getMesh(mesh);
+ *     timer.addItems(mesh.numFaces());
+ * }
+ * @endcode
+ */
+class StageTimer
+{
+public:
+
+    /**
+     * @brief Starts timing the given stage.
+     */
+    explicit StageTimer(const std::string& stage);
+
+    /**
+     * @brief Stops the timer if it is still running.
+     */
+    ~StageTimer();
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    /**
+     * @brief Adds n processed items to this stage. Can be called concurrently.
+     */
+    void addItems(size_t n) { m_items.fetch_add(n, std::memory_order_relaxed); }
+
+    /**
+     * @brief Stops the timer and reports the stage. Further calls have
+     *        no effect.
+     */
+    void stop();
+
+private:
+
+    /// Name of the stage
+    std::string         m_stage;
+
+    /// Wall clock time at construction in seconds
+    double              m_wallStart;
+
+    /// Process CPU time at construction in seconds
+    double              m_cpuStart;
+
+    /// Number of processed items
+    std::atomic<size_t> m_items;
+
+    /// True after the stage was reported
+    bool                m_stopped;
+};
+
+} // namespace lvr2
+
+#endif // LVR2_UTIL_STAGETIMER_HPP
@@ -199,6 +199,22 @@ void ChunkHashGrid::setBoundingBox(const BoundingBox<BaseVector<float>> bounding
     setChunkAmountAndOffset(chunkAmount, chunkIndexOffset);
 }
 
+void ChunkHashGrid::setLevelOfDetailErrors(std::string layer, const std::vector<float>& errors)
+{
+    m_lodErrors[layer] = errors;
+    m_io.saveLodErrors(layer, errors);
+}
+
+const std::vector<float>& ChunkHashGrid::getLevelOfDetailErrors(std::string layer)
+{
+    auto it = m_lodErrors.find(layer);
+    if (it == m_lodErrors.end())
+    {
+        it = m_lodErrors.emplace(layer, m_io.loadLodErrors(layer)).first;
+    }
+    return it->second;
+}
+
 void ChunkHashGrid::setChunkAmountAndOffset(const BaseVector<std::size_t>& chunkAmount,
                                             const BaseVector<std::size_t>& chunkIndexOffset)
 {
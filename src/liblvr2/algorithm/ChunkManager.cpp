@@ -39,8 +39,12 @@
 #include "lvr2/io/ModelFactory.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <boost/filesystem.hpp>
 #include <cmath>
+#include <cstring>
+#include <map>
 
 namespace
 {
@@ -58,6 +62,104 @@ struct VectorCapsule
     ~VectorCapsule() = default;
     void operator()(void*) {}
 };
+
+/**
+ * @brief Adds a channel of the original mesh to a chunk. Vertex and face channels are
+ *        reduced to the rows given in vertexRows and faceRows, others are shared unchanged.
+ */
+template <typename T>
+void addChunkChannel(lvr2::MeshBufferPtr chunk,
+                     const std::string& name,
+                     const lvr2::MultiChannelMap::val_type& channel,
+                     size_t numVertices,
+                     size_t numFaces,
+                     const std::vector<unsigned int>& vertexRows,
+                     const std::vector<unsigned int>& faceRows)
+{
+    const std::vector<unsigned int>* rows = nullptr;
+    if (channel.numElements() == numVertices)
+    {
+        rows = &vertexRows;
+    }
+    else if (channel.numElements() == numFaces)
+    {
+        rows = &faceRows;
+    }
+    else
+    {
+        // a channel that is not a vertex or a face channel will be added unchanged to each chunk
+        chunk->addChannel<T>(channel.dataPtr<T>(), name, channel.numElements(), channel.width());
+        return;
+    }
+
+    size_t width = channel.width();
+    boost::shared_array<T> source = channel.dataPtr<T>();
+    boost::shared_array<T> target(new T[rows->size() * width]);
+    for (size_t i = 0; i < rows->size(); i++)
+    {
+        std::memcpy(target.get() + i * width, source.get() + (*rows)[i] * width, width * sizeof(T));
+    }
+    chunk->addChannel<T>(target, name, rows->size(), width);
+}
+
+/**
+ * @brief returns the number of vertices of a chunk that are shared with other chunks
+ */
+size_t getNumDuplicates(const lvr2::MeshBufferPtr& chunk)
+{
+    boost::optional<unsigned int> numDuplicates = chunk->getAtomic<unsigned int>("num_duplicates");
+    return numDuplicates ? *numDuplicates : 0;
+}
+
+/**
+ * @brief Adds a channel that is merged from several chunks. Rows are given as pairs of source
+ *        chunk and row in the source chunk. Channels missing in a source or differing in type,
+ *        width or kind are dropped.
+ */
+template <typename T>
+void addMergedChannel(lvr2::MeshBufferPtr target,
+                      const std::string& name,
+                      const std::vector<lvr2::MeshBufferPtr>& sources,
+                      const std::vector<std::pair<unsigned int, unsigned int>>& vertexRows,
+                      const std::vector<std::pair<unsigned int, unsigned int>>& faceRows)
+{
+    // 0: vertex channel, 1: face channel, 2: other channel
+    auto kind = [](const lvr2::MeshBufferPtr& mesh, const lvr2::MultiChannelMap::val_type& channel) {
+        return channel.numElements() == mesh->numVertices() ? 0 : channel.numElements() == mesh->numFaces() ? 1 : 2;
+    };
+
+    const lvr2::MultiChannelMap::val_type& firstChannel = sources[0]->find(name)->second;
+    const size_t width     = firstChannel.width();
+    const int channelKind  = kind(sources[0], firstChannel);
+
+    std::vector<boost::shared_array<T>> sourceData;
+    for (const lvr2::MeshBufferPtr& source : sources)
+    {
+        auto it = source->find(name);
+        if (it == source->end() || !it->second.template is_type<T>() || it->second.width() != width
+            || kind(source, it->second) != channelKind)
+        {
+            return;
+        }
+        sourceData.push_back(it->second.template dataPtr<T>());
+    }
+
+    if (channelKind == 2)
+    {
+        target->addChannel<T>(sourceData[0], name, firstChannel.numElements(), width);
+        return;
+    }
+
+    const std::vector<std::pair<unsigned int, unsigned int>>& rows = channelKind == 0 ? vertexRows : faceRows;
+    boost::shared_array<T> data(new T[rows.size() * width]);
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        std::memcpy(data.get() + i * width,
+                    sourceData[rows[i].first].get() + rows[i].second * width,
+                    width * sizeof(T));
+    }
+    target->addChannel<T>(data, name, rows.size(), width);
+}
 } // namespace
 
 namespace lvr2
@@ -242,6 +344,15 @@ MeshBufferPtr ChunkManager::extractArea(const BoundingBox<BaseVector<float>>& ar
     }
     std::cout << "Extracted " << chunks.size() << " Chunks" << std::endl;
 
+    MeshBufferPtr areaMeshPtr = combineChunks(chunks);
+
+    ModelFactory::saveModel(ModelPtr(new Model(areaMeshPtr)), "test1.ply");
+
+    return areaMeshPtr;
+}
+
+MeshBufferPtr ChunkManager::combineChunks(std::unordered_map<std::size_t, MeshBufferPtr>& chunks)
+{
     std::vector<float> areaDuplicateVertices;
     std::vector<std::unordered_map<std::size_t, std::size_t>> areaVertexIndices;
     std::vector<float> areaUniqueVertices;
@@ -401,8 +512,6 @@ MeshBufferPtr ChunkManager::extractArea(const BoundingBox<BaseVector<float>>& ar
     std::cout << "Vertices: " << areaMeshPtr->numVertices()
               << ", Faces: " << areaMeshPtr->numFaces() << std::endl;
 
-    ModelFactory::saveModel(ModelPtr(new Model(areaMeshPtr)), "test1.ply");
-
     return areaMeshPtr;
 }
 
@@ -533,120 +642,284 @@ void ChunkManager::initBoundingBox(MeshBufferPtr mesh)
     setBoundingBox(boundingBox);
 }
 
-void ChunkManager::cutLargeFaces(
-    std::shared_ptr<HalfEdgeMesh<BaseVector<float>>> halfEdgeMesh,
-    float overlapRatio,
-    std::shared_ptr<std::unordered_map<unsigned int, unsigned int>> splitVertices,
-    std::shared_ptr<std::unordered_map<unsigned int, unsigned int>> splitFaces)
-
+bool ChunkManager::isLargeEdge(const float* referenceVertex,
+                               const float* comparedVertex,
+                               float overlapRatio) const
 {
-    // check all edges if they range too far into different chunks
-    MeshHandleIteratorPtr<EdgeHandle> iterator = halfEdgeMesh->edgesBegin();
-    while (iterator != halfEdgeMesh->edgesEnd())
+    // check distance to nearest chunkBorder for all three directions
+    for (unsigned int axis = 0; axis < 3; axis++)
     {
-        // check both directions for each face
-        std::array<VertexHandle, 2> vertices = halfEdgeMesh->getVerticesOfEdge(*iterator);
-        for (unsigned int i = 0; i <= 1; i++)
+        // key for size comparison depending on the current axis
+        float referenceVertexKey = referenceVertex[axis];
+        float comparedVertexKey  = comparedVertex[axis];
+
+        // if the edge goes over multiple chunks it is to large because of a chunk
+        // border located in the middle of the edge
+        if (fabs(referenceVertexKey - comparedVertexKey) > 2 * getChunkSize())
         {
-            VertexHandle referenceVertex = vertices[i];
-            VertexHandle comparedVertex  = vertices[(i + 1) % 2];
+            return true;
+        }
 
-            bool isLargeEdge = false;
+        // get coordinate for plane in direction of the current axis
+        float chunkBorder
+            = getChunkSize() * (static_cast<int>(referenceVertexKey / getChunkSize()))
+              + fmod(getBoundingBox().getMin()[axis], getChunkSize());
 
-            // check distance to nearest chunkBorder for all three directions
-            for (unsigned int axis = 0; axis < 3; axis++)
-            {
-                // key for size comparison depending on the current axis
-                float referenceVertexKey = halfEdgeMesh->getVertexPosition(referenceVertex)[axis];
-                float comparedVertexKey  = halfEdgeMesh->getVertexPosition(comparedVertex)[axis];
+        // select plane of chunk depending on the relative position of the compared
+        // vertex
+        if (referenceVertexKey < comparedVertexKey)
+        {
+            chunkBorder += getChunkSize();
+        }
 
-                // if the edge goes over multiple chunks it is to large because of a chunk
-                // border located in the middle of the edge
-                if (fabs(referenceVertexKey - comparedVertexKey) > 2 * getChunkSize())
-                {
-                    isLargeEdge = true;
-                    break;
-                }
+        // check whether or not to cut the face
+        if (referenceVertexKey - chunkBorder < 0 && comparedVertexKey - chunkBorder >= 0
+            && chunkBorder - referenceVertexKey > overlapRatio * getChunkSize()
+            && comparedVertexKey - chunkBorder > overlapRatio * getChunkSize())
+        {
+            return true;
+        }
+        else if (referenceVertexKey - chunkBorder >= 0
+                 && comparedVertexKey - chunkBorder < 0
+                 && referenceVertexKey - chunkBorder > overlapRatio * getChunkSize()
+                 && chunkBorder - comparedVertexKey > overlapRatio * getChunkSize())
+        {
+            return true;
+        }
+    }
 
-                // get coordinate for plane in direction of the current axis
-                float chunkBorder
-                    = getChunkSize() * (static_cast<int>(referenceVertexKey / getChunkSize()))
-                      + fmod(getBoundingBox().getMin()[axis], getChunkSize());
+    return false;
+}
 
-                // select plane of chunk depending on the relative position of the compared
-                // vertex
-                if (referenceVertexKey < comparedVertexKey)
-                {
-                    chunkBorder += getChunkSize();
-                }
+bool ChunkManager::cutLargeFaces(std::vector<float>& vertices,
+                                 std::vector<unsigned int>& faces,
+                                 std::vector<unsigned int>& vertexSources,
+                                 std::vector<unsigned int>& faceSources,
+                                 size_t numOriginalVertices,
+                                 size_t numOriginalFaces,
+                                 float overlapRatio) const
+{
+    bool changed = false;
 
-                // check whether or not to cut the face
-                if (referenceVertexKey - chunkBorder < 0 && comparedVertexKey - chunkBorder >= 0
-                    && chunkBorder - referenceVertexKey > overlapRatio * getChunkSize()
-                    && comparedVertexKey - chunkBorder > overlapRatio * getChunkSize())
+    // every pass halves the large edges, so this limit is only reached for degenerate options
+    for (int pass = 0; pass < 32; pass++)
+    {
+        size_t numFaces = faces.size() / 3;
+
+        // bit i marks the edge from vertex i to vertex i + 1 of a face
+        std::vector<unsigned char> cutEdges(numFaces, 0);
+        size_t numCutFaces = 0;
+
+        #pragma omp parallel for reduction(+:numCutFaces) schedule(static)
+        for (size_t face = 0; face < numFaces; face++)
+        {
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                const float* a = &vertices[faces[face * 3 + i] * 3];
+                const float* b = &vertices[faces[face * 3 + (i + 1) % 3] * 3];
+                if (isLargeEdge(a, b, overlapRatio) || isLargeEdge(b, a, overlapRatio))
                 {
-                    isLargeEdge = true;
-                    break;
+                    cutEdges[face] |= 1 << i;
                 }
-                else if (referenceVertexKey - chunkBorder >= 0
-                         && comparedVertexKey - chunkBorder < 0
-                         && referenceVertexKey - chunkBorder > overlapRatio * getChunkSize()
-                         && chunkBorder - comparedVertexKey > overlapRatio * getChunkSize())
+            }
+            if (cutEdges[face])
+            {
+                numCutFaces++;
+            }
+        }
+
+        if (numCutFaces == 0)
+        {
+            break;
+        }
+        changed = true;
+
+        // one new vertex in the center of every large edge
+        std::vector<std::pair<unsigned int, unsigned int>> edges;
+        edges.reserve(numCutFaces * 3);
+        for (size_t face = 0; face < numFaces; face++)
+        {
+            for (unsigned int i = 0; cutEdges[face] && i < 3; i++)
+            {
+                if (cutEdges[face] & (1 << i))
                 {
-                    isLargeEdge = true;
-                    break;
+                    unsigned int a = faces[face * 3 + i];
+                    unsigned int b = faces[face * 3 + (i + 1) % 3];
+                    edges.push_back({std::min(a, b), std::max(a, b)});
                 }
             }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
 
-            if (isLargeEdge)
+        unsigned int firstCenter = vertices.size() / 3;
+        for (const auto& edge : edges)
+        {
+            for (unsigned int axis = 0; axis < 3; axis++)
             {
-                std::array<OptionalFaceHandle, 2> faces = halfEdgeMesh->getFacesOfEdge(*iterator);
+                vertices.push_back((vertices[edge.first * 3 + axis] + vertices[edge.second * 3 + axis]) * 0.5f);
+            }
+            // the new vertex uses the attributes of one end of the edge
+            vertexSources.push_back(edge.first < numOriginalVertices
+                                        ? edge.first
+                                        : vertexSources[edge.first - numOriginalVertices]);
+        }
+
+        auto center = [&](unsigned int a, unsigned int b) {
+            auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(std::min(a, b), std::max(a, b)));
+            return firstCenter + static_cast<unsigned int>(it - edges.begin());
+        };
 
-                // build newIndex -> oldIndex map to use
-                unsigned int faceIndex = halfEdgeMesh->nextFaceIndex();
-                if (faces[0])
+        // split the faces, keeping the orientation
+        for (size_t face = 0; face < numFaces; face++)
+        {
+            unsigned char cut = cutEdges[face];
+            if (!cut)
+            {
+                continue;
+            }
+
+            unsigned int source = face < numOriginalFaces ? face : faceSources[face - numOriginalFaces];
+            std::vector<std::array<unsigned int, 3>> parts;
+
+            int numCut = (cut & 1) + ((cut >> 1) & 1) + ((cut >> 2) & 1);
+            if (numCut == 3)
+            {
+                unsigned int w0 = faces[face * 3], w1 = faces[face * 3 + 1], w2 = faces[face * 3 + 2];
+                unsigned int m0 = center(w0, w1), m1 = center(w1, w2), m2 = center(w2, w0);
+                parts = {{w0, m0, m2}, {m0, w1, m1}, {m2, m1, w2}, {m0, m1, m2}};
+            }
+            else
+            {
+                // rotate the face so that edge (w0, w1) is cut and, for two cut edges, (w1, w2) too
+                unsigned int r = 0;
+                while (!(cut & (1 << r)) || (numCut == 2 && !(cut & (1 << ((r + 1) % 3)))))
                 {
-                    unsigned int face = faces[0].unwrap().idx();
-                    while (splitFaces->find(face) != splitFaces->end())
-                    {
-                        face = splitFaces->at(face);
-                    }
-                    splitFaces->insert({faceIndex, face});
-                    faceIndex++;
+                    r++;
                 }
-                if (faces[1])
+                unsigned int w0 = faces[face * 3 + r];
+                unsigned int w1 = faces[face * 3 + (r + 1) % 3];
+                unsigned int w2 = faces[face * 3 + (r + 2) % 3];
+                unsigned int m0 = center(w0, w1);
+
+                if (numCut == 1)
                 {
-                    unsigned int face = faces[1].unwrap().idx();
-                    while (splitFaces->find(face) != splitFaces->end())
-                    {
-                        face = splitFaces->at(face);
-                    }
-                    splitFaces->insert({faceIndex, face});
+                    parts = {{w0, m0, w2}, {m0, w1, w2}};
                 }
-
-                unsigned int vertex = referenceVertex.idx();
-                while (splitVertices->find(vertex) != splitVertices->end())
+                else
                 {
-                    vertex = splitVertices->at(vertex);
+                    unsigned int m1 = center(w1, w2);
+                    parts = {{m0, w1, m1}, {w0, m0, m1}, {w0, m1, w2}};
                 }
-                splitVertices->insert({halfEdgeMesh->nextVertexIndex(), vertex});
-
-                // cut edge in half
-                float cutRatio = 0.5;
-                BaseVector<float> cutPoint
-                    = halfEdgeMesh->getVertexPosition(referenceVertex) * cutRatio
-                      + halfEdgeMesh->getVertexPosition(comparedVertex) * (1 - cutRatio);
+            }
 
-                halfEdgeMesh->splitVertex(*iterator,
-                                          referenceVertex,
-                                          halfEdgeMesh->getVertexPosition(referenceVertex),
-                                          cutPoint);
-                break;
+            // the first part replaces the original face
+            std::copy(parts[0].begin(), parts[0].end(), faces.begin() + face * 3);
+            for (size_t i = 1; i < parts.size(); i++)
+            {
+                faces.insert(faces.end(), parts[i].begin(), parts[i].end());
+                faceSources.push_back(source);
             }
         }
+    }
+
+    return changed;
+}
+
+MeshBufferPtr ChunkManager::buildChunkMesh(MeshBufferPtr mesh,
+                                           const float* vertices,
+                                           const unsigned int* faces,
+                                           const std::vector<unsigned int>& vertexSources,
+                                           const std::vector<unsigned int>& faceSources,
+                                           const unsigned int* chunkFaces,
+                                           size_t numChunkFaces,
+                                           const std::vector<std::atomic<unsigned int>>& vertexChunks) const
+{
+    const size_t numOriginalVertices = mesh->numVertices();
+    const size_t numOriginalFaces    = mesh->numFaces();
+
+    // all vertices used by the chunk, in ascending order
+    std::vector<unsigned int> chunkVertices(numChunkFaces * 3);
+    for (size_t i = 0; i < numChunkFaces; i++)
+    {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            chunkVertices[i * 3 + j] = faces[chunkFaces[i] * 3 + j];
+        }
+    }
+    std::sort(chunkVertices.begin(), chunkVertices.end());
+    chunkVertices.erase(std::unique(chunkVertices.begin(), chunkVertices.end()),
+                        chunkVertices.end());
+    const size_t numVertices = chunkVertices.size();
+
+    // vertices that are shared with other chunks are stored first
+    std::vector<unsigned int> localIndices(numVertices);
+    size_t numDuplicates = 0;
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        if (vertexChunks[chunkVertices[i]].load(std::memory_order_relaxed) == SHARED_VERTEX)
+        {
+            numDuplicates++;
+        }
+    }
+    size_t nextDuplicate = 0, nextUnique = numDuplicates;
+    std::vector<unsigned int> vertexRows(numVertices);
+    lvr2::floatArr chunkPositions(new float[numVertices * 3]);
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        unsigned int vertex = chunkVertices[i];
+        bool shared = vertexChunks[vertex].load(std::memory_order_relaxed) == SHARED_VERTEX;
+        unsigned int local = shared ? nextDuplicate++ : nextUnique++;
+        localIndices[i] = local;
+
+        std::copy(vertices + vertex * 3, vertices + vertex * 3 + 3, chunkPositions.get() + local * 3);
+        vertexRows[local] = vertex < numOriginalVertices
+                                ? vertex
+                                : vertexSources[vertex - numOriginalVertices];
+    }
+
+    lvr2::indexArray chunkFaceIndices(new unsigned int[numChunkFaces * 3]);
+    std::vector<unsigned int> faceRows(numChunkFaces);
+    for (size_t i = 0; i < numChunkFaces; i++)
+    {
+        unsigned int face = chunkFaces[i];
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            auto it = std::lower_bound(chunkVertices.begin(), chunkVertices.end(), faces[face * 3 + j]);
+            chunkFaceIndices[i * 3 + j] = localIndices[it - chunkVertices.begin()];
+        }
+        faceRows[i] = face < numOriginalFaces ? face : faceSources[face - numOriginalFaces];
+    }
 
-        ++iterator;
+    lvr2::MeshBufferPtr chunk(new lvr2::MeshBuffer);
+
+    // TODO: add more types if needed
+    for (auto elem : *mesh)
+    {
+        if (elem.first == "vertices" || elem.first == "face_indices")
+        {
+            continue;
+        }
+        if (elem.second.is_type<unsigned char>())
+        {
+            addChunkChannel<unsigned char>(chunk, elem.first, elem.second, numOriginalVertices, numOriginalFaces, vertexRows, faceRows);
+        }
+        else if (elem.second.is_type<unsigned int>())
+        {
+            addChunkChannel<unsigned int>(chunk, elem.first, elem.second, numOriginalVertices, numOriginalFaces, vertexRows, faceRows);
+        }
+        else if (elem.second.is_type<float>())
+        {
+            addChunkChannel<float>(chunk, elem.first, elem.second, numOriginalVertices, numOriginalFaces, vertexRows, faceRows);
+        }
     }
+
+    chunk->setVertices(chunkPositions, numVertices);
+    chunk->setFaceIndices(chunkFaceIndices, numChunkFaces);
+
+    chunk->addAtomic<unsigned int>(numDuplicates, "num_duplicates");
+
+    return chunk;
 }
 
 void ChunkManager::buildChunks(MeshBufferPtr mesh,
@@ -654,90 +927,568 @@ void ChunkManager::buildChunks(MeshBufferPtr mesh,
                                std::string savePath,
                                std::string layer)
 {
-    std::vector<ChunkBuilderPtr> chunkBuilders(getChunkAmount().x * getChunkAmount().y
-                                               * getChunkAmount().z);
+    const size_t numOriginalVertices = mesh->numVertices();
+    const size_t numOriginalFaces    = mesh->numFaces();
+
+    const float* vertices     = mesh->getVertices().get();
+    const unsigned int* faces = mesh->getFaceIndices().get();
+    size_t numVertices        = numOriginalVertices;
+    size_t numFaces           = numOriginalFaces;
+
+    // prepare mesh to prevent faces from overlapping too much on chunk borders. The copies are
+    // released again if no face had to be cut
+    std::vector<float> cutVertices(vertices, vertices + numVertices * 3);
+    std::vector<unsigned int> cutFaces(faces, faces + numFaces * 3);
+    std::vector<unsigned int> vertexSources;
+    std::vector<unsigned int> faceSources;
+    if (cutLargeFaces(cutVertices, cutFaces, vertexSources, faceSources,
+                      numOriginalVertices, numOriginalFaces, maxChunkOverlap))
+    {
+        vertices    = cutVertices.data();
+        faces       = cutFaces.data();
+        numVertices = cutVertices.size() / 3;
+        numFaces    = cutFaces.size() / 3;
+    }
+    else
+    {
+        std::vector<float>().swap(cutVertices);
+        std::vector<unsigned int>().swap(cutFaces);
+    }
 
-    std::shared_ptr<HalfEdgeMesh<BaseVector<float>>> halfEdgeMesh
-        = std::shared_ptr<HalfEdgeMesh<BaseVector<float>>>(
-            new HalfEdgeMesh<BaseVector<float>>(mesh));
+    const BaseVector<std::size_t>& amount = getChunkAmount();
+    const size_t numChunks = amount.x * amount.y * amount.z;
+    const BaseVector<int> minIndex = getChunkMinChunkIndex();
+    const BaseVector<int> maxIndex = getChunkMaxChunkIndex();
 
-    // map from new indices to old indices to allow attributes for cut faces
-    std::shared_ptr<std::unordered_map<unsigned int, unsigned int>> splitVertices(
-        new std::unordered_map<unsigned int, unsigned int>);
-    std::shared_ptr<std::unordered_map<unsigned int, unsigned int>> splitFaces(
-        new std::unordered_map<unsigned int, unsigned int>);
+    // chunk of every face, determined by its center point
+    std::vector<size_t> faceChunks(numFaces);
+    #pragma omp parallel for schedule(static)
+    for (size_t face = 0; face < numFaces; face++)
+    {
+        BaseVector<float> center(0, 0, 0);
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            const float* v = vertices + faces[face * 3 + j] * 3;
+            center += BaseVector<float>(v[0], v[1], v[2]);
+        }
+        BaseVector<int> cell = getCellCoordinates(center / 3);
+        cell.x = std::min(std::max(cell.x, minIndex.x), maxIndex.x - 1);
+        cell.y = std::min(std::max(cell.y, minIndex.y), maxIndex.y - 1);
+        cell.z = std::min(std::max(cell.z, minIndex.z), maxIndex.z - 1);
+        faceChunks[face] = hashValue(cell.x, cell.y, cell.z);
+    }
 
-    // prepare mash to prevent faces from overlapping too much on chunk borders
-    cutLargeFaces(halfEdgeMesh, maxChunkOverlap, splitVertices, splitFaces);
+    // counting sort of the faces by chunk
+    std::vector<size_t> chunkOffsets(numChunks + 1, 0);
+    for (size_t face = 0; face < numFaces; face++)
+    {
+        chunkOffsets[faceChunks[face] + 1]++;
+    }
+    std::vector<size_t> usedChunks;
+    for (size_t chunk = 0; chunk < numChunks; chunk++)
+    {
+        if (chunkOffsets[chunk + 1] > 0)
+        {
+            usedChunks.push_back(chunk);
+        }
+        chunkOffsets[chunk + 1] += chunkOffsets[chunk];
+    }
+    std::vector<unsigned int> sortedFaces(numFaces);
+    {
+        std::vector<size_t> next(chunkOffsets.begin(), chunkOffsets.end() - 1);
+        for (size_t face = 0; face < numFaces; face++)
+        {
+            sortedFaces[next[faceChunks[face]]++] = face;
+        }
+    }
+    std::vector<size_t>().swap(faceChunks);
 
-    // one vector of variable size for each vertex - this is used for duplicate detection
-    std::shared_ptr<std::unordered_map<unsigned int, std::vector<std::weak_ptr<ChunkBuilder>>>>
-        vertexUse(new std::unordered_map<unsigned int, std::vector<std::weak_ptr<ChunkBuilder>>>());
+    // the first chunk that uses a vertex claims it, any other chunk marks it as shared
+    std::vector<std::atomic<unsigned int>> vertexChunks(numVertices);
+    #pragma omp parallel for schedule(static)
+    for (size_t vertex = 0; vertex < numVertices; vertex++)
+    {
+        vertexChunks[vertex].store(UNUSED_VERTEX, std::memory_order_relaxed);
+    }
 
-    for (int i = getChunkMinChunkIndex().x; i < getChunkMaxChunkIndex().x; i++)
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < usedChunks.size(); i++)
     {
-        for (int j = getChunkMinChunkIndex().y; j < getChunkMaxChunkIndex().y; j++)
+        const unsigned int id = i;
+        size_t chunk = usedChunks[i];
+        for (size_t j = chunkOffsets[chunk]; j < chunkOffsets[chunk + 1]; j++)
         {
-            for (int k = getChunkMinChunkIndex().z; k < getChunkMaxChunkIndex().z; k++)
+            for (unsigned int k = 0; k < 3; k++)
             {
-                chunkBuilders[hashValue(i, j, k)]
-                    = ChunkBuilderPtr(new ChunkBuilder(halfEdgeMesh, vertexUse));
+                std::atomic<unsigned int>& owner = vertexChunks[faces[sortedFaces[j] * 3 + k]];
+                unsigned int current = owner.load(std::memory_order_relaxed);
+                while (current != id && current != SHARED_VERTEX)
+                {
+                    unsigned int desired = current == UNUSED_VERTEX ? id : SHARED_VERTEX;
+                    if (owner.compare_exchange_weak(current, desired, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
             }
         }
     }
 
-    // assign the faces to the chunks
-    BaseVector<float> currentCenterPoint;
-    MeshHandleIteratorPtr<FaceHandle> iterator = halfEdgeMesh->facesBegin();
-    for (size_t i = 0; i < halfEdgeMesh->numFaces(); i++)
+    // build the chunks in parallel, HDF5 access is serialized
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < usedChunks.size(); i++)
     {
-        currentCenterPoint             = getFaceCenter(halfEdgeMesh, *iterator);
-        BaseVector<int> cellCorrdinate = getCellCoordinates(currentCenterPoint);
-        size_t hash = hashValue(cellCorrdinate.x, cellCorrdinate.y, cellCorrdinate.z);
+        size_t chunk = usedChunks[i];
+        MeshBufferPtr chunkMeshPtr = buildChunkMesh(mesh,
+                                                    vertices,
+                                                    faces,
+                                                    vertexSources,
+                                                    faceSources,
+                                                    sortedFaces.data() + chunkOffsets[chunk],
+                                                    chunkOffsets[chunk + 1] - chunkOffsets[chunk],
+                                                    vertexChunks);
+
+        int x = chunk / (amount.y * amount.z) + minIndex.x;
+        int y = (chunk / amount.z) % amount.y + minIndex.y;
+        int z = chunk % amount.z + minIndex.z;
+
+        #pragma omp critical(chunkManagerIO)
+        {
+            // write chunk in hdf5
+            setChunk<MeshBufferPtr>(layer, x, y, z, chunkMeshPtr);
+        }
+    }
+}
 
-        chunkBuilders[hash]->addFace(*iterator);
+std::string ChunkManager::getLevelOfDetailLayer(const std::string& layer, size_t lod)
+{
+    return lod == 0 ? layer : layer + "/lod_" + std::to_string(lod);
+}
 
-        ++iterator;
+BaseVector<std::size_t> ChunkManager::getLevelOfDetailAmount(size_t lod) const
+{
+    const BaseVector<std::size_t>& amount = getChunkAmount();
+    return BaseVector<std::size_t>(((amount.x - 1) >> lod) + 1,
+                                   ((amount.y - 1) >> lod) + 1,
+                                   ((amount.z - 1) >> lod) + 1);
+}
+
+size_t ChunkManager::getNumLevelsOfDetail(std::string layer)
+{
+    return std::max<size_t>(getLevelOfDetailErrors(layer).size(), 1);
+}
+
+size_t ChunkManager::selectLevelOfDetail(float distance,
+                                         float projectionScale,
+                                         float maxScreenError,
+                                         std::string layer)
+{
+    const std::vector<float>& errors = getLevelOfDetailErrors(layer);
+
+    size_t lod = 0;
+    while (lod + 1 < errors.size() && errors[lod + 1] * projectionScale <= maxScreenError * distance)
+    {
+        lod++;
     }
+    return lod;
+}
 
-    // save the chunks as .ply
-    for (int i = getChunkMinChunkIndex().x; i < getChunkMaxChunkIndex().x; i++)
+void ChunkManager::extractArea(const BoundingBox<BaseVector<float>>& area,
+                               std::unordered_map<std::size_t, MeshBufferPtr>& chunks,
+                               std::string layer,
+                               size_t lod)
+{
+    const BaseVector<int> minIndex = getChunkMinChunkIndex();
+    const BaseVector<int> maxIndex = getChunkMaxChunkIndex();
+
+    // index range of the full resolution chunks inside the area
+    auto clampIndex = [&](BaseVector<int> index) {
+        index.x = std::min(std::max(index.x, minIndex.x), maxIndex.x - 1);
+        index.y = std::min(std::max(index.y, minIndex.y), maxIndex.y - 1);
+        index.z = std::min(std::max(index.z, minIndex.z), maxIndex.z - 1);
+        return index;
+    };
+    const BaseVector<int> first = clampIndex(getCellCoordinates(area.getMin()));
+    const BaseVector<int> last  = clampIndex(getCellCoordinates(area.getMax()));
+
+    // cell n of a level of detail is stored at the chunk coordinates minIndex + n
+    const std::string lodLayer = getLevelOfDetailLayer(layer, lod);
+    for (int i = (first.x - minIndex.x) >> lod; i <= (last.x - minIndex.x) >> lod; i++)
     {
-        for (int j = getChunkMinChunkIndex().y; j < getChunkMaxChunkIndex().y; j++)
+        for (int j = (first.y - minIndex.y) >> lod; j <= (last.y - minIndex.y) >> lod; j++)
         {
-            for (int k = getChunkMinChunkIndex().z; k < getChunkMaxChunkIndex().z; k++)
+            for (int k = (first.z - minIndex.z) >> lod; k <= (last.z - minIndex.z) >> lod; k++)
             {
-                std::size_t hash = hashValue(i, j, k);
-
-                if (chunkBuilders[hash]->numFaces() > 0)
+                boost::optional<MeshBufferPtr> loadedChunk = getChunk<MeshBufferPtr>(
+                    lodLayer, minIndex.x + i, minIndex.y + j, minIndex.z + k);
+                if (loadedChunk)
                 {
-                    // std::cout << "writing " << i << " " << j << " " << k << std::endl;
+                    chunks.insert(
+                        {hashValue(minIndex.x + i, minIndex.y + j, minIndex.z + k), *loadedChunk});
+                }
+            }
+        }
+    }
+}
+
+MeshBufferPtr ChunkManager::extractArea(const BoundingBox<BaseVector<float>>& area,
+                                        std::string layer,
+                                        size_t lod)
+{
+    std::unordered_map<std::size_t, MeshBufferPtr> chunks;
+    extractArea(area, chunks, layer, lod);
+
+    return combineChunks(chunks);
+}
+
+void ChunkManager::buildLevelsOfDetail(std::string layer, unsigned int resolution, size_t levels)
+{
+    // by default, the coarsest level consists of a single cell
+    if (levels == 0)
+    {
+        const BaseVector<std::size_t>& amount = getChunkAmount();
+        size_t maxAmount = std::max(amount.x, std::max(amount.y, amount.z));
+        while (((maxAmount - 1) >> levels) > 0)
+        {
+            levels++;
+        }
+    }
 
-                    // get mesh of chunk from chunk builder
-                    MeshBufferPtr chunkMeshPtr
-                        = chunkBuilders[hash]->buildMesh(mesh, splitVertices, splitFaces);
+    const BaseVector<int> minIndex = getChunkMinChunkIndex();
+    std::vector<float> errors(1, 0.0f);
 
-                    // export chunked meshes for debugging
-                    // ModelFactory::saveModel(ModelPtr(new Model(chunkMeshPtr)),
-                    //                        savePath + "/" + std::to_string(i) + "-"
-                    //                            + std::to_string(j) + "-" + std::to_string(k)
-                    //                            + ".ply");
-                    // write chunk in hdf5
-                    setChunk<MeshBufferPtr>(layer, i, j, k, chunkMeshPtr);
+    for (size_t lod = 1; lod <= levels; lod++)
+    {
+        const std::string childLayer              = getLevelOfDetailLayer(layer, lod - 1);
+        const std::string lodLayer                = getLevelOfDetailLayer(layer, lod);
+        const BaseVector<std::size_t> childAmount = getLevelOfDetailAmount(lod - 1);
+        const BaseVector<std::size_t> lodAmount   = getLevelOfDetailAmount(lod);
+        const size_t numCells                     = lodAmount.x * lodAmount.y * lodAmount.z;
+
+        auto cellIndex = [&](size_t cell) {
+            return BaseVector<int>(cell / (lodAmount.y * lodAmount.z),
+                                   (cell / lodAmount.z) % lodAmount.y,
+                                   cell % lodAmount.z);
+        };
+
+        // the up to eight chunks of the previous level covered by a cell. HDF5 access is serialized
+        auto loadChildren = [&](size_t cell) {
+            BaseVector<int> index = cellIndex(cell);
+            std::vector<MeshBufferPtr> children;
+            for (int i = index.x * 2; i < std::min<int>(index.x * 2 + 2, childAmount.x); i++)
+            {
+                for (int j = index.y * 2; j < std::min<int>(index.y * 2 + 2, childAmount.y); j++)
+                {
+                    for (int k = index.z * 2; k < std::min<int>(index.z * 2 + 2, childAmount.z); k++)
+                    {
+                        boost::optional<MeshBufferPtr> child;
+                        #pragma omp critical(chunkManagerIO)
+                        child = getChunk<MeshBufferPtr>(
+                            childLayer, minIndex.x + i, minIndex.y + j, minIndex.z + k);
+                        if (child && (*child)->numFaces() > 0)
+                        {
+                            children.push_back(*child);
+                        }
+                    }
+                }
+            }
+            return children;
+        };
 
-                    chunkBuilders[hash] = nullptr; // deallocate
+        // vertices that are shared between different cells of this level stay locked
+        std::vector<std::vector<std::array<float, 3>>> cellDuplicates(numCells);
+        #pragma omp parallel for schedule(dynamic)
+        for (size_t cell = 0; cell < numCells; cell++)
+        {
+            std::vector<std::array<float, 3>>& duplicates = cellDuplicates[cell];
+            for (const MeshBufferPtr& child : loadChildren(cell))
+            {
+                floatArr vertices = child->getVertices();
+                for (size_t v = 0; v < getNumDuplicates(child); v++)
+                {
+                    duplicates.push_back({vertices[v * 3], vertices[v * 3 + 1], vertices[v * 3 + 2]});
                 }
             }
+            std::sort(duplicates.begin(), duplicates.end());
+            duplicates.erase(std::unique(duplicates.begin(), duplicates.end()), duplicates.end());
+        }
+
+        std::vector<std::array<float, 3>> duplicates;
+        for (std::vector<std::array<float, 3>>& cell : cellDuplicates)
+        {
+            duplicates.insert(duplicates.end(), cell.begin(), cell.end());
+            std::vector<std::array<float, 3>>().swap(cell);
+        }
+        std::sort(duplicates.begin(), duplicates.end());
+
+        std::vector<std::array<float, 3>> borderVertices;
+        for (size_t i = 1; i < duplicates.size(); i++)
+        {
+            if (duplicates[i] == duplicates[i - 1]
+                && (borderVertices.empty() || borderVertices.back() != duplicates[i]))
+            {
+                borderVertices.push_back(duplicates[i]);
+            }
         }
+        std::vector<std::array<float, 3>>().swap(duplicates);
+
+        // merge and simplify the cells in parallel
+        const float clusterSize = std::ldexp(getChunkSize(), lod) / resolution;
+        float maxDisplacement   = 0.0f;
+        #pragma omp parallel for schedule(dynamic) reduction(max : maxDisplacement)
+        for (size_t cell = 0; cell < numCells; cell++)
+        {
+            std::vector<MeshBufferPtr> children = loadChildren(cell);
+            if (children.empty())
+            {
+                continue;
+            }
+
+            float displacement     = 0.0f;
+            MeshBufferPtr lodChunk = buildLevelOfDetailChunk(children, borderVertices, clusterSize, displacement);
+            maxDisplacement        = std::max(maxDisplacement, displacement);
+            if (lodChunk->numFaces() == 0)
+            {
+                continue;
+            }
+
+            BaseVector<int> index = cellIndex(cell);
+            #pragma omp critical(chunkManagerIO)
+            setChunk<MeshBufferPtr>(
+                lodLayer, minIndex.x + index.x, minIndex.y + index.y, minIndex.z + index.z, lodChunk);
+        }
+
+        // the errors of the levels add up
+        errors.push_back(errors.back() + maxDisplacement);
+
+        std::cout << timestamp << "Built level of detail " << lod << " of layer '" << layer
+                  << "' with a geometric error of " << errors.back() << std::endl;
     }
+
+    setLevelOfDetailErrors(layer, errors);
 }
 
-BaseVector<float> ChunkManager::getFaceCenter(std::shared_ptr<HalfEdgeMesh<BaseVector<float>>> mesh,
-                                              const FaceHandle& handle) const
+MeshBufferPtr ChunkManager::buildLevelOfDetailChunk(const std::vector<MeshBufferPtr>& children,
+                                                    const std::vector<std::array<float, 3>>& borderVertices,
+                                                    float clusterSize,
+                                                    float& maxDisplacement) const
 {
-    return (mesh->getVertexPositionsOfFace(handle)[0] + mesh->getVertexPositionsOfFace(handle)[1]
-            + mesh->getVertexPositionsOfFace(handle)[2])
-           / 3;
+    // merge the children, vertices shared between them are only added once. Sources are pairs of
+    // child and row in the child
+    std::vector<std::array<float, 3>> positions;
+    std::vector<bool> locked;
+    std::vector<std::pair<unsigned int, unsigned int>> vertexSources;
+    std::vector<unsigned int> faces;
+    std::vector<std::pair<unsigned int, unsigned int>> faceSources;
+    std::map<std::array<float, 3>, unsigned int> sharedVertices;
+
+    for (unsigned int c = 0; c < children.size(); c++)
+    {
+        const MeshBufferPtr& child   = children[c];
+        floatArr childVertices       = child->getVertices();
+        indexArray childFaces        = child->getFaceIndices();
+        const size_t numDuplicates   = getNumDuplicates(child);
+        std::vector<unsigned int> indices(child->numVertices());
+
+        for (unsigned int v = 0; v < child->numVertices(); v++)
+        {
+            std::array<float, 3> position
+                = {childVertices[v * 3], childVertices[v * 3 + 1], childVertices[v * 3 + 2]};
+            if (v < numDuplicates)
+            {
+                auto inserted = sharedVertices.emplace(position, positions.size());
+                indices[v]    = inserted.first->second;
+                if (!inserted.second)
+                {
+                    continue;
+                }
+                locked.push_back(
+                    std::binary_search(borderVertices.begin(), borderVertices.end(), position));
+            }
+            else
+            {
+                indices[v] = positions.size();
+                locked.push_back(false);
+            }
+            positions.push_back(position);
+            vertexSources.push_back({c, v});
+        }
+
+        for (unsigned int f = 0; f < child->numFaces(); f++)
+        {
+            for (unsigned int j = 0; j < 3; j++)
+            {
+                faces.push_back(indices[childFaces[f * 3 + j]]);
+            }
+            faceSources.push_back({c, f});
+        }
+    }
+
+    // cluster the unlocked vertices. The member closest to the mean of a cluster replaces the others
+    const size_t numVertices = positions.size();
+    std::vector<unsigned int> replacement(numVertices);
+    std::vector<std::pair<std::array<long long, 3>, unsigned int>> clusters;
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+        replacement[v] = v;
+        if (!locked[v])
+        {
+            clusters.push_back({{static_cast<long long>(std::floor(positions[v][0] / clusterSize)),
+                                 static_cast<long long>(std::floor(positions[v][1] / clusterSize)),
+                                 static_cast<long long>(std::floor(positions[v][2] / clusterSize))},
+                                v});
+        }
+    }
+    std::sort(clusters.begin(), clusters.end());
+
+    auto distance2 = [](const std::array<float, 3>& a, const std::array<float, 3>& b) {
+        return (a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1])
+               + (a[2] - b[2]) * (a[2] - b[2]);
+    };
+
+    maxDisplacement = 0.0f;
+    for (size_t first = 0, last = 0; first < clusters.size(); first = last)
+    {
+        std::array<float, 3> mean = {0.0f, 0.0f, 0.0f};
+        for (last = first; last < clusters.size() && clusters[last].first == clusters[first].first; last++)
+        {
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                mean[axis] += positions[clusters[last].second][axis];
+            }
+        }
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            mean[axis] /= last - first;
+        }
+
+        unsigned int representative = clusters[first].second;
+        for (size_t i = first + 1; i < last; i++)
+        {
+            if (distance2(positions[clusters[i].second], mean) < distance2(positions[representative], mean))
+            {
+                representative = clusters[i].second;
+            }
+        }
+        for (size_t i = first; i < last; i++)
+        {
+            replacement[clusters[i].second] = representative;
+            maxDisplacement = std::max(maxDisplacement,
+                std::sqrt(distance2(positions[clusters[i].second], positions[representative])));
+        }
+    }
+
+    // remove collapsed and duplicated faces, the remaining faces keep their orientation
+    std::vector<std::pair<std::array<unsigned int, 3>, unsigned int>> lodFaces;
+    for (unsigned int f = 0; f < faceSources.size(); f++)
+    {
+        unsigned int a = replacement[faces[f * 3]];
+        unsigned int b = replacement[faces[f * 3 + 1]];
+        unsigned int c = replacement[faces[f * 3 + 2]];
+        if (a == b || b == c || a == c)
+        {
+            continue;
+        }
+
+        if (b < a && b < c)
+        {
+            lodFaces.push_back({{b, c, a}, f});
+        }
+        else if (c < a && c < b)
+        {
+            lodFaces.push_back({{c, a, b}, f});
+        }
+        else
+        {
+            lodFaces.push_back({{a, b, c}, f});
+        }
+    }
+    std::sort(lodFaces.begin(), lodFaces.end());
+    lodFaces.erase(std::unique(lodFaces.begin(),
+                               lodFaces.end(),
+                               [](const std::pair<std::array<unsigned int, 3>, unsigned int>& l,
+                                  const std::pair<std::array<unsigned int, 3>, unsigned int>& r) {
+                                   return l.first == r.first;
+                               }),
+                   lodFaces.end());
+
+    // locked vertices are shared with other cells and therefore stored first
+    std::vector<unsigned int> lodIndices(numVertices, UNUSED_VERTEX);
+    for (const auto& face : lodFaces)
+    {
+        for (unsigned int v : face.first)
+        {
+            lodIndices[v] = 0;
+        }
+    }
+    unsigned int numLodVertices = 0;
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+        if (lodIndices[v] != UNUSED_VERTEX && locked[v])
+        {
+            lodIndices[v] = numLodVertices++;
+        }
+    }
+    const unsigned int numDuplicates = numLodVertices;
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+        if (lodIndices[v] != UNUSED_VERTEX && !locked[v])
+        {
+            lodIndices[v] = numLodVertices++;
+        }
+    }
+
+    floatArr lodVertices(new float[numLodVertices * 3]);
+    std::vector<std::pair<unsigned int, unsigned int>> lodVertexSources(numLodVertices);
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+        if (lodIndices[v] != UNUSED_VERTEX)
+        {
+            std::copy(positions[v].begin(), positions[v].end(), lodVertices.get() + lodIndices[v] * 3);
+            lodVertexSources[lodIndices[v]] = vertexSources[v];
+        }
+    }
+
+    indexArray lodFaceIndices(new unsigned int[lodFaces.size() * 3]);
+    std::vector<std::pair<unsigned int, unsigned int>> lodFaceSources(lodFaces.size());
+    for (size_t f = 0; f < lodFaces.size(); f++)
+    {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            lodFaceIndices[f * 3 + j] = lodIndices[lodFaces[f].first[j]];
+        }
+        lodFaceSources[f] = faceSources[lodFaces[f].second];
+    }
+
+    MeshBufferPtr lodChunk(new MeshBuffer);
+
+    // TODO: add more types if needed
+    for (auto elem : *children[0])
+    {
+        if (elem.first == "vertices" || elem.first == "face_indices" || elem.first == "num_duplicates")
+        {
+            continue;
+        }
+        if (elem.second.is_type<unsigned char>())
+        {
+            addMergedChannel<unsigned char>(lodChunk, elem.first, children, lodVertexSources, lodFaceSources);
+        }
+        else if (elem.second.is_type<unsigned int>())
+        {
+            addMergedChannel<unsigned int>(lodChunk, elem.first, children, lodVertexSources, lodFaceSources);
+        }
+        else if (elem.second.is_type<float>())
+        {
+            addMergedChannel<float>(lodChunk, elem.first, children, lodVertexSources, lodFaceSources);
+        }
+    }
+
+    lodChunk->setVertices(lodVertices, numLodVertices);
+    lodChunk->setFaceIndices(lodFaceIndices, lodFaces.size());
+
+    lodChunk->addAtomic<unsigned int>(numDuplicates, "num_duplicates");
+
+    return lodChunk;
 }
 
 BaseVector<int> ChunkManager::getCellCoordinates(const BaseVector<float>& vec) const
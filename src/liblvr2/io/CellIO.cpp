@@ -0,0 +1,389 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * CellIO.cpp
+ *
+ *  @date 18.10.2026
+ */
+
+#include "lvr2/io/CellIO.hpp"
+
+#include <lz4.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace lvr2
+{
+
+namespace
+{
+
+const char CELL_FILE_MAGIC[8] = { 'L', 'V', 'R', 'C', 'E', 'L', 'L', 'S' };
+
+/// Encodings of a column
+enum CellColumnEncoding : uint32_t
+{
+    /// Plain little endian array
+    CELL_COLUMN_RAW = 0,
+
+    /// Byte-shuffled floats, compressed with LZ4 in independent blocks
+    CELL_COLUMN_SHUFFLED_LZ4 = 1
+};
+
+struct CellFileColumn
+{
+    uint32_t encoding;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct CellFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t numColumns;
+    uint64_t numCells;
+    CellFileColumn columns[3];
+};
+
+static_assert(sizeof(CellFileHeader) == 96, "Unexpected padding in cell file header");
+
+/// Order of the columns in the header
+enum CellFileColumnIndex
+{
+    CENTER_COLUMN = 0,
+    EXTRUDED_COLUMN = 1,
+    DISTANCE_COLUMN = 2
+};
+
+/// Size of one record in the legacy format: center, extrusion flag, distances
+constexpr size_t LEGACY_RECORD_SIZE = 3 * sizeof(float) + sizeof(bool) + 8 * sizeof(float);
+
+/// Number of floats compressed in one independent block (16 MiB)
+constexpr size_t COMPRESSION_BLOCK_FLOATS = 1 << 22;
+
+/**
+ * @brief Compresses `n` floats. The result starts with the number of blocks
+ *        and a table of (raw size, compressed size) pairs, followed by the
+ *        compressed blocks.
+ */
+std::vector<char> compressFloats(const float* values, size_t n)
+{
+    const size_t numBlocks = (n + COMPRESSION_BLOCK_FLOATS - 1) / COMPRESSION_BLOCK_FLOATS;
+    std::vector<std::vector<char>> blocks(numBlocks);
+    std::vector<uint32_t> table(2 * numBlocks);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long b = 0; b < static_cast<long>(numBlocks); b++)
+    {
+        const size_t begin = b * COMPRESSION_BLOCK_FLOATS;
+        const size_t count = std::min(COMPRESSION_BLOCK_FLOATS, n - begin);
+        const int rawBytes = static_cast<int>(count * sizeof(float));
+
+        // Group the k-th bytes of all floats, which makes exponents and
+        // high mantissa bytes of similar values compressible.
+        std::vector<char> shuffled(rawBytes);
+        const char* bytes = reinterpret_cast<const char*>(values + begin);
+        for (size_t i = 0; i < count; i++)
+        {
+            for (size_t k = 0; k < sizeof(float); k++)
+            {
+                shuffled[k * count + i] = bytes[i * sizeof(float) + k];
+            }
+        }
+
+        blocks[b].resize(LZ4_compressBound(rawBytes));
+        int compressedBytes = LZ4_compress_default(
+            shuffled.data(), blocks[b].data(), rawBytes, static_cast<int>(blocks[b].size())
+        );
+        blocks[b].resize(compressedBytes);
+        table[2 * b] = rawBytes;
+        table[2 * b + 1] = compressedBytes;
+    }
+
+    std::vector<char> out(sizeof(uint64_t) + table.size() * sizeof(uint32_t));
+    uint64_t blockCount = numBlocks;
+    std::memcpy(out.data(), &blockCount, sizeof(uint64_t));
+    std::memcpy(out.data() + sizeof(uint64_t), table.data(), table.size() * sizeof(uint32_t));
+    for (auto& block: blocks)
+    {
+        out.insert(out.end(), block.begin(), block.end());
+    }
+    return out;
+}
+
+/// Inverse of compressFloats()
+void decompressFloats(const char* data, size_t size, size_t n, std::vector<float>& values)
+{
+    uint64_t numBlocks;
+    if (size < sizeof(uint64_t))
+    {
+        throw std::runtime_error("CellFileReader: truncated compressed column");
+    }
+    std::memcpy(&numBlocks, data, sizeof(uint64_t));
+
+    const size_t tableBytes = numBlocks * 2 * sizeof(uint32_t);
+    if (size < sizeof(uint64_t) + tableBytes)
+    {
+        throw std::runtime_error("CellFileReader: truncated compressed column");
+    }
+    std::vector<uint32_t> table(2 * numBlocks);
+    std::memcpy(table.data(), data + sizeof(uint64_t), tableBytes);
+
+    // Offsets of all blocks within the column
+    std::vector<size_t> offsets(numBlocks + 1);
+    offsets[0] = sizeof(uint64_t) + tableBytes;
+    size_t numValues = 0;
+    for (size_t b = 0; b < numBlocks; b++)
+    {
+        offsets[b + 1] = offsets[b] + table[2 * b + 1];
+        numValues += table[2 * b] / sizeof(float);
+    }
+    if (offsets[numBlocks] > size || numValues != n)
+    {
+        throw std::runtime_error("CellFileReader: malformed compressed column");
+    }
+
+    values.resize(n);
+    bool valid = true;
+
+    #pragma omp parallel for schedule(dynamic, 1) reduction(&&: valid)
+    for (long b = 0; b < static_cast<long>(numBlocks); b++)
+    {
+        const size_t begin = b * COMPRESSION_BLOCK_FLOATS;
+        const size_t count = table[2 * b] / sizeof(float);
+        std::vector<char> shuffled(table[2 * b]);
+
+        int decoded = LZ4_decompress_safe(
+            data + offsets[b], shuffled.data(), table[2 * b + 1], table[2 * b]
+        );
+        if (decoded != static_cast<int>(table[2 * b]) || begin + count > n)
+        {
+            valid = false;
+            continue;
+        }
+
+        char* bytes = reinterpret_cast<char*>(values.data() + begin);
+        for (size_t i = 0; i < count; i++)
+        {
+            for (size_t k = 0; k < sizeof(float); k++)
+            {
+                bytes[i * sizeof(float) + k] = shuffled[k * count + i];
+            }
+        }
+    }
+
+    if (!valid)
+    {
+        throw std::runtime_error("CellFileReader: corrupt compressed column");
+    }
+}
+
+} // anonymous namespace
+
+void writeCellFile(
+    const std::string& filename,
+    size_t numCells,
+    const float* centers,
+    const unsigned char* extruded,
+    const float* distances,
+    bool compress)
+{
+    std::vector<char> compressedCenters;
+    std::vector<char> compressedDistances;
+    if (compress)
+    {
+        compressedCenters = compressFloats(centers, 3 * numCells);
+        compressedDistances = compressFloats(distances, 8 * numCells);
+    }
+
+    CellFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CELL_FILE_MAGIC, sizeof(header.magic));
+    header.version = CELL_FILE_VERSION;
+    header.numColumns = 3;
+    header.numCells = numCells;
+
+    const uint32_t floatEncoding = compress ? CELL_COLUMN_SHUFFLED_LZ4 : CELL_COLUMN_RAW;
+
+    CellFileColumn& centerColumn = header.columns[CENTER_COLUMN];
+    centerColumn.encoding = floatEncoding;
+    centerColumn.offset = sizeof(CellFileHeader);
+    centerColumn.size = compress ? compressedCenters.size() : 3 * numCells * sizeof(float);
+
+    CellFileColumn& extrudedColumn = header.columns[EXTRUDED_COLUMN];
+    extrudedColumn.encoding = CELL_COLUMN_RAW;
+    extrudedColumn.offset = centerColumn.offset + centerColumn.size;
+    extrudedColumn.size = numCells;
+
+    // Keep the distances aligned, so that they can be used in place
+    CellFileColumn& distanceColumn = header.columns[DISTANCE_COLUMN];
+    distanceColumn.encoding = floatEncoding;
+    distanceColumn.offset = (extrudedColumn.offset + extrudedColumn.size + 7) & ~uint64_t(7);
+    distanceColumn.size = compress ? compressedDistances.size() : 8 * numCells * sizeof(float);
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    const char padding[8] = { 0 };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (compress)
+    {
+        out.write(compressedCenters.data(), compressedCenters.size());
+    }
+    else
+    {
+        out.write(reinterpret_cast<const char*>(centers), centerColumn.size);
+    }
+    out.write(reinterpret_cast<const char*>(extruded), extrudedColumn.size);
+    out.write(padding, distanceColumn.offset - extrudedColumn.offset - extrudedColumn.size);
+    if (compress)
+    {
+        out.write(compressedDistances.data(), compressedDistances.size());
+    }
+    else
+    {
+        out.write(reinterpret_cast<const char*>(distances), distanceColumn.size);
+    }
+
+    if (!out.good())
+    {
+        throw std::runtime_error("writeCellFile: unable to write " + filename);
+    }
+}
+
+CellFileReader::CellFileReader(const std::string& filename)
+    : m_numCells(0),
+      m_version(0),
+      m_centers(nullptr),
+      m_extruded(nullptr),
+      m_distances(nullptr)
+{
+    try
+    {
+        m_file.open(filename);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error("CellFileReader: unable to open " + filename + ": " + e.what());
+    }
+
+    const char* data = m_file.data();
+    const size_t size = m_file.size();
+
+    if (size < sizeof(CellFileHeader) || std::memcmp(data, CELL_FILE_MAGIC, sizeof(CELL_FILE_MAGIC)) != 0)
+    {
+        readLegacy(data, size);
+        return;
+    }
+
+    CellFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version > CELL_FILE_VERSION || header.numColumns != 3)
+    {
+        throw std::runtime_error("CellFileReader: unsupported version of " + filename);
+    }
+
+    m_version = header.version;
+    m_numCells = header.numCells;
+
+    for (auto& column: header.columns)
+    {
+        if (column.offset > size || column.size > size - column.offset)
+        {
+            throw std::runtime_error("CellFileReader: truncated file " + filename);
+        }
+    }
+
+    auto readFloats = [&](const CellFileColumn& column, size_t n, std::vector<float>& buffer)
+    {
+        if (column.encoding == CELL_COLUMN_SHUFFLED_LZ4)
+        {
+            decompressFloats(data + column.offset, column.size, n, buffer);
+            return static_cast<const float*>(buffer.data());
+        }
+        if (column.encoding != CELL_COLUMN_RAW || column.size != n * sizeof(float) || column.offset % sizeof(float))
+        {
+            throw std::runtime_error("CellFileReader: malformed column in " + filename);
+        }
+        return reinterpret_cast<const float*>(data + column.offset);
+    };
+
+    m_centers = readFloats(header.columns[CENTER_COLUMN], 3 * m_numCells, m_centerBuffer);
+    m_distances = readFloats(header.columns[DISTANCE_COLUMN], 8 * m_numCells, m_distanceBuffer);
+
+    const CellFileColumn& extrudedColumn = header.columns[EXTRUDED_COLUMN];
+    if (extrudedColumn.encoding != CELL_COLUMN_RAW || extrudedColumn.size != m_numCells)
+    {
+        throw std::runtime_error("CellFileReader: malformed column in " + filename);
+    }
+    m_extruded = reinterpret_cast<const unsigned char*>(data + extrudedColumn.offset);
+}
+
+void CellFileReader::readLegacy(const char* data, size_t size)
+{
+    uint64_t numCells = 0;
+    if (size < sizeof(uint64_t))
+    {
+        throw std::runtime_error("CellFileReader: file too small");
+    }
+    std::memcpy(&numCells, data, sizeof(uint64_t));
+    if ((size - sizeof(uint64_t)) / LEGACY_RECORD_SIZE != numCells)
+    {
+        throw std::runtime_error("CellFileReader: unknown file format");
+    }
+
+    m_version = 0;
+    m_numCells = numCells;
+    m_centerBuffer.resize(3 * m_numCells);
+    m_extrudedBuffer.resize(m_numCells);
+    m_distanceBuffer.resize(8 * m_numCells);
+
+    // Records have a fixed size, so they can be converted independently
+    const char* records = data + sizeof(uint64_t);
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(m_numCells); i++)
+    {
+        const char* record = records + i * LEGACY_RECORD_SIZE;
+        std::memcpy(&m_centerBuffer[3 * i], record, 3 * sizeof(float));
+        bool extruded;
+        std::memcpy(&extruded, record + 3 * sizeof(float), sizeof(bool));
+        m_extrudedBuffer[i] = extruded;
+        std::memcpy(&m_distanceBuffer[8 * i], record + 3 * sizeof(float) + sizeof(bool), 8 * sizeof(float));
+    }
+
+    m_centers = m_centerBuffer.data();
+    m_extruded = m_extrudedBuffer.data();
+    m_distances = m_distanceBuffer.data();
+}
+
+} // namespace lvr2
@@ -32,6 +32,19 @@ int GeoTIFFIO::writeBand(cv::Mat *mat, int band)
         return -1;
     }
 
+    // Continuous 16 bit data can be handed to GDAL as a whole
+    if (mat->isContinuous() && mat->type() == CV_16UC1)
+    {
+        if (m_gtif_dataset->GetRasterBand(band)->RasterIO(
+                GF_Write, 0, 0, m_cols, m_rows, mat->data, m_cols, m_rows, GDT_UInt16, 0, 0) != CPLE_None)
+        {
+            std::cout << timestamp << "An error occurred in GDAL while writing band "
+                << band << "." << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
     uint16_t *rowBuff = (uint16_t *) CPLMalloc(sizeof(uint16_t) * m_cols);
     for (int row = 0; row < m_rows; row++)
     {
@@ -44,9 +57,11 @@ int GeoTIFFIO::writeBand(cv::Mat *mat, int band)
         {
             std::cout << timestamp << "An error occurred in GDAL while writing band "
                 << band << " in row " << row << "." << std::endl;
+            CPLFree(rowBuff);
             return -1;
         }
     }
+    CPLFree(rowBuff);
     return 0;
 }
 
@@ -118,6 +118,22 @@ size_t HDF5IO::chunkSize()
     return m_chunkSize;
 }
 
+std::vector<size_t> HDF5IO::getDimensions(std::string groupName, std::string datasetName)
+{
+    std::vector<size_t> dim;
+
+    if(m_hdf5_file && exist(groupName))
+    {
+        HighFive::Group g = getGroup(groupName, false);
+        if (g.exist(datasetName))
+        {
+            dim = g.getDataSet(datasetName).getSpace().getDimensions();
+        }
+    }
+
+    return dim;
+}
+
 ModelPtr HDF5IO::read(std::string filename)
 {
     open(filename, HighFive::File::ReadOnly);
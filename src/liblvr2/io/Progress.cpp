@@ -37,6 +37,7 @@
 
 #include <sstream>
 #include <iostream>
+#include <cmath>
 
 using std::stringstream;
 using std::cout;
@@ -55,6 +56,7 @@ ProgressBar::ProgressBar(size_t max_val, string prefix)
 	m_maxVal = max_val;
     m_currentVal = 0;
 	m_percent = 0;
+    m_nextUpdateVal = nextUpdateVal();
 
 	if(m_titleCallback)
 	{
@@ -82,35 +84,29 @@ void ProgressBar::setProgressTitleCallback(ProgressTitleCallbackPtr ptr)
 
 void ProgressBar::operator++()
 {
-    boost::mutex::scoped_lock lock(m_mutex);
-
-    m_currentVal++;
-    short difference = (short)((float)m_currentVal/m_maxVal * 100 - m_percent);
-    if (difference < 1)
+    // Fast path: no lock unless the next percent step is reached
+    size_t val = m_currentVal.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (val >= m_nextUpdateVal.load(std::memory_order_relaxed))
     {
-        return;
+        update();
     }
+}
 
-    while (difference >= 1)
+void ProgressBar::operator+=(size_t n)
+{
+    size_t val = m_currentVal.fetch_add(n, std::memory_order_relaxed) + n;
+    if (val >= m_nextUpdateVal.load(std::memory_order_relaxed))
     {
-        m_percent++;
-        difference--;
-        print_bar();
-
-        if(m_progressCallback)
-        {
-        	m_progressCallback(m_percent);
-        }
+        update();
     }
-
 }
 
-void ProgressBar::operator+=(size_t n)
+void ProgressBar::update()
 {
     boost::mutex::scoped_lock lock(m_mutex);
 
-    m_currentVal+= n;
-    short difference = (short)((float)m_currentVal/m_maxVal * 100 - m_percent);
+    size_t val = m_currentVal.load(std::memory_order_relaxed);
+    short difference = (short)((float)val/m_maxVal * 100 - m_percent);
     if (difference < 1)
     {
         return;
@@ -124,10 +120,17 @@ void ProgressBar::operator+=(size_t n)
 
         if(m_progressCallback)
         {
-            m_progressCallback(m_percent);
+        	m_progressCallback(m_percent);
         }
     }
 
+    m_nextUpdateVal.store(nextUpdateVal(), std::memory_order_relaxed);
+}
+
+size_t ProgressBar::nextUpdateVal() const
+{
+    // Smallest counter value for which the next percent step is printed
+    return static_cast<size_t>(std::floor((m_percent + 1) * static_cast<double>(m_maxVal) / 100.0));
 }
 
 void ProgressBar::print_bar()
@@ -144,17 +147,17 @@ ProgressCounter::ProgressCounter(int stepVal, string prefix)
 
 void ProgressCounter::operator++()
 {
-	boost::mutex::scoped_lock lock(m_mutex);
-	m_currentVal++;
-	if(m_currentVal % m_stepVal == 0)
+	size_t val = m_currentVal.fetch_add(1, std::memory_order_relaxed) + 1;
+	if(val % m_stepVal == 0)
 	{
-		print_progress();
+		boost::mutex::scoped_lock lock(m_mutex);
+		print_progress(val);
 	}
 }
 
-void ProgressCounter::print_progress()
+void ProgressCounter::print_progress(size_t val)
 {
-	cout << "\r" << m_prefix << " " << m_currentVal << flush;
+	cout << "\r" << m_prefix << " " << val << flush;
 }
 
 PacmanProgressCallbackPtr PacmanProgressBar::m_progressCallback = 0;
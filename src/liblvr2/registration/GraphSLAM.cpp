@@ -35,6 +35,7 @@
 
 #include <Eigen/SparseCholesky>
 
+#include <algorithm>
 #include <math.h>
 
 using namespace std;
@@ -99,6 +100,68 @@ bool findCloseScans(const vector<SLAMScanPtr>& scans, size_t scan, const SLAMOpt
     return !output.empty();
 }
 
+bool findCloseScans(const vector<SLAMScanPtr>& scans, size_t scan, const SLAMOptions& options, const ScanPoseIndex& index, vector<size_t>& output)
+{
+    if (scan < options.loopSize)
+    {
+        return false;
+    }
+
+    const SLAMScanPtr& cur = scans[scan];
+    size_t end = scan - options.loopSize;
+    vector<size_t> candidates;
+
+    // closeLoopPairs not specified => use closeLoopDistance
+    if (options.closeLoopPairs < 0)
+    {
+        index.scansNear(cur->getPosition(), options.closeLoopDistance, end, candidates);
+        output.insert(output.end(), candidates.begin(), candidates.end());
+    }
+    else
+    {
+        index.scansOverlapping(scan, end, candidates);
+
+        // The estimate is an upper bound of the pair count => Scans below the limit can be skipped
+        vector<size_t> remaining;
+        for (size_t other : candidates)
+        {
+            if (index.estimatePairs(scan, other) >= options.closeLoopPairs)
+            {
+                remaining.push_back(other);
+            }
+        }
+
+        if (options.estimateOverlap || remaining.empty())
+        {
+            output.insert(output.end(), remaining.begin(), remaining.end());
+            return !output.empty();
+        }
+
+        // convert current Scan to KDTree for Pair search
+        auto tree = KDTree::create(cur, options.maxLeafSize);
+
+        size_t maxLen = 0;
+        for (size_t other : remaining)
+        {
+            maxLen = max(maxLen, scans[other]->numPoints());
+        }
+        KDTree::Neighbor* neighbors = new KDTree::Neighbor[maxLen];
+
+        for (size_t other : remaining)
+        {
+            size_t count = KDTree::nearestNeighbors(tree, scans[other], neighbors, options.slamMaxDistance);
+            if (count >= options.closeLoopPairs)
+            {
+                output.push_back(other);
+            }
+        }
+
+        delete[] neighbors;
+    }
+
+    return !output.empty();
+}
+
 
 /**
  * Conversion from Pose to Matrix representation in GraphSLAMs internally consistent Coordinate System
@@ -115,7 +178,7 @@ void EulerToMatrix4(const Vector3d& pos, const Vector3d& theta, Matrix4d& mat);
 void Matrix4ToEuler(const Matrix4d mat, Vector3d& rPosTheta, Vector3d& rPos);
 
 GraphSLAM::GraphSLAM(const SLAMOptions* options)
-    : m_options(options)
+    : m_options(options), m_treeCacheBytes(0), m_treeCacheTick(0), m_poseIndex(options)
 {
 }
 
@@ -249,33 +312,36 @@ void GraphSLAM::createGraph(const vector<SLAMScanPtr>& scans, size_t last, Graph
         graph.push_back(make_pair(i - 1, i));
     }
 
-    vector<size_t> others;
+    m_poseIndex.update(scans, last);
+
+    vector<vector<size_t>> others(last + 1);
+
+    #pragma omp parallel for schedule(dynamic)
     for (size_t i = m_options->loopSize; i <= last; i++)
     {
-        findCloseScans(scans, i, *m_options, others);
+        findCloseScans(scans, i, *m_options, m_poseIndex, others[i]);
+    }
 
-        for (size_t other : others)
+    for (size_t i = m_options->loopSize; i <= last; i++)
+    {
+        for (size_t other : others[i])
         {
             graph.push_back(make_pair(other, i));
         }
-
-        others.clear();
     }
 }
 
 void GraphSLAM::fillEquation(const vector<SLAMScanPtr>& scans, const Graph& graph, GraphMatrix& mat, GraphVector& vec) const
 {
-    // Cache all KDTrees
-    map<size_t, KDTreePtr> trees;
+    // KDTrees of all source scans in their local frames
+    vector<size_t> sources;
+    sources.reserve(graph.size());
     for (size_t i = 0; i < graph.size(); i++)
     {
-        size_t a = graph[i].first;
-        if (trees.find(a) == trees.end())
-        {
-            auto tree = KDTree::create(scans[a], m_options->maxLeafSize);
-            trees.insert(make_pair(a, tree));
-        }
+        sources.push_back(graph[i].first);
     }
+    vector<KDTreePtr> trees;
+    localTrees(scans, sources, trees);
 
     vector<pair<Matrix6d, Vector6d>> coeff(graph.size());
 
@@ -290,12 +356,13 @@ void GraphSLAM::fillEquation(const vector<SLAMScanPtr>& scans, const Graph& grap
 
         Matrix6d coeffMat;
         Vector6d coeffVec;
-        eulerCovariance(tree, scan, coeffMat, coeffVec);
+        eulerCovariance(tree, scans[a]->pose(), scan, coeffMat, coeffVec);
 
         coeff[i] = make_pair(coeffMat, coeffVec);
     }
 
     trees.clear();
+    trimTreeCache();
 
     map<pair<int, int>, Matrix6d> result;
 
@@ -389,13 +456,113 @@ void GraphSLAM::fillEquation(const vector<SLAMScanPtr>& scans, const Graph& grap
     mat.setFromTriplets(triplets.begin(), triplets.end());
 }
 
-void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outMat, Vector6d& outVec) const
+void GraphSLAM::localTrees(const vector<SLAMScanPtr>& scans, const vector<size_t>& indices, vector<KDTreePtr>& trees) const
+{
+    m_treeCacheTick++;
+
+    // Forget trees of destroyed scans
+    for (auto it = m_treeCache.begin(); it != m_treeCache.end();)
+    {
+        if (it->second.scan.expired())
+        {
+            m_treeCacheBytes -= it->second.bytes;
+            it = m_treeCache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    trees.assign(scans.size(), nullptr);
+    vector<bool> visited(scans.size(), false);
+    vector<size_t> missing;
+    for (size_t index : indices)
+    {
+        if (visited[index])
+        {
+            continue;
+        }
+        visited[index] = true;
+
+        const SLAMScanPtr& scan = scans[index];
+        const Vector3f* points = scan->numPoints() > 0 ? &scan->rawPoint(0) : nullptr;
+
+        auto found = m_treeCache.find(scan.get());
+        if (found != m_treeCache.end()
+            && found->second.points == points && found->second.numPoints == scan->numPoints())
+        {
+            found->second.lastUse = m_treeCacheTick;
+            trees[index] = found->second.tree;
+        }
+        else
+        {
+            missing.push_back(index);
+        }
+    }
+
+    vector<KDTreePtr> built(missing.size());
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < missing.size(); i++)
+    {
+        built[i] = KDTree::createLocal(scans[missing[i]], m_options->maxLeafSize);
+    }
+
+    for (size_t i = 0; i < missing.size(); i++)
+    {
+        const SLAMScanPtr& scan = scans[missing[i]];
+        trees[missing[i]] = built[i];
+
+        CachedTree& entry = m_treeCache[scan.get()];
+        m_treeCacheBytes -= entry.tree ? entry.bytes : 0;
+
+        entry.scan = scan;
+        entry.points = scan->numPoints() > 0 ? &scan->rawPoint(0) : nullptr;
+        entry.numPoints = scan->numPoints();
+        entry.tree = built[i];
+        entry.bytes = KDTree::estimateMemory(scan->numPoints(), m_options->maxLeafSize);
+        entry.lastUse = m_treeCacheTick;
+        m_treeCacheBytes += entry.bytes;
+    }
+}
+
+void GraphSLAM::trimTreeCache() const
+{
+    size_t maxBytes = max(m_options->slamTreeCacheSize, 0.0) * 1024 * 1024;
+    if (m_treeCacheBytes <= maxBytes)
+    {
+        return;
+    }
+
+    vector<pair<size_t, const SLAMScanWrapper*>> byAge;
+    byAge.reserve(m_treeCache.size());
+    for (auto& entry : m_treeCache)
+    {
+        byAge.push_back(make_pair(entry.second.lastUse, entry.first));
+    }
+    sort(byAge.begin(), byAge.end());
+
+    for (size_t i = 0; i < byAge.size() && m_treeCacheBytes > maxBytes; i++)
+    {
+        auto found = m_treeCache.find(byAge[i].second);
+        m_treeCacheBytes -= found->second.bytes;
+        m_treeCache.erase(found);
+    }
+}
+
+void GraphSLAM::eulerCovariance(KDTreePtr tree, const Transformd& treePose, SLAMScanPtr scan, Matrix6d& outMat, Vector6d& outVec) const
 {
     size_t n = scan->numPoints();
 
     KDTree::Neighbor* results = new KDTree::Neighbor[n];
 
-    size_t pairs = KDTree::nearestNeighbors(tree, scan, results, m_options->slamMaxDistance);
+    // Search in the local frame of the tree, neighbors are transformed back below
+    Transformd toTree = treePose.inverse() * scan->pose();
+    size_t pairs = KDTree::nearestNeighbors(tree, scan, toTree, results, m_options->slamMaxDistance);
+
+    Matrix3d treeRotation = treePose.block<3, 3>(0, 0);
+    Vector3d treeTranslation = treePose.block<3, 1>(0, 3);
 
     Vector6d mz = Vector6d::Zero();
     Vector3d sum = Vector3d::Zero();
@@ -410,7 +577,7 @@ void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outM
         }
 
         Vector3d p = scan->point(i).cast<double>();
-        Vector3d r = results[i]->cast<double>();
+        Vector3d r = treeRotation * results[i]->cast<double>() + treeTranslation;
 
         Vector3d mid = (p + r) / 2.0;
         Vector3d d = r - p;
@@ -463,7 +630,7 @@ void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outM
         }
 
         Vector3d p = scan->point(i).cast<double>();
-        Vector3d r = results[i]->cast<double>();
+        Vector3d r = treeRotation * results[i]->cast<double>() + treeTranslation;
 
         Vector3d mid = (p + r) / 2.0;
         Vector3d delta = r - p;
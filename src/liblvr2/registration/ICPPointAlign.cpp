@@ -51,6 +51,7 @@ ICPPointAlign::ICPPointAlign(SLAMScanPtr model, SLAMScanPtr data) :
     m_maxIterations     = 50;
     m_epsilon           = 0.00001;
     m_verbose           = false;
+    m_maxLeafSize       = 20;
 
     m_searchTree = KDTree::create(model, m_maxLeafSize);
 }
@@ -136,7 +137,12 @@ void ICPPointAlign::setMaxIterations(int i)
 
 void ICPPointAlign::setMaxLeafSize(int m)
 {
-    m_maxLeafSize = m;
+    if (m != m_maxLeafSize)
+    {
+        // the tree is built in the constructor
+        m_maxLeafSize = m;
+        m_searchTree = KDTree::create(m_modelCloud, m_maxLeafSize);
+    }
 }
 
 void ICPPointAlign::setEpsilon(double e)
@@ -33,6 +33,9 @@
  */
 #include "lvr2/registration/KDTree.hpp"
 #include "lvr2/registration/AABB.hpp"
+#include "lvr2/registration/Metascan.hpp"
+
+#include <algorithm>
 
 namespace lvr2
 {
@@ -106,6 +109,27 @@ private:
     int count;
 };
 
+class KDForest : public KDTree
+{
+public:
+    KDForest(std::vector<KDTreePtr> trees)
+        : trees(move(trees))
+    { }
+
+protected:
+    virtual void nnInternal(const Point& point, Neighbor& neighbor, double& maxDist) const override
+    {
+        // every tree only accepts neighbors closer than the best one so far
+        for (auto& tree : this->trees)
+        {
+            tree->nnInternal(point, neighbor, maxDist);
+        }
+    }
+
+private:
+    std::vector<KDTreePtr> trees;
+};
+
 KDTreePtr create_recursive(KDTree::Point* points, int n, int maxLeafSize)
 {
     if (n <= maxLeafSize)
@@ -152,7 +176,11 @@ KDTreePtr create_recursive(KDTree::Point* points, int n, int maxLeafSize)
 
 KDTreePtr KDTree::create(SLAMScanPtr scan, int maxLeafSize)
 {
-    KDTreePtr ret;
+    // Metascans keep their own incremental trees
+    if (auto meta = std::dynamic_pointer_cast<Metascan>(scan))
+    {
+        return meta->searchTree(maxLeafSize);
+    }
 
     size_t n = scan->numPoints();
     auto points = boost::shared_array<Point>(new Point[n]);
@@ -163,6 +191,27 @@ KDTreePtr KDTree::create(SLAMScanPtr scan, int maxLeafSize)
         points[i] = scan->point(i).cast<PointT>();
     }
 
+    return create(points, n, maxLeafSize);
+}
+
+KDTreePtr KDTree::createLocal(SLAMScanPtr scan, int maxLeafSize)
+{
+    size_t n = scan->numPoints();
+    auto points = boost::shared_array<Point>(new Point[n]);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++)
+    {
+        points[i] = scan->rawPoint(i).cast<PointT>();
+    }
+
+    return create(points, n, maxLeafSize);
+}
+
+KDTreePtr KDTree::create(boost::shared_array<Point> points, size_t n, int maxLeafSize)
+{
+    KDTreePtr ret;
+
     #pragma omp parallel // allows "pragma omp task"
     #pragma omp single // only execute every task once
     ret = create_recursive(points.get(), n, maxLeafSize);
@@ -172,6 +221,23 @@ KDTreePtr KDTree::create(SLAMScanPtr scan, int maxLeafSize)
     return ret;
 }
 
+KDTreePtr KDTree::create(std::vector<KDTreePtr> trees)
+{
+    if (trees.size() == 1)
+    {
+        return trees[0];
+    }
+    return KDTreePtr(new KDForest(move(trees)));
+}
+
+size_t KDTree::estimateMemory(size_t n, int maxLeafSize)
+{
+    // Leaves hold between 1 and maxLeafSize points, every node and leaf costs about
+    // 100 bytes including its control block
+    size_t nodes = 4 * n / std::max(maxLeafSize, 1) + 1;
+    return n * sizeof(Point) + nodes * 100;
+}
+
 
 size_t KDTree::nearestNeighbors(KDTreePtr tree, SLAMScanPtr scan, KDTree::Neighbor* neighbors, double maxDistance, Vector3d& centroid_m, Vector3d& centroid_d)
 {
@@ -212,4 +278,25 @@ size_t KDTree::nearestNeighbors(KDTreePtr tree, SLAMScanPtr scan, KDTree::Neighb
     return found;
 }
 
+size_t KDTree::nearestNeighbors(KDTreePtr tree, SLAMScanPtr scan, const Transformd& transform, KDTree::Neighbor* neighbors, double maxDistance)
+{
+    size_t found = 0;
+    double distance = 0.0;
+
+    Eigen::Matrix3d rotation = transform.block<3, 3>(0, 0);
+    Vector3d translation = transform.block<3, 1>(0, 3);
+
+    #pragma omp parallel for firstprivate(distance) reduction(+:found) schedule(dynamic,8)
+    for (size_t i = 0; i < scan->numPoints(); i++)
+    {
+        Vector3d point = rotation * scan->rawPoint(i).cast<double>() + translation;
+        if (tree->nearestNeighbor(point, neighbors[i], distance, maxDistance))
+        {
+            found++;
+        }
+    }
+
+    return found;
+}
+
 }
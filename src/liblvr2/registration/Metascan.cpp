@@ -33,11 +33,13 @@
  */
 #include "lvr2/registration/Metascan.hpp"
 
+#include <algorithm>
+
 namespace lvr2
 {
 
-Metascan::Metascan()
-    : SLAMScanWrapper(ScanPtr(nullptr))
+Metascan::Metascan(size_t window)
+    : SLAMScanWrapper(ScanPtr(nullptr)), m_window(window), m_maxLeafSize(0)
 {
 
 }
@@ -74,6 +76,118 @@ void Metascan::addScan(SLAMScanPtr scan)
     m_scans.push_back(scan);
     m_numPoints += scan->numPoints();
     m_deltaPose = scan->deltaPose();
+
+    Block block;
+    block.first = m_scans.size() - 1;
+    block.count = 1;
+    block.numPoints = scan->numPoints();
+    m_blocks.push_back(block);
+
+    // merge the newest blocks while they are of similar size, like carrying in a binary counter
+    size_t maxCount = m_window > 0 ? std::max<size_t>(m_window / 2, 1) : m_scans.size();
+    while (m_blocks.size() >= 2)
+    {
+        Block& prev = m_blocks[m_blocks.size() - 2];
+        Block& last = m_blocks.back();
+        if (prev.numPoints >= 2 * last.numPoints || prev.count + last.count > maxCount)
+        {
+            break;
+        }
+        prev.count += last.count;
+        prev.numPoints += last.numPoints;
+        prev.tree.reset();
+        prev.poses.clear();
+        m_blocks.pop_back();
+    }
+
+    dropOld();
+}
+
+void Metascan::dropOld()
+{
+    if (m_window == 0)
+    {
+        return;
+    }
+
+    size_t dropped = 0;
+    while (m_blocks.size() > 1 && m_scans.size() - dropped - m_blocks.front().count >= m_window)
+    {
+        dropped += m_blocks.front().count;
+        m_numPoints -= m_blocks.front().numPoints;
+        m_blocks.erase(m_blocks.begin());
+    }
+
+    if (dropped > 0)
+    {
+        m_scans.erase(m_scans.begin(), m_scans.begin() + dropped);
+        for (auto& block : m_blocks)
+        {
+            block.first -= dropped;
+        }
+    }
+}
+
+KDTreePtr Metascan::searchTree(int maxLeafSize)
+{
+    if (maxLeafSize != m_maxLeafSize)
+    {
+        for (auto& block : m_blocks)
+        {
+            block.tree.reset();
+        }
+        m_maxLeafSize = maxLeafSize;
+    }
+
+    std::vector<KDTreePtr> trees;
+    trees.reserve(m_blocks.size());
+    for (auto& block : m_blocks)
+    {
+        bool moved = false;
+        for (size_t i = 0; i < block.poses.size() && !moved; i++)
+        {
+            moved = m_scans[block.first + i]->pose() != block.poses[i];
+        }
+        if (!block.tree || moved)
+        {
+            buildBlock(block, maxLeafSize);
+        }
+        trees.push_back(block.tree);
+    }
+
+    return KDTree::create(trees);
+}
+
+void Metascan::buildBlock(Block& block, int maxLeafSize)
+{
+    m_numPoints -= block.numPoints;
+    block.numPoints = 0;
+    block.poses.clear();
+    for (size_t i = 0; i < block.count; i++)
+    {
+        const SLAMScanPtr& scan = m_scans[block.first + i];
+        block.numPoints += scan->numPoints();
+        block.poses.push_back(scan->pose());
+    }
+    m_numPoints += block.numPoints;
+
+    auto points = boost::shared_array<KDTree::Point>(new KDTree::Point[block.numPoints]);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < block.count; i++)
+    {
+        const SLAMScanPtr& scan = m_scans[block.first + i];
+        size_t n = scan->numPoints();
+
+        #pragma omp parallel for schedule(static)
+        for (size_t j = 0; j < n; j++)
+        {
+            points[offset + j] = scan->point(j).cast<KDTree::PointT>();
+        }
+        offset += n;
+    }
+
+    block.tree = KDTree::create(points, block.numPoints, maxLeafSize);
 }
 
 } /* namespace lvr2 */
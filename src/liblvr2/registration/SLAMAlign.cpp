@@ -45,7 +45,7 @@ namespace lvr2
 {
 
 SLAMAlign::SLAMAlign(const SLAMOptions& options, const vector<SLAMScanPtr>& scans, std::vector<bool> new_scans)
-    : m_options(options), m_scans(scans), m_graph(&m_options), m_foundLoop(false), m_loopIndexCount(0), m_new_scans(new_scans)
+    : m_options(options), m_scans(scans), m_graph(&m_options), m_poseIndex(&m_options), m_foundLoop(false), m_loopIndexCount(0), m_new_scans(new_scans)
 {
 
     for (auto& scan : m_scans)
@@ -55,7 +55,7 @@ SLAMAlign::SLAMAlign(const SLAMOptions& options, const vector<SLAMScanPtr>& scan
 }
 
 SLAMAlign::SLAMAlign(const SLAMOptions& options, std::vector<bool> new_scans)
-    : m_options(options), m_graph(&m_options), m_foundLoop(false), m_loopIndexCount(0), m_new_scans(new_scans)
+    : m_options(options), m_graph(&m_options), m_poseIndex(&m_options), m_foundLoop(false), m_loopIndexCount(0), m_new_scans(new_scans)
 {
 }
 
@@ -87,7 +87,7 @@ void SLAMAlign::addScan(const SLAMScanPtr& scan, bool match)
 
 void SLAMAlign::addScan(const ScanPtr& scan, bool match)
 {
-    addScan(make_shared<SLAMScanWrapper>(scan));
+    addScan(make_shared<SLAMScanWrapper>(scan, m_options.sharePoints));
 }
 
 SLAMScanPtr SLAMAlign::scan(size_t index) const
@@ -132,7 +132,7 @@ void SLAMAlign::match()
 
     if (m_options.metascan && !m_metascan)
     {
-        Metascan* meta = new Metascan();
+        Metascan* meta = new Metascan(std::max(m_options.metascanWindow, 0));
         
         meta->addScan(m_scans[0]);
 
@@ -276,8 +276,10 @@ void SLAMAlign::checkLoopClose(size_t last)
     bool hasLoop = false;
     size_t first = 0;
 
+    m_poseIndex.update(m_scans, last);
+
     vector<size_t> others;
-    if (findCloseScans(m_scans, last, m_options, others))
+    if (findCloseScans(m_scans, last, m_options, m_poseIndex, others))
     {
         hasLoop = true;
         first = others[0];
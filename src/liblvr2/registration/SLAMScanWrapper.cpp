@@ -42,8 +42,8 @@ using namespace std;
 namespace lvr2
 {
 
-SLAMScanWrapper::SLAMScanWrapper(ScanPtr scan)
-    : m_scan(scan), m_deltaPose(Transformd::Identity())
+SLAMScanWrapper::SLAMScanWrapper(ScanPtr scan, bool sharePoints)
+    : m_scan(scan), m_pointData(nullptr), m_deltaPose(Transformd::Identity())
 {
     if (m_scan)
     {
@@ -54,11 +54,22 @@ SLAMScanWrapper::SLAMScanWrapper(ScanPtr scan)
         m_numPoints = m_scan->points->numPoints();
         lvr2::floatArr arr = m_scan->points->getPointArray();
 
-        m_points.resize(m_numPoints);
-        #pragma omp parallel for schedule(static)
-        for (size_t i = 0; i < m_numPoints; i++)
+        if (sharePoints)
         {
-            m_points[i] = Vector3f(arr[i * 3], arr[i * 3 + 1], arr[i * 3 + 2]);
+            // xyz triples of floats have the same layout as Vector3f
+            static_assert(sizeof(Vector3f) == 3 * sizeof(float), "Vector3f is not packed");
+            m_sharedPoints = arr;
+            m_pointData = reinterpret_cast<const Vector3f*>(arr.get());
+        }
+        else
+        {
+            m_points.resize(m_numPoints);
+            #pragma omp parallel for schedule(static)
+            for (size_t i = 0; i < m_numPoints; i++)
+            {
+                m_points[i] = Vector3f(arr[i * 3], arr[i * 3 + 1], arr[i * 3 + 2]);
+            }
+            m_pointData = m_points.data();
         }
 
         // TODO: m_scan->m_points->unload();
@@ -88,12 +99,16 @@ void SLAMScanWrapper::transform(const Transformd& transform, bool writeFrame, Fr
 
 void SLAMScanWrapper::reduce(double voxelSize, int maxLeafSize)
 {
+    materialize();
     m_numPoints = octreeReduce(m_points.data(), m_numPoints, voxelSize, maxLeafSize);
     m_points.resize(m_numPoints);
+    m_pointData = m_points.data();
 }
 
 void SLAMScanWrapper::setMinDistance(double minDistance)
 {
+    materialize();
+
     double sqDist = minDistance * minDistance;
 
     size_t cur = 0;
@@ -110,10 +125,13 @@ void SLAMScanWrapper::setMinDistance(double minDistance)
         }
     }
     m_points.resize(m_numPoints);
+    m_pointData = m_points.data();
 }
 
 void SLAMScanWrapper::setMaxDistance(double maxDistance)
 {
+    materialize();
+
     double sqDist = maxDistance * maxDistance;
 
     size_t cur = 0;
@@ -130,24 +148,52 @@ void SLAMScanWrapper::setMaxDistance(double maxDistance)
         }
     }
     m_points.resize(m_numPoints);
+    m_pointData = m_points.data();
 }
 
 void SLAMScanWrapper::trim()
 {
+    if (m_sharedPoints)
+    {
+        return;
+    }
     m_points.resize(m_numPoints);
     m_points.shrink_to_fit();
+    m_pointData = m_points.data();
+}
+
+void SLAMScanWrapper::materialize()
+{
+    if (!m_sharedPoints)
+    {
+        return;
+    }
+
+    m_points.resize(m_numPoints);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < m_numPoints; i++)
+    {
+        m_points[i] = m_pointData[i];
+    }
+    m_pointData = m_points.data();
+    m_sharedPoints.reset();
+}
+
+bool SLAMScanWrapper::sharesPoints() const
+{
+    return (bool)m_sharedPoints;
 }
 
 Vector3d SLAMScanWrapper::point(size_t index) const
 {
-    const Vector3f& p = m_points[index];
+    const Vector3f& p = m_pointData[index];
     Vector4d extended(p.x(), p.y(), p.z(), 1.0);
     return (pose() * extended).block<3, 1>(0, 0);
 }
 
 const Vector3f& SLAMScanWrapper::rawPoint(size_t index) const
 {
-    return m_points[index];
+    return m_pointData[index];
 }
 
 size_t SLAMScanWrapper::numPoints() const
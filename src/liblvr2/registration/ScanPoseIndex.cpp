@@ -0,0 +1,405 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * ScanPoseIndex.cpp
+ *
+ *  @date 18.10.2026
+ */
+
+#include "lvr2/registration/ScanPoseIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace lvr2
+{
+
+namespace
+{
+
+/// Number of bits per coordinate in a packed key
+constexpr int KEY_BITS = 21;
+constexpr int64_t KEY_OFFSET = int64_t(1) << (KEY_BITS - 1);
+constexpr uint64_t KEY_MASK = (uint64_t(1) << KEY_BITS) - 1;
+
+void unpack(uint64_t key, int64_t& x, int64_t& y, int64_t& z)
+{
+    x = int64_t((key >> (2 * KEY_BITS)) & KEY_MASK) - KEY_OFFSET;
+    y = int64_t((key >> KEY_BITS) & KEY_MASK) - KEY_OFFSET;
+    z = int64_t(key & KEY_MASK) - KEY_OFFSET;
+}
+
+bool lessKey(const pair<uint64_t, uint32_t>& voxel, uint64_t key)
+{
+    return voxel.first < key;
+}
+
+} // namespace
+
+ScanPoseIndex::ScanPoseIndex(const SLAMOptions* options)
+    : m_options(options), m_cellSize(0.0), m_maxRadius(0.0), m_voxelSize(0.0), m_pairs(false)
+{
+}
+
+uint64_t ScanPoseIndex::key(int64_t x, int64_t y, int64_t z)
+{
+    return (uint64_t(x + KEY_OFFSET) & KEY_MASK) << (2 * KEY_BITS)
+           | (uint64_t(y + KEY_OFFSET) & KEY_MASK) << KEY_BITS
+           | (uint64_t(z + KEY_OFFSET) & KEY_MASK);
+}
+
+int64_t ScanPoseIndex::cellCoord(double value) const
+{
+    return (int64_t)floor(value / m_cellSize);
+}
+
+void ScanPoseIndex::update(const vector<SLAMScanPtr>& scans, size_t last)
+{
+    bool pairs = m_options->closeLoopPairs >= 0;
+
+    // Slightly larger than slamMaxDistance, so rounding can't move a pair of points
+    // within slamMaxDistance more than one voxel apart
+    double voxelSize = m_options->slamMaxDistance * 1.01;
+
+    if (pairs != m_pairs || voxelSize != m_voxelSize)
+    {
+        // The options changed => start over
+        m_entries.clear();
+        m_cells.clear();
+        m_cellSize = 0.0;
+        m_maxRadius = 0.0;
+        m_voxelSize = voxelSize;
+        m_pairs = pairs;
+    }
+
+    if (m_cellSize <= 0.0)
+    {
+        m_cellSize = pairs ? max(m_options->slamMaxDistance, 1.0) : max(m_options->closeLoopDistance, 1e-3);
+    }
+
+    // Scans that were removed
+    for (size_t i = last + 1; i < m_entries.size(); i++)
+    {
+        if (m_entries[i].valid)
+        {
+            removeFromGrid(i);
+        }
+    }
+    m_entries.resize(last + 1);
+
+    // Scans that are new or were moved
+    vector<size_t> stale;
+    for (size_t i = 0; i <= last; i++)
+    {
+        const Entry& entry = m_entries[i];
+        const SLAMScanPtr& scan = scans[i];
+        if (!entry.valid || entry.scan != scan.get() || entry.numPoints != scan->numPoints() || entry.pose != scan->pose())
+        {
+            if (entry.valid)
+            {
+                removeFromGrid(i);
+            }
+            stale.push_back(i);
+        }
+    }
+
+    if (stale.empty())
+    {
+        return;
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < stale.size(); i++)
+    {
+        updateEntry(stale[i], scans[stale[i]], pairs);
+    }
+
+    for (size_t index : stale)
+    {
+        const Entry& entry = m_entries[index];
+        for (int corner = 0; corner < 8; corner++)
+        {
+            Vector3d c((corner & 1) ? entry.max.x() : entry.min.x(),
+                       (corner & 2) ? entry.max.y() : entry.min.y(),
+                       (corner & 4) ? entry.max.z() : entry.min.z());
+            m_maxRadius = max(m_maxRadius, (c - entry.position).norm());
+        }
+    }
+
+    // Bounding box queries look at all cells within m_maxRadius of the box, keep
+    // the cells large enough for that to be a small neighborhood
+    if (pairs && m_maxRadius > m_cellSize)
+    {
+        rebuildGrid(2.0 * m_maxRadius);
+    }
+    else
+    {
+        for (size_t index : stale)
+        {
+            insertIntoGrid(index);
+        }
+    }
+}
+
+void ScanPoseIndex::updateEntry(size_t index, const SLAMScanPtr& scan, bool voxels)
+{
+    Entry& entry = m_entries[index];
+    size_t n = scan->numPoints();
+
+    // Distance queries only need the position
+    if (!voxels)
+    {
+        entry.localMin = entry.localMax = Vector3d::Zero();
+    }
+    else if (!entry.valid || entry.scan != scan.get() || entry.numPoints != n)
+    {
+        entry.localMin = Vector3d::Constant(n > 0 ? numeric_limits<double>::max() : 0.0);
+        entry.localMax = Vector3d::Constant(n > 0 ? numeric_limits<double>::lowest() : 0.0);
+        for (size_t i = 0; i < n; i++)
+        {
+            Vector3d p = scan->rawPoint(i).cast<double>();
+            entry.localMin = entry.localMin.cwiseMin(p);
+            entry.localMax = entry.localMax.cwiseMax(p);
+        }
+    }
+
+    const Transformd& pose = scan->pose();
+    entry.scan = scan.get();
+    entry.pose = pose;
+    entry.numPoints = n;
+    entry.valid = true;
+    entry.position = pose.block<3, 1>(0, 3);
+
+    // The box around the transformed corners contains all transformed points
+    entry.min = Vector3d::Constant(numeric_limits<double>::max());
+    entry.max = Vector3d::Constant(numeric_limits<double>::lowest());
+    for (int corner = 0; corner < 8; corner++)
+    {
+        Vector4d c((corner & 1) ? entry.localMax.x() : entry.localMin.x(),
+                   (corner & 2) ? entry.localMax.y() : entry.localMin.y(),
+                   (corner & 4) ? entry.localMax.z() : entry.localMin.z(),
+                   1.0);
+        Vector3d t = (pose * c).block<3, 1>(0, 0);
+        entry.min = entry.min.cwiseMin(t);
+        entry.max = entry.max.cwiseMax(t);
+    }
+
+    entry.voxels.clear();
+    if (!voxels)
+    {
+        return;
+    }
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        Vector3d p = scan->point(i);
+        keys[i] = key((int64_t)floor(p.x() / m_voxelSize),
+                      (int64_t)floor(p.y() / m_voxelSize),
+                      (int64_t)floor(p.z() / m_voxelSize));
+    }
+    sort(keys.begin(), keys.end());
+
+    for (size_t i = 0; i < n;)
+    {
+        size_t j = i + 1;
+        while (j < n && keys[j] == keys[i])
+        {
+            j++;
+        }
+        entry.voxels.push_back(make_pair(keys[i], uint32_t(j - i)));
+        i = j;
+    }
+    entry.voxels.shrink_to_fit();
+}
+
+void ScanPoseIndex::insertIntoGrid(size_t index)
+{
+    Entry& entry = m_entries[index];
+    entry.cell = key(cellCoord(entry.position.x()), cellCoord(entry.position.y()), cellCoord(entry.position.z()));
+    m_cells[entry.cell].push_back(index);
+}
+
+void ScanPoseIndex::removeFromGrid(size_t index)
+{
+    auto found = m_cells.find(m_entries[index].cell);
+    if (found == m_cells.end())
+    {
+        return;
+    }
+
+    vector<size_t>& cell = found->second;
+    auto it = find(cell.begin(), cell.end(), index);
+    if (it != cell.end())
+    {
+        *it = cell.back();
+        cell.pop_back();
+    }
+    if (cell.empty())
+    {
+        m_cells.erase(found);
+    }
+}
+
+void ScanPoseIndex::rebuildGrid(double cellSize)
+{
+    m_cellSize = cellSize;
+    m_cells.clear();
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        if (m_entries[i].valid)
+        {
+            insertIntoGrid(i);
+        }
+    }
+}
+
+template<typename F>
+void ScanPoseIndex::forEachInBox(const Vector3d& min, const Vector3d& max, F f) const
+{
+    int64_t x0 = cellCoord(min.x()), x1 = cellCoord(max.x());
+    int64_t y0 = cellCoord(min.y()), y1 = cellCoord(max.y());
+    int64_t z0 = cellCoord(min.z()), z1 = cellCoord(max.z());
+
+    double numCells = double(x1 - x0 + 1) * double(y1 - y0 + 1) * double(z1 - z0 + 1);
+    if (numCells > m_cells.size())
+    {
+        // Cheaper to look at all occupied cells
+        for (auto& cell : m_cells)
+        {
+            int64_t x, y, z;
+            unpack(cell.first, x, y, z);
+            if (x >= x0 && x <= x1 && y >= y0 && y <= y1 && z >= z0 && z <= z1)
+            {
+                for (size_t index : cell.second)
+                {
+                    f(index);
+                }
+            }
+        }
+        return;
+    }
+
+    for (int64_t x = x0; x <= x1; x++)
+    {
+        for (int64_t y = y0; y <= y1; y++)
+        {
+            for (int64_t z = z0; z <= z1; z++)
+            {
+                auto found = m_cells.find(key(x, y, z));
+                if (found != m_cells.end())
+                {
+                    for (size_t index : found->second)
+                    {
+                        f(index);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ScanPoseIndex::scansNear(const Vector3d& position, double radius, size_t end, vector<size_t>& output) const
+{
+    output.clear();
+    double maxDist = radius * radius;
+    Vector3d extent = Vector3d::Constant(radius);
+
+    forEachInBox(position - extent, position + extent, [&](size_t index)
+    {
+        if (index < end && (m_entries[index].position - position).squaredNorm() < maxDist)
+        {
+            output.push_back(index);
+        }
+    });
+
+    sort(output.begin(), output.end());
+}
+
+void ScanPoseIndex::scansOverlapping(size_t scan, size_t end, vector<size_t>& output) const
+{
+    output.clear();
+    const Entry& cur = m_entries[scan];
+    Vector3d margin = Vector3d::Constant(m_options->slamMaxDistance);
+    Vector3d min = cur.min - margin;
+    Vector3d max = cur.max + margin;
+
+    // The position of a Scan is at most m_maxRadius away from its bounding box
+    Vector3d search = Vector3d::Constant(m_maxRadius);
+
+    forEachInBox(min - search, max + search, [&](size_t index)
+    {
+        const Entry& other = m_entries[index];
+        if (index < end
+            && (other.min.array() <= max.array()).all()
+            && (other.max.array() >= min.array()).all())
+        {
+            output.push_back(index);
+        }
+    });
+
+    sort(output.begin(), output.end());
+}
+
+size_t ScanPoseIndex::estimatePairs(size_t scan, size_t other) const
+{
+    const auto& occupied = m_entries[scan].voxels;
+    const auto& voxels = m_entries[other].voxels;
+
+    size_t count = 0;
+    for (const auto& voxel : voxels)
+    {
+        int64_t x, y, z;
+        unpack(voxel.first, x, y, z);
+
+        bool found = false;
+        for (int dx = -1; dx <= 1 && !found; dx++)
+        {
+            for (int dy = -1; dy <= 1 && !found; dy++)
+            {
+                for (int dz = -1; dz <= 1 && !found; dz++)
+                {
+                    uint64_t k = key(x + dx, y + dy, z + dz);
+                    auto it = lower_bound(occupied.begin(), occupied.end(), k, lessKey);
+                    found = it != occupied.end() && it->first == k;
+                }
+            }
+        }
+        if (found)
+        {
+            count += voxel.second;
+        }
+    }
+
+    return count;
+}
+
+} /* namespace lvr2 */
@@ -0,0 +1,309 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * TextureAtlas.cpp
+ *
+ *  @date 18.10.2026
+ */
+
+#include "lvr2/texture/TextureAtlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace lvr2
+{
+
+SkylinePacker::SkylinePacker(unsigned int width, unsigned int height)
+    : m_width(width), m_height(height), m_usedWidth(0), m_usedHeight(0)
+{
+    m_skyline.push_back({0, 0, width});
+}
+
+bool SkylinePacker::insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y)
+{
+    if (width == 0 || height == 0 || width > m_width || height > m_height)
+    {
+        return false;
+    }
+
+    // Find the segment where the rectangle's top edge ends up lowest
+    size_t bestSegment = m_skyline.size();
+    unsigned int bestY = std::numeric_limits<unsigned int>::max();
+    for (size_t i = 0; i < m_skyline.size(); i++)
+    {
+        unsigned int left = m_skyline[i].x;
+        if (left + width > m_width)
+        {
+            break;
+        }
+
+        // The rectangle rests on the highest segment below it
+        unsigned int top = 0;
+        unsigned int covered = 0;
+        for (size_t j = i; covered < width; j++)
+        {
+            top = std::max(top, m_skyline[j].y);
+            covered += m_skyline[j].width;
+        }
+
+        if (top + height <= m_height && top < bestY)
+        {
+            bestSegment = i;
+            bestY = top;
+        }
+    }
+
+    if (bestSegment == m_skyline.size())
+    {
+        return false;
+    }
+
+    x = m_skyline[bestSegment].x;
+    y = bestY;
+
+    // Put the new segment on top and cut away what it covers
+    m_skyline.insert(m_skyline.begin() + bestSegment, Segment{x, y + height, width});
+    for (size_t j = bestSegment + 1; j < m_skyline.size();)
+    {
+        const unsigned int prevEnd = m_skyline[j - 1].x + m_skyline[j - 1].width;
+        if (m_skyline[j].x >= prevEnd)
+        {
+            break;
+        }
+        const unsigned int overlap = prevEnd - m_skyline[j].x;
+        if (overlap >= m_skyline[j].width)
+        {
+            m_skyline.erase(m_skyline.begin() + j);
+        }
+        else
+        {
+            m_skyline[j].x += overlap;
+            m_skyline[j].width -= overlap;
+            break;
+        }
+    }
+
+    // Merge neighbouring segments of the same height
+    for (size_t j = 1; j < m_skyline.size();)
+    {
+        if (m_skyline[j - 1].y == m_skyline[j].y)
+        {
+            m_skyline[j - 1].width += m_skyline[j].width;
+            m_skyline.erase(m_skyline.begin() + j);
+        }
+        else
+        {
+            j++;
+        }
+    }
+
+    m_usedWidth = std::max(m_usedWidth, x + width);
+    m_usedHeight = std::max(m_usedHeight, y + height);
+    return true;
+}
+
+std::vector<Texture> packTextureAtlas(
+    const std::vector<const Texture*>& textures,
+    unsigned int pageSize,
+    unsigned int padding,
+    std::vector<AtlasRegion>& regions,
+    int firstIndex)
+{
+    regions.assign(textures.size(), AtlasRegion());
+    std::vector<Texture> pages;
+    if (textures.empty())
+    {
+        return pages;
+    }
+
+    // Texture sizes are stored as unsigned short
+    pageSize = std::min<unsigned int>(pageSize, std::numeric_limits<unsigned short>::max());
+
+    // Shared pages use the pixel format of the first texture
+    const unsigned char numChannels = textures[0]->m_numChannels;
+    const unsigned char numBytesPerChan = textures[0]->m_numBytesPerChan;
+
+    // Tall textures first, that keeps the skyline flat
+    std::vector<size_t> order(textures.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (textures[a]->m_height != textures[b]->m_height)
+        {
+            return textures[a]->m_height > textures[b]->m_height;
+        }
+        return textures[a]->m_width > textures[b]->m_width;
+    });
+
+    // Place all textures. Pages without a packer hold a single texture.
+    std::vector<SkylinePacker> packers;
+    std::vector<size_t> pagePacker;
+    std::vector<unsigned int> pageWidth, pageHeight;
+    std::vector<unsigned int> pagePadding;
+    std::vector<const Texture*> pageFormat;
+
+    for (size_t i : order)
+    {
+        const Texture& texture = *textures[i];
+        AtlasRegion& region = regions[i];
+
+        // Empty textures get a cleared pixel, so their regions and pages are never empty
+        region.m_width = std::max<unsigned int>(texture.m_width, 1);
+        region.m_height = std::max<unsigned int>(texture.m_height, 1);
+
+        const unsigned int paddedWidth = region.m_width + 2 * padding;
+        const unsigned int paddedHeight = region.m_height + 2 * padding;
+        bool ownPage = paddedWidth > pageSize || paddedHeight > pageSize
+            || texture.m_numChannels != numChannels || texture.m_numBytesPerChan != numBytesPerChan;
+
+        bool placed = false;
+        unsigned int x, y;
+        if (!ownPage)
+        {
+            for (size_t p = 0; p < pagePacker.size() && !placed; p++)
+            {
+                if (pagePacker[p] != std::numeric_limits<size_t>::max()
+                    && packers[pagePacker[p]].insert(paddedWidth, paddedHeight, x, y))
+                {
+                    region.m_page = p;
+                    placed = true;
+                }
+            }
+            if (!placed)
+            {
+                SkylinePacker packer(pageSize, pageSize);
+                if (packer.insert(paddedWidth, paddedHeight, x, y))
+                {
+                    packers.push_back(packer);
+                    region.m_page = pagePacker.size();
+                    pagePacker.push_back(packers.size() - 1);
+                    pageWidth.push_back(0);
+                    pageHeight.push_back(0);
+                    pagePadding.push_back(padding);
+                    pageFormat.push_back(textures[0]);
+                    placed = true;
+                }
+            }
+            ownPage = !placed;
+        }
+
+        if (placed)
+        {
+            region.m_x = x + padding;
+            region.m_y = y + padding;
+        }
+        else
+        {
+            region.m_page = pagePacker.size();
+            region.m_x = 0;
+            region.m_y = 0;
+            pagePacker.push_back(std::numeric_limits<size_t>::max());
+            pageWidth.push_back(region.m_width);
+            pageHeight.push_back(region.m_height);
+            pagePadding.push_back(0);
+            pageFormat.push_back(&texture);
+        }
+    }
+
+    // Crop the pages to the used area and allocate them in the format of their textures
+    for (size_t p = 0; p < pagePacker.size(); p++)
+    {
+        if (pagePacker[p] != std::numeric_limits<size_t>::max())
+        {
+            pageWidth[p] = packers[pagePacker[p]].usedWidth();
+            pageHeight[p] = packers[pagePacker[p]].usedHeight();
+        }
+    }
+    pages.reserve(pagePacker.size());
+    for (size_t p = 0; p < pagePacker.size(); p++)
+    {
+        const Texture& format = *pageFormat[p];
+        pages.emplace_back(
+            firstIndex + p,
+            pageWidth[p],
+            pageHeight[p],
+            format.m_numChannels,
+            format.m_numBytesPerChan,
+            format.m_texelSize
+        );
+        const size_t pixelSize = size_t(format.m_numChannels) * format.m_numBytesPerChan;
+        std::fill_n(pages.back().m_data, size_t(pageWidth[p]) * pageHeight[p] * pixelSize, 0);
+    }
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        regions[i].m_pageWidth = pageWidth[regions[i].m_page];
+        regions[i].m_pageHeight = pageHeight[regions[i].m_page];
+    }
+
+    // Copy the pixels. The padded areas don't overlap, so the textures can
+    // be copied concurrently.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long i = 0; i < (long)textures.size(); i++)
+    {
+        const Texture& texture = *textures[i];
+        const AtlasRegion& region = regions[i];
+        Texture& page = pages[region.m_page];
+        const int pad = pagePadding[region.m_page];
+        const size_t srcPixel = texture.m_numChannels * texture.m_numBytesPerChan;
+        const size_t srcRow = texture.m_width * srcPixel;
+        const size_t dstRow = region.m_pageWidth * srcPixel;
+
+        // Empty textures keep their cleared pixel. Textures are only placed on
+        // pages of their own pixel format, never copy with a different stride.
+        if (texture.m_width == 0 || texture.m_height == 0
+            || texture.m_numChannels != page.m_numChannels
+            || texture.m_numBytesPerChan != page.m_numBytesPerChan)
+        {
+            continue;
+        }
+
+        for (int row = -pad; row < (int)texture.m_height + pad; row++)
+        {
+            // Rows and columns outside the texture repeat its border
+            const int srcY = std::min(std::max(row, 0), (int)texture.m_height - 1);
+            const unsigned char* src = texture.m_data + srcY * srcRow;
+            unsigned char* dst = page.m_data + ((long)region.m_y + row) * dstRow + region.m_x * srcPixel;
+
+            for (int col = -pad; col < 0; col++)
+            {
+                std::memcpy(dst + col * (long)srcPixel, src, srcPixel);
+            }
+            std::memcpy(dst, src, srcRow);
+            for (int col = texture.m_width; col < (int)texture.m_width + pad; col++)
+            {
+                std::memcpy(dst + col * srcPixel, src + srcRow - srcPixel, srcPixel);
+            }
+        }
+    }
+
+    return pages;
+}
+
+} // namespace lvr2
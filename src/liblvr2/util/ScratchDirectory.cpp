@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * ScratchDirectory.cpp
+ *
+ *  @date 18.10.2026
+ */
+
+#include "lvr2/util/ScratchDirectory.hpp"
+
+#include <iostream>
+
+#include <boost/filesystem/operations.hpp>
+
+namespace lvr2
+{
+
+ScratchDirectory::ScratchDirectory(const std::string& parent, const std::string& prefix)
+    : m_keep(false)
+{
+    boost::filesystem::path parentDir(parent);
+    if (parentDir.empty())
+    {
+        parentDir = boost::filesystem::current_path();
+    }
+    boost::filesystem::create_directories(parentDir);
+
+    // create_directory() fails silently (returns false) if the generated
+    // name is already taken, e.g. by a concurrent process, so retry
+    do
+    {
+        m_path = parentDir / boost::filesystem::unique_path(prefix + "-%%%%-%%%%-%%%%-%%%%");
+    }
+    while (!boost::filesystem::create_directory(m_path));
+}
+
+ScratchDirectory::~ScratchDirectory()
+{
+    if (m_keep)
+    {
+        return;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(m_path, ec);
+    if (ec)
+    {
+        std::cerr << "ScratchDirectory: Could not remove " << m_path.string() << ": "
+                  << ec.message() << std::endl;
+    }
+}
+
+std::string ScratchDirectory::file(const std::string& name) const
+{
+    return (m_path / name).string();
+}
+
+} // namespace lvr2
@@ -0,0 +1,257 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * StageTimer.cpp
+ *
+ *  @date 18.10.2026
+ */
+
+#include "lvr2/util/StageTimer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace lvr2
+{
+
+namespace
+{
+
+double wallClockTime()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void writeJSONString(std::ostream& os, const std::string& str)
+{
+    os << '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"':  os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                   << static_cast<int>(c) << std::dec << std::setfill(' ');
+            }
+            else
+            {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+void writeRegistryAtExit()
+{
+    StageTimerRegistry& registry = StageTimerRegistry::instance();
+    std::string filename = registry.exitFile();
+    if (!filename.empty())
+    {
+        registry.writeJSON(filename);
+    }
+}
+
+} // anonymous namespace
+
+StageTimerRegistry& StageTimerRegistry::instance()
+{
+    static StageTimerRegistry registry;
+    return registry;
+}
+
+void StageTimerRegistry::add(const std::string& stage, double wallTime, double cpuTime, size_t items, size_t peakRss)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    auto it = m_index.find(stage);
+    if (it == m_index.end())
+    {
+        it = m_index.emplace(stage, m_records.size()).first;
+        m_records.emplace_back();
+        m_records.back().name = stage;
+    }
+
+    StageRecord& record = m_records[it->second];
+    record.calls++;
+    record.wallTime += wallTime;
+    record.cpuTime += cpuTime;
+    record.items += items;
+    record.peakRss = std::max(record.peakRss, peakRss);
+}
+
+std::vector<StageRecord> StageTimerRegistry::records() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_records;
+}
+
+void StageTimerRegistry::clear()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_records.clear();
+    m_index.clear();
+}
+
+void StageTimerRegistry::writeJSON(std::ostream& os) const
+{
+    std::vector<StageRecord> stages = records();
+
+    os << "{" << std::endl;
+    os << "  \"peak_rss_bytes\": " << processPeakRss() << "," << std::endl;
+    os << "  \"cpu_time_s\": " << processCpuTime() << "," << std::endl;
+    os << "  \"stages\": [";
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        const StageRecord& s = stages[i];
+        os << (i == 0 ? "" : ",") << std::endl;
+        os << "    { \"name\": ";
+        writeJSONString(os, s.name);
+        os << ", \"calls\": " << s.calls
+           << ", \"wall_time_s\": " << s.wallTime
+           << ", \"cpu_time_s\": " << s.cpuTime
+           << ", \"items\": " << s.items
+           << ", \"peak_rss_bytes\": " << s.peakRss
+           << " }";
+    }
+    os << std::endl << "  ]" << std::endl;
+    os << "}" << std::endl;
+}
+
+bool StageTimerRegistry::writeJSON(const std::string& filename) const
+{
+    std::ofstream out(filename);
+    if (!out.good())
+    {
+        std::cout << "StageTimerRegistry: Unable to open " << filename << " for writing." << std::endl;
+        return false;
+    }
+    writeJSON(out);
+    return out.good();
+}
+
+void StageTimerRegistry::writeJSONAtExit(const std::string& filename)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_exitFile = filename;
+    if (!m_exitHandlerRegistered && !filename.empty())
+    {
+        // The registry is a function local static that was constructed
+        // before this call, so it is still alive when the handler runs.
+        std::atexit(writeRegistryAtExit);
+        m_exitHandlerRegistered = true;
+    }
+}
+
+std::string StageTimerRegistry::exitFile() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_exitFile;
+}
+
+double StageTimerRegistry::processCpuTime()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+    }
+#endif
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+size_t StageTimerRegistry::processPeakRss()
+{
+#if defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        // Bytes on macOS
+        return static_cast<size_t>(usage.ru_maxrss);
+    }
+#elif defined(__unix__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        // Kilobytes on Linux
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    }
+#endif
+    return 0;
+}
+
+StageTimer::StageTimer(const std::string& stage)
+    : m_stage(stage),
+      m_wallStart(wallClockTime()),
+      m_cpuStart(StageTimerRegistry::processCpuTime()),
+      m_items(0),
+      m_stopped(false)
+{
+}
+
+StageTimer::~StageTimer()
+{
+    stop();
+}
+
+void StageTimer::stop()
+{
+    if (m_stopped)
+    {
+        return;
+    }
+    m_stopped = true;
+
+    StageTimerRegistry::instance().add(
+        m_stage,
+        wallClockTime() - m_wallStart,
+        StageTimerRegistry::processCpuTime() - m_cpuStart,
+        m_items.load(),
+        StageTimerRegistry::processPeakRss()
+    );
+}
+
+} // namespace lvr2
@@ -121,6 +121,13 @@ int main(int argc, char** argv)
 
             }
          lvr2::ChunkManager chunker(meshes, size, maxChunkOverlap, outputPath.string(), layers);
+         if (options.getLodLevels() >= 0)
+         {
+             for (const std::string& layer : layers)
+             {
+                 chunker.buildLevelsOfDetail(layer, options.getLodResolution(), options.getLodLevels());
+             }
+         }
         }
     }
     return EXIT_SUCCESS;
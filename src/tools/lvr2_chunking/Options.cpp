@@ -62,7 +62,9 @@ Options::Options(int argc, char** argv) : m_descr("Supported options")
         "y_max", value<float>()->default_value(10.0f), "bounding box maximum value in y-dimension")(
         "z_max", value<float>()->default_value(10.0f), "bounding box maximum value in z-dimension")(
         "cacheSize", value<int>()->default_value(200), "while loading the maximum number of chunks in RAM")(
-        "meshName", value<std::string>()->default_value(""), "group name of the mesh if the HDF5 contains multiple meshes");
+        "meshName", value<std::string>()->default_value(""), "group name of the mesh if the HDF5 contains multiple meshes")(
+        "lodLevels", value<int>()->default_value(-1), "number of levels of detail to build, 0 builds levels until one chunk covers the mesh, -1 builds none")(
+        "lodResolution", value<int>()->default_value(64), "number of vertex clusters along the side of a chunk on every level of detail");
 
     // Parse command line and generate variables map
     store(command_line_parser(argc, argv).options(m_descr).positional(m_posDescr).run(),
@@ -164,6 +166,21 @@ std::string Options::getMeshGroup() const
     return m_variables["meshName"].as<std::string>();
 }
 
+int Options::getLodLevels() const
+{
+    return m_variables["lodLevels"].as<int>();
+}
+
+int Options::getLodResolution() const
+{
+    int resolution = m_variables["lodResolution"].as<int>();
+    if(resolution > 0)
+    {
+        return resolution;
+    }
+    return 64;
+}
+
 Options::~Options()
 {
     // TODO Auto-generated destructor stub
@@ -128,6 +128,14 @@ class Options
      * @brief   Returns the mesh group in the HDF5
      */
     std::string getMeshGroup() const;
+    /**
+     * @brief   Returns the number of levels of detail to build, -1 if none should be built
+     */
+    int getLodLevels() const;
+    /**
+     * @brief   Returns the number of vertex clusters along a chunk side on every level of detail
+     */
+    int getLodResolution() const;
 
 private:
     /// The internally used variable map
@@ -28,6 +28,7 @@ namespace gs_reconstruction{
                 ("deleteLongEdgesFactor",value<int>(&m_deleteLongEdgesFactor)->default_value(10), "0 = no deleting, default: 10")
                 ("interior",value<bool>(&m_interior)->default_value(false), "false: reconstruct exterior, true: reconstruct interior")
                 ("balances",value<int>(&m_balances)->default_value(20), "Number of TumbleTree-Balances during the reconstruction. default: 20")
+                ("batchSize",value<int>(&m_batchSize)->default_value(1), "Random points per parallel basic step, 1 = sequential basic steps. default: 1")
                 ("kd", value<int>(&m_kd)->default_value(5), "Number of normals used for distance function evaluation")
                 ("ki", value<int>(&m_ki)->default_value(10), "Number of normals used in the normal interpolation process")
                 ("kn", value<int>(&m_kn)->default_value(10), "Size of k-neighborhood used for normal estimation")
@@ -100,6 +101,10 @@ namespace gs_reconstruction{
         return m_variables["balances"].as<int>();
     }
 
+    int Options::getBatchSize() const {
+        return m_variables["batchSize"].as<int>();
+    }
+
 
 
 
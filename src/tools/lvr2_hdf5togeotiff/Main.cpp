@@ -9,6 +9,8 @@
 #include <boost/foreach.hpp>
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <future>
 #include <string>
 #include <fstream>
 
@@ -27,21 +29,27 @@ using namespace lvr2;
  * @param output_filename Path to the output GeoTIFF file
  * @param min_channel lowest channel to be extracted
  * @param max_channel highest channel to be extracted
+ * @param bands_per_read number of bands read from the HDF5 file at once
  * @return standard C++ return value
  */
 int processConversion(std::string input_filename,
-        std::string position_code, std::string output_filename, size_t min_channel, size_t max_channel)
+        std::string position_code, std::string output_filename, size_t min_channel, size_t max_channel,
+        size_t bands_per_read)
 {
     /*------------------- HDF5 INPUT ------------------------*/
     HDF5IO hdf5(input_filename, false);
-    std::vector<size_t> dim;
 
-    // extract radiometric data
+    // extract array dimension information without reading the radiometric data
     std::string groupname = "raw/spectral/position_" + position_code;
     std::string datasetname = "spectral";
-    boost::shared_array<uint16_t> spectrals = hdf5.getArray<uint16_t>(groupname, datasetname, dim);
+    std::vector<size_t> dim = hdf5.getDimensions(groupname, datasetname);
+
+    if (dim.size() != 3)
+    {
+        std::cout << "No spectral data found in " << groupname << "." << std::endl;
+        return -1;
+    }
 
-    // extract array dimension information
     size_t num_channels = dim[0];
     size_t num_rows = dim[1];
     size_t num_cols = dim[2];
@@ -52,29 +60,66 @@ int processConversion(std::string input_filename,
         std::cout << "The dataset has only " << num_channels << " channels. Using this as upper boundary." << std::endl;
         max_channel = num_channels;
     }
+    if (max_channel <= min_channel)
+    {
+        std::cout << "No channels left to convert." << std::endl;
+        return -1;
+    }
     num_channels = max_channel - min_channel;
 
     GeoTIFFIO gtifio(output_filename, num_cols, num_rows, num_channels);
 
     /*--------------- FILE CONVERSION --------------------*/
-    // for each channel create a cv::Mat containing the spectral intensity data for the channel ...
-    for(size_t channel = 0; channel < num_channels; channel++)
+    // The bands are read in blocks of bands_per_read bands via hyperslab selection.
+    // While one block is written to the GeoTIFF file, the next one is read into
+    // the second buffer in the background. Only one thread accesses HDF5 at a time.
+    size_t band_size = num_rows * num_cols;
+    std::vector<uint16_t> buffers[2];
+
+    auto readBlock = [&](size_t first, size_t count, std::vector<uint16_t>* buffer)
+    {
+        buffer->resize(count * band_size);
+        return hdf5.getArraySlice<uint16_t>(groupname, datasetname, min_channel + first, count, buffer->data());
+    };
+
+    std::future<bool> pending = std::async(std::launch::async, readBlock,
+            0, std::min(bands_per_read, num_channels), &buffers[0]);
+
+    int current = 0;
+    for(size_t first = 0; first < num_channels; first += bands_per_read)
     {
-        cv::Mat *mat = new cv::Mat(num_rows, num_cols, CV_16UC1);
-        for(size_t row = 0; row < num_rows; row++)
+        size_t count = std::min(bands_per_read, num_channels - first);
+        if (!pending.get())
         {
-            for(size_t col = 0; col < num_cols; col++)
-            {
-                mat->at<uint16_t>(row, col) = spectrals.get()[(channel + min_channel) * num_cols * num_rows + row * num_cols + col];
-            }
+            std::cout << "Unable to read channels " << min_channel + first << " to "
+                      << min_channel + first + count - 1 << "." << std::endl;
+            return -1;
         }
-        // ... and write it to the output GeoTIFF file
-        int ret = gtifio.writeBand(mat, channel + 1);
-        delete mat;
-        if (ret != 0)
+
+        // start reading the next block ...
+        size_t next = first + count;
+        if (next < num_channels)
         {
-            return ret;
+            pending = std::async(std::launch::async, readBlock,
+                    next, std::min(bands_per_read, num_channels - next), &buffers[1 - current]);
         }
+
+        // ... while the current one is written to the output GeoTIFF file
+        for (size_t band = 0; band < count; band++)
+        {
+            cv::Mat mat(num_rows, num_cols, CV_16UC1, buffers[current].data() + band * band_size);
+            int ret = gtifio.writeBand(&mat, first + band + 1);
+            if (ret != 0)
+            {
+                if (pending.valid())
+                {
+                    pending.wait();
+                }
+                return ret;
+            }
+        }
+
+        current = 1 - current;
     }
     return 0;
 }
@@ -93,6 +138,7 @@ int main(int argc, char**argv)
     
     size_t min_channel = options.getMinChannel();
     size_t max_channel = options.getMaxChannel();
+    size_t bands_per_read = options.getBandsPerRead();
 
     std::string position_code = options.getPositionCode();
 
@@ -105,7 +151,7 @@ int main(int argc, char**argv)
     }
 
     std::cout << "Starting conversion..." <<  std::endl;
-    if (processConversion(input_filename.string(), position_code, output_filename.string(), min_channel, max_channel) < 0)
+    if (processConversion(input_filename.string(), position_code, output_filename.string(), min_channel, max_channel, bands_per_read) < 0)
     {
         std::cout << "An Error occurred during conversion." << std::endl;
     }
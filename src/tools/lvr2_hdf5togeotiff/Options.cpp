@@ -44,7 +44,8 @@ namespace hdf5togeotiff
                 ("gtif", value<string>()->default_value("gtif.tif"), "Output GeoTIFF raster dataset containing hyperspectral data.")
                 ("min", value<size_t>()->default_value(0), "Minimum hyperspectral band to be included in conversion.")
                 ("max", value<size_t>()->default_value(UINT_MAX), "Maximum hyperspectral band to be included in conversion.")
-                ("pos", value<string>()->default_value("00000"), "5 character identification code of scan position to be converted.");
+                ("pos", value<string>()->default_value("00000"), "5 character identification code of scan position to be converted.")
+                ("bandsPerRead", value<size_t>()->default_value(1), "Number of hyperspectral bands read from the HDF5 file at once. Two such blocks are kept in memory.");
 
         // Parse command line and generate variables map
         store(command_line_parser(argc, argv).options(m_descr).positional(m_pdescr).run(), m_variables);
@@ -55,6 +56,7 @@ namespace hdf5togeotiff
             || m_variables["pos"].as<string>().length() != 5
             || m_variables["min"].as<size_t>() < 0
             || m_variables["max"].as<size_t>() <= m_variables["min"].as<size_t>()
+            || m_variables["bandsPerRead"].as<size_t>() == 0
             || !boost::filesystem::exists(boost::filesystem::path(m_variables["h5"].as<string>()))
         )
         {
@@ -36,6 +36,7 @@ namespace hdf5togeotiff
         size_t  getMinChannel()     const { return m_variables["min"].as<size_t>(); }
         size_t  getMaxChannel()     const { return m_variables["max"].as<size_t>(); }
         string  getPositionCode()   const { return m_variables["pos"].as<string>(); }
+        size_t  getBandsPerRead()   const { return m_variables["bandsPerRead"].as<size_t>(); }
 
     private:
         /// The internally used variable map
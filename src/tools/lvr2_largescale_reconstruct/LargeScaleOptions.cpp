@@ -187,7 +187,17 @@ Options::Options(int argc, char** argv) : BaseOption(argc, argv)
         "volumenSize",
         value<size_t>(&m_volumenSize)->default_value(0),
         "The volumen of the partitions. Volume = (voxelsize*volumenSize)^3 if not set kd-tree will "
-        "be used")("onlyNormals", "If true, only normals will be generated");
+        "be used")("onlyNormals", "If true, only normals will be generated")(
+        "timings",
+        value<string>()->default_value(""),
+        "Write wall time, CPU time, item counts and peak memory of all pipeline stages as JSON to "
+        "the given file at exit")(
+        "scratchDir",
+        value<string>()->default_value(""),
+        "Directory for intermediate files (memory mapped point files, partition cells). Defaults to "
+        "the current working directory")(
+        "compressCells",
+        "Losslessly compress the intermediate cell files");
 
     setup();
 }
@@ -213,6 +223,12 @@ bool Options::getBigMesh() const { return m_variables["bigMesh"].as<bool>();}
 
 bool Options::getDebugChunks() const { return m_variables["debugChunks"].as<bool>();}
 
+string Options::getTimingsFile() const { return m_variables["timings"].as<string>(); }
+
+string Options::getScratchDir() const { return m_variables["scratchDir"].as<string>(); }
+
+bool Options::compressCells() const { return m_variables.count("compressCells"); }
+
 bool Options::useGPU() const { return m_variables.count("useGPU"); }
 
 vector<float> Options::getVoxelSizes() const
@@ -75,6 +75,23 @@ class Options : public lvr2::BaseOption
      */
     bool getDebugChunks() const;
 
+    /**
+     * @brief   Returns the name of the file the stage timings are written to
+     *          (empty if disabled)
+     */
+    string getTimingsFile() const;
+
+    /**
+     * @brief   Returns the directory for intermediate files
+     *          (empty for the current working directory)
+     */
+    string getScratchDir() const;
+
+    /**
+     * @brief   Returns if the intermediate cell files should be compressed
+     */
+    bool compressCells() const;
+
     /**
      * @brief   Returns if the GPU shuold be used for the normal estimation
      */
@@ -32,6 +32,7 @@
 #include <iostream>
 #include "lvr2/geometry/BaseVector.hpp"
 #include "lvr2/config/lvropenmp.hpp"
+#include "lvr2/util/StageTimer.hpp"
 #include <random>
 #include <string>
 #include <lvr2/io/hdf5/ScanIO.hpp>
@@ -93,12 +94,18 @@ int main(int argc, char** argv)
 
     OpenMPConfig::setNumThreads(options.getNumThreads());
 
+    if (!options.getTimingsFile().empty())
+    {
+        StageTimerRegistry::instance().writeJSONAtExit(options.getTimingsFile());
+    }
+
     LargeScaleReconstruction<Vec> lsr(options.getVoxelSizes(), options.getBGVoxelsize(), options.getScaling(),
                                       options.getNodeSize(), options.getPartMethod(), options.getKi(), options.getKd(), options.getKn(),
                                       options.useRansac(), options.getFlippoint(), options.extrude(), options.getDanglingArtifacts(),
                                       options.getCleanContourIterations(), options.getFillHoles(), options.optimizePlanes(),
                                       options.getNormalThreshold(), options.getPlaneIterations(), options.getMinPlaneSize(), options.getSmallRegionThreshold(),
-                                      options.retesselate(), options.getLineFusionThreshold(), options.getBigMesh(), options.getDebugChunks(), options.useGPU());
+                                      options.retesselate(), options.getLineFusionThreshold(), options.getBigMesh(), options.getDebugChunks(), options.useGPU(),
+                                      options.getScratchDir(), options.compressCells());
 
     
 
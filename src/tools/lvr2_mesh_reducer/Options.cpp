@@ -53,7 +53,10 @@ Options::Options(int argc, char** argv) : BaseOption(argc, argv)
         "reductionRatio,r",
         value<float>(&m_edgeCollapseReductionRatio)->default_value(0.0),
         "Percentage of faces to remove via edge-collapse (0.0 means no reduction, 1.0 means to "
-        "remove all faces which can be removed)");
+        "remove all faces which can be removed)")(
+        "batched,b",
+        "Collapse many independent edges per round instead of strictly the cheapest edge first. "
+        "Much faster for large reductions.");
     setup();
 }
 
@@ -67,6 +70,11 @@ float Options::getEdgeCollapseReductionRatio() const
     return (m_variables["reductionRatio"].as<float>());
 }
 
+bool Options::useBatchedCollapse() const
+{
+    return m_variables.count("batched");
+}
+
 bool Options::printUsage() const
 {
     if (m_variables.count("help"))
@@ -76,6 +76,11 @@ class Options : public lvr2::BaseOption
      */
     float getEdgeCollapseReductionRatio() const;
 
+    /**
+     * @brief Whether to use batched independent-set edge collapses
+     */
+    bool useBatchedCollapse() const;
+
     bool printUsage() const;
 
   private:
@@ -88,6 +93,8 @@ inline ostream& operator<<(ostream& os, const Options& o)
     {
         cout << "##### Edge collapse reduction ratio\t: " << o.getEdgeCollapseReductionRatio()
              << endl;
+        cout << "##### Batched edge collapse\t\t: " << (o.useBatchedCollapse() ? "YES" : "NO")
+             << endl;
     }
 
     return os;
@@ -68,6 +68,7 @@
 #include "lvr2/io/ModelFactory.hpp"
 #include "lvr2/io/PlutoMapIO.hpp"
 #include "lvr2/util/Factories.hpp"
+#include "lvr2/util/StageTimer.hpp"
 #include "lvr2/algorithm/GeometryAlgorithms.hpp"
 #include "lvr2/algorithm/UtilAlgorithms.hpp"
 
@@ -314,12 +315,20 @@ int main(int argc, char** argv)
     // =======================================================================
     OpenMPConfig::setNumThreads(options.getNumThreads());
 
+    if (!options.getTimingsFile().empty())
+    {
+        StageTimerRegistry::instance().writeJSONAtExit(options.getTimingsFile());
+    }
+
+    StageTimer loadTimer("load_point_cloud");
     auto surface = loadPointCloud<Vec>(options);
     if (!surface)
     {
         cout << "Failed to create pointcloud. Exiting." << endl;
         return EXIT_FAILURE;
     }
+    loadTimer.addItems(surface->pointBuffer()->numPoints());
+    loadTimer.stop();
 
     // Save points and normals only
     if(options.savePointNormals())
@@ -336,10 +345,18 @@ int main(int argc, char** argv)
 
     shared_ptr<GridBase> grid;
     unique_ptr<FastReconstructionBase<Vec>> reconstruction;
-    std::tie(grid, reconstruction) = createGridAndReconstruction(options, surface);
+    {
+        StageTimer timer("grid_and_distance_values");
+        std::tie(grid, reconstruction) = createGridAndReconstruction(options, surface);
+        timer.addItems(surface->pointBuffer()->numPoints());
+    }
 
     // Reconstruct mesh
-    reconstruction->getMesh(mesh);
+    {
+        StageTimer timer("mesh_extraction");
+        reconstruction->getMesh(mesh);
+        timer.addItems(mesh.numFaces());
+    }
 
     // Save grid to file
     if(options.saveGrid() && grid)
@@ -350,6 +367,7 @@ int main(int argc, char** argv)
     // =======================================================================
     // Optimize mesh
     // =======================================================================
+    StageTimer cleanupTimer("mesh_cleanup");
     if(options.getDanglingArtifacts())
     {
         cout << timestamp << "Removing dangling artifacts" << endl;
@@ -365,6 +383,9 @@ int main(int argc, char** argv)
         naiveFillSmallHoles(mesh, options.getFillHoles(), false);
     }
 
+    cleanupTimer.addItems(mesh.numFaces());
+    cleanupTimer.stop();
+
     // Calculate initial face normals
     auto faceNormals = calcFaceNormals(mesh);
 
@@ -372,6 +393,8 @@ int main(int argc, char** argv)
     const auto reductionRatio = options.getEdgeCollapseReductionRatio();
     if (reductionRatio > 0.0)
     {
+        StageTimer timer("mesh_reduction");
+
         if (reductionRatio > 1.0)
         {
             throw "The reduction ratio needs to be between 0 and 1!";
@@ -381,8 +404,10 @@ int main(int argc, char** argv)
         // TODO: maybe we should calculate this differently...
         const auto count = static_cast<size_t>((mesh.numFaces() / 2) * reductionRatio);
         auto collapsedCount = simpleMeshReduction(mesh, count, faceNormals);
+        timer.addItems(collapsedCount);
     }
 
+    StageTimer planeTimer("plane_optimization");
     ClusterBiMap<FaceHandle> clusterBiMap;
     if(options.optimizePlanes())
     {
@@ -391,7 +416,10 @@ int main(int argc, char** argv)
             faceNormals,
             options.getNormalThreshold(),
             options.getPlaneIterations(),
-            options.getMinPlaneSize()
+            options.getMinPlaneSize(),
+            100, // RANSAC iterations
+            10,  // RANSAC samples
+            !options.parallelPlaneClustering()
         );
 
         if(options.getSmallRegionThreshold() > 0)
@@ -413,19 +441,29 @@ int main(int argc, char** argv)
     }
     else
     {
-        clusterBiMap = planarClusterGrowing(mesh, faceNormals, options.getNormalThreshold());
+        clusterBiMap = planarClusterGrowing(
+            mesh,
+            faceNormals,
+            options.getNormalThreshold(),
+            !options.parallelPlaneClustering()
+        );
     }
+    planeTimer.addItems(mesh.numFaces());
+    planeTimer.stop();
 
     // =======================================================================
     // Finalize mesh
     // =======================================================================
     // Prepare color data for finalizing
+    StageTimer attributeTimer("vertex_attributes");
     ClusterPainter painter(clusterBiMap);
     auto clusterColors = boost::optional<DenseClusterMap<Rgb8Color>>(painter.simpsons(mesh));
     auto vertexColors = calcColorFromPointCloud(mesh, surface);
 
     // Calc normals for vertices
     auto vertexNormals = calcVertexNormals(mesh, faceNormals, *surface);
+    attributeTimer.addItems(mesh.numVertices());
+    attributeTimer.stop();
 
     // Prepare finalize algorithm
     TextureFinalizer<Vec> finalize(clusterBiMap);
@@ -496,15 +534,26 @@ int main(int argc, char** argv)
 
             // materializer.setTexturizer(img_texter);
         }
+
+        if (options.getTexAtlasSize() > 0)
+        {
+            materializer.setTextureAtlas(options.getTexAtlasSize());
+        }
     }
 
     // Generate materials
+    StageTimer materialTimer("materials");
     MaterializerResult<Vec> matResult = materializer.generateMaterials();
+    materialTimer.addItems(clusterBiMap.numCluster());
+    materialTimer.stop();
 
     // Add material data to finalize algorithm
     finalize.setMaterializerResult(matResult);
     // Run finalize algorithm
+    StageTimer finalizeTimer("finalize");
     auto buffer = finalize.apply(mesh);
+    finalizeTimer.addItems(buffer->numFaces());
+    finalizeTimer.stop();
 
     // When using textures ...
     if (options.generateTextures())
@@ -528,11 +577,14 @@ int main(int argc, char** argv)
         cout << "REPAIR SAVING" << endl;
     }
 
+    StageTimer saveTimer("save_mesh");
     for(const std::string& output_filename : options.getOutputFileNames())
     {
         cout << timestamp << "Saving mesh to "<< output_filename << "." << endl;
         ModelFactory::saveModel(m, output_filename);
     }
+    saveTimer.addItems(buffer->numFaces());
+    saveTimer.stop();
 
     if (matResult.m_keypoints)
     {
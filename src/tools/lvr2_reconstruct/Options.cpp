@@ -72,6 +72,7 @@ Options::Options(int argc, char** argv)
         ("clusterPlanes,c", "Cluster planar regions based on normal threshold, do not shift vertices into regression plane.")
         ("cleanContours", value<int>(&m_cleanContourIterations)->default_value(0), "Remove noise artifacts from contours. Same values are between 2 and 4")
         ("planeIterations", value<int>(&m_planeIterations)->default_value(3), "Number of iterations for plane optimization")
+        ("parallelPlaneClustering", "Compare the normals of adjacent faces instead of the normal of a cluster's first face and build the planar clusters in parallel.")
         ("fillHoles,f", value<int>(&m_fillHoles)->default_value(0), "Maximum size for hole filling")
         ("rda", value<int>(&m_rda)->default_value(0), "Remove dangling artifacts, i.e. remove the n smallest not connected surfaces")
         ("pnt", value<float>(&m_planeNormalThreshold)->default_value(0.85), "(Plane Normal Threshold) Normal threshold for plane optimization. Default 0.85 equals about 3 degrees.")
@@ -90,6 +91,7 @@ Options::Options(int argc, char** argv)
         ("generateTextures", "Generate textures during finalization.")
         ("texMinClusterSize", value<int>(&m_texMinClusterSize)->default_value(100), "Minimum number of faces of a cluster to create a texture from")
         ("texMaxClusterSize", value<int>(&m_texMaxClusterSize)->default_value(0), "Maximum number of faces of a cluster to create a texture from (0 = no limit)")
+        ("texAtlasSize", value<int>(&m_texAtlasSize)->default_value(0), "Pack the generated textures into atlas pages of at most this many texels per side (0 = one texture per cluster)")
         ("textureAnalysis", "Enable texture analysis features for texture matchung.")
         ("texelSize", value<float>(&m_texelSize)->default_value(1), "Texel size that determines texture resolution.")
         ("classifier", value<string>(&m_classifier)->default_value("PlaneSimpsons"),"Classfier object used to color the mesh.")
@@ -114,6 +116,7 @@ Options::Options(int argc, char** argv)
         ("flipPoint", value< vector<float> >()->multitoken(), "Flippoint --flipPoint x y z" )
         ("texFromImages,q", "Foo Bar ............")
         ("projectDir,a", value<string>()->default_value(""), "Foo Bar ............")
+        ("timings", value<string>()->default_value(""), "Write wall time, CPU time, item counts and peak memory of all pipeline stages as JSON to the given file at exit")
     ;
 
     setup();
@@ -294,6 +297,11 @@ bool Options::optimizePlanes() const
         || m_variables.count("retesselate");
 }
 
+bool Options::parallelPlaneClustering() const
+{
+    return m_variables.count("parallelPlaneClustering");
+}
+
 bool Options::clusterPlanes() const
 {
     return m_variables.count("clusterPlanes");
@@ -433,6 +441,11 @@ int Options::getTexMaxClusterSize() const
     return m_variables["texMaxClusterSize"].as<int>();
 }
 
+int Options::getTexAtlasSize() const
+{
+    return m_variables["texAtlasSize"].as<int>();
+}
+
 bool Options::vertexColorsFromPointcloud() const
 {
     return m_variables.count("vcfp");
@@ -474,6 +487,11 @@ string Options::getProjectDir() const
     return m_variables["projectDir"].as<string>();
 }
 
+string Options::getTimingsFile() const
+{
+    return m_variables["timings"].as<string>();
+}
+
 Options::~Options() {
     // TODO Auto-generated destructor stub
 }
@@ -121,6 +121,13 @@ public:
      */
     bool    optimizePlanes() const;
 
+    /**
+     * @brief   Returns true if planar clusters should be grown in parallel
+     *          by comparing adjacent faces instead of the first face of
+     *          each cluster
+     */
+    bool    parallelPlaneClustering() const;
+
     /**
      * @brief   Indicates whether to save the used points
      *          together with the interpolated normals.
@@ -320,6 +327,8 @@ public:
 
     int getTexMaxClusterSize() const;
 
+    int getTexAtlasSize() const;
+
     bool vertexColorsFromPointcloud() const;
 
     bool useGPU() const;
@@ -330,6 +339,12 @@ public:
 
     string getProjectDir() const;
 
+    /**
+     * @brief   Returns the name of the file the stage timings are written to
+     *          (empty if disabled).
+     */
+    string getTimingsFile() const;
+
 private:
 
     /// The set voxelsize
@@ -446,6 +461,9 @@ private:
 
     int m_texMaxClusterSize;
 
+    ///Maximum edge length of a texture atlas page (0 = no atlas)
+    int m_texAtlasSize;
+
     ///Use pointcloud colors to paint vertices
     bool m_vertexColorsFromPointcloud;
 
@@ -530,6 +548,7 @@ inline ostream& operator<<(ostream& os, const Options &o)
     {
         cout << "##### Optimize Planes \t\t: YES" << endl;
         cout << "##### Plane iterations\t\t: " << o.getPlaneIterations() << endl;
+        cout << "##### Parallel clustering\t: " << (o.parallelPlaneClustering() ? "YES" : "NO") << endl;
         cout << "##### Normal threshold \t\t: " << o.getNormalThreshold() << endl;
         cout << "##### Region threshold\t\t: " << o.getSmallRegionThreshold() << endl;
         cout << "##### Region min size\t\t: " << o.getMinPlaneSize() << endl;
@@ -561,6 +580,10 @@ inline ostream& operator<<(ostream& os, const Options &o)
         cout << "##### Texel size \t\t: " << o.getTexelSize() << endl;
         cout << "##### Texture Min#Cluster \t: " << o.getTexMinClusterSize() << endl;
         cout << "##### Texture Max#Cluster \t: " << o.getTexMaxClusterSize() << endl;
+        if(o.getTexAtlasSize() > 0)
+        {
+            cout << "##### Texture atlas size \t: " << o.getTexAtlasSize() << endl;
+        }
 
         if(o.doTextureAnalysis())
         {
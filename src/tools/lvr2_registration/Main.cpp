@@ -151,6 +151,13 @@ int main(int argc, char** argv)
         ("metascan", bool_switch(&options.metascan),
          "Match Scans to the combined Pointcloud of all previous Scans instead of just the last Scan.")
 
+        ("metascanWindow", value<int>(&options.metascanWindow)->default_value(options.metascanWindow),
+         "Only keep the last <arg> Scans in the combined Pointcloud of --metascan to bound the memory usage.\n"
+         "0 (default): keep all Scans.")
+
+        ("sharePoints", bool_switch(&options.sharePoints),
+         "Read the Points of the Scans directly instead of copying them. Saves memory if no reduction is used.")
+
         ("noFrames,F", bool_switch(&no_frames),
          "Don't write \".frames\" files.")
 
@@ -208,6 +215,10 @@ int main(int argc, char** argv)
          "Pairs are judged using slamMaxDistance.\n"
          "-1 (default): use --closeLoopDistance instead.")
 
+        ("estimateOverlap", bool_switch(&options.estimateOverlap),
+         "Use a voxel based estimate of the pair overlap for --closeLoopPairs instead of counting the pairs.\n"
+         "Faster, but the estimate is an upper bound and may accept Scans with fewer pairs.")
+
         ("loopSize,l", value<int>(&options.loopSize)->default_value(options.loopSize),
          "The minimum number of Scans to be considered a Loop to prevent Loopclosing from triggering on adjacent Scans.\n"
          "Also used in GraphSLAM when considering other Scans for Edges\n"
@@ -221,6 +232,9 @@ int main(int argc, char** argv)
 
         ("slamEpsilon", value<double>(&options.slamEpsilon)->default_value(options.slamEpsilon),
          "The epsilon difference of SLAM corrections for the stop criterion of SLAM.")
+
+        ("slamTreeCache", value<double>(&options.slamTreeCacheSize)->default_value(options.slamTreeCacheSize),
+         "Memory in MB for the search trees that GraphSLAM keeps between iterations.")
         ;
 
         options_description hidden_options("hidden_options");
@@ -439,7 +453,7 @@ int main(int argc, char** argv)
             proj.project->positions.push_back(std::make_shared<ScanPosition>(pos));
             proj.changed.push_back(false);
 
-            SLAMScanPtr slamScan = SLAMScanPtr(new SLAMScanWrapper(tempScan));
+            SLAMScanPtr slamScan = SLAMScanPtr(new SLAMScanWrapper(tempScan, options.sharePoints));
 
            // scans.push_back(slamScan);
            // align.addScan(slamScan);
@@ -486,7 +500,7 @@ int main(int argc, char** argv)
             scan->points = model->m_pointCloud;
             scan->poseEstimation = pose;
 
-            SLAMScanPtr slamScan = SLAMScanPtr(new SLAMScanWrapper(scan));
+            SLAMScanPtr slamScan = SLAMScanPtr(new SLAMScanWrapper(scan, options.sharePoints));
             scans.push_back(slamScan);
             align.addScan(slamScan);
         }
@@ -0,0 +1,132 @@
+#include "LVRChunkLoadScheduler.hpp"
+
+#include "lvr2/io/Timestamp.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+using namespace lvr2;
+
+ChunkLoadScheduler::ChunkLoadScheduler(Job job, size_t num_threads) : m_job(job), m_stop(false)
+{
+    if(num_threads == 0)
+    {
+        unsigned int hardware_threads = std::thread::hardware_concurrency();
+        num_threads = hardware_threads > 1 ? hardware_threads - 1 : 1;
+    }
+
+    for(size_t i = 0; i < num_threads; ++i)
+    {
+        m_threads.emplace_back(&ChunkLoadScheduler::work, this);
+    }
+}
+
+ChunkLoadScheduler::~ChunkLoadScheduler()
+{
+    stop();
+}
+
+void ChunkLoadScheduler::stop()
+{
+    std::unique_lock<std::mutex> l(m_mutex);
+    m_stop = true;
+    m_queue = decltype(m_queue)();
+    l.unlock();
+    m_cond.notify_all();
+
+    for(auto& thread : m_threads)
+    {
+        if(thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    m_idleCond.notify_all();
+}
+
+void ChunkLoadScheduler::schedule(const std::vector<Request>& requests)
+{
+    std::unique_lock<std::mutex> l(m_mutex);
+    m_queue = decltype(m_queue)();
+    if(m_stop)
+    {
+        return;
+    }
+    for(const Request& request : requests)
+    {
+        if(m_running.find(request.second) == m_running.end())
+        {
+            m_queue.push(request);
+        }
+    }
+    bool idle = m_queue.empty() && m_running.empty();
+    l.unlock();
+
+    m_cond.notify_all();
+    if(idle)
+    {
+        m_idleCond.notify_all();
+    }
+}
+
+void ChunkLoadScheduler::cancel()
+{
+    schedule(std::vector<Request>());
+}
+
+void ChunkLoadScheduler::wait()
+{
+    std::unique_lock<std::mutex> l(m_mutex);
+    m_idleCond.wait(l, [this] { return m_queue.empty() && m_running.empty(); });
+}
+
+size_t ChunkLoadScheduler::numPending() const
+{
+    std::lock_guard<std::mutex> l(m_mutex);
+    return m_queue.size();
+}
+
+void ChunkLoadScheduler::work()
+{
+    while(true)
+    {
+        std::unique_lock<std::mutex> l(m_mutex);
+        m_cond.wait(l, [this] { return m_stop || !m_queue.empty(); });
+        if(m_stop)
+        {
+            return;
+        }
+
+        size_t id = m_queue.top().second;
+        m_queue.pop();
+        m_running.insert(id);
+        l.unlock();
+
+        // exceptions must not leave the worker thread
+        try
+        {
+            m_job(id);
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << timestamp << "ChunkLoadScheduler: Failed to process chunk " << id << ": "
+                      << e.what() << std::endl;
+        }
+        catch(...)
+        {
+            std::cerr << timestamp << "ChunkLoadScheduler: Failed to process chunk " << id
+                      << std::endl;
+        }
+
+        l.lock();
+        m_running.erase(id);
+        bool idle = m_queue.empty() && m_running.empty();
+        l.unlock();
+
+        if(idle)
+        {
+            m_idleCond.notify_all();
+        }
+    }
+}
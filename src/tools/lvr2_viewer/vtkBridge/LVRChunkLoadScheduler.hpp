@@ -0,0 +1,104 @@
+#ifndef LVR2_CHUNK_LOAD_SCHEDULER_HPP_
+#define LVR2_CHUNK_LOAD_SCHEDULER_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace lvr2 {
+
+template <typename T>
+class CompareDistancePair
+{
+
+    public:
+        bool operator()(std::pair<float,T> p1, std::pair<float,T> p2)
+        {
+            return p1.first > p2.first;
+        }
+};
+
+/**
+ * @brief Worker pool that processes chunk requests in the order of their priority.
+ *
+ * Requests are pairs of priority and chunk id, smaller priorities are processed first.
+ * Every call of schedule replaces all pending requests, so requests of an outdated view are
+ * cancelled before they are started. Chunks that are currently processed are not scheduled
+ * again. The scheduler does not depend on VTK or Qt and can be used without a display.
+ */
+class ChunkLoadScheduler
+{
+    public:
+        using Job = std::function<void(size_t)>;
+        using Request = std::pair<float, size_t>;
+
+        /**
+         * @brief Starts the worker threads
+         *
+         * @param job function called with the id of every processed chunk. Runs concurrently
+         *            in the worker threads
+         * @param num_threads number of worker threads, 0 uses all but one hardware thread
+         */
+        ChunkLoadScheduler(Job job, size_t num_threads = 0);
+
+        /**
+         * @brief Calls stop()
+         */
+        ~ChunkLoadScheduler();
+
+        ChunkLoadScheduler(const ChunkLoadScheduler&) = delete;
+        ChunkLoadScheduler& operator=(const ChunkLoadScheduler&) = delete;
+
+        /**
+         * @brief Replaces all pending requests with the given ones
+         */
+        void schedule(const std::vector<Request>& requests);
+
+        /**
+         * @brief Cancels all pending requests. Running jobs are finished
+         */
+        void cancel();
+
+        /**
+         * @brief Blocks until no request is pending or running
+         */
+        void wait();
+
+        /**
+         * @brief Cancels all pending requests, lets the running jobs finish and joins the
+         * worker threads. Later requests are ignored. Calling it again has no effect.
+         */
+        void stop();
+
+        /**
+         * @brief Returns the number of requests that have not been started yet
+         */
+        size_t numPending() const;
+
+        /**
+         * @brief Returns the number of worker threads
+         */
+        size_t numThreads() const { return m_threads.size(); }
+
+    private:
+        void work();
+
+        Job m_job;
+        std::vector<std::thread> m_threads;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::condition_variable m_idleCond;
+        std::priority_queue<Request, std::vector<Request>, CompareDistancePair<size_t> > m_queue;
+        std::unordered_set<size_t> m_running;
+        bool m_stop;
+};
+
+} // namespace lvr2
+
+#endif
@@ -18,32 +18,50 @@
 #include <vtkPolyDataMapper.h>
 
 
+#include <algorithm>
 #include <chrono>
-#include <queue>
 using namespace lvr2;
 
 
-LVRChunkedMeshBridge::LVRChunkedMeshBridge(std::string file, vtkSmartPointer<vtkRenderer> renderer, std::vector<std::string> layers, size_t cache_size) : m_chunkManager(file, cache_size), m_renderer(renderer), m_layers(layers), m_cacheSize(cache_size)
+LVRChunkedMeshBridge::LVRChunkedMeshBridge(std::string file, vtkSmartPointer<vtkRenderer> renderer, std::vector<std::string> layers, size_t cache_size, size_t num_threads) : m_chunkManager(file, cache_size), m_renderer(renderer), m_layers(layers), m_cacheSize(cache_size)
 {
     getNew_ = false;
     running_ = true;
+    m_scheduler = std::make_unique<ChunkLoadScheduler>(
+            [this](size_t id) { buildHighResActor(id); }, num_threads);
     worker = std::thread(&LVRChunkedMeshBridge::highResWorker, this);
 
 }
 
+LVRChunkedMeshBridge::~LVRChunkedMeshBridge()
+{
+    std::unique_lock<std::mutex> l(mutex);
+    running_ = false;
+    l.unlock();
+    cond_.notify_all();
+    worker.join();
+
+    // join the workers before the chunks and actors they use are destroyed.
+    // The workers still use m_scheduler until they are joined, so it is only
+    // released afterwards.
+    m_scheduler->stop();
+    m_scheduler.reset();
+}
 
 void LVRChunkedMeshBridge::highResWorker()
 {
-    while(running_)
+    while(true)
     {
        std::unique_lock<std::mutex> l(mutex);
-       while(!getNew_) 
+       cond_.wait(l, [this] { return getNew_ || !running_; });
+       if(!running_)
        {
-           cond_.wait(l);
+           return;
        }
        getNew_ = false;
        std::vector<size_t> visible_indices = m_highResIndices;
        std::vector<BaseVector<float> > visible_centroids = m_highResCentroids;
+       BaseVector<float> eye = m_eye;
        // delta for new fetch
        // basically prevents an endless loop of reloads.
        BaseVector<float> diff = m_region.getCentroid() - m_lastRegion.getCentroid();
@@ -53,179 +71,175 @@ void LVRChunkedMeshBridge::highResWorker()
            continue;
        }
        m_lastRegion = m_region;
+       BaseVector<float> center = m_region.getCentroid();
        l.unlock();
 
-       // Needed for consistency for underlying buffers of actors.
-       // see below.
-       auto old_highRes = m_highRes;
-       m_highRes.clear();
+       std::unordered_set<size_t> wanted(visible_indices.begin(), visible_indices.end());
 
-       // check if there is only one layer.
-       // if yes use the chunks from the "lowRes" layer.
-       if(m_layers.size() > 1)
+       // Cache: keep the previous chunks closest to the centroid of the current
+       // region until the cache is full.
+       size_t numCopy = m_cacheSize > visible_indices.size() ? m_cacheSize - visible_indices.size() : 0;
+       typedef std::pair<float, size_t> IndexPair;
+       std::vector<IndexPair> cached;
+       for(size_t i = 0; i < m_lastIndices.size(); ++i)
        {
-            m_chunkManager.extractArea(m_region, m_highRes, m_layers[0]);
+           if(wanted.find(m_lastIndices[i]) == wanted.end())
+           {
+               cached.push_back({m_lastCentroids[i].distance(center), i});
+           }
        }
-       else
+       if(cached.size() > numCopy)
        {
-            for(auto& index : visible_indices)
-            {
-                m_highRes.insert({index, m_chunks[index]});
-            }
+           std::nth_element(cached.begin(), cached.begin() + numCopy, cached.end());
+           cached.resize(numCopy);
        }
 
-       // Consistency for underlying buffers of actors.
-       // The chunkmanagers may have loaded new meshbuffers while we use old ones
-       // Use the old ones otherwise we need to rebuild and copy the actors.
-       // New ones are ignored in that case.
-       for(auto& it : m_highRes)
+       std::vector<size_t> last_indices = visible_indices;
+       std::vector<BaseVector<float> > last_centroids = visible_centroids;
+       for(const IndexPair& it : cached)
        {
-           if(old_highRes.find(it.first) != old_highRes.end())
-           {
-               m_highRes.at(it.first) = old_highRes.at(it.first);
-               // TODO Not clearing may result in duplicates.
-               //old_highRes.erase(it.first);
-           }
+           wanted.insert(m_lastIndices[it.second]);
+           last_indices.push_back(m_lastIndices[it.second]);
+           last_centroids.push_back(m_lastCentroids[it.second]);
        }
-        
-       // This should be a cache based on 2 queues 
-       // and the distance of the centroids of the chunk to the current frustum centroid.
-       size_t numCopy =  m_cacheSize - m_highResIndices.size();
-       if(numCopy > 0)
+       m_lastIndices.swap(last_indices);
+       m_lastCentroids.swap(last_centroids);
+
+       // Drop the actors that left the cache and request the visible chunks without
+       // an actor. The priority is the inverse of the projected size of the chunk, so
+       // near and large chunks are converted first.
+       actorMap remove_actors;
+       std::vector<ChunkLoadScheduler::Request> requests;
        {
-           // This is the caching based on the distance of the centroids
-           // to the centroids from the current visible region.
-           // ALL this is far from optimal.
-           typedef std::pair<float, size_t> IndexPair;
-           typedef std::pair<float, BaseVector<float> > CentroidPair;
-           std::priority_queue<IndexPair, std::vector<IndexPair>, CompareDistancePair<size_t> > index_queue;
-           std::priority_queue<CentroidPair, std::vector<CentroidPair>, CompareDistancePair<BaseVector<float> > > centroid_queue;
-           BaseVector<float> center = m_region.getCentroid();
-           if(m_lastCentroids.size() > 0)
+           std::lock_guard<std::mutex> lock(m_actorMutex);
+           m_wanted = wanted;
+           for(auto it = m_highResActors.begin(); it != m_highResActors.end();)
            {
-               float distance = m_lastCentroids[0].distance(center);
-               index_queue.push({distance, m_lastIndices[0]});
-               centroid_queue.push({distance, m_lastCentroids[0]});
-               for(size_t i = 1; i < m_lastCentroids.size(); ++i)
+               if(wanted.find(it->first) == wanted.end())
                {
-
-                   float distance = m_lastCentroids[i].distance(center);
-                   if(index_queue.size() < numCopy)
+                   // actors that were not sent yet are unknown to the main thread
+                   if(m_newActors.erase(it->first) == 0)
                    {
-                       centroid_queue.push({distance, m_lastCentroids[i]});
-                       index_queue.push({distance, m_lastIndices[i]});
-                   }
-                   else if(index_queue.top().first > distance)
-                   {
-                       index_queue.pop();
-                       index_queue.push({distance, m_lastIndices[i]});
-                       centroid_queue.pop();
-                       centroid_queue.push({distance, m_lastCentroids[i]});
+                       remove_actors.insert(*it);
                    }
+                   it = m_highResActors.erase(it);
+               }
+               else
+               {
+                   ++it;
                }
            }
 
-           m_lastIndices.clear();
-           m_lastCentroids.clear();
-
-           // add current visible to cache
            for(size_t i = 0; i < visible_indices.size(); ++i)
            {
-                m_lastIndices.push_back(visible_indices[i]);
-                m_lastCentroids.push_back(visible_centroids[i]);
-            
+               size_t id = visible_indices[i];
+               if(m_highResActors.find(id) != m_highResActors.end())
+               {
+                   continue;
+               }
+
+               float extent = m_chunkManager.getChunkSize();
+               auto extentIt = m_chunkExtents.find(id);
+               if(extentIt != m_chunkExtents.end() && extentIt->second > 0.0f)
+               {
+                   extent = extentIt->second;
+               }
+               requests.push_back({visible_centroids[i].distance(eye) / extent, id});
            }
-            
-           // Build new cache.
-           while(!index_queue.empty())
+
+           // emitted with the lock held, so the main thread gets the updates in the
+           // order of the changes to m_highResActors.
+           if(!remove_actors.empty())
            {
-                size_t index = index_queue.top().second;
-                // here is the error it maybe already present in highres
-                //  and deleted from old_highres....
-                index_queue.pop();
-                m_highRes.insert({index, old_highRes[index]});
-                m_lastIndices.push_back(index);
-                auto centroid = centroid_queue.top().second;
-                centroid_queue.pop();
-                m_lastCentroids.push_back(centroid);
+               Q_EMIT updateHighRes(remove_actors, actorMap());
            }
        }
 
-       // compute and copy actors
-       std::unordered_map<size_t, vtkSmartPointer<vtkActor>> tmp_highResActors;
-       for(auto it = m_highRes.begin(); it != m_highRes.end(); ++it)
-       { 
-           auto chunk = *it;
-           size_t id = chunk.first;
-           lvr2::MeshBufferPtr meshbuffer = chunk.second;
+       // replaces the requests of the previous view that have not been started.
+       m_scheduler->schedule(requests);
 
-           if(m_highResActors.find(id) == m_highResActors.end())
-           {
-               tmp_highResActors.insert({id, computeMeshActor(id, meshbuffer)});
-           }
-           else
-           {
-               tmp_highResActors.insert({id, m_highResActors[id]});
-           }
-       }
+       // the cancelled requests may have held back the last batch.
+       std::lock_guard<std::mutex> lock(m_actorMutex);
+       sendHighResActors(true);
+    }
 
+}
 
-       // add highres dummies because their maybe lowres chunks
-       // which do not exist in the highres map
-       for(auto& it: visible_indices)
-       {
-            if(tmp_highResActors.find(it) == tmp_highResActors.end())
-            {
-                auto mptr = MeshBufferPtr();
-                tmp_highResActors.insert({it, computeMeshActor(it, mptr)});
-            }
-       }
+void LVRChunkedMeshBridge::buildHighResActor(size_t id)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_actorMutex);
+        if(m_wanted.find(id) == m_wanted.end() || m_highResActors.find(id) != m_highResActors.end())
+        {
+            sendHighResActors(false);
+            return;
+        }
+    }
 
-       // Syncing with main thread.
-       actorMap remove_actors;
-       actorMap new_actors;
-       for(auto& it: m_highResActors)
-       {
-           if(tmp_highResActors.find(it.first) == tmp_highResActors.end())
-           {
-               //vtkSmartPointer<vtkActor> copy = vtkSmartPointer<vtkActor>::New();
-               //it.second->ShallowCopy(copy);
-               remove_actors.insert({it.first, it.second});
-           }
-       }
+    // check if there is only one layer.
+    // if yes use the chunks from the "lowRes" layer.
+    MeshBufferPtr chunk;
+    if(m_layers.size() > 1)
+    {
+        std::lock_guard<std::mutex> lock(m_chunkMutex);
+        BaseVector<int> index = m_chunkManager.getChunkIndex(id);
+        boost::optional<MeshBufferPtr> loaded
+            = m_chunkManager.getChunk<MeshBufferPtr>(m_layers[0], index.x, index.y, index.z);
+        if(loaded)
+        {
+            chunk = *loaded;
+        }
+    }
+    else
+    {
+        auto it = m_chunks.find(id);
+        if(it != m_chunks.end())
+        {
+            chunk = it->second;
+        }
+    }
 
-       for(auto& it: tmp_highResActors)
-       {
-           if(m_highResActors.find(it.first) == m_highResActors.end())
-           { 
-               //vtkSmartPointer<vtkActor> copy = vtkSmartPointer<vtkActor>::New();
-               //it.second->ShallowCopy(copy);
-               new_actors.insert({it.first, it.second});
-           }
-       }
+    // Chunks without high resolution data get an empty actor, because there
+    // may be lowres chunks which do not exist in the highres layer.
+    // The chunk manager may evict the loaded chunk from its cache,
+    // so the actor needs its own copy of the vertices.
+    vtkSmartPointer<vtkActor> actor = computeMeshActor(id, chunk, m_layers.size() > 1);
+
+    std::lock_guard<std::mutex> lock(m_actorMutex);
+    if(m_wanted.find(id) != m_wanted.end())
+    {
+        m_highResActors.insert({id, actor});
+        m_newActors.insert({id, actor});
+    }
+    sendHighResActors(false);
+}
 
-       Q_EMIT updateHighRes(remove_actors, new_actors);
-//       while(!release)
-//       {
-//            mw_cond.wait(main_lock);
-//       }
-       m_highResActors = tmp_highResActors; 
-       old_highRes.clear();
-       release = false;
-//       l.unlock();
+void LVRChunkedMeshBridge::sendHighResActors(bool force)
+{
+    // Every update renders the scene once, so the actors are sent in batches.
+    // The last batch is sent once no request is pending anymore.
+    if(m_newActors.empty())
+    {
+        return;
     }
 
+    if(force || m_newActors.size() >= m_highResBatchSize || m_scheduler->numPending() == 0)
+    {
+        Q_EMIT updateHighRes(actorMap(), m_newActors);
+        m_newActors.clear();
+    }
 }
 
 void LVRChunkedMeshBridge::fetchHighRes(BoundingBox<BaseVector<float> > bb,
                                         std::vector<size_t> indices,
-                                        std::vector<BaseVector<float> > centroids)
+                                        std::vector<BaseVector<float> > centroids,
+                                        BaseVector<float> eye)
 {
-    // FUCKING SYNCHRONIZATION
     std::unique_lock<std::mutex> l(mutex);
     m_region = bb;
     m_highResIndices = indices;
     m_highResCentroids = centroids;
+    m_eye = eye;
     getNew_ = true;
     l.unlock();
     cond_.notify_all();
@@ -300,6 +314,7 @@ void LVRChunkedMeshBridge::addInitialActors(vtkSmartPointer<vtkRenderer> rendere
 
         BoundingBox<BaseVector<float> > chunk_bb(v1, v2);
         centroids.push_back(chunk_bb.getCentroid());
+        m_chunkExtents.insert({chunk.first, v1.distance(v2)});
     }
     
     m_oct = std::make_unique<MeshOctree<BaseVector<float> >> (m_chunkManager.getChunkSize(),
@@ -347,7 +362,7 @@ void LVRChunkedMeshBridge::computeMeshActors()
     std::cout << lvr2::timestamp << "Done actor computation" << std::endl;
 }
 
-vtkSmartPointer<vtkActor> LVRChunkedMeshBridge::computeMeshActor(size_t& id, MeshBufferPtr& meshbuffer)
+vtkSmartPointer<vtkActor> LVRChunkedMeshBridge::computeMeshActor(size_t& id, MeshBufferPtr& meshbuffer, bool copy_data)
 {
 
     vtkSmartPointer<vtkActor> meshActor = vtkSmartPointer<vtkActor>::New();
@@ -369,7 +384,15 @@ vtkSmartPointer<vtkActor> LVRChunkedMeshBridge::computeMeshActor(size_t& id, Mes
         vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
         vtkSmartPointer<vtkFloatArray> pts_data = vtkSmartPointer<vtkFloatArray>::New();
         pts_data->SetNumberOfComponents(3);
-        pts_data->SetVoidArray(meshbuffer->getVertices().get(), n_v * 3, 1);
+        if(copy_data)
+        {
+            pts_data->SetNumberOfTuples(n_v);
+            std::copy(vertices.get(), vertices.get() + n_v * 3, pts_data->GetPointer(0));
+        }
+        else
+        {
+            pts_data->SetVoidArray(meshbuffer->getVertices().get(), n_v * 3, 1);
+        }
         points->SetData(pts_data);
 
 
@@ -18,7 +18,11 @@
 #include "lvr2/geometry/BoundingBox.hpp"
 #include "lvr2/display/MeshOctree.hpp"
 
+#include "LVRChunkLoadScheduler.hpp"
+
+#include <memory>
 #include <string>
+#include <unordered_set>
 
 //#include "MeshChunkActor.hpp"
 
@@ -51,24 +55,14 @@ Q_DECLARE_METATYPE(actorMap)
 //#include <GL/glx.h>
 namespace lvr2 {
 
-template <typename T>
-class CompareDistancePair
-{
-
-    public:
-        bool operator()(std::pair<float,T> p1, std::pair<float,T> p2)
-        {
-            return p1.first > p2.first;
-        }
-};
-
-
     class LVRChunkedMeshBridge : public QObject
     {
         Q_OBJECT
         public:
             LVRChunkedMeshBridge(std::string file, vtkSmartPointer<vtkRenderer> renderer,
-                                 std::vector<std::string> layers, size_t cache_size = 1000);
+                                 std::vector<std::string> layers, size_t cache_size = 1000,
+                                 size_t num_threads = 0);
+            ~LVRChunkedMeshBridge();
             void getActors(double planes[24],
                     std::vector<BaseVector<float> >& centroids, 
                     std::vector<size_t >& indices);
@@ -77,14 +71,37 @@ class CompareDistancePair
             std::condition_variable mw_cond;
             bool release = false;
 
-            std::unordered_map<size_t, vtkSmartPointer<vtkActor>> getHighResActors() { return m_highResActors; }
+            std::unordered_map<size_t, vtkSmartPointer<vtkActor>> getHighResActors()
+            {
+                // only the actors that were sent to the main thread
+                std::lock_guard<std::mutex> lock(m_actorMutex);
+                actorMap actors = m_highResActors;
+                for(auto& it : m_newActors)
+                {
+                    actors.erase(it.first);
+                }
+                return actors;
+            }
             std::unordered_map<size_t, vtkSmartPointer<vtkActor>> getLowResActors()  { return m_chunkActors;   }
                     //std::unordered_map<size_t, vtkSmartPointer<vtkActor> >& actors);
             void addInitialActors(vtkSmartPointer<vtkRenderer> renderer);
 
+            /**
+             * @brief Requests the high resolution chunks of the given area.
+             *
+             * The chunks are loaded and converted by a worker pool, chunks that appear large
+             * on the screen first. Chunks of previous requests that have not been started
+             * are cancelled.
+             *
+             * @param bb area of the high resolution chunks
+             * @param indices visible chunks in the area
+             * @param centroids centroids of the visible chunks
+             * @param eye position of the camera
+             */
             void fetchHighRes(BoundingBox<BaseVector<float > > bb,
                               std::vector<size_t> indices,
-                              std::vector<BaseVector<float>> centroids);
+                              std::vector<BaseVector<float>> centroids,
+                              BaseVector<float> eye);
 
             double getHighResDistance() {return m_highResDistance; }
 
@@ -94,7 +111,20 @@ class CompareDistancePair
 
         protected:
             void computeMeshActors();
-            inline vtkSmartPointer<vtkActor> computeMeshActor(size_t& id, MeshBufferPtr& chunk);
+            inline vtkSmartPointer<vtkActor> computeMeshActor(size_t& id, MeshBufferPtr& chunk,
+                                                              bool copy_data = false);
+
+            /**
+             * @brief Loads a high resolution chunk and converts it to an actor. Runs in the
+             * worker pool.
+             */
+            void buildHighResActor(size_t id);
+
+            /**
+             * @brief Sends the finished high resolution actors to the main thread once the
+             * batch is full or no request is pending. Requires m_actorMutex.
+             */
+            void sendHighResActors(bool force);
 
         private:
             vtkSmartPointer<vtkRenderer> m_renderer;
@@ -107,6 +137,7 @@ class CompareDistancePair
             bool running_;
             BoundingBox<BaseVector<float> > m_region;
             BoundingBox<BaseVector<float> > m_lastRegion;
+            BaseVector<float> m_eye;
             // Maybe use 2 maps.
             std::vector<size_t> m_highResIndices;
             std::vector<BaseVector<float> > m_highResCentroids;
@@ -118,11 +149,24 @@ class CompareDistancePair
             void highResWorker();
             lvr2::ChunkManager m_chunkManager;
             std::unordered_map<size_t, MeshBufferPtr> m_chunks;
-            std::unordered_map<size_t, MeshBufferPtr> m_highRes;
             std::unordered_map<size_t, vtkSmartPointer<vtkActor> > m_chunkActors;
+            // diagonal of the bounding box of every chunk
+            std::unordered_map<size_t, float> m_chunkExtents;
+
+            // guards the chunk manager, which is used by all workers
+            std::mutex m_chunkMutex;
+
+            // guards the high resolution actors and the chunks that are still wanted.
+            // updateHighRes is only emitted with this lock held.
+            std::mutex m_actorMutex;
             std::unordered_map<size_t, vtkSmartPointer<vtkActor> > m_highResActors;
+            std::unordered_set<size_t> m_wanted;
+            // finished actors that were not sent to the main thread yet
+            actorMap m_newActors;
+            const size_t m_highResBatchSize = 16;
 
             std::unique_ptr<MeshOctree<BaseVector<float> > > m_oct;
+            std::unique_ptr<ChunkLoadScheduler> m_scheduler;
     };
     typedef boost::shared_ptr<LVRChunkedMeshBridge> ChunkedMeshBridgePtr;
 
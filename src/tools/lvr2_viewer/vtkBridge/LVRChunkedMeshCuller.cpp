@@ -83,7 +83,8 @@ namespace lvr2{
         //highResArea.expand(eye + (perp * 100.0));
         //highResArea.expand(eye + (perp * ((-1) * 100.0)));
 
-        m_bridge->fetchHighRes(highResArea, indices2, centroids2);
+        BaseVector<float> eye(position[0], position[1], position[2]);
+        m_bridge->fetchHighRes(highResArea, indices2, centroids2, eye);
 
         //vtkActorCollection* actors = ren->GetActors();
         //actors->InitTraversal();